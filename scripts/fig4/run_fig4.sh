@@ -7,11 +7,36 @@ set -e
 GIT_ROOT=$(git rev-parse --show-toplevel)
 SUMMARY_FILE="$GIT_ROOT/scripts/fig4/pandas_summary.txt"
 
+# Function to print usage
+usage() {
+    echo "Usage: $0 [-t] [-c]"
+    echo "  - -t splits lineitem.tbl with tbl_converter instead of split_lineitem.py."
+    echo "  - -c compresses the columns with one table_compression process instead of iaa_lineitem_compression per column."
+    exit 1
+}
+
+# The figure was measured with split_lineitem.py and iaa_lineitem_compression; the faster tools are opt-in
+USE_TBL_CONVERTER=0
+USE_TABLE_COMPRESSION=0
+while getopts "tc" opt; do
+    case "$opt" in
+        t) USE_TBL_CONVERTER=1 ;;
+        c) USE_TABLE_COMPRESSION=1 ;;
+        *) usage ;;
+    esac
+done
+
 # Move to pandas evaluation directory
 cd "$GIT_ROOT/src/end_to_end/pandas"
 
-# Run split_lineitem.py
-python3 split_lineitem.py "$GIT_ROOT/data/tpc_h_data/lineitem.tbl" "$GIT_ROOT/data/lineitem/" >"$SUMMARY_FILE"
+if [[ "$USE_TBL_CONVERTER" -eq 1 ]]; then
+    # Split lineitem.tbl into column binaries (same output as split_lineitem.py, parsed in parallel)
+    bash iaa_tbl_converter.sh
+    ./tbl_converter "$GIT_ROOT/data/tpc_h_data/lineitem.tbl" "$GIT_ROOT/data/lineitem/" >"$SUMMARY_FILE"
+else
+    # Run split_lineitem.py
+    python3 split_lineitem.py "$GIT_ROOT/data/tpc_h_data/lineitem.tbl" "$GIT_ROOT/data/lineitem/" >"$SUMMARY_FILE"
+fi
 
 # Ensure iaa_preprocess.sh is executable
 if [[ ! -x "iaa_preprocess.sh" ]]; then
@@ -21,11 +46,18 @@ fi
 # Run iaa_preprocess.sh
 ./iaa_preprocess.sh
 
-# Run iaa_lineitem_compression with all .tbl files
 mkdir -p "$GIT_ROOT/data/lineitem/iaa_compressed/"
-for tbl_file in "$GIT_ROOT/data/lineitem/"*.bin; do
-    ./iaa_lineitem_compression hardware_path "$GIT_ROOT/data/lineitem/" "$(basename "$tbl_file")" "$GIT_ROOT/data/lineitem/iaa_compressed/" 2 > "$SUMMARY_FILE"
-done
+if [[ "$USE_TABLE_COMPRESSION" -eq 1 ]]; then
+    # Compress all column binaries in one pass over every IAA device.
+    # --huffman=dynamic keeps the per-chunk Huffman tables iaa_lineitem_compression builds by default (table_compression defaults to canned)
+    bash iaa_table_compression.sh
+    ./table_compression hardware_path "$GIT_ROOT/data/lineitem/" "$GIT_ROOT/data/lineitem/iaa_compressed/" 64 --huffman=dynamic > "$SUMMARY_FILE"
+else
+    # Run iaa_lineitem_compression with all .tbl files
+    for tbl_file in "$GIT_ROOT/data/lineitem/"*.bin; do
+        ./iaa_lineitem_compression hardware_path "$GIT_ROOT/data/lineitem/" "$(basename "$tbl_file")" "$GIT_ROOT/data/lineitem/iaa_compressed/" 2 > "$SUMMARY_FILE"
+    done
+fi
 echo "End-End (Pandas) Test Summary - $(date)" > "$SUMMARY_FILE"
 echo "=====================================" >> "$SUMMARY_FILE"
 
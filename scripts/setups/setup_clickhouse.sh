@@ -23,6 +23,21 @@ git submodule update --init --recursive
 
 # Copy custom CMakeLists.txt
 cp "$GIT_REPO_DIR/src/end_to_end/clickhouse/clickhouse.cpp" "$GIT_REPO_DIR/ClickHouse/src/Compression/CompressionCodecDeflateQpl.cpp"
+cp "$GIT_REPO_DIR/src/end_to_end/clickhouse/clickhouse.h" "$GIT_REPO_DIR/ClickHouse/src/Compression/CompressionCodecDeflateQpl.h"
+
+# Export the codec metrics in system.asynchronous_metrics
+sed -i -e '0,/^#include/ s//#include "config.h"\n#if USE_QPL\n#include <Compression\/CompressionCodecDeflateQpl.h>\n#endif\n&/' \
+       -e '/^void ServerAsynchronousMetrics::updateImpl(/,/^{$/ s/^{$/{\n#if USE_QPL\n    DeflateQplMetrics::updateAsynchronousMetrics(new_values);\n#endif/' \
+       src/Interpreters/ServerAsynchronousMetrics.cpp
+grep -q "DeflateQplMetrics::updateAsynchronousMetrics" src/Interpreters/ServerAsynchronousMetrics.cpp
+
+# Run merges and mutations in the background priority class of the codec's job pool
+for task in MergeTask MutateTask; do
+    sed -i -e '0,/^#include/ s//#include "config.h"\n#if USE_QPL\n#include <Compression\/CompressionCodecDeflateQpl.h>\n#endif\n&/' \
+           -e "/^bool ${task}::execute()\$/,/^{\$/ s/^{\$/{\n#if USE_QPL\n    DeflateQplJobHWPool::PriorityScope deflate_qpl_priority(DeflateQplJobHWPool::Priority::Background);\n#endif/" \
+           "src/Storages/MergeTree/${task}.cpp"
+    grep -q "DeflateQplJobHWPool::PriorityScope" "src/Storages/MergeTree/${task}.cpp"
+done
 
 # Configure the build with CMake
 cmake -D CMAKE_C_COMPILER=/usr/bin/clang-18 \
@@ -4,11 +4,22 @@
 #include <Poco/Logger.h>
 #include <Common/MemorySanitizer.h>
 #include <Common/logger_useful.h>
-#include <Common/randomSeed.h>
 #include <base/scope_guard.h>
 #include <base/getPageSize.h>
+#include <base/unaligned.h>
+#include <algorithm>
+#include <bit>
 #include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <queue>
 #include <thread>
+#include <unordered_set>
+#include <sched.h>
+#include <sys/mman.h>
 
 #if USE_QPL
 
@@ -24,6 +35,198 @@ namespace ErrorCodes
     extern const int CANNOT_DECOMPRESS;
 }
 
+/// Names in DeflateQplMetrics::Counter and DeflateQplMetrics::Histogram order
+static const char * const metric_counter_names[] = {
+    "HardwareCompressions", "HardwareDecompressions", "AsyncCompressSubmissions", "AsyncDecompressSubmissions",
+    "SoftwareCompressions", "SoftwareDecompressions", "FallbackNoHardware", "FallbackPoolExhausted", "FallbackSubmitFailed",
+    "FallbackJobFailed", "CompressedBytesIn", "CompressedBytesOut", "DecompressedBytesIn", "DecompressedBytesOut",
+    "PrefaultedDestinations", "PoolWaitNanoseconds", "DictionaryCompressions", "DictionaryDecompressions"};
+static const char * const metric_histogram_names[] = {
+    "HardwareCompressLatency", "HardwareDecompressLatency", "AsyncCompressLatency", "AsyncDecompressLatency", "PoolWaitLatency"};
+static_assert(std::size(metric_counter_names) == DeflateQplMetrics::COUNTERS);
+static_assert(std::size(metric_histogram_names) == DeflateQplMetrics::HISTOGRAMS);
+
+DeflateQplMetrics & DeflateQplMetrics::instance()
+{
+    static DeflateQplMetrics metrics;
+    return metrics;
+}
+
+DeflateQplMetrics::ThreadSlotHolder::~ThreadSlotHolder()
+{
+    if (slot)
+    {
+        auto & metrics = DeflateQplMetrics::instance();
+        std::lock_guard lock(metrics.slots_mutex);
+        metrics.free_slots.push_back(slot);
+    }
+}
+
+DeflateQplMetrics::ThreadSlot & DeflateQplMetrics::threadSlot()
+{
+    static thread_local ThreadSlotHolder holder;
+    if (!holder.slot)
+    {
+        auto & metrics = DeflateQplMetrics::instance();
+        std::lock_guard lock(metrics.slots_mutex);
+        if (!metrics.free_slots.empty())
+        {
+            holder.slot = metrics.free_slots.back();
+            metrics.free_slots.pop_back();
+        }
+        else
+            holder.slot = metrics.slots.emplace_back(std::make_unique<ThreadSlot>()).get();
+    }
+    return *holder.slot;
+}
+
+void DeflateQplMetrics::add(Counter counter, UInt64 value)
+{
+    auto & cell = threadSlot().counters[static_cast<size_t>(counter)];
+    cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void DeflateQplMetrics::observe(Histogram histogram, UInt64 nanoseconds)
+{
+    const size_t bucket = std::min<size_t>(nanoseconds ? std::bit_width(nanoseconds) - 1 : 0, HISTOGRAM_BUCKETS - 1);
+    auto & cell = threadSlot().histograms[static_cast<size_t>(histogram)][bucket];
+    cell.store(cell.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+UInt64 DeflateQplMetrics::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+DeflateQplMetrics::Snapshot DeflateQplMetrics::getSnapshot() const
+{
+    Snapshot snapshot;
+    std::lock_guard lock(slots_mutex);
+    for (const auto & slot : slots)
+    {
+        for (size_t i = 0; i < COUNTERS; ++i)
+            snapshot.counters[i] += slot->counters[i].load(std::memory_order_relaxed);
+        for (size_t h = 0; h < HISTOGRAMS; ++h)
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b)
+                snapshot.histograms[h][b] += slot->histograms[h][b].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+const char * DeflateQplMetrics::getName(Counter counter)
+{
+    return metric_counter_names[static_cast<size_t>(counter)];
+}
+
+const char * DeflateQplMetrics::getName(Histogram histogram)
+{
+    return metric_histogram_names[static_cast<size_t>(histogram)];
+}
+
+UInt64 DeflateQplMetrics::Snapshot::count(Histogram histogram) const
+{
+    UInt64 total = 0;
+    for (UInt64 bucket_count : histograms[static_cast<size_t>(histogram)])
+        total += bucket_count;
+    return total;
+}
+
+UInt64 DeflateQplMetrics::Snapshot::quantile(Histogram histogram, double q) const
+{
+    const UInt64 total = count(histogram);
+    if (total == 0)
+        return 0;
+    const auto rank = static_cast<UInt64>(q * static_cast<double>(total - 1)) + 1;
+    UInt64 seen = 0;
+    const auto & buckets = histograms[static_cast<size_t>(histogram)];
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b)
+    {
+        seen += buckets[b];
+        if (seen >= rank)
+            return (UInt64{2} << b) - 1;
+    }
+    return std::numeric_limits<UInt64>::max();
+}
+
+void DeflateQplMetrics::Snapshot::forEach(const std::function<void(const std::string & name, UInt64 value)> & callback) const
+{
+    for (size_t i = 0; i < COUNTERS; ++i)
+        callback(std::string("DeflateQpl") + metric_counter_names[i], counters[i]);
+    for (size_t h = 0; h < HISTOGRAMS; ++h)
+    {
+        const std::string name = std::string("DeflateQpl") + metric_histogram_names[h];
+        const auto histogram = static_cast<Histogram>(h);
+        callback(name + "Count", count(histogram));
+        callback(name + "P50", quantile(histogram, 0.5));
+        callback(name + "P99", quantile(histogram, 0.99));
+    }
+}
+
+void DeflateQplMetrics::updateAsynchronousMetrics(AsynchronousMetricValues & new_values)
+{
+    const Snapshot snapshot = instance().getSnapshot();
+    for (size_t i = 0; i < COUNTERS; ++i)
+        new_values[std::string("DeflateQpl") + metric_counter_names[i]]
+            = {snapshot.counters[i], "Counter of the DEFLATE_QPL codec since server start, see DeflateQplMetrics::Counter."};
+    for (size_t h = 0; h < HISTOGRAMS; ++h)
+    {
+        const std::string name = std::string("DeflateQpl") + metric_histogram_names[h];
+        const auto histogram = static_cast<Histogram>(h);
+        new_values[name + "Count"] = {snapshot.count(histogram), "Latencies of the DEFLATE_QPL codec recorded since server start."};
+        new_values[name + "P50"] = {snapshot.quantile(histogram, 0.5), "Upper bound in nanoseconds of the bucket holding the median latency."};
+        new_values[name + "P99"] = {snapshot.quantile(histogram, 0.99), "Upper bound in nanoseconds of the bucket holding the 99th percentile latency."};
+    }
+}
+
+/// NUMA node of each CPU, parsed from /sys/devices/system/node/node<N>/cpulist ("0-15,32-47"). Empty without NUMA information.
+static std::vector<Int32> readCpuNumaNodes()
+{
+    std::vector<Int32> cpu_numa_nodes;
+    std::error_code ec;
+    for (const auto & entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+            continue;
+        const Int32 numa_node = static_cast<Int32>(std::stoi(name.substr(4)));
+        std::ifstream cpulist(entry.path() / "cpulist");
+        std::string range;
+        while (std::getline(cpulist, range, ','))
+        {
+            if (range.empty() || range[0] < '0' || range[0] > '9')
+                continue;
+            const size_t dash = range.find('-');
+            const size_t first = std::stoul(range.substr(0, dash));
+            const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            if (cpu_numa_nodes.size() <= last)
+                cpu_numa_nodes.resize(last + 1, -1);
+            for (size_t cpu = first; cpu <= last; ++cpu)
+                cpu_numa_nodes[cpu] = numa_node;
+        }
+    }
+    return cpu_numa_nodes;
+}
+
+/// A node with unknown NUMA placement is local to every thread, and every node is local to a thread on an unknown CPU.
+static bool isLocalNode(Int32 pool_numa_node, Int32 numa_node)
+{
+    return pool_numa_node < 0 || numa_node < 0 || pool_numa_node == numa_node;
+}
+
+/// Priority class of the jobs the thread acquires, set by DeflateQplJobHWPool::PriorityScope
+static thread_local DeflateQplJobHWPool::Priority thread_priority = DeflateQplJobHWPool::Priority::Foreground;
+
+DeflateQplJobHWPool::PriorityScope::PriorityScope(Priority priority)
+    : previous(thread_priority)
+{
+    thread_priority = priority;
+}
+
+DeflateQplJobHWPool::PriorityScope::~PriorityScope()
+{
+    thread_priority = previous;
+}
+
 DeflateQplJobHWPool & DeflateQplJobHWPool::instance()
 {
     static DeflateQplJobHWPool pool;
@@ -32,12 +235,11 @@ DeflateQplJobHWPool & DeflateQplJobHWPool::instance()
 
 DeflateQplJobHWPool::DeflateQplJobHWPool()
     : max_hw_jobs(0)
-    , random_engine(randomSeed())
 {
     LoggerPtr log = getLogger("DeflateQplJobHWPool");
     const char * qpl_version = qpl_get_library_version();
 
-    // loop all configured workqueue size to get maximum job number.
+    // loop all configured workqueue size to get maximum job number, grouping the devices by NUMA node.
     accfg_ctx * ctx_ptr = nullptr;
     auto ctx_status = accfg_new(&ctx_ptr);
     SCOPE_EXIT({ accfg_unref(ctx_ptr); });
@@ -46,8 +248,26 @@ DeflateQplJobHWPool::DeflateQplJobHWPool()
         auto * dev_ptr = accfg_device_get_first(ctx_ptr);
         while (dev_ptr != nullptr)
         {
+            UInt32 device_jobs = 0;
             for (auto * wq_ptr = accfg_wq_get_first(dev_ptr); wq_ptr != nullptr; wq_ptr = accfg_wq_get_next(wq_ptr))
-                max_hw_jobs += accfg_wq_get_size(wq_ptr);
+                device_jobs += accfg_wq_get_size(wq_ptr);
+            if (device_jobs > 0)
+            {
+                const Int32 numa_node = accfg_device_get_numa_node(dev_ptr);
+                auto it = std::find_if(node_pools.begin(), node_pools.end(), [&](const auto & node) { return node->numa_node == numa_node; });
+                if (it == node_pools.end())
+                {
+                    node_pools.push_back(std::make_unique<NodePool>());
+                    node_pools.back()->numa_node = numa_node;
+                    it = std::prev(node_pools.end());
+                }
+                NodePool & node = **it;
+                if (!node.devices.empty())
+                    node.devices += ",";
+                node.devices += accfg_device_get_devname(dev_ptr);
+                node.size += device_jobs;
+                max_hw_jobs += device_jobs;
+            }
             dev_ptr = accfg_device_get_next(dev_ptr);
         }
     }
@@ -64,12 +284,40 @@ DeflateQplJobHWPool::DeflateQplJobHWPool()
         LOG_WARNING(log, "Initialization of hardware-assisted DeflateQpl codec failed, falling back to software DeflateQpl codec. Failed to get available workqueue size -> total_wq_size: {}, QPL Version: {}.", max_hw_jobs, qpl_version);
         return;
     }
-    distribution = std::uniform_int_distribution<int>(0, max_hw_jobs - 1);
+    /// DEFLATE_QPL_ACQUIRE_WAIT_US: how long compression and synchronous decompression wait for a free hardware job
+    /// before falling back to software, 0 falls back at once. DEFLATE_QPL_MAX_WAITERS: threads allowed to wait together.
+    max_waiters = max_hw_jobs;
+    if (const char * wait_us = std::getenv("DEFLATE_QPL_ACQUIRE_WAIT_US"))
+        acquire_wait_budget = std::chrono::microseconds(std::strtoull(wait_us, nullptr, 10));
+    if (const char * waiters_env = std::getenv("DEFLATE_QPL_MAX_WAITERS"))
+        max_waiters = static_cast<UInt32>(std::strtoul(waiters_env, nullptr, 10));
+    /// DEFLATE_QPL_PRIORITY_CLASSES: 0 puts every thread in the foreground class. DEFLATE_QPL_BACKGROUND_MAX_PERCENT: share
+    /// of the jobs background work may hold, the rest is reserved for foreground work. DEFLATE_QPL_FOREGROUND_SHARE: jobs
+    /// handed to queued foreground threads for each one handed to a queued background thread.
+    UInt32 background_percent = 75;
+    if (const char * classes_env = std::getenv("DEFLATE_QPL_PRIORITY_CLASSES"))
+        priority_classes_enabled = std::strtoul(classes_env, nullptr, 10) != 0;
+    if (const char * percent_env = std::getenv("DEFLATE_QPL_BACKGROUND_MAX_PERCENT"))
+        background_percent = std::min<UInt32>(static_cast<UInt32>(std::strtoul(percent_env, nullptr, 10)), 100);
+    if (const char * share_env = std::getenv("DEFLATE_QPL_FOREGROUND_SHARE"))
+        foreground_share = std::max<UInt32>(static_cast<UInt32>(std::strtoul(share_env, nullptr, 10)), 1);
+    priorityClass(Priority::Foreground).limit = max_hw_jobs;
+    priorityClass(Priority::Background).limit = std::max<UInt32>(static_cast<UInt32>(UInt64{max_hw_jobs} * background_percent / 100), 1);
+
+    UInt32 first_index = 0;
+    for (const auto & node : node_pools)
+    {
+        node->first_index = first_index;
+        first_index += node->size;
+    }
+    cpu_numa_nodes = readCpuNumaNodes();
+
     /// Get size required for saving a single qpl job object
     qpl_get_job_size(qpl_path_hardware, &per_job_size);
     /// Allocate job buffer pool for storing all job objects
     hw_jobs_buffer = std::make_unique<uint8_t[]>(per_job_size * max_hw_jobs);
-    hw_job_ptr_locks = std::make_unique<std::atomic_bool[]>(max_hw_jobs);
+    free_next = std::make_unique<std::atomic<UInt32>[]>(max_hw_jobs);
+    job_priority = std::make_unique<Priority[]>(max_hw_jobs);
     /// Initialize all job objects in job buffer pool
     for (UInt32 index = 0; index < max_hw_jobs; ++index)
     {
@@ -80,43 +328,74 @@ DeflateQplJobHWPool::DeflateQplJobHWPool()
             LOG_WARNING(log, "Initialization of hardware-assisted DeflateQpl codec failed, falling back to software DeflateQpl codec. Failed to Initialize qpl job -> status: {}, QPL Version: {}.", static_cast<UInt32>(status), qpl_version);
             return;
         }
-        unLockJob(index);
+        ++initialized_jobs;
+        pushFreeJob(index);
     }
 
     job_pool_ready = true;
-    LOG_DEBUG(log, "Hardware-assisted DeflateQpl codec is ready! QPL Version: {}, max_hw_jobs: {}",qpl_version, max_hw_jobs);
+    LOG_DEBUG(log, "Hardware-assisted DeflateQpl codec is ready! QPL Version: {}, max_hw_jobs: {}, acquire wait budget: {} us, max waiters: {}, "
+              "priority classes: {} (background limit: {} jobs, foreground share: {})",
+              qpl_version, max_hw_jobs, acquire_wait_budget.count(), max_waiters, priority_classes_enabled,
+              priorityClass(Priority::Background).limit, foreground_share);
+    for (const auto & node : node_pools)
+        LOG_DEBUG(log, "DeflateQpl NUMA node {}: devices {}, {} jobs", node->numa_node, node->devices, node->size);
 }
 
 DeflateQplJobHWPool::~DeflateQplJobHWPool()
 {
-    for (UInt32 i = 0; i < max_hw_jobs; ++i)
+    /// Every initialized job is finalized once it is back on the free list.
+    for (UInt32 finalized = 0; finalized < initialized_jobs;)
     {
-        qpl_job * job_ptr = reinterpret_cast<qpl_job *>(hw_jobs_buffer.get() + i * per_job_size);
-        while (!tryLockJob(i));
-        qpl_fini_job(job_ptr);
-        unLockJob(i);
+        UInt32 index = 0;
+        if (!popFreeJob(index, -1))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        qpl_fini_job(reinterpret_cast<qpl_job *>(hw_jobs_buffer.get() + index * per_job_size));
+        ++finalized;
     }
     job_pool_ready = false;
 }
 
-qpl_job * DeflateQplJobHWPool::acquireJob(UInt32 & job_id)
+qpl_job * DeflateQplJobHWPool::acquireJob(UInt32 & job_id, bool wait)
 {
     if (isJobPoolReady())
     {
-        UInt32 retry = 0;
-        UInt32 index = distribution(random_engine);
-        while (!tryLockJob(index))
+        UInt32 index = 0;
+        const Int32 numa_node = currentNumaNode();
+        const Priority priority = currentPriority();
+        PriorityClass & priority_class = priorityClass(priority);
+        /// Waiting callers do not overtake threads of their class or a higher one already in the admission queue.
+        if ((!wait || !hasWaitersAhead(priority)) && popClassFreeJob(index, priority, numa_node))
+            acquired_immediate.fetch_add(1, std::memory_order_relaxed);
+        else if (!wait || acquire_wait_budget.count() == 0)
         {
-            index = distribution(random_engine);
-            retry++;
-            if (retry > max_hw_jobs)
-            {
-                return nullptr;
-            }
+            /// Every hardware job of the class is in flight: the caller falls back to software.
+            fallback_no_wait.fetch_add(1, std::memory_order_relaxed);
+            priority_class.fallbacks.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else if (!waitForJob(index, priority, numa_node))
+        {
+            priority_class.fallbacks.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
         }
         job_id = max_hw_jobs - index;
         assert(index < max_hw_jobs);
-        return reinterpret_cast<qpl_job *>(hw_jobs_buffer.get() + index * per_job_size);
+        job_priority[index] = priority;
+        priority_class.acquired.fetch_add(1, std::memory_order_relaxed);
+
+        NodePool & node = nodeOfJob(index);
+        node.in_use.fetch_add(1, std::memory_order_relaxed);
+        if (isLocalNode(node.numa_node, numa_node))
+            node.acquired_local.fetch_add(1, std::memory_order_relaxed);
+        else
+            node.acquired_remote.fetch_add(1, std::memory_order_relaxed);
+        auto * job_ptr = reinterpret_cast<qpl_job *>(hw_jobs_buffer.get() + index * per_job_size);
+        /// QPL submits the job to a device on this node, -1 lets it pick the node of the calling thread.
+        job_ptr->numa_id = node.numa_node;
+        return job_ptr;
     }
     else
         return nullptr;
@@ -125,20 +404,474 @@ qpl_job * DeflateQplJobHWPool::acquireJob(UInt32 & job_id)
 void DeflateQplJobHWPool::releaseJob(UInt32 job_id)
 {
     if (isJobPoolReady())
-        unLockJob(max_hw_jobs - job_id);
+    {
+        const UInt32 index = max_hw_jobs - job_id;
+        nodeOfJob(index).in_use.fetch_sub(1, std::memory_order_relaxed);
+        priorityClass(job_priority[index]).in_use.fetch_sub(1, std::memory_order_relaxed);
+        pushFreeJob(index);
+        /// Pairs with the fence in waitForJob: either the new waiter finds this job on the free list or this sees the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard lock(waiters_mutex);
+            handOverFreeJobs();
+        }
+    }
 }
 
-bool DeflateQplJobHWPool::tryLockJob(UInt32 index)
+bool DeflateQplJobHWPool::waitForJob(UInt32 & index, Priority priority, Int32 numa_node)
 {
-    bool expected = false;
-    assert(index < max_hw_jobs);
-    return hw_job_ptr_locks[index].compare_exchange_strong(expected, true);
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock lock(waiters_mutex);
+    PriorityClass & priority_class = priorityClass(priority);
+    if (waiting.load(std::memory_order_relaxed) >= max_waiters)
+    {
+        fallback_queue_full.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    JobWaiter waiter;
+    waiter.numa_node = numa_node;
+    priority_class.waiters.push_back(&waiter);
+    priority_class.waiting.fetch_add(1, std::memory_order_relaxed);
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    /// A job released before this thread was queued is still on the free list.
+    handOverFreeJobs();
+    waiter.cv.wait_until(lock, start + acquire_wait_budget, [&] { return waiter.granted; });
+    priority_class.waiting.fetch_sub(1, std::memory_order_relaxed);
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+    const auto wait_ns = static_cast<UInt64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    total_wait_us.fetch_add(wait_ns / 1000, std::memory_order_relaxed);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::PoolWaitNanoseconds, wait_ns);
+    DeflateQplMetrics::observe(DeflateQplMetrics::Histogram::PoolWaitLatency, wait_ns);
+    if (!waiter.granted)
+    {
+        priority_class.waiters.erase(std::find(priority_class.waiters.begin(), priority_class.waiters.end(), &waiter));
+        fallback_budget_expired.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    index = waiter.index;
+    acquired_after_wait.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DeflateQplJobHWPool::handOverFreeJobs()
+{
+    while (true)
+    {
+        /// While both classes wait, every foreground_share hand-overs to foreground are followed by one to background,
+        /// so a stream of foreground reads cannot starve merges completely.
+        const bool background_turn = foreground_served >= foreground_share && !priorityClass(Priority::Background).waiters.empty();
+        const Priority first = background_turn ? Priority::Background : Priority::Foreground;
+        const Priority second = background_turn ? Priority::Foreground : Priority::Background;
+        if (handOverFreeJob(first))
+            foreground_served = first == Priority::Foreground ? foreground_served + 1 : 0;
+        else if (handOverFreeJob(second))
+            foreground_served = second == Priority::Foreground ? foreground_served + 1 : 0;
+        else
+            return;
+    }
+}
+
+bool DeflateQplJobHWPool::handOverFreeJob(Priority priority)
+{
+    auto & waiters = priorityClass(priority).waiters;
+    if (waiters.empty())
+        return false;
+    UInt32 index = 0;
+    JobWaiter * waiter = waiters.front();
+    if (!popClassFreeJob(index, priority, waiter->numa_node))
+        return false;
+    waiters.pop_front();
+    waiter->index = index;
+    waiter->granted = true;
+    waiter->cv.notify_one();
+    return true;
+}
+
+DeflateQplJobHWPool::Priority DeflateQplJobHWPool::currentPriority() const
+{
+    return priority_classes_enabled ? thread_priority : Priority::Foreground;
+}
+
+bool DeflateQplJobHWPool::popClassFreeJob(UInt32 & index, Priority priority, Int32 numa_node)
+{
+    PriorityClass & priority_class = priorityClass(priority);
+    /// The slot is taken before the job, so concurrent acquires of the class never exceed its limit together.
+    if (priority_class.in_use.fetch_add(1, std::memory_order_relaxed) < priority_class.limit && popFreeJob(index, numa_node))
+        return true;
+    priority_class.in_use.fetch_sub(1, std::memory_order_relaxed);
+    return false;
 }
 
-void DeflateQplJobHWPool::unLockJob(UInt32 index)
+bool DeflateQplJobHWPool::hasWaitersAhead(Priority priority) const
+{
+    for (size_t i = 0; i <= static_cast<size_t>(priority); ++i)
+        if (priority_classes[i].waiting.load(std::memory_order_relaxed) > 0)
+            return true;
+    return false;
+}
+
+DeflateQplJobHWPool::AcquireCounters DeflateQplJobHWPool::getAcquireCounters() const
+{
+    AcquireCounters counters;
+    counters.immediate = acquired_immediate.load(std::memory_order_relaxed);
+    counters.after_wait = acquired_after_wait.load(std::memory_order_relaxed);
+    counters.budget_expired = fallback_budget_expired.load(std::memory_order_relaxed);
+    counters.queue_full = fallback_queue_full.load(std::memory_order_relaxed);
+    counters.no_wait = fallback_no_wait.load(std::memory_order_relaxed);
+    counters.wait_us = total_wait_us.load(std::memory_order_relaxed);
+    return counters;
+}
+
+std::vector<DeflateQplJobHWPool::ClassUtilization> DeflateQplJobHWPool::getClassUtilization() const
+{
+    std::vector<ClassUtilization> utilization;
+    for (size_t i = 0; i < PRIORITIES; ++i)
+    {
+        ClassUtilization & entry = utilization.emplace_back();
+        entry.priority = static_cast<Priority>(i);
+        entry.limit = priority_classes[i].limit;
+        entry.in_use = priority_classes[i].in_use.load(std::memory_order_relaxed);
+        entry.acquired = priority_classes[i].acquired.load(std::memory_order_relaxed);
+        entry.fallbacks = priority_classes[i].fallbacks.load(std::memory_order_relaxed);
+    }
+    return utilization;
+}
+
+std::vector<DeflateQplJobHWPool::NodeUtilization> DeflateQplJobHWPool::getNodeUtilization() const
+{
+    std::vector<NodeUtilization> utilization;
+    for (const auto & node : node_pools)
+    {
+        NodeUtilization & entry = utilization.emplace_back();
+        entry.numa_node = node->numa_node;
+        entry.devices = node->devices;
+        entry.jobs = node->size;
+        entry.in_use = node->in_use.load(std::memory_order_relaxed);
+        entry.acquired_local = node->acquired_local.load(std::memory_order_relaxed);
+        entry.acquired_remote = node->acquired_remote.load(std::memory_order_relaxed);
+    }
+    return utilization;
+}
+
+Int32 DeflateQplJobHWPool::currentNumaNode() const
+{
+    const int cpu = sched_getcpu();
+    if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_numa_nodes.size())
+        return -1;
+    return cpu_numa_nodes[cpu];
+}
+
+bool DeflateQplJobHWPool::popFreeJob(UInt32 & index, Int32 numa_node)
+{
+    /// Remote nodes only when every job of the local ones is in flight
+    for (const auto & node : node_pools)
+        if (isLocalNode(node->numa_node, numa_node) && popNodeFreeJob(*node, index))
+            return true;
+    for (const auto & node : node_pools)
+        if (!isLocalNode(node->numa_node, numa_node) && popNodeFreeJob(*node, index))
+            return true;
+    return false;
+}
+
+DeflateQplJobHWPool::NodePool & DeflateQplJobHWPool::nodeOfJob(UInt32 index) const
+{
+    for (const auto & node : node_pools)
+        if (index - node->first_index < node->size)
+            return *node;
+    assert(false);
+    return *node_pools.front();
+}
+
+bool DeflateQplJobHWPool::popNodeFreeJob(NodePool & node, UInt32 & index)
+{
+    auto & free_head = node.free_head;
+    UInt64 head = free_head.load(std::memory_order_acquire);
+    while (true)
+    {
+        index = static_cast<UInt32>(head);
+        if (index == EMPTY_INDEX)
+            return false;
+        assert(index < max_hw_jobs);
+        /// free_next[index] may already be rewritten by a concurrent pop and push of the same job; the tag makes the
+        /// exchange fail in that case.
+        const UInt64 next_head = (((head >> 32) + 1) << 32) | free_next[index].load(std::memory_order_relaxed);
+        if (free_head.compare_exchange_weak(head, next_head, std::memory_order_acquire, std::memory_order_acquire))
+            return true;
+    }
+}
+
+void DeflateQplJobHWPool::pushFreeJob(UInt32 index)
 {
     assert(index < max_hw_jobs);
-    hw_job_ptr_locks[index].store(false);
+    auto & free_head = nodeOfJob(index).free_head;
+    UInt64 head = free_head.load(std::memory_order_relaxed);
+    while (true)
+    {
+        free_next[index].store(static_cast<UInt32>(head), std::memory_order_relaxed);
+        const UInt64 next_head = (((head >> 32) + 1) << 32) | index;
+        /// Release: the next owner of the job sees everything written to it before this push.
+        if (free_head.compare_exchange_weak(head, next_head, std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
+}
+
+/// DEFLATE_QPL_WAIT_STRATEGY values, in DeflateQplJobWaiter::Strategy order
+static constexpr const char * wait_strategy_names[] = {"spin", "tpause", "yield", "blocking", "qpl_wait"};
+
+DeflateQplJobWaiter & DeflateQplJobWaiter::instance()
+{
+    static DeflateQplJobWaiter waiter;
+    return waiter;
+}
+
+DeflateQplJobWaiter::DeflateQplJobWaiter()
+{
+    LoggerPtr log = getLogger("DeflateQplJobWaiter");
+    if (const char * name = std::getenv("DEFLATE_QPL_WAIT_STRATEGY"))
+    {
+        const auto * it = std::find_if(std::begin(wait_strategy_names), std::end(wait_strategy_names),
+                                       [&](const char * known) { return std::strcmp(name, known) == 0; });
+        if (it != std::end(wait_strategy_names))
+            strategy = static_cast<Strategy>(it - std::begin(wait_strategy_names));
+        else
+            LOG_WARNING(log, "Unknown DEFLATE_QPL_WAIT_STRATEGY '{}', using tpause. Valid values: spin, tpause, yield, blocking, qpl_wait.", name);
+    }
+
+    if (strategy == Strategy::Blocking)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const UInt64 start_cycles = __rdtsc();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1))
+            _mm_pause();
+        const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        tsc_per_ns = static_cast<double>(__rdtsc() - start_cycles) / static_cast<double>(elapsed_ns);
+    }
+    LOG_DEBUG(log, "DeflateQpl completion wait strategy: {}, TSC cycles per ns: {}", wait_strategy_names[static_cast<size_t>(strategy)], tsc_per_ns);
+}
+
+void DeflateQplJobWaiter::pauseFor(UInt64 cycles) const
+{
+    switch (strategy)
+    {
+        case Strategy::Spin:
+            _mm_pause();
+            return;
+        case Strategy::TPause:
+            _tpause(1, __rdtsc() + cycles);
+            return;
+        case Strategy::Yield:
+            std::this_thread::yield();
+            return;
+        case Strategy::Blocking:
+            std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<UInt64>(static_cast<double>(cycles) / tsc_per_ns)));
+            return;
+        case Strategy::QplWait:
+            return;
+    }
+}
+
+qpl_status DeflateQplJobWaiter::wait(qpl_job * job_ptr, UInt32 bytes)
+{
+    const UInt64 start = __rdtsc();
+    qpl_status status = QPL_STS_BEING_PROCESSED;
+    UInt64 n_polls = 1;
+    if (strategy == Strategy::QplWait)
+        status = qpl_wait_job(job_ptr);
+    else
+    {
+        /// The first pause ends at 3/4 of the expected duration, so a shorter job still pulls the average down.
+        UInt64 window = static_cast<UInt64>(bytes) * cycles_per_kb.load(std::memory_order_relaxed) / 1024 * 3 / 4;
+        while ((status = qpl_check_job(job_ptr)) == QPL_STS_BEING_PROCESSED)
+        {
+            const UInt64 elapsed = __rdtsc() - start;
+            pauseFor(window > elapsed + SHORT_WINDOW_CYCLES ? window - elapsed : SHORT_WINDOW_CYCLES);
+            window = 0;
+            n_polls++;
+        }
+    }
+    const UInt64 cycles = __rdtsc() - start;
+
+    if (status == QPL_STS_OK && bytes >= 1024)
+    {
+        const UInt64 observed = cycles * 1024 / bytes;
+        const UInt64 expected = cycles_per_kb.load(std::memory_order_relaxed);
+        cycles_per_kb.store(expected ? (expected * 7 + observed) / 8 : observed, std::memory_order_relaxed);
+    }
+    waits.fetch_add(1, std::memory_order_relaxed);
+    polls.fetch_add(n_polls, std::memory_order_relaxed);
+    wait_cycles.fetch_add(cycles, std::memory_order_relaxed);
+    return status;
+}
+
+void DeflateQplJobWaiter::pause(qpl_job * job_ptr)
+{
+    const UInt64 start = __rdtsc();
+    if (strategy == Strategy::QplWait)
+        qpl_wait_job(job_ptr);
+    else
+        pauseFor(SHORT_WINDOW_CYCLES);
+    pauses.fetch_add(1, std::memory_order_relaxed);
+    wait_cycles.fetch_add(__rdtsc() - start, std::memory_order_relaxed);
+}
+
+DeflateQplJobWaiter::Counters DeflateQplJobWaiter::getCounters() const
+{
+    Counters counters;
+    counters.waits = waits.load(std::memory_order_relaxed);
+    counters.pauses = pauses.load(std::memory_order_relaxed);
+    counters.polls = polls.load(std::memory_order_relaxed);
+    counters.wait_cycles = wait_cycles.load(std::memory_order_relaxed);
+    return counters;
+}
+
+DeflateQplBufferPool::Buffer::Buffer(Buffer && other) noexcept
+    : ptr(std::exchange(other.ptr, nullptr))
+    , capacity(std::exchange(other.capacity, 0))
+{
+}
+
+DeflateQplBufferPool::Buffer & DeflateQplBufferPool::Buffer::operator=(Buffer && other) noexcept
+{
+    if (this != &other)
+    {
+        if (ptr)
+            DeflateQplBufferPool::instance().giveBack(ptr, capacity);
+        ptr = std::exchange(other.ptr, nullptr);
+        capacity = std::exchange(other.capacity, 0);
+    }
+    return *this;
+}
+
+DeflateQplBufferPool::Buffer::~Buffer()
+{
+    if (ptr)
+        DeflateQplBufferPool::instance().giveBack(ptr, capacity);
+}
+
+DeflateQplBufferPool & DeflateQplBufferPool::instance()
+{
+    static DeflateQplBufferPool pool;
+    return pool;
+}
+
+DeflateQplBufferPool::DeflateQplBufferPool()
+{
+    if (const char * pool_mb = std::getenv("DEFLATE_QPL_BUFFER_POOL_MB"))
+        max_bytes = static_cast<size_t>(std::strtoull(pool_mb, nullptr, 10)) * 1024 * 1024;
+    if (const char * huge = std::getenv("DEFLATE_QPL_BUFFER_HUGE_PAGES"))
+        huge_pages = std::strcmp(huge, "1") == 0;
+}
+
+DeflateQplBufferPool::~DeflateQplBufferPool()
+{
+    for (const auto & [start, capacity] : buffers)
+        munmap(reinterpret_cast<void *>(start), capacity);
+}
+
+char * DeflateQplBufferPool::mapBuffer(size_t capacity)
+{
+    void * ptr = MAP_FAILED;
+    if (huge_pages && capacity >= HUGE_PAGE_SIZE)
+        ptr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB, -1, 0);
+    /// Without reserved huge pages MAP_HUGETLB fails, the buffer then takes normal pages.
+    if (ptr == MAP_FAILED)
+        ptr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<char *>(ptr);
+}
+
+DeflateQplBufferPool::Buffer DeflateQplBufferPool::borrow(size_t size)
+{
+    borrows.fetch_add(1, std::memory_order_relaxed);
+    const size_t capacity = std::bit_ceil(std::max(size, MIN_BUFFER_SIZE));
+    const size_t size_class = std::countr_zero(capacity / MIN_BUFFER_SIZE);
+    if (capacity > max_bytes)
+    {
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    {
+        std::unique_lock lock(mutex);
+        if (size_class < free_buffers.size() && !free_buffers[size_class].empty())
+        {
+            char * ptr = free_buffers[size_class].back();
+            free_buffers[size_class].pop_back();
+            reuses.fetch_add(1, std::memory_order_relaxed);
+            return Buffer(ptr, capacity);
+        }
+
+        /// Drop free buffers of other sizes, largest first, till the new one fits under the cap.
+        for (size_t other_class = free_buffers.size(); other_class-- > 0 && mapped_bytes + capacity > max_bytes;)
+        {
+            auto & free_list = free_buffers[other_class];
+            while (!free_list.empty() && mapped_bytes + capacity > max_bytes)
+            {
+                const size_t other_capacity = MIN_BUFFER_SIZE << other_class;
+                munmap(free_list.back(), other_capacity);
+                buffers.erase(reinterpret_cast<uintptr_t>(free_list.back()));
+                free_list.pop_back();
+                mapped_bytes -= other_capacity;
+                unmaps.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (mapped_bytes + capacity > max_bytes)
+        {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        /// Reserved before mapping outside the lock, MAP_POPULATE faults in the whole buffer.
+        mapped_bytes += capacity;
+    }
+
+    char * ptr = mapBuffer(capacity);
+    std::unique_lock lock(mutex);
+    if (!ptr)
+    {
+        mapped_bytes -= capacity;
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+    buffers.emplace(reinterpret_cast<uintptr_t>(ptr), capacity);
+    maps.fetch_add(1, std::memory_order_relaxed);
+    return Buffer(ptr, capacity);
+}
+
+void DeflateQplBufferPool::giveBack(char * ptr, size_t capacity)
+{
+    const size_t size_class = std::countr_zero(capacity / MIN_BUFFER_SIZE);
+    std::unique_lock lock(mutex);
+    if (free_buffers.size() <= size_class)
+        free_buffers.resize(size_class + 1);
+    free_buffers[size_class].push_back(ptr);
+}
+
+bool DeflateQplBufferPool::isPrefaulted(const char * ptr, size_t size) const
+{
+    /// Most destinations are not pooled, a server that never borrowed skips the lock.
+    if (maps.load(std::memory_order_relaxed) == 0)
+        return false;
+    const auto address = reinterpret_cast<uintptr_t>(ptr);
+    std::shared_lock lock(mutex);
+    auto it = buffers.upper_bound(address);
+    if (it == buffers.begin())
+        return false;
+    --it;
+    return address + size <= it->first + it->second;
+}
+
+DeflateQplBufferPool::Counters DeflateQplBufferPool::getCounters() const
+{
+    Counters counters;
+    counters.borrows = borrows.load(std::memory_order_relaxed);
+    counters.reuses = reuses.load(std::memory_order_relaxed);
+    counters.maps = maps.load(std::memory_order_relaxed);
+    counters.unmaps = unmaps.load(std::memory_order_relaxed);
+    counters.exhausted = exhausted.load(std::memory_order_relaxed);
+    std::shared_lock lock(mutex);
+    counters.mapped_bytes = mapped_bytes;
+    return counters;
 }
 
 HardwareCodecDeflateQpl::HardwareCodecDeflateQpl(SoftwareCodecDeflateQpl & sw_codec_)
@@ -150,204 +883,648 @@ HardwareCodecDeflateQpl::HardwareCodecDeflateQpl(SoftwareCodecDeflateQpl & sw_co
 HardwareCodecDeflateQpl::~HardwareCodecDeflateQpl()
 {
 #ifndef NDEBUG
-    assert(decomp_async_job_map.empty());
+    assert(decomp_async_jobs.empty());
 #else
-    if (!decomp_async_job_map.empty())
+    if (!decomp_async_jobs.empty())
+    {
+        LOG_WARNING(log, "Find un-released job when HardwareCodecDeflateQpl destroy");
+        for (const auto & job : decomp_async_jobs)
+            DeflateQplJobHWPool::instance().releaseJob(job.job_id);
+        decomp_async_jobs.clear();
+    }
+#endif
+#ifndef NDEBUG
+    assert(comp_async_requests.empty());
+#else
+    if (!comp_async_requests.empty())
+    {
+        LOG_WARNING(log, "Find un-released compression job when HardwareCodecDeflateQpl destroy");
+        for (const auto & request : comp_async_requests)
+            DeflateQplJobHWPool::instance().releaseJob(request.job_id);
+        comp_async_requests.clear();
+    }
+#endif
+}
+
+static void setCompressJob(qpl_job * job_ptr, const char * source, UInt32 source_size, char * dest, UInt32 dest_size,
+                           const DeflateQplDictionary * dictionary = nullptr)
+{
+    if (source_size <= 2*1024*1024 && dest_size > 2*1024*1024) {
+        dest_size = 2*1024*1024;
+    }
+
+    job_ptr->op = qpl_op_compress;
+    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
+    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
+    job_ptr->available_in = source_size;
+    job_ptr->level = qpl_default_level;
+    job_ptr->available_out = dest_size;
+    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+    /// Jobs are reused, a plain block must not inherit the dictionary of the previous one.
+    job_ptr->dictionary = dictionary ? dictionary->get() : nullptr;
+}
+
+static void setDecompressJob(qpl_job * job_ptr, const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size,
+                             const DeflateQplDictionary * dictionary = nullptr)
+{
+    job_ptr->op = qpl_op_decompress;
+    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
+    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
+    job_ptr->available_in = source_size;
+    job_ptr->available_out = uncompressed_size;
+    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    job_ptr->dictionary = dictionary ? dictionary->get() : nullptr;
+}
+
+/// A dictionary job that IAA refuses at submission will be refused again, its later blocks skip the hardware.
+static void noteDictionarySubmitFailure(const DeflateQplDictionary * dictionary)
+{
+    if (dictionary)
+        dictionary->hardware.store(false, std::memory_order_relaxed);
+}
+
+void HardwareCodecDeflateQpl::logAcquireFallback(const char * caller) const
+{
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackPoolExhausted);
+    const auto counters = DeflateQplJobHWPool::instance().getAcquireCounters();
+    LOG_INFO(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: {}->acquireJob fail, no hardware job freed within the wait budget. "
+             "Acquired immediately/after wait: {}/{}, fell back after the budget/with a full queue/without waiting: {}/{}/{}, waited {} us in total)",
+             caller, counters.immediate, counters.after_wait, counters.budget_expired, counters.queue_full, counters.no_wait, counters.wait_us);
+}
+
+Int32 HardwareCodecDeflateQpl::doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size,
+                                              const DeflateQplDictionary * dictionary) const
+{
+    UInt32 job_id = 0;
+    qpl_job * job_ptr = nullptr;
+    UInt32 compressed_size = 0;
+    if (!(job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id, /*wait=*/ true)))
+    {
+        logAcquireFallback("doCompressData");
+        return RET_ERROR;
+    }
+
+    setCompressJob(job_ptr, source, source_size, dest, dest_size, dictionary);
+
+    const UInt64 start = DeflateQplMetrics::now();
+    auto status = qpl_submit_job(job_ptr);
+    const bool submitted = status == QPL_STS_OK;
+    if (submitted)
+        status = DeflateQplJobWaiter::instance().wait(job_ptr, source_size);
+    else
+        noteDictionarySubmitFailure(dictionary);
+    if (status == QPL_STS_OK)
+    {
+        compressed_size = job_ptr->total_out;
+        DeflateQplJobHWPool::instance().releaseJob(job_id);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::HardwareCompressions);
+        DeflateQplMetrics::observe(DeflateQplMetrics::Histogram::HardwareCompressLatency, DeflateQplMetrics::now() - start);
+        return compressed_size;
+    }
+    else
     {
-        LOG_WARNING(log, "Find un-released job when HardwareCodecDeflateQpl destroy");
-        for (auto it : decomp_async_job_map)
-        {
-            DeflateQplJobHWPool::instance().releaseJob(it.first);
-        }
-        decomp_async_job_map.clear();
+        DeflateQplMetrics::add(submitted ? DeflateQplMetrics::Counter::FallbackJobFailed : DeflateQplMetrics::Counter::FallbackSubmitFailed);
+        LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doCompressData->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+        DeflateQplJobHWPool::instance().releaseJob(job_id);
+        return RET_ERROR;
     }
-#endif
 }
 
-Int32 HardwareCodecDeflateQpl::doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size) const
+Int32 HardwareCodecDeflateQpl::doCompressDataAsynchronous(const char * source, UInt32 source_size, char * dest, UInt32 dest_size, UInt32 request_id,
+                                                          const DeflateQplDictionary * dictionary)
 {
     UInt32 job_id = 0;
     qpl_job * job_ptr = nullptr;
-    UInt32 compressed_size = 0;
+    /// No waiting for a free job: the jobs this codec already holds are released only by its own flush.
     if (!(job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id)))
     {
-        LOG_INFO(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doCompressData->acquireJob fail, probably job pool exhausted)");
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackPoolExhausted);
+        LOG_INFO(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doCompressDataAsynchronous->acquireJob fail, probably job pool exhausted)");
         return RET_ERROR;
     }
 
-    if (source_size <= 2*1024*1024 && dest_size > 2*1024*1024) {
-        dest_size = 2*1024*1024;
-    }
-
-    job_ptr->op = qpl_op_compress;
-    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
-    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
-    job_ptr->available_in = source_size;
-    job_ptr->level = qpl_default_level;
-    job_ptr->available_out = dest_size;
-    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+    setCompressJob(job_ptr, source, source_size, dest, dest_size, dictionary);
 
-    if (auto status = qpl_execute_job(job_ptr); status == QPL_STS_OK)
+    const UInt64 submitted_ns = DeflateQplMetrics::now();
+    if (auto status = qpl_submit_job(job_ptr); status == QPL_STS_OK)
     {
-        compressed_size = job_ptr->total_out;
-        DeflateQplJobHWPool::instance().releaseJob(job_id);
-        return compressed_size;
+        comp_async_requests.push_back({job_id, job_ptr, request_id, source, source_size, dest, dest_size, dictionary, submitted_ns});
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::AsyncCompressSubmissions);
+        return job_id;
     }
     else
     {
-        LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doCompressData->qpl_execute_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackSubmitFailed);
+        noteDictionarySubmitFailure(dictionary);
         DeflateQplJobHWPool::instance().releaseJob(job_id);
+        LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doCompressDataAsynchronous->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
         return RET_ERROR;
     }
 }
 
-Int32 HardwareCodecDeflateQpl::doDecompressDataSynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size)
+void HardwareCodecDeflateQpl::flushAsynchronousCompressRequests(const std::function<void(UInt32, UInt32)> & on_compressed)
+{
+    while (!comp_async_requests.empty())
+    {
+        bool completed = false;
+        for (size_t i = 0; i < comp_async_requests.size();)
+        {
+            const AsyncCompressRequest request = comp_async_requests[i];
+            auto status = qpl_check_job(request.job_ptr);
+            if (status == QPL_STS_BEING_PROCESSED)
+            {
+                ++i;
+                continue;
+            }
+
+            UInt32 compressed_size = 0;
+            if (status == QPL_STS_OK)
+            {
+                compressed_size = request.job_ptr->total_out;
+                DeflateQplMetrics::add(DeflateQplMetrics::Counter::HardwareCompressions);
+                DeflateQplMetrics::observe(DeflateQplMetrics::Histogram::AsyncCompressLatency, DeflateQplMetrics::now() - request.submitted_ns);
+            }
+            else
+            {
+                DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackJobFailed);
+                LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: flushAsynchronousCompressRequests with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+            }
+            /// Erasing keeps the remaining jobs in submission order, so the oldest are checked first.
+            comp_async_requests.erase(comp_async_requests.begin() + i);
+            DeflateQplJobHWPool::instance().releaseJob(request.job_id);
+            if (status != QPL_STS_OK)
+                compressed_size = sw_codec.doCompressData(request.source, request.source_size, request.dest, request.dest_size, request.dictionary);
+            on_compressed(request.request_id, compressed_size);
+            completed = true;
+        }
+
+        if (!completed && !comp_async_requests.empty())
+            DeflateQplJobWaiter::instance().pause(comp_async_requests.front().job_ptr);
+    }
+}
+
+Int32 HardwareCodecDeflateQpl::doDecompressDataSynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size,
+                                                           const DeflateQplDictionary * dictionary)
 {
     UInt32 job_id = 0;
     qpl_job * job_ptr = nullptr;
     UInt32 decompressed_size = 0;
-    if (!(job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id)))
+    if (!(job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id, /*wait=*/ true)))
     {
-        LOG_INFO(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doDecompressDataSynchronous->acquireJob fail, probably job pool exhausted)");
+        logAcquireFallback("doDecompressDataSynchronous");
         return RET_ERROR;
     }
 
     // Performing a decompression operation
-    job_ptr->op = qpl_op_decompress;
-    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
-    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
-    job_ptr->available_in = source_size;
-    job_ptr->available_out = uncompressed_size;
-    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    setDecompressJob(job_ptr, source, source_size, dest, uncompressed_size, dictionary);
 
+    const UInt64 start = DeflateQplMetrics::now();
     auto status = qpl_submit_job(job_ptr);
     if (status != QPL_STS_OK)
     {
         DeflateQplJobHWPool::instance().releaseJob(job_id);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackSubmitFailed);
+        noteDictionarySubmitFailure(dictionary);
         LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doDecompressDataSynchronous->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
         return RET_ERROR;
     }
     /// Busy waiting till job complete.
-    do
-    {
-        _tpause(1, __rdtsc() + 1000);
-        status = qpl_check_job(job_ptr);
-    } while (status == QPL_STS_BEING_PROCESSED);
+    status = DeflateQplJobWaiter::instance().wait(job_ptr, source_size);
 
     if (status != QPL_STS_OK)
     {
         DeflateQplJobHWPool::instance().releaseJob(job_id);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackJobFailed);
         LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doDecompressDataSynchronous->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
         return RET_ERROR;
     }
 
     decompressed_size = job_ptr->total_out;
     DeflateQplJobHWPool::instance().releaseJob(job_id);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::HardwareDecompressions);
+    DeflateQplMetrics::observe(DeflateQplMetrics::Histogram::HardwareDecompressLatency, DeflateQplMetrics::now() - start);
     return decompressed_size;
 }
 
-Int32 HardwareCodecDeflateQpl::doDecompressDataAsynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size)
+Int32 HardwareCodecDeflateQpl::doDecompressDataAsynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size, UInt32 request_id,
+                                                            const DeflateQplDictionary * dictionary)
 {
     UInt32 job_id = 0;
     qpl_job * job_ptr = nullptr;
     if (!(job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id)))
     {
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackPoolExhausted);
         LOG_INFO(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doDecompressDataAsynchronous->acquireJob fail, probably job pool exhausted)");
         return RET_ERROR;
     }
 
     // Performing a decompression operation
-    job_ptr->op = qpl_op_decompress;
-    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
-    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
-    job_ptr->available_in = source_size;
-    job_ptr->available_out = uncompressed_size;
-    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    setDecompressJob(job_ptr, source, source_size, dest, uncompressed_size, dictionary);
 
+    const UInt64 submitted_ns = DeflateQplMetrics::now();
     if (auto status = qpl_submit_job(job_ptr); status == QPL_STS_OK)
     {
-        decomp_async_job_map.insert({job_id, job_ptr});
+        decomp_async_jobs.push_back({job_ptr, job_id, request_id, source, dest, source_size, uncompressed_size, dictionary, submitted_ns});
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::AsyncDecompressSubmissions);
         return job_id;
     }
     else
     {
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackSubmitFailed);
+        noteDictionarySubmitFailure(dictionary);
         DeflateQplJobHWPool::instance().releaseJob(job_id);
         LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: doDecompressDataAsynchronous->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
         return RET_ERROR;
     }
 }
 
+size_t HardwareCodecDeflateQpl::waitAsynchronousDecompressRequests(size_t min_completed)
+{
+    size_t n_jobs_completed = 0;
+    std::vector<AsyncDecompressJob> failed_jobs;
+    while (!decomp_async_jobs.empty() && n_jobs_completed < min_completed)
+    {
+        /// One pass checks every job in flight. Unfinished jobs are moved down over the finished ones, so the table stays dense
+        /// and in submission order.
+        size_t n_jobs_processing = 0;
+        for (const auto & job : decomp_async_jobs)
+        {
+            auto status = qpl_check_job(job.job_ptr);
+            if (status == QPL_STS_BEING_PROCESSED)
+            {
+                decomp_async_jobs[n_jobs_processing++] = job;
+                continue;
+            }
+            if (status == QPL_STS_OK)
+            {
+                DeflateQplMetrics::add(DeflateQplMetrics::Counter::HardwareDecompressions);
+                DeflateQplMetrics::observe(DeflateQplMetrics::Histogram::AsyncDecompressLatency, DeflateQplMetrics::now() - job.submitted_ns);
+            }
+            else
+            {
+                DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackJobFailed);
+                LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: flushAsynchronousDecompressRequests with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+                failed_jobs.push_back(job);
+            }
+            DeflateQplJobHWPool::instance().releaseJob(job.job_id);
+            n_jobs_completed++;
+        }
+        decomp_async_jobs.resize(n_jobs_processing);
+
+        /// The table is consistent again, a throwing software fallback leaves no released job in it.
+        for (const auto & job : failed_jobs)
+            sw_codec.doDecompressData(job.source, job.source_size, job.dest, job.uncompressed_size, job.dictionary);
+        failed_jobs.clear();
+
+        if (n_jobs_completed < min_completed && !decomp_async_jobs.empty())
+            DeflateQplJobWaiter::instance().pause(decomp_async_jobs.front().job_ptr);
+    }
+    return n_jobs_completed;
+}
+
 void HardwareCodecDeflateQpl::flushAsynchronousDecompressRequests()
 {
-    auto n_jobs_processing = decomp_async_job_map.size();
-    std::map<UInt32, qpl_job *>::iterator it = decomp_async_job_map.begin();
+    waitAsynchronousDecompressRequests(decomp_async_jobs.size());
+}
+
+std::optional<UInt32> HardwareCodecDeflateQpl::oldestAsynchronousDecompressRequest() const
+{
+    if (decomp_async_jobs.empty())
+        return {};
+    return decomp_async_jobs.front().request_id;
+}
+
+void HardwareCodecDeflateQpl::doCompressDataParallel(std::vector<SubStream> & streams)
+{
+    processSubStreams(streams, /*compress=*/ true);
+}
+
+void HardwareCodecDeflateQpl::doDecompressDataParallel(std::vector<SubStream> & streams)
+{
+    processSubStreams(streams, /*compress=*/ false);
+}
+
+void HardwareCodecDeflateQpl::processSubStreams(std::vector<SubStream> & streams, bool compress)
+{
+    struct SubStreamJob
+    {
+        qpl_job * job_ptr;
+        UInt32 job_id;
+        size_t stream;
+    };
+    std::vector<SubStreamJob> jobs;
+    std::vector<size_t> failed_streams;
+    jobs.reserve(streams.size());
 
-    while (n_jobs_processing)
+    /// No waiting for a free job: the jobs already taken for this block are released only below.
+    for (size_t i = 0; i < streams.size(); ++i)
     {
+        const auto & stream = streams[i];
         UInt32 job_id = 0;
-        qpl_job * job_ptr = nullptr;
-        job_id = it->first;
-        job_ptr = it->second;
-
-        auto status = qpl_check_job(job_ptr);
-        if (status == QPL_STS_BEING_PROCESSED)
+        qpl_job * job_ptr = DeflateQplJobHWPool::instance().acquireJob(job_id);
+        if (!job_ptr)
         {
-            it++;
+            DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackPoolExhausted);
+            failed_streams.push_back(i);
+            continue;
         }
+
+        if (compress)
+            setCompressJob(job_ptr, stream.source, stream.source_size, stream.dest, stream.dest_size);
+        else
+            setDecompressJob(job_ptr, stream.source, stream.source_size, stream.dest, stream.dest_size);
+
+        if (auto status = qpl_submit_job(job_ptr); status == QPL_STS_OK)
+            jobs.push_back({job_ptr, job_id, i});
         else
         {
-            if (status != QPL_STS_OK)
+            DeflateQplJobHWPool::instance().releaseJob(job_id);
+            DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackSubmitFailed);
+            LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: processSubStreams->qpl_submit_job with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+            failed_streams.push_back(i);
+        }
+    }
+
+    while (!jobs.empty())
+    {
+        size_t n_jobs_processing = 0;
+        for (const auto & job : jobs)
+        {
+            auto status = qpl_check_job(job.job_ptr);
+            if (status == QPL_STS_BEING_PROCESSED)
             {
-                sw_codec.doDecompressData(
-                    reinterpret_cast<const char * >(job_ptr->next_in_ptr),
-                    job_ptr->available_in,
-                    reinterpret_cast<char *>(job_ptr->next_out_ptr),
-                    job_ptr->available_out);
-                LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: flushAsynchronousDecompressRequests with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+                jobs[n_jobs_processing++] = job;
+                continue;
             }
-            it = decomp_async_job_map.erase(it);
-            DeflateQplJobHWPool::instance().releaseJob(job_id);
-            n_jobs_processing--;
-            if (n_jobs_processing <= 0)
-                break;
+            if (status == QPL_STS_OK)
+            {
+                streams[job.stream].result_size = job.job_ptr->total_out;
+                DeflateQplMetrics::add(compress ? DeflateQplMetrics::Counter::HardwareCompressions : DeflateQplMetrics::Counter::HardwareDecompressions);
+            }
+            else
+            {
+                DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackJobFailed);
+                LOG_WARNING(log, "DeflateQpl HW codec failed, falling back to SW codec. (Details: processSubStreams with error code: {} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)", static_cast<UInt32>(status));
+                failed_streams.push_back(job.stream);
+            }
+            DeflateQplJobHWPool::instance().releaseJob(job.job_id);
         }
 
-        if (it == decomp_async_job_map.end())
+        const bool completed = n_jobs_processing < jobs.size();
+        jobs.resize(n_jobs_processing);
+        if (!completed)
+            DeflateQplJobWaiter::instance().pause(jobs.front().job_ptr);
+    }
+
+    /// Every job is released, so a throwing software fallback leaks none.
+    for (size_t i : failed_streams)
+    {
+        auto & stream = streams[i];
+        if (compress)
+            stream.result_size = sw_codec.doCompressData(stream.source, stream.source_size, stream.dest, stream.dest_size);
+        else
         {
-            it = decomp_async_job_map.begin();
-            _tpause(1, __rdtsc() + 1000);
+            sw_codec.doDecompressData(stream.source, stream.source_size, stream.dest, stream.dest_size);
+            stream.result_size = stream.dest_size;
         }
     }
 }
 
-SoftwareCodecDeflateQpl::~SoftwareCodecDeflateQpl()
+DeflateQplDictionaryRegistry & DeflateQplDictionaryRegistry::instance()
+{
+    static DeflateQplDictionaryRegistry registry;
+    return registry;
+}
+
+DeflateQplDictionaryRegistry::DeflateQplDictionaryRegistry()
+{
+    if (const char * cache_mb = std::getenv("DEFLATE_QPL_DICTIONARY_CACHE_MB"))
+        max_bytes = std::strtoull(cache_mb, nullptr, 10) * 1024 * 1024;
+}
+
+UInt32 DeflateQplDictionaryRegistry::getId(const std::string & raw)
+{
+    UInt32 id = 2166136261u;
+    for (char c : raw)
+        id = (id ^ static_cast<UInt8>(c)) * 16777619u;
+    return id;
+}
+
+std::shared_ptr<const DeflateQplDictionary> DeflateQplDictionaryRegistry::add(const std::string & raw, const std::string & embedded)
+{
+    if (raw.empty())
+        return nullptr;
+    const UInt32 id = getId(raw);
+    size_t buffer_size = 0;
+    std::unique_ptr<DeflateQplDictionary> built = build(id, raw, buffer_size);
+    if (!built)
+        return nullptr;
+    built->embedded = embedded;
+    std::shared_ptr<const DeflateQplDictionary> dictionary = std::move(built);
+    builds.fetch_add(1, std::memory_order_relaxed);
+
+    /// A dictionary of the same ID built from other bytes, a hash collision, is replaced; its holders keep their copy.
+    auto entry = std::make_unique<CachedDictionary>();
+    entry->dictionary = dictionary;
+    entry->bytes = raw.size() + embedded.size() + buffer_size;
+    entry->last_use.store(use_clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    std::unique_lock lock(mutex);
+    if (auto it = dictionaries.find(id); it != dictionaries.end())
+    {
+        cached_bytes -= it->second->bytes;
+        dictionaries.erase(it);
+    }
+    cached_bytes += entry->bytes;
+    dictionaries.emplace(id, std::move(entry));
+    evict();
+    return dictionary;
+}
+
+std::shared_ptr<const DeflateQplDictionary> DeflateQplDictionaryRegistry::find(UInt32 id, std::string_view embedded)
+{
+    std::shared_lock lock(mutex);
+    auto it = dictionaries.find(id);
+    if (it == dictionaries.end() || it->second->dictionary->embedded != embedded)
+        return nullptr;
+    it->second->last_use.store(use_clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second->dictionary;
+}
+
+void DeflateQplDictionaryRegistry::clear()
+{
+    std::unique_lock lock(mutex);
+    dictionaries.clear();
+    cached_bytes = 0;
+}
+
+void DeflateQplDictionaryRegistry::evict()
+{
+    while (cached_bytes > max_bytes && !dictionaries.empty())
+    {
+        auto oldest = std::min_element(dictionaries.begin(), dictionaries.end(), [](const auto & a, const auto & b)
+        {
+            return a.second->last_use.load(std::memory_order_relaxed) < b.second->last_use.load(std::memory_order_relaxed);
+        });
+        cached_bytes -= oldest->second->bytes;
+        dictionaries.erase(oldest);
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+DeflateQplDictionaryRegistry::Counters DeflateQplDictionaryRegistry::getCounters() const
+{
+    Counters counters;
+    counters.hits = hits.load(std::memory_order_relaxed);
+    counters.builds = builds.load(std::memory_order_relaxed);
+    counters.evictions = evictions.load(std::memory_order_relaxed);
+    std::shared_lock lock(mutex);
+    counters.cached = dictionaries.size();
+    counters.cached_bytes = cached_bytes;
+    return counters;
+}
+
+std::unique_ptr<DeflateQplDictionary> DeflateQplDictionaryRegistry::build(UInt32 id, const std::string & raw, size_t & buffer_size)
+{
+    auto dictionary = std::make_unique<DeflateQplDictionary>();
+    dictionary->id = id;
+    dictionary->raw = raw;
+    /// Built for both paths when QPL supports the dictionary on IAA, for the software path alone otherwise
+    for (auto hw_level : {hw_compression_level::HW_LEVEL_1, hw_compression_level::HW_NONE})
+    {
+        size_t dictionary_buffer_size = 0;
+        if (qpl_get_dictionary_size(sw_compression_level::LEVEL_1, hw_level, raw.size(), &dictionary_buffer_size) != QPL_STS_OK)
+            continue;
+        dictionary->buffer = std::make_unique<uint8_t[]>(dictionary_buffer_size);
+        if (qpl_build_dictionary(dictionary->get(), sw_compression_level::LEVEL_1, hw_level,
+                                 reinterpret_cast<const uint8_t *>(raw.data()), raw.size()) != QPL_STS_OK)
+            continue;
+        dictionary->hardware.store(hw_level != hw_compression_level::HW_NONE, std::memory_order_relaxed);
+        buffer_size = dictionary_buffer_size;
+        return dictionary;
+    }
+    return nullptr;
+}
+
+std::string DeflateQplDictionaryRegistry::train(const std::vector<std::string> & samples, size_t dictionary_size)
 {
-    if (!sw_job)
-        qpl_fini_job(sw_job);
+    /// Segments are scored by the 8-byte strings they hold. A string is counted once per sample, so strings that
+    /// recur across blocks, which only a dictionary can match, win over runs inside one block.
+    static constexpr size_t STRING_SIZE = 8;
+    static constexpr size_t SEGMENT_SIZE = 64;
+    std::unordered_map<UInt64, UInt32> frequency;
+    for (const auto & sample : samples)
+    {
+        std::unordered_set<UInt64> seen;
+        for (size_t i = 0; i + STRING_SIZE <= sample.size(); ++i)
+        {
+            const auto string = unalignedLoad<UInt64>(&sample[i]);
+            if (seen.insert(string).second)
+                ++frequency[string];
+        }
+    }
+
+    struct Segment
+    {
+        const char * data;
+        size_t size;
+    };
+    std::vector<Segment> segments;
+    for (const auto & sample : samples)
+        for (size_t offset = 0; offset < sample.size(); offset += SEGMENT_SIZE)
+            segments.push_back({sample.data() + offset, std::min(SEGMENT_SIZE, sample.size() - offset)});
+
+    auto score = [&](const Segment & segment)
+    {
+        UInt64 total = 0;
+        for (size_t i = 0; i + STRING_SIZE <= segment.size; ++i)
+            if (const UInt32 count = frequency[unalignedLoad<UInt64>(segment.data + i)]; count > 1)
+                total += count;
+        return total;
+    };
+
+    /// Greedy cover: a chosen segment zeroes its strings, so segments repeating it score lower. Scores only go down,
+    /// so a popped segment is rescored and taken only if it still beats the next best.
+    std::priority_queue<std::pair<UInt64, size_t>> queue;
+    for (size_t i = 0; i < segments.size(); ++i)
+        if (const UInt64 segment_score = score(segments[i]))
+            queue.emplace(segment_score, i);
+    std::vector<size_t> chosen;
+    size_t chosen_size = 0;
+    while (!queue.empty() && chosen_size < dictionary_size)
+    {
+        const size_t index = queue.top().second;
+        queue.pop();
+        const UInt64 segment_score = score(segments[index]);
+        if (segment_score == 0)
+            continue;
+        if (!queue.empty() && segment_score < queue.top().first)
+        {
+            queue.emplace(segment_score, index);
+            continue;
+        }
+        chosen.push_back(index);
+        chosen_size += segments[index].size;
+        for (size_t i = 0; i + STRING_SIZE <= segments[index].size; ++i)
+            frequency[unalignedLoad<UInt64>(segments[index].data + i)] = 0;
+    }
+
+    std::string dictionary;
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        dictionary.append(segments[*it].data, segments[*it].size);
+    /// The overflow of the last segment chosen is cut from the front, where the least valuable segments are.
+    if (dictionary.size() > dictionary_size)
+        dictionary.erase(0, dictionary.size() - dictionary_size);
+    return dictionary;
 }
 
+/// Software job of one thread, finalized when the thread exits
+struct ThreadSoftwareJob
+{
+    std::unique_ptr<uint8_t[]> buffer;
+    qpl_job * job = nullptr;
+
+    ~ThreadSoftwareJob()
+    {
+        if (job)
+            qpl_fini_job(job);
+    }
+};
+
+static std::atomic<UInt64> initialized_software_jobs{0};
+
 qpl_job * SoftwareCodecDeflateQpl::getJobCodecPtr()
 {
-    if (!sw_job)
+    static thread_local ThreadSoftwareJob thread_job;
+    if (!thread_job.job)
     {
         UInt32 size = 0;
         qpl_get_job_size(qpl_path_software, &size);
 
-        sw_buffer = std::make_unique<uint8_t[]>(size);
-        sw_job = reinterpret_cast<qpl_job *>(sw_buffer.get());
+        auto buffer = std::make_unique<uint8_t[]>(size);
+        auto * job_ptr = reinterpret_cast<qpl_job *>(buffer.get());
 
         // Job initialization
-        if (auto status = qpl_init_job(qpl_path_software, sw_job); status != QPL_STS_OK)
+        if (auto status = qpl_init_job(qpl_path_software, job_ptr); status != QPL_STS_OK)
             throw Exception(ErrorCodes::CANNOT_COMPRESS,
                             "Initialization of DeflateQpl software fallback codec failed. "
                             "(Details: qpl_init_job with error code: "
                             "{} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)",
                             static_cast<UInt32>(status));
+        thread_job.buffer = std::move(buffer);
+        thread_job.job = job_ptr;
+        initialized_software_jobs.fetch_add(1, std::memory_order_relaxed);
     }
-    return sw_job;
+    return thread_job.job;
+}
+
+UInt64 SoftwareCodecDeflateQpl::getInitializedJobs()
+{
+    return initialized_software_jobs.load(std::memory_order_relaxed);
 }
 
-UInt32 SoftwareCodecDeflateQpl::doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size)
+UInt32 SoftwareCodecDeflateQpl::doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size,
+                                               const DeflateQplDictionary * dictionary)
 {
     qpl_job * job_ptr = getJobCodecPtr();
     // Performing a compression operation
@@ -358,6 +1535,7 @@ UInt32 SoftwareCodecDeflateQpl::doCompressData(const char * source, UInt32 sourc
     job_ptr->available_out = dest_size;
     job_ptr->level = qpl_default_level;
     job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+    job_ptr->dictionary = dictionary ? dictionary->get() : nullptr;
 
     if (auto status = qpl_execute_job(job_ptr); status != QPL_STS_OK)
         throw Exception(ErrorCodes::CANNOT_COMPRESS,
@@ -366,20 +1544,17 @@ UInt32 SoftwareCodecDeflateQpl::doCompressData(const char * source, UInt32 sourc
                         "{} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)",
                         static_cast<UInt32>(status));
 
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::SoftwareCompressions);
     return job_ptr->total_out;
 }
 
-void SoftwareCodecDeflateQpl::doDecompressData(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size)
+void SoftwareCodecDeflateQpl::doDecompressData(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size,
+                                               const DeflateQplDictionary * dictionary)
 {
     qpl_job * job_ptr = getJobCodecPtr();
 
     // Performing a decompression operation
-    job_ptr->op = qpl_op_decompress;
-    job_ptr->next_in_ptr = reinterpret_cast<uint8_t *>(const_cast<char *>(source));
-    job_ptr->next_out_ptr = reinterpret_cast<uint8_t *>(dest);
-    job_ptr->available_in = source_size;
-    job_ptr->available_out = uncompressed_size;
-    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    setDecompressJob(job_ptr, source, source_size, dest, uncompressed_size, dictionary);
 
     if (auto status = qpl_execute_job(job_ptr); status != QPL_STS_OK)
         throw Exception(ErrorCodes::CANNOT_DECOMPRESS,
@@ -387,13 +1562,111 @@ void SoftwareCodecDeflateQpl::doDecompressData(const char * source, UInt32 sourc
                         "(Details: qpl_execute_job with error code: "
                         "{} - please refer to qpl_status in ./contrib/qpl/include/qpl/c_api/status.h)",
                         static_cast<UInt32>(status));
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::SoftwareDecompressions);
+}
+
+/// Aligned with ZLIB
+static UInt32 deflateBound(UInt32 uncompressed_size)
+{
+    return ((uncompressed_size) + ((uncompressed_size) >> 12) + ((uncompressed_size) >> 14) + ((uncompressed_size) >> 25) + 13);
 }
 
-CompressionCodecDeflateQpl::CompressionCodecDeflateQpl()
+CompressionCodecDeflateQpl::CompressionCodecDeflateQpl(bool train_dictionary_)
     : sw_codec(std::make_unique<SoftwareCodecDeflateQpl>())
     , hw_codec(std::make_unique<HardwareCodecDeflateQpl>(*sw_codec))
+    , train_dictionary(train_dictionary_)
+{
+    setCodecDescription(train_dictionary ? "DEFLATE_QPL_DICT" : "DEFLATE_QPL");
+    if (!train_dictionary)
+        return;
+    /// DEFLATE looks back at most 32 KiB, a longer dictionary could not be referenced.
+    if (const char * size_env = std::getenv("DEFLATE_QPL_DICTIONARY_SIZE"))
+        dictionary_size = std::clamp<size_t>(std::strtoull(size_env, nullptr, 10), 1, 32 * 1024);
+    if (const char * sample_env = std::getenv("DEFLATE_QPL_DICTIONARY_SAMPLE_KB"))
+        dictionary_sample_bytes = std::max<size_t>(std::strtoull(sample_env, nullptr, 10), 1) * 1024;
+}
+
+std::optional<UInt32> CompressionCodecDeflateQpl::getDictionaryId() const
+{
+    if (const auto * trained = dictionary.load(std::memory_order_acquire))
+        return trained->id;
+    return {};
+}
+
+const DeflateQplDictionary * CompressionCodecDeflateQpl::dictionaryForBlock(const char * source, UInt32 source_size) const
+{
+    if (!train_dictionary || source_size > MAX_HW_TRANSFER_SIZE)
+        return nullptr;
+    if (const auto * trained = dictionary.load(std::memory_order_acquire))
+        return trained;
+
+    std::lock_guard lock(dictionary_mutex);
+    if (dictionary_training_done)
+        return dictionary.load(std::memory_order_relaxed);
+    /// Each block gives at most a sixteenth of the sample, so the dictionary does not learn from the first block or two alone.
+    const size_t sample_size = std::min({static_cast<size_t>(source_size), std::max<size_t>(dictionary_sample_bytes / 16, 1),
+                                         dictionary_sample_bytes - sampled_bytes});
+    dictionary_samples.emplace_back(source, sample_size);
+    sampled_bytes += sample_size;
+    if (sampled_bytes < dictionary_sample_bytes)
+        return nullptr;
+
+    /// Samples without shared strings give no dictionary, the codec then keeps writing plain blocks.
+    dictionary_training_done = true;
+    const std::string raw = DeflateQplDictionaryRegistry::train(dictionary_samples, dictionary_size);
+    std::vector<std::string>().swap(dictionary_samples);
+    if (raw.empty())
+        return nullptr;
+    /// Every dictionary block carries the dictionary, compressed once here
+    std::string embedded(deflateBound(static_cast<UInt32>(raw.size())), '\0');
+    embedded.resize(sw_codec->doCompressData(raw.data(), static_cast<UInt32>(raw.size()), embedded.data(), static_cast<UInt32>(embedded.size())));
+    trained_dictionary = DeflateQplDictionaryRegistry::instance().add(raw, embedded);
+    const DeflateQplDictionary * trained = trained_dictionary.get();
+    if (trained)
+        LOG_DEBUG(getLogger("CompressionCodecDeflateQpl"), "Trained DeflateQpl dictionary {} of {} bytes ({} compressed) from {} sampled bytes, hardware: {}",
+                  trained->id, trained->raw.size(), trained->embedded.size(), sampled_bytes, trained->hardware.load(std::memory_order_relaxed));
+    dictionary.store(trained, std::memory_order_release);
+    return trained;
+}
+
+UInt32 CompressionCodecDeflateQpl::writeDictionaryBlockHeader(char * dest, const DeflateQplDictionary & block_dictionary)
+{
+    dest[0] = static_cast<char>(DICTIONARY_BLOCK_MARKER);
+    dest[1] = static_cast<char>(DICTIONARY_BLOCK_VERSION);
+    unalignedStore<UInt16>(&dest[2], static_cast<UInt16>(block_dictionary.raw.size()));
+    unalignedStore<UInt32>(&dest[4], block_dictionary.id);
+    unalignedStore<UInt16>(&dest[8], static_cast<UInt16>(block_dictionary.embedded.size()));
+    dest[10] = 0;
+    dest[11] = 0;
+    memcpy(&dest[DICTIONARY_BLOCK_HEADER_SIZE], block_dictionary.embedded.data(), block_dictionary.embedded.size());
+    return DICTIONARY_BLOCK_HEADER_SIZE + static_cast<UInt32>(block_dictionary.embedded.size());
+}
+
+std::shared_ptr<const DeflateQplDictionary> CompressionCodecDeflateQpl::readDictionaryBlockHeader(
+    const char * source, UInt32 source_size, UInt32 & header_size) const
 {
-    setCodecDescription("DEFLATE_QPL");
+    if (source_size < DICTIONARY_BLOCK_HEADER_SIZE || static_cast<UInt8>(source[1]) != DICTIONARY_BLOCK_VERSION)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: malformed dictionary block header");
+    const UInt32 raw_size = unalignedLoad<UInt16>(&source[2]);
+    const UInt32 id = unalignedLoad<UInt32>(&source[4]);
+    const UInt32 embedded_size = unalignedLoad<UInt16>(&source[8]);
+    header_size = DICTIONARY_BLOCK_HEADER_SIZE + embedded_size;
+    if (raw_size == 0 || embedded_size == 0 || header_size > source_size)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: malformed dictionary block header");
+    const std::string_view embedded(&source[DICTIONARY_BLOCK_HEADER_SIZE], embedded_size);
+
+    auto & registry = DeflateQplDictionaryRegistry::instance();
+    if (auto cached = registry.find(id, embedded))
+        return cached;
+    /// First block of this dictionary since the start or since the cache dropped it: build it from the block
+    std::string raw(raw_size, '\0');
+    sw_codec->doDecompressData(embedded.data(), embedded_size, raw.data(), raw_size);
+    if (DeflateQplDictionaryRegistry::getId(raw) != id)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: the embedded dictionary does not match its ID {}", id);
+    auto block_dictionary = registry.add(raw, std::string(embedded));
+    if (!block_dictionary)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: QPL cannot build dictionary {}", id);
+    return block_dictionary;
 }
 
 uint8_t CompressionCodecDeflateQpl::getMethodByte() const
@@ -408,8 +1681,85 @@ void CompressionCodecDeflateQpl::updateHash(SipHash & hash) const
 
 UInt32 CompressionCodecDeflateQpl::getMaxCompressedDataSize(UInt32 uncompressed_size) const
 {
-    /// Aligned with ZLIB
-    return ((uncompressed_size) + ((uncompressed_size) >> 12) + ((uncompressed_size) >> 14) + ((uncompressed_size) >> 25) + 13);
+    if (uncompressed_size <= MAX_HW_TRANSFER_SIZE)
+        return deflateBound(uncompressed_size)
+            + (train_dictionary ? DICTIONARY_BLOCK_HEADER_SIZE + deflateBound(static_cast<UInt32>(dictionary_size)) : 0);
+    /// A split block also holds its header and the end of every sub-stream.
+    const UInt32 count = (uncompressed_size + MAX_HW_TRANSFER_SIZE - 1) / MAX_HW_TRANSFER_SIZE;
+    return deflateBound(uncompressed_size) + splitBlockHeaderSize(count) + 13 * count;
+}
+
+UInt32 CompressionCodecDeflateQpl::compressSplitBlock(const char * source, UInt32 source_size, char * dest) const
+{
+    const UInt32 count = (source_size + MAX_HW_TRANSFER_SIZE - 1) / MAX_HW_TRANSFER_SIZE;
+    const UInt32 header_size = splitBlockHeaderSize(count);
+
+    /// Each sub-stream is compressed into a slot of the largest size it may take, then moved down behind the previous one.
+    std::vector<HardwareCodecDeflateQpl::SubStream> streams(count);
+    UInt32 slot_offset = header_size;
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        const UInt32 stream_size = std::min(MAX_HW_TRANSFER_SIZE, source_size - i * MAX_HW_TRANSFER_SIZE);
+        const UInt32 slot_size = deflateBound(stream_size);
+        streams[i] = {source + i * MAX_HW_TRANSFER_SIZE, stream_size, dest + slot_offset, slot_size};
+        slot_offset += slot_size;
+    }
+    hw_codec->doCompressDataParallel(streams);
+
+    dest[0] = static_cast<char>(SPLIT_BLOCK_MARKER);
+    dest[1] = static_cast<char>(SPLIT_BLOCK_VERSION);
+    dest[2] = 0;
+    dest[3] = 0;
+    unalignedStore<UInt32>(&dest[4], MAX_HW_TRANSFER_SIZE);
+    unalignedStore<UInt32>(&dest[8], count);
+    UInt32 compressed_size = header_size;
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        unalignedStore<UInt32>(&dest[12 + 4 * i], streams[i].result_size);
+        memmove(dest + compressed_size, streams[i].dest, streams[i].result_size);
+        compressed_size += streams[i].result_size;
+    }
+    return compressed_size;
+}
+
+void CompressionCodecDeflateQpl::decompressSplitBlock(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size) const
+{
+    const UInt32 stream_size = source_size >= 12 ? unalignedLoad<UInt32>(&source[4]) : 0;
+    const UInt32 count = source_size >= 12 ? unalignedLoad<UInt32>(&source[8]) : 0;
+    if (stream_size == 0 || count == 0 || static_cast<UInt8>(source[1]) != SPLIT_BLOCK_VERSION || count > (source_size - 12) / 4)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: malformed split block header");
+
+    std::vector<HardwareCodecDeflateQpl::SubStream> streams(count);
+    UInt64 source_offset = splitBlockHeaderSize(count);
+    UInt64 dest_offset = 0;
+    for (UInt32 i = 0; i < count; ++i)
+    {
+        const UInt32 compressed_size = unalignedLoad<UInt32>(&source[12 + 4 * i]);
+        if (source_offset + compressed_size > source_size || dest_offset >= uncompressed_size)
+            throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: split block sizes exceed the block");
+        const UInt32 decompressed_size = static_cast<UInt32>(std::min<UInt64>(stream_size, uncompressed_size - dest_offset));
+        streams[i] = {source + source_offset, compressed_size, dest + dest_offset, decompressed_size};
+        source_offset += compressed_size;
+        dest_offset += decompressed_size;
+    }
+    if (source_offset != source_size || dest_offset != uncompressed_size)
+        throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: split block sizes do not match the block");
+
+    if (getDecompressMode() != CodecMode::SoftwareFallback && DeflateQplJobHWPool::instance().isJobPoolReady())
+        hw_codec->doDecompressDataParallel(streams);
+    else
+    {
+        for (auto & stream : streams)
+        {
+            sw_codec->doDecompressData(stream.source, stream.source_size, stream.dest, stream.dest_size);
+            stream.result_size = stream.dest_size;
+        }
+    }
+
+    for (const auto & stream : streams)
+        if (stream.result_size != stream.dest_size)
+            throw Exception(ErrorCodes::CANNOT_DECOMPRESS, "Cannot decompress DEFLATE_QPL block: sub-stream decompressed to {} bytes instead of {}",
+                            stream.result_size, stream.dest_size);
 }
 
 UInt32 CompressionCodecDeflateQpl::doCompressData(const char * source, UInt32 source_size, char * dest) const
@@ -417,12 +1767,89 @@ UInt32 CompressionCodecDeflateQpl::doCompressData(const char * source, UInt32 so
 /// QPL library is using AVX-512 with some shuffle operations.
 /// Memory sanitizer don't understand if there was uninitialized memory in SIMD register but it was not used in the result of shuffle.
     __msan_unpoison(dest, getMaxCompressedDataSize(source_size));
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::CompressedBytesIn, source_size);
+    /// A block larger than one hardware transfer can not be a single job. Without hardware it stays a single stream.
+    if (source_size > MAX_HW_TRANSFER_SIZE && DeflateQplJobHWPool::instance().isJobPoolReady())
+    {
+        const UInt32 compressed_size = compressSplitBlock(source, source_size, dest);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::CompressedBytesOut, compressed_size);
+        return compressed_size;
+    }
+
+    UInt32 header_size = 0;
+    const DeflateQplDictionary * block_dictionary = dictionaryForBlock(source, source_size);
+    if (block_dictionary)
+    {
+        header_size = writeDictionaryBlockHeader(dest, *block_dictionary);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::DictionaryCompressions);
+    }
+    char * stream = dest + header_size;
+    const UInt32 stream_size = getMaxCompressedDataSize(source_size) - header_size;
     Int32 res = HardwareCodecDeflateQpl::RET_ERROR;
-    if (DeflateQplJobHWPool::instance().isJobPoolReady())
-        res = hw_codec->doCompressData(source, source_size, dest, getMaxCompressedDataSize(source_size));
+    if (!DeflateQplJobHWPool::instance().isJobPoolReady())
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackNoHardware);
+    else if (!block_dictionary || block_dictionary->hardware.load(std::memory_order_relaxed))
+        res = hw_codec->doCompressData(source, source_size, stream, stream_size, block_dictionary);
+    if (res == HardwareCodecDeflateQpl::RET_ERROR)
+        res = sw_codec->doCompressData(source, source_size, stream, stream_size, block_dictionary);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::CompressedBytesOut, res + header_size);
+    return res + header_size;
+}
+
+UInt32 CompressionCodecDeflateQpl::compressAsynchronous(const char * source, UInt32 source_size, char * dest)
+{
+    const UInt32 request_id = static_cast<UInt32>(async_compress_blocks.size());
+    const UInt32 data_size = getMaxCompressedDataSize(source_size);
+    char * data = dest + getHeaderSize();
+    __msan_unpoison(data, data_size);
+    dest[0] = getMethodByte();
+    unalignedStore<UInt32>(&dest[5], source_size);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::CompressedBytesIn, source_size);
+
+    /// The sub-streams of a split block already run concurrently, so the block is finished before returning.
+    if (source_size > MAX_HW_TRANSFER_SIZE && DeflateQplJobHWPool::instance().isJobPoolReady())
+    {
+        async_compress_blocks.emplace_back(dest, 0);
+        async_compress_done.emplace_back(request_id, compressSplitBlock(source, source_size, data));
+        return request_id;
+    }
+
+    UInt32 header_size = 0;
+    const DeflateQplDictionary * block_dictionary = dictionaryForBlock(source, source_size);
+    if (block_dictionary)
+    {
+        header_size = writeDictionaryBlockHeader(data, *block_dictionary);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::DictionaryCompressions);
+    }
+    async_compress_blocks.emplace_back(dest, header_size);
+    Int32 res = HardwareCodecDeflateQpl::RET_ERROR;
+    if (!DeflateQplJobHWPool::instance().isJobPoolReady())
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackNoHardware);
+    else if (!block_dictionary || block_dictionary->hardware.load(std::memory_order_relaxed))
+        res = hw_codec->doCompressDataAsynchronous(source, source_size, data + header_size, data_size - header_size, request_id, block_dictionary);
     if (res == HardwareCodecDeflateQpl::RET_ERROR)
-        res = sw_codec->doCompressData(source, source_size, dest, getMaxCompressedDataSize(source_size));
-    return res;
+        async_compress_done.emplace_back(request_id, sw_codec->doCompressData(source, source_size, data + header_size, data_size - header_size, block_dictionary));
+    return request_id;
+}
+
+void CompressionCodecDeflateQpl::flushAsynchronousCompressRequests(const std::function<void(UInt32, UInt32)> & on_compressed)
+{
+    /// Same header as ICompressionCodec::compress: method byte, compressed block size, uncompressed size.
+    auto finish_block = [&](UInt32 request_id, UInt32 compressed_size)
+    {
+        const auto & [block, dictionary_header_size] = async_compress_blocks[request_id];
+        const UInt32 block_size = compressed_size + dictionary_header_size + getHeaderSize();
+        unalignedStore<UInt32>(&block[1], block_size);
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::CompressedBytesOut, compressed_size + dictionary_header_size);
+        on_compressed(request_id, block_size);
+    };
+
+    for (const auto & [request_id, compressed_size] : async_compress_done)
+        finish_block(request_id, compressed_size);
+    async_compress_done.clear();
+    if (DeflateQplJobHWPool::instance().isJobPoolReady())
+        hw_codec->flushAsynchronousCompressRequests(finish_block);
+    async_compress_blocks.clear();
 }
 
 inline void touchBufferWithZeroFilling(char * buffer, UInt32 buffer_size)
@@ -440,34 +1867,68 @@ void CompressionCodecDeflateQpl::doDecompressData(const char * source, UInt32 so
     __msan_unpoison(dest, uncompressed_size);
 /// Device IOTLB miss has big perf. impact for IAA accelerators.
 /// To avoid page fault, we need touch buffers related to accelerator in advance.
-    touchBufferWithZeroFilling(dest, uncompressed_size);
+/// Buffers borrowed from DeflateQplBufferPool were faulted in once when they were mapped.
+    if (DeflateQplBufferPool::instance().isPrefaulted(dest, uncompressed_size))
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::PrefaultedDestinations);
+    else
+        touchBufferWithZeroFilling(dest, uncompressed_size);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::DecompressedBytesIn, source_size);
+    DeflateQplMetrics::add(DeflateQplMetrics::Counter::DecompressedBytesOut, uncompressed_size);
+    if (getDecompressMode() != CodecMode::SoftwareFallback && !DeflateQplJobHWPool::instance().isJobPoolReady())
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::FallbackNoHardware);
+
+    /// A split block is decompressed at once in every mode, its sub-streams already run concurrently.
+    if (source_size > 0 && static_cast<UInt8>(source[0]) == SPLIT_BLOCK_MARKER)
+    {
+        if (getDecompressMode() == CodecMode::Asynchronous)
+            ++async_decompress_requests;
+        decompressSplitBlock(source, source_size, dest, uncompressed_size);
+        return;
+    }
+
+    std::shared_ptr<const DeflateQplDictionary> dictionary_holder;
+    if (source_size > 0 && static_cast<UInt8>(source[0]) == DICTIONARY_BLOCK_MARKER)
+    {
+        UInt32 header_size = 0;
+        dictionary_holder = readDictionaryBlockHeader(source, source_size, header_size);
+        source += header_size;
+        source_size -= header_size;
+        DeflateQplMetrics::add(DeflateQplMetrics::Counter::DictionaryDecompressions);
+    }
+    const DeflateQplDictionary * block_dictionary = dictionary_holder.get();
+    const bool use_hardware = DeflateQplJobHWPool::instance().isJobPoolReady()
+        && (!block_dictionary || block_dictionary->hardware.load(std::memory_order_relaxed));
 
     switch (getDecompressMode())
     {
         case CodecMode::Synchronous:
         {
             Int32 res = HardwareCodecDeflateQpl::RET_ERROR;
-            if (DeflateQplJobHWPool::instance().isJobPoolReady())
+            if (use_hardware)
             {
-                res = hw_codec->doDecompressDataSynchronous(source, source_size, dest, uncompressed_size);
+                res = hw_codec->doDecompressDataSynchronous(source, source_size, dest, uncompressed_size, block_dictionary);
                 if (res == HardwareCodecDeflateQpl::RET_ERROR)
-                    sw_codec->doDecompressData(source, source_size, dest, uncompressed_size);
+                    sw_codec->doDecompressData(source, source_size, dest, uncompressed_size, block_dictionary);
             }
             else
-                sw_codec->doDecompressData(source, source_size, dest, uncompressed_size);
+                sw_codec->doDecompressData(source, source_size, dest, uncompressed_size, block_dictionary);
             return;
         }
         case CodecMode::Asynchronous:
         {
+            const UInt32 request_id = async_decompress_requests++;
             Int32 res = HardwareCodecDeflateQpl::RET_ERROR;
-            if (DeflateQplJobHWPool::instance().isJobPoolReady())
-                res = hw_codec->doDecompressDataAsynchronous(source, source_size, dest, uncompressed_size);
+            if (use_hardware)
+                res = hw_codec->doDecompressDataAsynchronous(source, source_size, dest, uncompressed_size, request_id, block_dictionary);
+            /// The job reads the dictionary till the flush, even if the registry drops it meanwhile
+            if (res != HardwareCodecDeflateQpl::RET_ERROR && dictionary_holder)
+                async_decompress_dictionaries.push_back(std::move(dictionary_holder));
             if (res == HardwareCodecDeflateQpl::RET_ERROR)
-                sw_codec->doDecompressData(source, source_size, dest, uncompressed_size);
+                sw_codec->doDecompressData(source, source_size, dest, uncompressed_size, block_dictionary);
             return;
         }
         case CodecMode::SoftwareFallback:
-            sw_codec->doDecompressData(source, source_size, dest, uncompressed_size);
+            sw_codec->doDecompressData(source, source_size, dest, uncompressed_size, block_dictionary);
             return;
     }
 }
@@ -476,13 +1937,27 @@ void CompressionCodecDeflateQpl::flushAsynchronousDecompressRequests()
 {
     if (DeflateQplJobHWPool::instance().isJobPoolReady())
         hw_codec->flushAsynchronousDecompressRequests();
+    async_decompress_requests = 0;
+    async_decompress_dictionaries.clear();
     /// After flush previous all async requests, we must restore mode to be synchronous by default.
     setDecompressMode(CodecMode::Synchronous);
 }
+
+size_t CompressionCodecDeflateQpl::waitAsynchronousDecompressRequests(size_t min_completed)
+{
+    if (!DeflateQplJobHWPool::instance().isJobPoolReady())
+        return async_decompress_requests;
+    hw_codec->waitAsynchronousDecompressRequests(min_completed);
+    /// Requests below the oldest one in flight were decompressed in software or have finished on the hardware.
+    return hw_codec->oldestAsynchronousDecompressRequest().value_or(async_decompress_requests);
+}
 void registerCodecDeflateQpl(CompressionCodecFactory & factory)
 {
     factory.registerSimpleCompressionCodec(
         "DEFLATE_QPL", static_cast<char>(CompressionMethodByte::DeflateQpl), [&]() { return std::make_shared<CompressionCodecDeflateQpl>(); });
+    /// Writes blocks with the DEFLATE_QPL method byte, which the DEFLATE_QPL codec reads back, so it is registered by name only.
+    factory.registerCompressionCodec(
+        "DEFLATE_QPL_DICT", {}, [&](const ASTPtr &) { return std::make_shared<CompressionCodecDeflateQpl>(/*train_dictionary=*/ true); });
 }
 }
 #endif
@@ -0,0 +1,727 @@
+#pragma once
+
+#include <Compression/ICompressionCodec.h>
+#include <Common/AsynchronousMetrics.h>
+#include <Common/Logger.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <qpl/qpl.h>
+
+namespace DB
+{
+
+/// Counters and latency histograms of the codec for dashboards. Every thread records into a slot of its own with plain
+/// relaxed stores, so recording touches no shared cache line; getSnapshot sums the slots on demand.
+class DeflateQplMetrics
+{
+public:
+    enum class Counter : uint8_t
+    {
+        HardwareCompressions,       /// jobs compressed on IAA: blocks and sub-streams of split blocks
+        HardwareDecompressions,
+        AsyncCompressSubmissions,   /// jobs submitted by compressAsynchronous
+        AsyncDecompressSubmissions, /// jobs submitted in asynchronous decompression mode
+        SoftwareCompressions,       /// calls of the software codec, fallbacks included
+        SoftwareDecompressions,
+        FallbackNoHardware,         /// block processed in software because the job pool is not ready
+        FallbackPoolExhausted,      /// no free hardware job, or none within the wait budget
+        FallbackSubmitFailed,       /// qpl_submit_job failed
+        FallbackJobFailed,          /// the job finished with an error
+        CompressedBytesIn,          /// uncompressed bytes given to compression
+        CompressedBytesOut,
+        DecompressedBytesIn,        /// compressed bytes given to decompression
+        DecompressedBytesOut,
+        PrefaultedDestinations,     /// decompressions into a DeflateQplBufferPool buffer, which skip the touching pass
+        PoolWaitNanoseconds,        /// time spent in the admission queue of the job pool
+        DictionaryCompressions,     /// blocks compressed with a trained dictionary
+        DictionaryDecompressions,
+        MAX,
+    };
+
+    enum class Histogram : uint8_t
+    {
+        HardwareCompressLatency,    /// submit to completion of a synchronous job
+        HardwareDecompressLatency,
+        AsyncCompressLatency,       /// submit to completion seen by a flush
+        AsyncDecompressLatency,
+        PoolWaitLatency,            /// acquires that waited in the admission queue
+        MAX,
+    };
+
+    static constexpr size_t COUNTERS = static_cast<size_t>(Counter::MAX);
+    static constexpr size_t HISTOGRAMS = static_cast<size_t>(Histogram::MAX);
+    /// Bucket i counts values of [2^i, 2^(i+1)) nanoseconds, bucket 0 also 0 and the last one everything larger.
+    static constexpr size_t HISTOGRAM_BUCKETS = 40;
+
+    struct Snapshot
+    {
+        std::array<UInt64, COUNTERS> counters{};
+        std::array<std::array<UInt64, HISTOGRAM_BUCKETS>, HISTOGRAMS> histograms{};
+
+        UInt64 get(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+        UInt64 count(Histogram histogram) const;
+        /// Upper bound in nanoseconds of the bucket holding quantile q, 0 for an empty histogram
+        UInt64 quantile(Histogram histogram, double q) const;
+        /// Every counter, then count, p50 and p99 of every histogram, named like DeflateQplHardwareCompressions and
+        /// DeflateQplHardwareCompressLatencyP99, for export as system metrics.
+        void forEach(const std::function<void(const std::string & name, UInt64 value)> & callback) const;
+    };
+
+    static DeflateQplMetrics & instance();
+
+    static void add(Counter counter, UInt64 value = 1);
+    static void observe(Histogram histogram, UInt64 nanoseconds);
+    /// Nanoseconds of a monotonic clock, for latencies passed to observe
+    static UInt64 now();
+
+    Snapshot getSnapshot() const;
+
+    /// Provider for system.asynchronous_metrics: ServerAsynchronousMetrics::updateImpl calls it with its new_values on
+    /// every update, and each value of Snapshot::forEach becomes a row under the same name.
+    static void updateAsynchronousMetrics(AsynchronousMetricValues & new_values);
+
+    static const char * getName(Counter counter);
+    static const char * getName(Histogram histogram);
+
+private:
+    /// Written by one thread at a time, the one holding the slot
+    struct alignas(64) ThreadSlot
+    {
+        std::array<std::atomic<UInt64>, COUNTERS> counters{};
+        std::array<std::array<std::atomic<UInt64>, HISTOGRAM_BUCKETS>, HISTOGRAMS> histograms{};
+    };
+
+    /// Returns the slot of an exiting thread for reuse; its counts stay in the sums.
+    struct ThreadSlotHolder
+    {
+        ThreadSlot * slot = nullptr;
+        ~ThreadSlotHolder();
+    };
+
+    static ThreadSlot & threadSlot();
+
+    mutable std::mutex slots_mutex;
+    std::vector<std::unique_ptr<ThreadSlot>> slots;
+    std::vector<ThreadSlot *> free_slots;
+};
+
+/// DeflateQplJobHWPool is resource pool to provide the job objects.
+/// Job object is used for storing context information during offloading compression job to HW Accelerator.
+class DeflateQplJobHWPool
+{
+public:
+    DeflateQplJobHWPool();
+    ~DeflateQplJobHWPool();
+
+    /// Priority class of the jobs a thread acquires. Background work may hold only part of the jobs, the rest is reserved
+    /// for foreground work, and queued foreground threads are served first in proportion to their share.
+    enum class Priority : uint8_t
+    {
+        Foreground,     /// reads of queries, the default
+        Background,     /// merges and mutations
+        MAX,
+    };
+    static constexpr size_t PRIORITIES = static_cast<size_t>(Priority::MAX);
+
+    /// Puts the jobs the calling thread acquires into a priority class while the scope lives.
+    /// setup_clickhouse.sh opens PriorityScope(Priority::Background) in MergeTask::execute and MutateTask::execute.
+    class PriorityScope
+    {
+    public:
+        explicit PriorityScope(Priority priority);
+        ~PriorityScope();
+        PriorityScope(const PriorityScope &) = delete;
+        PriorityScope & operator=(const PriorityScope &) = delete;
+
+    private:
+        Priority previous;
+    };
+
+    /// With wait set, an empty pool makes the caller queue for up to the wait budget before it gets nullptr.
+    /// The job counts against the priority class of the calling thread.
+    qpl_job * acquireJob(UInt32 & job_id, bool wait = false);
+    void releaseJob(UInt32 job_id);
+    const bool & isJobPoolReady() { return job_pool_ready; }
+    static DeflateQplJobHWPool & instance();
+
+    /// How acquireJob calls ended
+    struct AcquireCounters
+    {
+        UInt64 immediate = 0;       /// a job was free
+        UInt64 after_wait = 0;      /// a released job was handed over within the wait budget
+        UInt64 budget_expired = 0;  /// nullptr after waiting the whole budget
+        UInt64 queue_full = 0;      /// nullptr without waiting, max_waiters threads were already queued
+        UInt64 no_wait = 0;         /// nullptr at once: no free job and the caller does not wait (or the budget is 0)
+        UInt64 wait_us = 0;         /// total time spent in the admission queue
+    };
+    AcquireCounters getAcquireCounters() const;
+
+    /// Jobs of the IAA devices on one NUMA node and how they were used
+    struct NodeUtilization
+    {
+        Int32 numa_node = -1;
+        std::string devices;
+        UInt32 jobs = 0;
+        UInt32 in_use = 0;
+        UInt64 acquired_local = 0;   /// by threads running on this node
+        UInt64 acquired_remote = 0;  /// by threads of other nodes whose own devices were saturated
+    };
+    std::vector<NodeUtilization> getNodeUtilization() const;
+
+    /// Jobs of one priority class and how its acquires ended
+    struct ClassUtilization
+    {
+        Priority priority = Priority::Foreground;
+        UInt32 limit = 0;           /// jobs the class may hold at once
+        UInt32 in_use = 0;
+        UInt64 acquired = 0;
+        UInt64 fallbacks = 0;       /// acquires that returned nullptr
+    };
+    std::vector<ClassUtilization> getClassUtilization() const;
+    /// False with DEFLATE_QPL_PRIORITY_CLASSES=0, every job then counts as foreground
+    bool arePriorityClassesEnabled() const { return priority_classes_enabled; }
+
+private:
+    /// A thread in the admission queue. releaseJob hands free jobs to waiters in arrival order.
+    struct JobWaiter
+    {
+        std::condition_variable cv;
+        Int32 numa_node = -1;
+        UInt32 index = 0;
+        bool granted = false;
+    };
+
+    /// Jobs of the devices on one NUMA node, with their own free list. Jobs are routed to a node by qpl_job::numa_id;
+    /// QPL spreads them over the node's devices and work queues itself.
+    struct NodePool
+    {
+        Int32 numa_node = -1;
+        std::string devices;
+        /// The node owns jobs first_index .. first_index + size - 1 of hw_jobs_buffer
+        UInt32 first_index = 0;
+        UInt32 size = 0;
+        /// Head of the node's free list, see popNodeFreeJob
+        std::atomic<UInt64> free_head{EMPTY_INDEX};
+        std::atomic<UInt32> in_use{0};
+        std::atomic<UInt64> acquired_local{0};
+        std::atomic<UInt64> acquired_remote{0};
+    };
+
+    /// Jobs held by one priority class and its admission queue
+    struct PriorityClass
+    {
+        UInt32 limit = 0;
+        std::atomic<UInt32> in_use{0};
+        /// Threads of the class in the admission queue, guarded by waiters_mutex
+        std::deque<JobWaiter *> waiters;
+        std::atomic<UInt32> waiting{0};
+        std::atomic<UInt64> acquired{0};
+        std::atomic<UInt64> fallbacks{0};
+    };
+
+    bool waitForJob(UInt32 & index, Priority priority, Int32 numa_node);
+    /// Moves jobs from the free lists to queued waiters, oldest first within a class. Called with waiters_mutex held.
+    void handOverFreeJobs();
+    /// Hands a free job to the oldest waiter of the class, if the class is below its limit
+    bool handOverFreeJob(Priority priority);
+
+    /// Priority class of the calling thread, Foreground when the classes are disabled
+    Priority currentPriority() const;
+    PriorityClass & priorityClass(Priority priority) { return priority_classes[static_cast<size_t>(priority)]; }
+    /// Takes a free job for the class if it holds fewer jobs than its limit.
+    bool popClassFreeJob(UInt32 & index, Priority priority, Int32 numa_node);
+    /// Whether threads of the class or of a higher one are queued, which a new caller of the class must not overtake
+    bool hasWaitersAhead(Priority priority) const;
+
+    /// NUMA node of the CPU the calling thread runs on, -1 if unknown
+    Int32 currentNumaNode() const;
+    /// Takes a free job from a node local to numa_node, or from the other nodes when the local ones have none.
+    bool popFreeJob(UInt32 & index, Int32 numa_node);
+    NodePool & nodeOfJob(UInt32 index) const;
+
+    /// Lock-free stack of free job indices per node. The head packs the top index (low 32 bits) with a tag (high 32 bits)
+    /// that changes on every update, so a thread holding a stale head cannot swap it back in (ABA).
+    bool popNodeFreeJob(NodePool & node, UInt32 & index);
+    void pushFreeJob(UInt32 index);
+
+    static constexpr UInt32 EMPTY_INDEX = std::numeric_limits<UInt32>::max();
+
+    /// size of each job objects
+    UInt32 per_job_size;
+    /// Maximum jobs running in parallel supported by IAA hardware
+    UInt32 max_hw_jobs;
+    /// Jobs initialized in hw_jobs_buffer, finalized by the destructor
+    UInt32 initialized_jobs = 0;
+    /// Entire buffer for storing all job objects
+    std::unique_ptr<uint8_t[]> hw_jobs_buffer;
+    /// Jobs grouped by the NUMA node of their devices
+    std::vector<std::unique_ptr<NodePool>> node_pools;
+    /// NUMA node of each CPU, from sysfs
+    std::vector<Int32> cpu_numa_nodes;
+    /// Free lists: the index below each free job
+    std::unique_ptr<std::atomic<UInt32>[]> free_next;
+    /// Priority class each job was acquired for, written by its owner
+    std::unique_ptr<Priority[]> job_priority;
+
+    /// DEFLATE_QPL_PRIORITY_CLASSES, DEFLATE_QPL_BACKGROUND_MAX_PERCENT and DEFLATE_QPL_FOREGROUND_SHARE
+    /// (defaults: 1, 75, 4), see the constructor
+    bool priority_classes_enabled = true;
+    UInt32 foreground_share = 4;
+    /// Hand-overs to foreground waiters since the last one to a background waiter, guarded by waiters_mutex
+    UInt32 foreground_served = 0;
+    std::array<PriorityClass, PRIORITIES> priority_classes;
+
+    /// DEFLATE_QPL_ACQUIRE_WAIT_US and DEFLATE_QPL_MAX_WAITERS (defaults: 100 us, max_hw_jobs)
+    std::chrono::microseconds acquire_wait_budget{100};
+    UInt32 max_waiters = 0;
+    std::mutex waiters_mutex;
+    /// Threads in the admission queues of all classes
+    std::atomic<UInt32> waiting{0};
+
+    std::atomic<UInt64> acquired_immediate{0};
+    std::atomic<UInt64> acquired_after_wait{0};
+    std::atomic<UInt64> fallback_budget_expired{0};
+    std::atomic<UInt64> fallback_queue_full{0};
+    std::atomic<UInt64> fallback_no_wait{0};
+    std::atomic<UInt64> total_wait_us{0};
+
+    bool job_pool_ready;
+};
+
+/// Waits for the IAA jobs this codec submits. DEFLATE_QPL_WAIT_STRATEGY picks how:
+///   spin     - qpl_check_job in a PAUSE loop
+///   tpause   - TPAUSE till the job is expected to be finished, then in short windows (default)
+///   yield    - yield between checks, other threads can run on the core
+///   blocking - sleep till the job is expected to be finished, then in short sleeps; the core is free meanwhile
+///   qpl_wait - qpl_wait_job, which UMWAITs on the job's completion record
+/// The expected duration of a job is learned per input byte from the finished ones.
+class DeflateQplJobWaiter
+{
+public:
+    enum class Strategy : uint8_t
+    {
+        Spin,
+        TPause,
+        Yield,
+        Blocking,
+        QplWait,
+    };
+
+    DeflateQplJobWaiter();
+    static DeflateQplJobWaiter & instance();
+
+    /// Waits till a submitted job is finished and returns its status. bytes is the input size of the job.
+    qpl_status wait(qpl_job * job_ptr, UInt32 bytes);
+    /// One short wait between two polls over several jobs in flight, none of which has finished. job_ptr is the oldest of them.
+    void pause(qpl_job * job_ptr);
+
+    Strategy getStrategy() const { return strategy; }
+
+    /// CPU accounting: TSC cycles the calling threads spent in wait and pause
+    struct Counters
+    {
+        UInt64 waits = 0;
+        UInt64 pauses = 0;
+        UInt64 polls = 0;
+        UInt64 wait_cycles = 0;
+    };
+    Counters getCounters() const;
+
+private:
+    /// Window of a TPAUSE after the expected duration has passed, and of every pause
+    static constexpr UInt64 SHORT_WINDOW_CYCLES = 1000;
+
+    void pauseFor(UInt64 cycles) const;
+
+    Strategy strategy = Strategy::TPause;
+    /// TSC cycles per nanosecond, measured once for the blocking strategy
+    double tsc_per_ns = 1.0;
+    /// Expected job duration in TSC cycles per KiB of input: moving average over finished jobs, 0 until the first one
+    std::atomic<UInt64> cycles_per_kb{0};
+
+    std::atomic<UInt64> waits{0};
+    std::atomic<UInt64> pauses{0};
+    std::atomic<UInt64> polls{0};
+    std::atomic<UInt64> wait_cycles{0};
+};
+
+/// Pre-faulted output buffers for hardware decompression. A buffer is mapped with MAP_POPULATE once and reused, so the
+/// pages IAA writes are present without a touching pass per call. doDecompressData skips touchBufferWithZeroFilling for a
+/// destination inside a pooled buffer. ClickHouse's CompressedReadBuffer decompresses into its own memory and does not
+/// borrow from the pool, so inside the server every destination is still touched; only callers of the codec that borrow
+/// their targets here, such as the standalone harness, skip the pass.
+/// DEFLATE_QPL_BUFFER_POOL_MB caps the mapped memory (default 256, 0 disables the pool). DEFLATE_QPL_BUFFER_HUGE_PAGES=1
+/// maps buffers of 2 MiB and more with huge pages when the system has them reserved.
+class DeflateQplBufferPool
+{
+public:
+    /// A borrowed buffer, given back to the pool on destruction. Empty if the pool could not provide one.
+    class Buffer
+    {
+    public:
+        Buffer() = default;
+        Buffer(Buffer && other) noexcept;
+        Buffer & operator=(Buffer && other) noexcept;
+        ~Buffer();
+
+        char * data() const { return ptr; }
+        size_t size() const { return capacity; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+    private:
+        friend class DeflateQplBufferPool;
+        Buffer(char * ptr_, size_t capacity_) : ptr(ptr_), capacity(capacity_) {}
+
+        char * ptr = nullptr;
+        size_t capacity = 0;
+    };
+
+    DeflateQplBufferPool();
+    ~DeflateQplBufferPool();
+    static DeflateQplBufferPool & instance();
+
+    /// A pre-faulted buffer of at least size bytes, or an empty one if the pool is disabled or full.
+    Buffer borrow(size_t size);
+    /// Whether [ptr, ptr + size) lies in one pooled buffer
+    bool isPrefaulted(const char * ptr, size_t size) const;
+
+    struct Counters
+    {
+        UInt64 borrows = 0;
+        UInt64 reuses = 0;        /// borrows served by a buffer mapped before
+        UInt64 maps = 0;
+        UInt64 unmaps = 0;        /// free buffers dropped to make room under the cap
+        UInt64 exhausted = 0;     /// borrows left empty
+        UInt64 mapped_bytes = 0;
+    };
+    Counters getCounters() const;
+
+private:
+    /// Buffers come in power of two sizes from MIN_BUFFER_SIZE, one free list per size
+    static constexpr size_t MIN_BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    char * mapBuffer(size_t capacity);
+    void giveBack(char * ptr, size_t capacity);
+
+    size_t max_bytes = 256 * 1024 * 1024;
+    bool huge_pages = false;
+
+    mutable std::shared_mutex mutex;
+    /// Free buffers by size class: capacity MIN_BUFFER_SIZE << class
+    std::vector<std::vector<char *>> free_buffers;
+    /// Start address -> capacity of every mapped buffer
+    std::map<uintptr_t, size_t> buffers;
+    size_t mapped_bytes = 0;
+
+    std::atomic<UInt64> borrows{0};
+    std::atomic<UInt64> reuses{0};
+    std::atomic<UInt64> maps{0};
+    std::atomic<UInt64> unmaps{0};
+    std::atomic<UInt64> exhausted{0};
+};
+
+/// A trained DEFLATE dictionary, the history window preset before each block compressed with it
+struct DeflateQplDictionary
+{
+    UInt32 id = 0;
+    std::string raw;
+    /// raw compressed as one DEFLATE stream, as every dictionary block carries it
+    std::string embedded;
+    /// The qpl_dictionary built from raw
+    std::unique_ptr<uint8_t[]> buffer;
+    /// Cleared when QPL cannot build the dictionary for IAA or IAA rejects a job with it; its blocks then go to the
+    /// software codec directly.
+    mutable std::atomic<bool> hardware{true};
+
+    qpl_dictionary * get() const { return reinterpret_cast<qpl_dictionary *>(buffer.get()); }
+};
+
+/// Cache of built dictionaries, for the whole process. Every dictionary block carries its dictionary, so the cache only
+/// saves building the qpl_dictionary again; a block read on another server, after a restart or after an eviction builds
+/// it from its own bytes. The ID is a hash of the raw bytes alone. DEFLATE_QPL_DICTIONARY_CACHE_MB caps the cached bytes
+/// (default 64); past the cap the least recently used dictionaries are dropped. Holders of a dictionary keep it alive.
+class DeflateQplDictionaryRegistry
+{
+public:
+    static DeflateQplDictionaryRegistry & instance();
+
+    /// Builds and caches a dictionary from raw and its compressed form. nullptr if QPL cannot build it.
+    std::shared_ptr<const DeflateQplDictionary> add(const std::string & raw, const std::string & embedded);
+    /// The cached dictionary of id if it was built from the same compressed bytes, nullptr otherwise
+    std::shared_ptr<const DeflateQplDictionary> find(UInt32 id, std::string_view embedded);
+    /// Drops every cached dictionary, as a restart does
+    void clear();
+
+    struct Counters
+    {
+        UInt64 hits = 0;
+        UInt64 builds = 0;          /// dictionaries built by add, after a miss or for a newly trained one
+        UInt64 evictions = 0;
+        UInt64 cached = 0;
+        UInt64 cached_bytes = 0;
+    };
+    Counters getCounters() const;
+
+    /// FNV-1a hash of the bytes
+    static UInt32 getId(const std::string & raw);
+
+    /// Picks the segments of the samples with the most substrings shared across samples, up to dictionary_size bytes.
+    /// The most valuable segments go last, closest to the data, where matches cost the fewest distance bits.
+    static std::string train(const std::vector<std::string> & samples, size_t dictionary_size);
+
+private:
+    DeflateQplDictionaryRegistry();
+
+    struct CachedDictionary
+    {
+        std::shared_ptr<const DeflateQplDictionary> dictionary;
+        /// raw, embedded and the qpl_dictionary
+        size_t bytes = 0;
+        /// Value of use_clock at the last find that returned it
+        std::atomic<UInt64> last_use{0};
+    };
+
+    /// The qpl_dictionary of raw, for IAA when QPL supports it there. nullptr if QPL cannot build it.
+    static std::unique_ptr<DeflateQplDictionary> build(UInt32 id, const std::string & raw, size_t & buffer_size);
+    /// Drops the least recently used dictionaries until cached_bytes is within max_bytes. Called with mutex held.
+    void evict();
+
+    size_t max_bytes = 64 * 1024 * 1024;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<UInt32, std::unique_ptr<CachedDictionary>> dictionaries;
+    size_t cached_bytes = 0;
+    std::atomic<UInt64> use_clock{0};
+    std::atomic<UInt64> hits{0};
+    std::atomic<UInt64> builds{0};
+    std::atomic<UInt64> evictions{0};
+};
+
+/// The software job is per thread, not per codec. A job is busy only within one call, so each thread initializes one
+/// job once and all codecs it runs share it; fallbacks of different threads run in parallel.
+class SoftwareCodecDeflateQpl final
+{
+public:
+    UInt32 doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size,
+                          const DeflateQplDictionary * dictionary = nullptr);
+    void doDecompressData(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size,
+                          const DeflateQplDictionary * dictionary = nullptr);
+
+    /// Software jobs initialized so far, one per thread that has used the software codec
+    static UInt64 getInitializedJobs();
+
+private:
+    static qpl_job * getJobCodecPtr();
+};
+
+class HardwareCodecDeflateQpl
+{
+public:
+    /// RET_ERROR stands for hardware codec fail, needs fallback to software codec.
+    static constexpr Int32 RET_ERROR = -1;
+
+    /// One of the independent streams of a split block
+    struct SubStream
+    {
+        const char * source;
+        UInt32 source_size;
+        char * dest;
+        UInt32 dest_size;
+        /// Output size once processed
+        UInt32 result_size = 0;
+    };
+
+    explicit HardwareCodecDeflateQpl(SoftwareCodecDeflateQpl & sw_codec_);
+    ~HardwareCodecDeflateQpl();
+
+    /// The operations take the dictionary of a dictionary block, nullptr for a plain one.
+    Int32 doCompressData(const char * source, UInt32 source_size, char * dest, UInt32 dest_size,
+                         const DeflateQplDictionary * dictionary = nullptr) const;
+
+    /// Submit compression job request to the IAA hardware and return immediately. request_id is passed back by the flush.
+    Int32 doCompressDataAsynchronous(const char * source, UInt32 source_size, char * dest, UInt32 dest_size, UInt32 request_id,
+                                     const DeflateQplDictionary * dictionary = nullptr);
+
+    /// Busy waiting till all the jobs in "comp_async_requests" are finished, calling on_compressed(request_id, compressed_size)
+    /// for each of them in completion order. A job that failed is compressed again by the software codec.
+    void flushAsynchronousCompressRequests(const std::function<void(UInt32, UInt32)> & on_compressed);
+
+    /// Submit job request to the IAA hardware and then busy waiting till it complete.
+    Int32 doDecompressDataSynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size,
+                                      const DeflateQplDictionary * dictionary = nullptr);
+
+    /// Submit job request to the IAA hardware and return immediately. IAA hardware will process decompression jobs automatically.
+    /// request_id tells the caller's requests apart, see oldestAsynchronousDecompressRequest.
+    Int32 doDecompressDataAsynchronous(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size, UInt32 request_id,
+                                       const DeflateQplDictionary * dictionary = nullptr);
+
+    /// Busy waiting till at least min_completed of the jobs in "decomp_async_jobs" are finished, or all of them if fewer are in flight.
+    /// Failed jobs are decompressed again by the software codec. Returns the number of jobs that finished.
+    size_t waitAsynchronousDecompressRequests(size_t min_completed);
+
+    /// Flush result for all previous requests which means busy waiting till all the jobs in "decomp_async_jobs" are finished.
+    /// Must be called subsequently after several calls of doDecompressDataReq.
+    void flushAsynchronousDecompressRequests();
+
+    /// Request id of the oldest decompression job still in flight, none if all are finished.
+    std::optional<UInt32> oldestAsynchronousDecompressRequest() const;
+
+    /// Compress or decompress all sub-streams as concurrent hardware jobs and busy waiting till they are finished.
+    /// A sub-stream that gets no job or whose job fails is processed by the software codec.
+    void doCompressDataParallel(std::vector<SubStream> & streams);
+    void doDecompressDataParallel(std::vector<SubStream> & streams);
+
+private:
+    void processSubStreams(std::vector<SubStream> & streams, bool compress);
+
+    /// LOG_INFO of a software fallback caused by an exhausted job pool, with the pool's acquire counters
+    void logAcquireFallback(const char * caller) const;
+
+    struct AsyncDecompressJob
+    {
+        qpl_job * job_ptr;
+        UInt32 job_id;
+        UInt32 request_id;
+        /// Kept for the software fallback, the job advances its own pointers
+        const char * source;
+        char * dest;
+        UInt32 source_size;
+        UInt32 uncompressed_size;
+        const DeflateQplDictionary * dictionary;
+        UInt64 submitted_ns;
+    };
+    /// In-flight decompression jobs in submission order. Each poll checks them all in one pass over the array
+    /// and compacts the unfinished ones to the front.
+    std::vector<AsyncDecompressJob> decomp_async_jobs;
+
+    struct AsyncCompressRequest
+    {
+        UInt32 job_id;
+        qpl_job * job_ptr;
+        UInt32 request_id;
+        /// Kept for the software fallback, the job advances its own pointers
+        const char * source;
+        UInt32 source_size;
+        char * dest;
+        UInt32 dest_size;
+        const DeflateQplDictionary * dictionary;
+        UInt64 submitted_ns;
+    };
+    /// Submitted compression jobs in submission order
+    std::vector<AsyncCompressRequest> comp_async_requests;
+    LoggerPtr log;
+    /// Provides a fallback in case of errors.
+    SoftwareCodecDeflateQpl & sw_codec;
+};
+
+class CompressionCodecDeflateQpl final : public ICompressionCodec
+{
+public:
+    /// With train_dictionary set this is DEFLATE_QPL_DICT: the codec samples the first blocks it compresses, trains a
+    /// dictionary from them and compresses later blocks with it. Every DEFLATE_QPL codec decompresses both kinds of block.
+    explicit CompressionCodecDeflateQpl(bool train_dictionary_ = false);
+    uint8_t getMethodByte() const override;
+    void updateHash(SipHash & hash) const override;
+
+    /// Asynchronous batched compression for callers with many blocks to compress (inserts, merges).
+    /// compressAsynchronous writes the block header to dest, submits the data and returns a request id. dest must hold
+    /// getCompressedReserveSize(source_size) bytes and, like source, stay valid until the flush.
+    /// flushAsynchronousCompressRequests waits for every submitted block and calls on_compressed(request_id, compressed_block_size)
+    /// in completion order; the sizes include the header, as returned by compress(). Request ids restart from 0 after a flush.
+    /// A block that gets no hardware job is compressed in software at submission, a failed hardware job is redone in software.
+    UInt32 compressAsynchronous(const char * source, UInt32 source_size, char * dest);
+    void flushAsynchronousCompressRequests(const std::function<void(UInt32, UInt32)> & on_compressed);
+
+    /// Partial flush on asynchronous mode: busy waiting till at least min_completed more blocks are decompressed, staying
+    /// asynchronous. Returns how many blocks, counting from the first one since the last full flush, are complete; a reader can
+    /// consume those while later blocks are still in flight.
+    size_t waitAsynchronousDecompressRequests(size_t min_completed);
+
+    /// ID of the dictionary the codec compresses with, none until it is trained
+    std::optional<UInt32> getDictionaryId() const;
+
+protected:
+    bool isCompression() const override { return true; }
+    bool isGenericCompression() const override { return true; }
+    bool isDeflateQpl() const override { return true; }
+
+    UInt32 doCompressData(const char * source, UInt32 source_size, char * dest) const override;
+    void doDecompressData(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size) const override;
+    /// Flush result for previous asynchronous decompression requests on asynchronous mode.
+    void flushAsynchronousDecompressRequests() override;
+
+private:
+    /// Blocks larger than one IAA transfer are split into independent sub-streams of at most MAX_HW_TRANSFER_SIZE bytes,
+    /// compressed as concurrent jobs. Layout of a split block, little-endian:
+    ///   UInt8 SPLIT_BLOCK_MARKER, UInt8 SPLIT_BLOCK_VERSION, UInt16 0, UInt32 uncompressed size of each sub-stream but
+    ///   the last, UInt32 count, UInt32 compressed size of each sub-stream, then the sub-streams one after another.
+    /// A single DEFLATE stream cannot start with SPLIT_BLOCK_MARKER (block type 3 is reserved), so both kinds stay readable.
+    static constexpr UInt32 MAX_HW_TRANSFER_SIZE = 2 * 1024 * 1024;
+    static constexpr UInt8 SPLIT_BLOCK_MARKER = 0xFF;
+    static constexpr UInt8 SPLIT_BLOCK_VERSION = 1;
+    static constexpr UInt32 splitBlockHeaderSize(UInt32 count) { return 12 + 4 * count; }
+
+    UInt32 compressSplitBlock(const char * source, UInt32 source_size, char * dest) const;
+    void decompressSplitBlock(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size) const;
+
+    /// A block compressed with a dictionary starts with UInt8 DICTIONARY_BLOCK_MARKER, UInt8 DICTIONARY_BLOCK_VERSION,
+    /// UInt16 raw dictionary size, UInt32 dictionary ID, UInt16 compressed dictionary size, UInt16 0, the dictionary
+    /// compressed as one DEFLATE stream, and then the block's DEFLATE stream. The block needs nothing outside itself, so
+    /// it stays readable wherever the part is fetched, restored or moved. Block type 3 is reserved, so a plain stream
+    /// cannot start with the marker either. Split blocks are never compressed with a dictionary.
+    static constexpr UInt8 DICTIONARY_BLOCK_MARKER = 0xFE;
+    static constexpr UInt8 DICTIONARY_BLOCK_VERSION = 2;
+    static constexpr UInt32 DICTIONARY_BLOCK_HEADER_SIZE = 12;
+
+    /// The dictionary to compress the block with. Until one is trained, samples the block and trains once enough
+    /// bytes are sampled; returns nullptr meanwhile.
+    const DeflateQplDictionary * dictionaryForBlock(const char * source, UInt32 source_size) const;
+    /// Writes the dictionary block header with the embedded dictionary to dest, returns its size
+    static UInt32 writeDictionaryBlockHeader(char * dest, const DeflateQplDictionary & dictionary);
+    /// The dictionary a dictionary block was compressed with, from the cache or built from the block, and the size of
+    /// its header. Throws for a malformed header or dictionary.
+    std::shared_ptr<const DeflateQplDictionary> readDictionaryBlockHeader(const char * source, UInt32 source_size, UInt32 & header_size) const;
+
+    UInt32 getMaxCompressedDataSize(UInt32 uncompressed_size) const override;
+    std::unique_ptr<SoftwareCodecDeflateQpl> sw_codec;
+    std::unique_ptr<HardwareCodecDeflateQpl> hw_codec;
+    /// Destination block of each asynchronous compression request and the size of its dictionary block header, indexed by request id
+    std::vector<std::pair<char *, UInt32>> async_compress_blocks;
+    /// Requests compressed in software at submission: request id - compressed data size
+    std::vector<std::pair<UInt32, UInt32>> async_compress_done;
+    /// Blocks decompressed on asynchronous mode since the last full flush, the next request id
+    mutable UInt32 async_decompress_requests = 0;
+
+    /// DEFLATE_QPL_DICT. DEFLATE_QPL_DICTIONARY_SIZE and DEFLATE_QPL_DICTIONARY_SAMPLE_KB (defaults: 4096 bytes, 256 KiB)
+    /// give the dictionary size and the bytes sampled before training.
+    const bool train_dictionary;
+    size_t dictionary_size = 4096;
+    size_t dictionary_sample_bytes = 256 * 1024;
+    /// The trained dictionary, set once under dictionary_mutex. The codec keeps it alive after the registry drops it,
+    /// so the pointer stays valid once published.
+    mutable std::shared_ptr<const DeflateQplDictionary> trained_dictionary;
+    mutable std::atomic<const DeflateQplDictionary *> dictionary{nullptr};
+    /// Dictionaries of the blocks decompressed on asynchronous mode, kept till the flush
+    mutable std::vector<std::shared_ptr<const DeflateQplDictionary>> async_decompress_dictionaries;
+    mutable std::mutex dictionary_mutex;
+    /// Guarded by dictionary_mutex
+    mutable std::vector<std::string> dictionary_samples;
+    mutable size_t sampled_bytes = 0;
+    mutable bool dictionary_training_done = false;
+};
+
+}
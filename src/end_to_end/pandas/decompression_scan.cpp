@@ -11,7 +11,8 @@
 #include <regex>
 #include <lz4.h>
 #include <zlib.h>
-#include <iomanip> 
+#include <iomanip>
+#include <cstring>
 
 #include "qpl/qpl.h"
 
@@ -114,8 +115,147 @@ void job_execution(qpl_job *job_ptr)
     }
 }
 
-double iaa_decompress_scan(std::string src_data_file_path, uint32_t iteration, const uint32_t queue_size, std::vector<qpl_job *>& job, std::vector<std::vector<uint8_t>>& mask, const uint32_t lower_boundary, const uint32_t upper_boundary, int* input_file_size, std::vector<uint32_t>& mask_length)
+// Runs the first enqueue_cnt jobs, one thread per job on the software path or submit & wait on the hardware path
+int run_jobs(std::vector<qpl_job *>& job, int enqueue_cnt, qpl_path_t execution_path)
 {
+    qpl_status status;
+    if (execution_path == qpl_path_software) {
+        std::vector<std::thread *> job_th;
+        job_th.resize(enqueue_cnt);
+        for (int i = 0; i < enqueue_cnt; ++i) { job_th[i] = new std::thread(job_execution, job[i]); }
+        for (int i = 0; i < enqueue_cnt; ++i) { job_th[i]->join(); }
+        for (int i = 0; i < enqueue_cnt; ++i) { delete job_th[i]; }
+        return 0;
+    }
+    for (int i = 0; i < enqueue_cnt; ++i) {
+        status = qpl_submit_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job submission." << std::endl;
+            return 1;
+        }
+    }
+    for (int i = 0; i < enqueue_cnt; ++i) {
+        status = qpl_wait_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job waiting." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Loads <src_data_file_path>.<file_id> into src_vector and returns its size, or -1 if the chunk file is missing
+int64_t read_compressed_chunk(const std::string& src_data_file_path, uint32_t file_id, std::vector<uint8_t>& src_vector)
+{
+    std::ifstream src_file;
+    src_file.open(src_data_file_path + "." + std::to_string(file_id), std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << src_data_file_path + "." + std::to_string(file_id) << std::endl;
+        return -1;
+    }
+    src_file.seekg(0, std::ios::end);
+    std::size_t src_file_size = static_cast<std::size_t>(src_file.tellg());
+    src_file.seekg(0, std::ios::beg);
+    src_vector.resize(src_file_size);
+    src_file.read(reinterpret_cast<char *>(&src_vector.front()), src_file_size);
+    src_file.close();
+    return static_cast<int64_t>(src_file_size);
+}
+
+// Counts the <column>.bin.iaa.compressed.<k> chunk files of every column in src_data_file_dir
+std::vector<uint32_t> count_compressed_chunks(const std::string& src_data_file_dir, const std::vector<std::string>& columns)
+{
+    std::vector<uint32_t> iteration(columns.size(), 0);
+    for (const auto& entry : std::filesystem::directory_iterator(src_data_file_dir)) {
+        if (entry.is_regular_file()) {
+            const std::string filename = entry.path().filename().string();
+            for (size_t i = 0; i < columns.size(); ++i) {
+                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
+                if (std::regex_search(filename, pattern)) {
+                    iteration[i]++;
+                }
+            }
+        }
+    }
+    return iteration;
+}
+
+/**
+ * Physical layout of one compressed column.
+ * Columns compressed by iaa_lineitem_compression with a storage encoding are chunked by row count and described by
+ * <column>.bin.iaa.compressed.meta, so chunk k of every column covers the same rows whatever the column width.
+ * Without the metadata file the column is a legacy 32-bit column chunked by chunk_size bytes, and its last chunk
+ * is sized from the original .bin file.
+ */
+struct column_layout {
+    std::string encoding = "32";
+    uint32_t bit_width = input_vector_width;
+    std::vector<uint32_t> chunk_rows;
+};
+
+int load_column_layout(const std::string& compressed_file_path, const std::string& orig_file_path, uint32_t iteration, column_layout& layout)
+{
+    layout = column_layout();
+    std::ifstream meta_file(compressed_file_path + ".meta");
+    if (meta_file) {
+        std::string key;
+        while (meta_file >> key) {
+            if (key == "encoding") { meta_file >> layout.encoding; }
+            else if (key == "bit_width") { meta_file >> layout.bit_width; }
+            else if (key == "chunk") {
+                uint32_t k = 0, rows = 0;
+                std::size_t bytes = 0, compressed_bytes = 0;
+                meta_file >> k >> rows >> bytes >> compressed_bytes;
+                layout.chunk_rows.push_back(rows);
+            } else {
+                std::string value;
+                meta_file >> value;
+            }
+        }
+        if (layout.chunk_rows.size() != iteration) {
+            std::cout << "Chunk metadata of " << compressed_file_path << " lists " << layout.chunk_rows.size() << " chunks, found " << iteration << " files" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    int file_size = 0;
+    getFileSize(orig_file_path, &file_size);
+    if (file_size < 0) { return 1; }
+    for (uint32_t k = 0; k < iteration; k++) {
+        std::size_t bytes = k == iteration - 1 ? file_size - chunk_size * (iteration - 1) : chunk_size;
+        layout.chunk_rows.push_back(static_cast<uint32_t>(bytes / (input_vector_width / 8)));
+    }
+    return 0;
+}
+
+// Columns compressed with a storage encoding carry chunk metadata and may be narrower than 32 bits
+bool has_column_metadata(const std::string& src_data_file_dir, const std::vector<std::string>& columns)
+{
+    for (const auto& column : columns) {
+        if (std::filesystem::exists(src_data_file_dir + column + ".bin.iaa.compressed.meta")) { return true; }
+    }
+    return false;
+}
+
+// Row-aligned masks require every column of a query to have the same rows in every chunk
+bool layouts_aligned(const std::vector<column_layout>& layouts)
+{
+    for (const auto& layout : layouts) {
+        if (layout.chunk_rows != layouts.front().chunk_rows) { return false; }
+    }
+    return true;
+}
+
+// Translates a query boundary to the stored encoding of the column (date16 stores days since epoch)
+uint32_t encode_boundary(const column_layout& layout, uint32_t value)
+{
+    if (layout.encoding == "date16") { return value / 86400; }
+    return value;
+}
+
+double iaa_decompress_scan(std::string src_data_file_path, const column_layout& layout, const uint32_t queue_size, std::vector<qpl_job *>& job, std::vector<std::vector<uint8_t>>& mask, const uint32_t lower_boundary, const uint32_t upper_boundary, std::vector<uint32_t>& mask_length)
+{
+    const uint32_t iteration = static_cast<uint32_t>(layout.chunk_rows.size());
     qpl_path_t execution_path = qpl_path_hardware;
     std::vector<std::vector<uint8_t>> src_vector;
     qpl_status                              status;
@@ -142,15 +282,11 @@ double iaa_decompress_scan(std::string src_data_file_path, uint32_t iteration, c
             job[i]->next_out_ptr   = mask[file_id].data();
             job[i]->available_in   = src_file_size;
             job[i]->available_out  = chunk_size;
-            job[i]->src1_bit_width     = input_vector_width;
+            job[i]->src1_bit_width     = layout.bit_width;
             job[i]->out_bit_width      = qpl_ow_nom;
-            job[i]->param_low          = lower_boundary;
-            job[i]->param_high         = upper_boundary;
-            int num_input_elements = chunk_size;
-            if (file_id == iteration - 1) {
-                num_input_elements = *input_file_size - chunk_size * (iteration - 1);
-            }
-            job[i]->num_input_elements = static_cast<uint32_t>(num_input_elements)/ (input_vector_width / 8);
+            job[i]->param_low          = encode_boundary(layout, lower_boundary);
+            job[i]->param_high         = encode_boundary(layout, upper_boundary);
+            job[i]->num_input_elements = layout.chunk_rows[file_id];
             job[i]->flags          = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
             enqueue_cnt = i + 1;
             ++file_id;
@@ -194,8 +330,9 @@ double iaa_decompress_scan(std::string src_data_file_path, uint32_t iteration, c
     return elapsed_time_sec;
 }
 
-double iaa_decompress_select(std::string src_data_file_path, uint32_t iteration, const uint32_t queue_size, std::vector<qpl_job *>& job, std::vector<std::vector<uint8_t>>& dest_vector, int* input_file_size, std::vector<std::vector<uint8_t>> bitmap, uint32_t bit_width, std::vector<uint32_t> mask_length, std::vector<uint32_t>& total_out)
+double iaa_decompress_select(std::string src_data_file_path, const column_layout& layout, const uint32_t queue_size, std::vector<qpl_job *>& job, std::vector<std::vector<uint8_t>>& dest_vector, const std::vector<std::vector<uint8_t>>& bitmap, const std::vector<uint32_t>& mask_length, std::vector<uint32_t>& total_out)
 {
+    const uint32_t iteration = static_cast<uint32_t>(layout.chunk_rows.size());
     qpl_path_t execution_path = qpl_path_hardware;
     std::vector<std::vector<uint8_t>> src_vector;
     qpl_status                              status;
@@ -221,13 +358,9 @@ double iaa_decompress_select(std::string src_data_file_path, uint32_t iteration,
             job[i]->next_out_ptr   = dest_vector[file_id].data();
             job[i]->available_in   = src_file_size;
             job[i]->available_out  = chunk_size;
-            job[i]->src1_bit_width     = input_vector_width;
-            int num_input_elements = chunk_size;
-            if (file_id == iteration - 1) {
-                num_input_elements = *input_file_size - chunk_size * (iteration - 1);
-            }
-            job[i]->num_input_elements = static_cast<uint32_t>(num_input_elements) / (bit_width / 8);
-            job[i]->next_src2_ptr      = bitmap[file_id].data();
+            job[i]->src1_bit_width     = layout.bit_width;
+            job[i]->num_input_elements = layout.chunk_rows[file_id];
+            job[i]->next_src2_ptr      = const_cast<uint8_t *>(bitmap[file_id].data());
             job[i]->available_src2     = mask_length[file_id];
             job[i]->src2_bit_width     = 1;
             job[i]->flags          = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
@@ -487,7 +620,11 @@ int query_processing(std::string src_data_file_dir, std::string dest_data_file_d
     std::vector<std::string> columns = {
         "l_discount", "l_quantity", "l_shipdate", "l_extendedprice"
     };
-    
+    // This path concatenates byte chunks and scans them as 32-bit values, which narrowed columns are not
+    if (has_column_metadata(src_data_file_dir, columns)) {
+        std::cout << "Columns in " << src_data_file_dir << " have chunk metadata (.meta); this path reads legacy 32-bit columns only" << std::endl;
+        return 1;
+    }
 
     for (const auto& entry : std::filesystem::directory_iterator(src_data_file_dir)) {
         if (entry.is_regular_file()) {
@@ -496,7 +633,7 @@ int query_processing(std::string src_data_file_dir, std::string dest_data_file_d
             // Check each column for a match
             for (size_t i = 0; i < columns.size(); ++i) {
                 // Create the regex pattern for each column
-                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\..*)");
+                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
                 
                 // Check if the filename matches the regex pattern
                 if (std::regex_search(filename, pattern)) {
@@ -710,7 +847,7 @@ int pipeliined_query_processing(std::string orig_file_path, std::string src_data
             // Check each column for a match
             for (size_t i = 0; i < columns.size(); ++i) {
                 // Create the regex pattern for each column
-                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\..*)");
+                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
                 
                 // Check if the filename matches the regex pattern
                 if (std::regex_search(filename, pattern)) {
@@ -791,32 +928,34 @@ int pipeliined_query_processing(std::string orig_file_path, std::string src_data
         discount_result[i].resize(chunk_size);
     }
 
+    // Chunk layouts: all columns must cover the same rows per chunk so that their masks line up
+    std::vector<column_layout> layout(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (load_column_layout(src_data_file_dir + columns[i] + ".bin.iaa.compressed", orig_file_path + columns[i] + ".bin", iteration[i], layout[i]) != 0) {
+            return 1;
+        }
+    }
+    if (!layouts_aligned(layout)) {
+        std::cout << "Columns are not chunked by the same row counts; recompress them with a storage encoding." << std::endl;
+        return 1;
+    }
+
     // shipdate
     std::string shipdate_src_file_path = src_data_file_dir + columns[2] + ".bin.iaa.compressed";
     uint32_t shipdate_iteration = iteration[2];
     std::string shipdate_orig_file_path = orig_file_path + columns[2] + ".bin";
-    int fileSize = 0;
-    getFileSize(shipdate_orig_file_path, &fileSize);
-    // baseline_iaa_decompress_scan(shipdate_src_file_path, shipdate_iteration, queue_size, job, shipdate_mask, shipdate_lower_boundary, shipdate_upper_boundary, &fileSize, mask_length);
-    double res = iaa_decompress_scan(shipdate_src_file_path, shipdate_iteration, queue_size, job, shipdate_mask, shipdate_lower_boundary, shipdate_upper_boundary, &fileSize, mask_length);
+    double res = iaa_decompress_scan(shipdate_src_file_path, layout[2], queue_size, job, shipdate_mask, shipdate_lower_boundary, shipdate_upper_boundary, mask_length);
     if(res == -1) {return 0;}
     scan_elapsed_time_sec += res;
     // discount
     std::string discount_src_file_path = src_data_file_dir + columns[0] + ".bin.iaa.compressed";
-    uint32_t discount_iteration = iteration[0];
     std::string discount_orig_file_path = orig_file_path + columns[0] + ".bin";
-    fileSize = 0;
-    getFileSize(discount_orig_file_path, &fileSize);
-    res = iaa_decompress_scan(discount_src_file_path, discount_iteration, queue_size, job, discount_mask, discount_lower_boundary, discount_upper_boundary, &fileSize, mask_length);
+    res = iaa_decompress_scan(discount_src_file_path, layout[0], queue_size, job, discount_mask, discount_lower_boundary, discount_upper_boundary, mask_length);
     if(res == -1) {return 0;}
     scan_elapsed_time_sec += res;
     // quantity
     std::string quantity_src_file_path = src_data_file_dir + columns[1] + ".bin.iaa.compressed";
-    uint32_t quantity_iteration = iteration[1];
-    std::string quantity_orig_file_path = orig_file_path + columns[1] + ".bin";
-    fileSize = 0;
-    getFileSize(quantity_orig_file_path, &fileSize);
-    res = iaa_decompress_scan(quantity_src_file_path, quantity_iteration, queue_size, job, quantity_mask, quantity_lower_boundary, quantity_upper_boundary, &fileSize, mask_length);
+    res = iaa_decompress_scan(quantity_src_file_path, layout[1], queue_size, job, quantity_mask, quantity_lower_boundary, quantity_upper_boundary, mask_length);
     if(res == -1) {return 0;}
     scan_elapsed_time_sec += res;
     
@@ -834,20 +973,13 @@ int pipeliined_query_processing(std::string orig_file_path, std::string src_data
 
     // discount
     std::string sel_discount_src_file_path = src_data_file_dir + columns[0] + ".bin.iaa.compressed";
-    uint32_t sel_discount_iteration = iteration[0];
-    std::string sel_discount_orig_file_path = orig_file_path + columns[0] + ".bin";
-    fileSize = 0;
-    getFileSize(sel_discount_orig_file_path, &fileSize);
-    res = iaa_decompress_select(sel_discount_src_file_path, sel_discount_iteration, queue_size, sel_job, discount_result, &fileSize, combination_mask1, 32, mask_length, total_out);
+    res = iaa_decompress_select(sel_discount_src_file_path, layout[0], queue_size, sel_job, discount_result, combination_mask1, mask_length, total_out);
     if (res == -1) {return 0;}
     select_elapsed_time_sec += res;
     // extended_price
     std::string sel_extended_price_src_file_path = src_data_file_dir + columns[3] + ".bin.iaa.compressed";
-    uint32_t sel_extended_price_iteration = iteration[3];
     std::string sel_extended_price_orig_file_path = orig_file_path + columns[3] + ".bin";
-    fileSize = 0;
-    getFileSize(sel_extended_price_orig_file_path, &fileSize);
-    res = iaa_decompress_select(sel_extended_price_src_file_path, sel_extended_price_iteration, queue_size, sel_job, extend_result, &fileSize, combination_mask1, 32, mask_length, total_out);
+    res = iaa_decompress_select(sel_extended_price_src_file_path, layout[3], queue_size, sel_job, extend_result, combination_mask1, mask_length, total_out);
     float aggregation_sum = 0.0;
     for (int i = 0; i < queue_size; ++i) {
         uint32_t sum_value = sel_job[i]->sum_value;
@@ -935,6 +1067,671 @@ int pipeliined_query_processing(std::string orig_file_path, std::string src_data
     return 0;
 }
 
+// Converts the first num_bits bits of a little-endian bitmap (qpl_ow_nom layout) into a list of set row indices
+void bitmap_to_index(const uint8_t* bitmap, uint32_t num_bits, std::vector<uint32_t>& indices)
+{
+    indices.clear();
+    uint32_t num_bytes = (num_bits + 7) / 8;
+    uint32_t byte_idx = 0;
+    for (; byte_idx + 8 <= num_bytes; byte_idx += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, bitmap + byte_idx, sizeof(word));
+        while (word) {
+            uint32_t idx = byte_idx * 8 + static_cast<uint32_t>(__builtin_ctzll(word));
+            if (idx < num_bits) { indices.push_back(idx); }
+            word &= word - 1;
+        }
+    }
+    for (; byte_idx < num_bytes; byte_idx++) {
+        uint32_t byte = bitmap[byte_idx];
+        while (byte) {
+            uint32_t idx = byte_idx * 8 + static_cast<uint32_t>(__builtin_ctz(byte));
+            if (idx < num_bits) { indices.push_back(idx); }
+            byte &= byte - 1;
+        }
+    }
+}
+
+uint32_t bitmap_popcount(const uint8_t* bitmap, uint32_t num_bytes)
+{
+    uint32_t count = 0;
+    uint32_t byte_idx = 0;
+    for (; byte_idx + 8 <= num_bytes; byte_idx += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, bitmap + byte_idx, sizeof(word));
+        count += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    for (; byte_idx < num_bytes; byte_idx++) { count += static_cast<uint32_t>(__builtin_popcount(bitmap[byte_idx])); }
+    return count;
+}
+
+/**
+ * Mini-block index written by iaa_lineitem_compression --index=<bytes>: per chunk, the bit offsets (low 32 bits) of
+ * the block header, of every mini-block and of the end of block. Columns without a .index file get mini_block_size 0.
+ */
+int load_column_index(const std::string& compressed_file_path, uint32_t iteration, uint32_t& mini_block_size, std::vector<std::vector<uint64_t>>& index)
+{
+    mini_block_size = 0;
+    index.clear();
+    std::ifstream index_file(compressed_file_path + ".index");
+    if (!index_file) { return 0; }
+    std::string key;
+    while (index_file >> key) {
+        if (key == "mini_block_size") { index_file >> mini_block_size; }
+        else if (key == "chunk") {
+            uint32_t k = 0, entries = 0;
+            index_file >> k >> entries;
+            index.emplace_back(entries);
+            for (auto& entry : index.back()) { index_file >> entry; }
+        }
+    }
+    if (index.size() != iteration || mini_block_size == 0) {
+        std::cout << "Mini-block index of " << compressed_file_path << " lists " << index.size() << " chunks, found " << iteration << " files" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Bit range [begin_bit, end_bit) of a chunk's compressed stream
+struct bit_range {
+    uint64_t begin_bit;
+    uint64_t end_bit;
+};
+
+// Points the job at a bit range of the compressed chunk for a random-access decompression (QPL_FLAG_RND_ACCESS)
+void set_random_access_input(qpl_job* job_ptr, const std::vector<uint8_t>& chunk, bit_range range)
+{
+    job_ptr->next_in_ptr       = const_cast<uint8_t*>(chunk.data()) + range.begin_bit / 8;
+    job_ptr->available_in      = static_cast<uint32_t>((range.end_bit + 7) / 8 - range.begin_bit / 8);
+    job_ptr->ignore_start_bits = static_cast<uint32_t>(range.begin_bit & 7);
+    job_ptr->ignore_end_bits   = static_cast<uint32_t>((8 - (range.end_bit & 7)) & 7);
+}
+
+/**
+ * Late materialization for the pipelined path.
+ * The combined Q6 mask of each chunk is inspected once. Chunks without a selected row are skipped: the projected
+ * columns are not read for them at all. Chunks whose selectivity is at least `selectivity_threshold` keep the bitmap
+ * select (decompress + select per projected column). Sparser chunks are turned into a 32-bit row index list once and
+ * the projected columns are gathered on the CPU at the listed rows only. With a mini-block index
+ * (iaa_lineitem_compression --index=<bytes>) only the block header and the mini-blocks covering [first selected row,
+ * last selected row] are decompressed. Without one, `qpl_op_extract` over that row range still has to decode the
+ * chunk's stream from its start, so it saves output bytes but no decompression.
+ * The default threshold 1/32 is where a 32-bit index list becomes smaller than the 1-bit mask.
+ */
+int late_materialization_query_processing(std::string orig_file_path, std::string src_data_file_dir, const uint32_t queue_size, double selectivity_threshold)
+{
+    std::cout << "[IAA with Pipelining Functionality and Late Materialization]" << std::endl;
+    std::vector<std::string> columns = {
+        "l_discount", "l_quantity", "l_shipdate", "l_extendedprice"
+    };
+    std::vector<uint32_t> iteration = count_compressed_chunks(src_data_file_dir, columns);
+    const qpl_path_t execution_path = qpl_path_hardware;
+
+    // Job initialization
+    std::vector<std::unique_ptr<uint8_t[]>> job_buffer;
+    std::vector<qpl_job *>                  job;
+    qpl_status                              status;
+    uint32_t                                size = 0;
+
+    job_buffer.resize(queue_size);
+    job.resize(queue_size);
+    status = qpl_get_job_size(execution_path, &size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < queue_size; ++i) {
+        job_buffer[i] = std::make_unique<uint8_t[]>(size);
+        job[i] = reinterpret_cast<qpl_job *>(job_buffer[i].get());
+        status = qpl_init_job(execution_path, job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+            return 1;
+        }
+    }
+
+    uint32_t num_chunks = iteration[2];
+    std::vector<std::vector<uint8_t>> shipdate_mask(num_chunks);
+    std::vector<std::vector<uint8_t>> discount_mask(num_chunks);
+    std::vector<std::vector<uint8_t>> quantity_mask(num_chunks);
+    std::vector<uint32_t> mask_length(num_chunks);
+    for (uint32_t i = 0; i < num_chunks; i++) {
+        shipdate_mask[i].resize(chunk_size);
+        discount_mask[i].resize(chunk_size);
+        quantity_mask[i].resize(chunk_size);
+    }
+
+    std::vector<column_layout> layout(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (load_column_layout(src_data_file_dir + columns[i] + ".bin.iaa.compressed", orig_file_path + columns[i] + ".bin", iteration[i], layout[i]) != 0) {
+            return 1;
+        }
+    }
+    if (!layouts_aligned(layout)) {
+        std::cout << "Columns are not chunked by the same row counts; recompress them with a storage encoding." << std::endl;
+        return 1;
+    }
+
+    // Decompress + scan of the three predicate columns, as in the pipelined path
+    double scan_elapsed_time_sec = 0;
+    double res = iaa_decompress_scan(src_data_file_dir + columns[2] + ".bin.iaa.compressed", layout[2], queue_size, job, shipdate_mask, shipdate_lower_boundary, shipdate_upper_boundary, mask_length);
+    if (res == -1) { return 1; }
+    scan_elapsed_time_sec += res;
+    res = iaa_decompress_scan(src_data_file_dir + columns[0] + ".bin.iaa.compressed", layout[0], queue_size, job, discount_mask, discount_lower_boundary, discount_upper_boundary, mask_length);
+    if (res == -1) { return 1; }
+    scan_elapsed_time_sec += res;
+    res = iaa_decompress_scan(src_data_file_dir + columns[1] + ".bin.iaa.compressed", layout[1], queue_size, job, quantity_mask, quantity_lower_boundary, quantity_upper_boundary, mask_length);
+    if (res == -1) { return 1; }
+    scan_elapsed_time_sec += res;
+
+    // Combine masks and pick the materialization strategy per chunk
+    std::chrono::duration<int64_t, std::nano> mask_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::vector<std::vector<uint8_t>> combination_mask(num_chunks);
+    std::vector<std::vector<uint32_t>> row_index(num_chunks);
+    std::vector<uint32_t> num_elements(num_chunks);
+    std::vector<bool> use_index(num_chunks, false);
+    std::vector<uint32_t> selected_chunks;
+    uint32_t index_chunks = 0;
+    for (uint32_t j = 0; j < num_chunks; j++) {
+        num_elements[j] = layout[2].chunk_rows[j];
+        std::size_t s = mask_length[j];
+        combination_mask[j].resize(chunk_size);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::size_t k = 0; k < s; k++) {
+            combination_mask[j][k] = shipdate_mask[j][k] & discount_mask[j][k] & quantity_mask[j][k];
+        }
+        uint32_t selected = bitmap_popcount(combination_mask[j].data(), static_cast<uint32_t>(s));
+        if (selected != 0) { selected_chunks.push_back(j); }
+        if (selected != 0 && static_cast<double>(selected) < selectivity_threshold * num_elements[j]) {
+            use_index[j] = true;
+            index_chunks++;
+            bitmap_to_index(combination_mask[j].data(), num_elements[j], row_index[j]);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        mask_elapsed_time_ns += end - start;
+    }
+
+    // Materialize l_discount and l_extendedprice of the chunks with selected rows: bitmap select, or a gather from
+    // the covering mini-blocks (or a narrow extract without an index)
+    std::chrono::duration<int64_t, std::nano> select_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> sum_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::vector<std::vector<uint8_t>> src_vector(queue_size);
+    std::vector<std::vector<uint8_t>> discount_result(queue_size);
+    std::vector<std::vector<uint8_t>> extend_result(queue_size);
+    std::vector<std::vector<uint8_t>>* projection_result[2] = {&discount_result, &extend_result};
+    std::string projection_file_path[2] = {
+        src_data_file_dir + columns[0] + ".bin.iaa.compressed", src_data_file_dir + columns[3] + ".bin.iaa.compressed"
+    };
+    const uint32_t projection_bit_width[2] = {layout[0].bit_width, layout[3].bit_width};
+    uint32_t mini_block_size[2] = {0, 0};
+    std::vector<std::vector<uint64_t>> mini_block_index[2];
+    for (int col = 0; col < 2; col++) {
+        if (load_column_index(projection_file_path[col], num_chunks, mini_block_size[col], mini_block_index[col]) != 0) { return 1; }
+    }
+    // Byte offset in the chunk of the first byte each job wrote, per projected column
+    std::vector<uint32_t> output_base[2] = {std::vector<uint32_t>(queue_size, 0), std::vector<uint32_t>(queue_size, 0)};
+    std::vector<uint32_t> projection_length(queue_size, 0);
+    std::vector<qpl_job *> mini_block_job;
+    std::vector<bool> random_access(queue_size, false);
+    std::vector<bit_range> mini_block_range(queue_size);
+    std::size_t select_output_bytes = 0;
+    std::size_t extract_output_bytes = 0;
+    std::size_t compressed_input_bytes = 0;
+    std::size_t skipped_input_bytes = 0;
+    for (uint32_t i = 0; i < queue_size; i++) {
+        discount_result[i].resize(chunk_size);
+        extend_result[i].resize(chunk_size);
+    }
+    double sum = 0;
+    for (uint32_t next = 0; next < selected_chunks.size();) {
+        int enqueue_cnt = static_cast<int>(std::min<std::size_t>(queue_size, selected_chunks.size() - next));
+        for (int col = 0; col < 2; col++) {
+            mini_block_job.clear();
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                uint32_t chunk = selected_chunks[next + i];
+                int64_t src_file_size = read_compressed_chunk(projection_file_path[col], chunk, src_vector[i]);
+                if (src_file_size < 0) { return 1; }
+                job[i]->next_out_ptr       = (*projection_result[col])[i].data();
+                job[i]->available_out      = chunk_size;
+                job[i]->ignore_start_bits  = 0;
+                job[i]->ignore_end_bits    = 0;
+                output_base[col][i]        = 0;
+                random_access[i]           = use_index[chunk] && mini_block_size[col] != 0;
+                const std::vector<uint32_t>& rows = row_index[chunk];
+                if (random_access[i]) {
+                    // Block header first (loads the Huffman tables into the job), then the covering mini-blocks
+                    const uint32_t value_bytes = projection_bit_width[col] / 8;
+                    const uint32_t first = rows.front() * value_bytes / mini_block_size[col];
+                    const uint32_t last = (rows.back() * value_bytes + value_bytes - 1) / mini_block_size[col];
+                    const std::vector<uint64_t>& index = mini_block_index[col][chunk];
+                    if (index.size() < last + 3) {
+                        std::cout << "Mini-block index of " << projection_file_path[col] << " chunk " << chunk << " is too short" << std::endl;
+                        return 1;
+                    }
+                    const bit_range header = {index[0] & 0xffffffffu, index[1] & 0xffffffffu};
+                    mini_block_range[i] = {index[1 + first] & 0xffffffffu, index[2 + last] & 0xffffffffu};
+                    const std::size_t read_bytes = (header.end_bit - header.begin_bit + 7) / 8 + (mini_block_range[i].end_bit - mini_block_range[i].begin_bit + 7) / 8;
+                    set_random_access_input(job[i], src_vector[i], header);
+                    job[i]->op             = qpl_op_decompress;
+                    job[i]->flags          = QPL_FLAG_FIRST | QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+                    output_base[col][i]    = first * mini_block_size[col];
+                    compressed_input_bytes += read_bytes;
+                    skipped_input_bytes += static_cast<std::size_t>(src_file_size) - std::min<std::size_t>(read_bytes, static_cast<std::size_t>(src_file_size));
+                    mini_block_job.push_back(job[i]);
+                    continue;
+                }
+                job[i]->next_in_ptr        = src_vector[i].data();
+                job[i]->available_in       = static_cast<uint32_t>(src_file_size);
+                job[i]->src1_bit_width     = projection_bit_width[col];
+                job[i]->num_input_elements = num_elements[chunk];
+                job[i]->out_bit_width      = qpl_ow_nom;
+                job[i]->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+                compressed_input_bytes += static_cast<std::size_t>(src_file_size);
+                if (use_index[chunk]) {
+                    job[i]->op             = qpl_op_extract;
+                    job[i]->param_low      = rows.front();
+                    job[i]->param_high     = rows.back();
+                    output_base[col][i]    = rows.front() * (projection_bit_width[col] / 8);
+                } else {
+                    job[i]->op             = qpl_op_select;
+                    job[i]->next_src2_ptr  = combination_mask[chunk].data();
+                    job[i]->available_src2 = mask_length[chunk];
+                    job[i]->src2_bit_width = 1;
+                }
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            if (run_jobs(job, enqueue_cnt, execution_path) != 0) { return 1; }
+            // Second round on the same jobs: the mini-blocks, decoded with the tables of their block header
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                if (!random_access[i]) { continue; }
+                set_random_access_input(job[i], src_vector[i], mini_block_range[i]);
+                job[i]->next_out_ptr   = (*projection_result[col])[i].data();
+                job[i]->available_out  = chunk_size;
+                job[i]->flags          = QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+            }
+            if (!mini_block_job.empty() && run_jobs(mini_block_job, static_cast<int>(mini_block_job.size()), execution_path) != 0) { return 1; }
+            auto end = std::chrono::high_resolution_clock::now();
+            select_elapsed_time_ns += end - start;
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                job[i]->ignore_start_bits = 0;
+                job[i]->ignore_end_bits   = 0;
+                projection_length[i] = job[i]->total_out;
+                if (use_index[selected_chunks[next + i]]) { extract_output_bytes += job[i]->total_out; }
+                else { select_output_bytes += job[i]->total_out; }
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < enqueue_cnt; ++i) {
+            uint32_t chunk = selected_chunks[next + i];
+            if (use_index[chunk]) {
+                for (uint32_t row : row_index[chunk]) {
+                    float f1 = 0;
+                    float f2 = 0;
+                    std::memcpy(&f1, discount_result[i].data() + (row * 4 - output_base[0][i]), sizeof(float));
+                    std::memcpy(&f2, extend_result[i].data() + (row * 4 - output_base[1][i]), sizeof(float));
+                    sum += static_cast<double>(f1) * f2;
+                }
+            } else {
+                for (uint32_t j = 0; j < projection_length[i] / 4; j++) {
+                    float f1 = 0;
+                    float f2 = 0;
+                    std::memcpy(&f1, discount_result[i].data() + j * 4, sizeof(float));
+                    std::memcpy(&f2, extend_result[i].data() + j * 4, sizeof(float));
+                    sum += static_cast<double>(f1) * f2;
+                }
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        sum_elapsed_time_ns += end - start;
+        next += enqueue_cnt;
+    }
+
+    double mask_elapsed_time_sec = static_cast<double>(mask_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double select_elapsed_time_sec = static_cast<double>(select_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double sum_elapsed_time_sec = static_cast<double>(sum_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double total_elapsed_time_sec = scan_elapsed_time_sec + mask_elapsed_time_sec + select_elapsed_time_sec + sum_elapsed_time_sec;
+    std::cout << "[Result Summary]" << std::endl;
+    std::cout << "Index-gather chunks: " << index_chunks << " / " << num_chunks << " (threshold " << selectivity_threshold << "), "
+              << num_chunks - selected_chunks.size() << " chunks without selected rows skipped" << std::endl;
+    std::cout << "Mini-block index: l_discount " << (mini_block_size[0] ? std::to_string(mini_block_size[0]) + " Bytes" : std::string("none"))
+              << ", l_extendedprice " << (mini_block_size[1] ? std::to_string(mini_block_size[1]) + " Bytes" : std::string("none")) << std::endl;
+    std::cout << "Compressed input = " << compressed_input_bytes << " Bytes (" << skipped_input_bytes << " Bytes outside the covering mini-blocks not decompressed)" << std::endl;
+    std::cout << "Select output = " << select_output_bytes << " Bytes, gather input = " << extract_output_bytes << " Bytes" << std::endl;
+    std::cout <<  "(Scan) Time take: " << scan_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Mask) Time take: " << mask_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Select) Time take: " << select_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Sum) Time take: " << sum_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Total) Time take: " << total_elapsed_time_sec << " sec" << std::endl;
+    std::cout << "sum: " << sum << std::endl;
+
+    for (int i = 0; i < queue_size; ++i) {
+        status = qpl_fini_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Batched filter-aggregate execution.
+ * Every query of the batch is `sum(product_column1 * product_column2) where <range predicates>` over the same
+ * lineitem columns. Each column chunk is decompressed once per batch and the decompressed chunk is shared by the
+ * scan and select jobs of every query, so the compressed bytes streamed through the accelerator scale with the
+ * number of distinct columns instead of (queries x columns). Identical predicates of different queries are scanned once.
+ */
+struct range_predicate {
+    uint32_t column;            // index into the batch column list
+    uint32_t lower_boundary;
+    uint32_t upper_boundary;
+};
+
+struct filter_aggregate_query {
+    std::vector<range_predicate> predicates;
+    uint32_t product_column1;
+    uint32_t product_column2;
+};
+
+// Bit pattern of a non-negative float32, which orders the same way as the float itself
+uint32_t float_boundary(double value)
+{
+    float f = static_cast<float>(value);
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// Unix timestamp of <year>-01-01, matching the date encoding of split_lineitem.py
+uint32_t year_start_timestamp(int year)
+{
+    uint32_t days = 0;
+    for (int y = 1970; y < year; y++) {
+        days += ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 366 : 365;
+    }
+    return days * 86400;
+}
+
+// TPC-H Q6 instances with the substitution parameters of the spec (DATE, DISCOUNT, QUANTITY);
+// the first query is the validation instance ('1994-01-01', 0.06, 24) used by the other modes.
+// Column indices follow {"l_discount", "l_quantity", "l_shipdate", "l_extendedprice"}.
+std::vector<filter_aggregate_query> build_q6_batch(uint32_t num_queries)
+{
+    std::vector<filter_aggregate_query> queries(num_queries);
+    for (uint32_t q = 0; q < num_queries; q++) {
+        int year = 1993 + static_cast<int>((1 + q) % 5);             // [1993, 1997]
+        int discount = 2 + static_cast<int>((4 + q / 5) % 8);        // [0.02, 0.09] in hundredths
+        uint32_t quantity = 24 + (q / 40) % 2;                       // [24, 25]
+        queries[q].predicates.push_back({2, year_start_timestamp(year), year_start_timestamp(year + 1) - 1});
+        queries[q].predicates.push_back({0, float_boundary((discount - 1) / 100.0) - 1, float_boundary((discount + 1) / 100.0)});
+        queries[q].predicates.push_back({1, 0, quantity - 1});
+        queries[q].product_column1 = 3;
+        queries[q].product_column2 = 0;
+    }
+    return queries;
+}
+
+int batched_query_processing(std::string orig_file_path, std::string src_data_file_dir, qpl_path_t execution_path, const uint32_t queue_size, const uint32_t num_queries)
+{
+    std::cout << "[IAA Batched Queries with Shared Decompression]" << std::endl;
+    std::vector<std::string> columns = {
+        "l_discount", "l_quantity", "l_shipdate", "l_extendedprice"
+    };
+    std::vector<uint32_t> iteration = count_compressed_chunks(src_data_file_dir, columns);
+    std::vector<filter_aggregate_query> queries = build_q6_batch(num_queries);
+
+    // Distinct predicates and columns of the batch
+    std::vector<range_predicate> unique_predicates;
+    std::vector<std::vector<uint32_t>> query_predicates(queries.size());
+    std::vector<bool> column_used(columns.size(), false);
+    for (size_t q = 0; q < queries.size(); q++) {
+        for (const auto& p : queries[q].predicates) {
+            size_t idx = 0;
+            while (idx < unique_predicates.size() &&
+                   !(unique_predicates[idx].column == p.column &&
+                     unique_predicates[idx].lower_boundary == p.lower_boundary &&
+                     unique_predicates[idx].upper_boundary == p.upper_boundary)) {
+                idx++;
+            }
+            if (idx == unique_predicates.size()) { unique_predicates.push_back(p); }
+            query_predicates[q].push_back(static_cast<uint32_t>(idx));
+            column_used[p.column] = true;
+        }
+        column_used[queries[q].product_column1] = true;
+        column_used[queries[q].product_column2] = true;
+    }
+    uint32_t num_chunks = 0;
+    std::vector<column_layout> layout(columns.size());
+    std::vector<column_layout> used_layout;
+    for (size_t c = 0; c < columns.size(); c++) {
+        if (!column_used[c]) { continue; }
+        if (load_column_layout(src_data_file_dir + columns[c] + ".bin.iaa.compressed", orig_file_path + columns[c] + ".bin", iteration[c], layout[c]) != 0) {
+            return 1;
+        }
+        used_layout.push_back(layout[c]);
+        num_chunks = iteration[c];
+    }
+    if (!used_layout.empty() && !layouts_aligned(used_layout)) {
+        std::cout << "Columns are not chunked by the same row counts; recompress them with a storage encoding." << std::endl;
+        return 1;
+    }
+    if (num_chunks == 0) {
+        std::cout << "No compressed chunks found in " << src_data_file_dir << std::endl;
+        return 1;
+    }
+    std::cout << "Queries: " << queries.size() << ", distinct predicates: " << unique_predicates.size() << ", chunks: " << num_chunks << std::endl;
+
+    // Job initialization
+    std::vector<std::unique_ptr<uint8_t[]>> job_buffer;
+    std::vector<qpl_job *>                  job;
+    qpl_status                              status;
+    uint32_t                                size = 0;
+
+    job_buffer.resize(queue_size);
+    job.resize(queue_size);
+    status = qpl_get_job_size(execution_path, &size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < queue_size; ++i) {
+        job_buffer[i] = std::make_unique<uint8_t[]>(size);
+        job[i] = reinterpret_cast<qpl_job *>(job_buffer[i].get());
+        status = qpl_init_job(execution_path, job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+            return 1;
+        }
+    }
+
+    // Per-round buffers: one decompressed chunk per column and queue slot, one mask per distinct predicate and queue slot
+    std::vector<std::vector<uint8_t>> src_vector(queue_size);
+    std::vector<std::vector<std::vector<uint8_t>>> decompressed(columns.size(), std::vector<std::vector<uint8_t>>(queue_size));
+    std::vector<std::vector<uint32_t>> decompressed_length(columns.size(), std::vector<uint32_t>(queue_size, 0));
+    std::vector<std::vector<std::vector<uint8_t>>> mask(unique_predicates.size(), std::vector<std::vector<uint8_t>>(queue_size));
+    std::vector<std::vector<uint32_t>> mask_length(unique_predicates.size(), std::vector<uint32_t>(queue_size, 0));
+    std::vector<std::vector<uint8_t>> combination_mask(queue_size);
+    std::vector<std::vector<uint8_t>> select_result1(queue_size);
+    std::vector<std::vector<uint8_t>> select_result2(queue_size);
+    for (size_t c = 0; c < columns.size(); c++) {
+        if (!column_used[c]) { continue; }
+        for (uint32_t i = 0; i < queue_size; i++) { decompressed[c][i].resize(chunk_size); }
+    }
+    for (size_t p = 0; p < unique_predicates.size(); p++) {
+        for (uint32_t i = 0; i < queue_size; i++) { mask[p][i].resize(chunk_size / 8); }
+    }
+    for (uint32_t i = 0; i < queue_size; i++) {
+        combination_mask[i].resize(chunk_size / 8);
+        select_result1[i].resize(chunk_size);
+        select_result2[i].resize(chunk_size);
+    }
+
+    std::vector<double> sum(queries.size(), 0);
+    std::vector<std::size_t> compressed_column_bytes(columns.size(), 0);
+    std::size_t decompressed_bytes = 0;
+    std::size_t scan_input_bytes = 0;
+    std::size_t select_input_bytes = 0;
+    std::chrono::duration<int64_t, std::nano> decompress_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> scan_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> mask_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> select_elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> sum_elapsed_time_ns = std::chrono::nanoseconds::zero();
+
+    for (uint32_t file_id = 0; file_id < num_chunks;) {
+        int enqueue_cnt = static_cast<int>(std::min<uint32_t>(queue_size, num_chunks - file_id));
+
+        // Decompress every distinct column chunk once
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (!column_used[c]) { continue; }
+            std::string src_data_file_path = src_data_file_dir + columns[c] + ".bin.iaa.compressed";
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                int64_t src_file_size = read_compressed_chunk(src_data_file_path, file_id + i, src_vector[i]);
+                if (src_file_size < 0) { return 1; }
+                job[i]->op             = qpl_op_decompress;
+                job[i]->level          = qpl_default_level;
+                job[i]->next_in_ptr    = src_vector[i].data();
+                job[i]->next_out_ptr   = decompressed[c][i].data();
+                job[i]->available_in   = static_cast<uint32_t>(src_file_size);
+                job[i]->available_out  = chunk_size;
+                job[i]->flags          = QPL_FLAG_FIRST | QPL_FLAG_OMIT_VERIFY | QPL_FLAG_LAST;
+                compressed_column_bytes[c] += static_cast<std::size_t>(src_file_size);
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            if (run_jobs(job, enqueue_cnt, execution_path) != 0) { return 1; }
+            auto end = std::chrono::high_resolution_clock::now();
+            decompress_elapsed_time_ns += end - start;
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                decompressed_length[c][i] = job[i]->total_out;
+                decompressed_bytes += job[i]->total_out;
+            }
+        }
+
+        // Scan the shared decompressed chunks once per distinct predicate
+        for (size_t p = 0; p < unique_predicates.size(); p++) {
+            uint32_t c = unique_predicates[p].column;
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                job[i]->op                 = qpl_op_scan_range;
+                job[i]->next_in_ptr        = decompressed[c][i].data();
+                job[i]->next_out_ptr       = mask[p][i].data();
+                job[i]->available_in       = decompressed_length[c][i];
+                job[i]->available_out      = static_cast<uint32_t>(mask[p][i].size());
+                job[i]->src1_bit_width     = layout[c].bit_width;
+                job[i]->num_input_elements = decompressed_length[c][i] / (layout[c].bit_width / 8);
+                job[i]->out_bit_width      = qpl_ow_nom;
+                job[i]->param_low          = encode_boundary(layout[c], unique_predicates[p].lower_boundary);
+                job[i]->param_high         = encode_boundary(layout[c], unique_predicates[p].upper_boundary);
+                job[i]->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+                scan_input_bytes += decompressed_length[c][i];
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            if (run_jobs(job, enqueue_cnt, execution_path) != 0) { return 1; }
+            auto end = std::chrono::high_resolution_clock::now();
+            scan_elapsed_time_ns += end - start;
+            for (int i = 0; i < enqueue_cnt; ++i) { mask_length[p][i] = job[i]->total_out; }
+        }
+
+        // Combine, select and aggregate per query
+        for (size_t q = 0; q < queries.size(); q++) {
+            const std::vector<uint32_t>& preds = query_predicates[q];
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                uint32_t s = mask_length[preds[0]][i];
+                for (uint32_t k = 0; k < s; k++) {
+                    uint8_t m = mask[preds[0]][i][k];
+                    for (size_t j = 1; j < preds.size(); j++) { m &= mask[preds[j]][i][k]; }
+                    combination_mask[i][k] = m;
+                }
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            mask_elapsed_time_ns += end - start;
+
+            uint32_t product_column[2] = {queries[q].product_column1, queries[q].product_column2};
+            std::vector<std::vector<uint8_t>>* select_result[2] = {&select_result1, &select_result2};
+            std::vector<uint32_t> select_length(enqueue_cnt, 0);
+            for (int col = 0; col < 2; col++) {
+                uint32_t c = product_column[col];
+                for (int i = 0; i < enqueue_cnt; ++i) {
+                    job[i]->op                 = qpl_op_select;
+                    job[i]->next_in_ptr        = decompressed[c][i].data();
+                    job[i]->next_out_ptr       = (*select_result[col])[i].data();
+                    job[i]->available_in       = decompressed_length[c][i];
+                    job[i]->available_out      = chunk_size;
+                    job[i]->src1_bit_width     = layout[c].bit_width;
+                    job[i]->num_input_elements = decompressed_length[c][i] / (layout[c].bit_width / 8);
+                    job[i]->next_src2_ptr      = combination_mask[i].data();
+                    job[i]->available_src2     = mask_length[preds[0]][i];
+                    job[i]->src2_bit_width     = 1;
+                    job[i]->out_bit_width      = qpl_ow_nom;
+                    job[i]->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+                    select_input_bytes += decompressed_length[c][i];
+                }
+                start = std::chrono::high_resolution_clock::now();
+                if (run_jobs(job, enqueue_cnt, execution_path) != 0) { return 1; }
+                end = std::chrono::high_resolution_clock::now();
+                select_elapsed_time_ns += end - start;
+                for (int i = 0; i < enqueue_cnt; ++i) { select_length[i] = job[i]->total_out; }
+            }
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                for (uint32_t j = 0; j < select_length[i] / 4; j++) {
+                    float f1 = 0;
+                    float f2 = 0;
+                    std::memcpy(&f1, select_result1[i].data() + j * 4, sizeof(float));
+                    std::memcpy(&f2, select_result2[i].data() + j * 4, sizeof(float));
+                    sum[q] += static_cast<double>(f1) * f2;
+                }
+            }
+            end = std::chrono::high_resolution_clock::now();
+            sum_elapsed_time_ns += end - start;
+        }
+        file_id += enqueue_cnt;
+    }
+
+    // Compressed bytes the per-query pipelined path would stream: one decompression per predicate and per projected column
+    std::size_t batched_compressed_bytes = 0;
+    std::size_t per_query_compressed_bytes = 0;
+    for (size_t c = 0; c < columns.size(); c++) { batched_compressed_bytes += compressed_column_bytes[c]; }
+    for (const auto& query : queries) {
+        for (const auto& p : query.predicates) { per_query_compressed_bytes += compressed_column_bytes[p.column]; }
+        per_query_compressed_bytes += compressed_column_bytes[query.product_column1];
+        per_query_compressed_bytes += compressed_column_bytes[query.product_column2];
+    }
+
+    double decompress_elapsed_time_sec = static_cast<double>(decompress_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double scan_elapsed_time_sec = static_cast<double>(scan_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double mask_elapsed_time_sec = static_cast<double>(mask_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double select_elapsed_time_sec = static_cast<double>(select_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double sum_elapsed_time_sec = static_cast<double>(sum_elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    double total_elapsed_time_sec = decompress_elapsed_time_sec + scan_elapsed_time_sec + mask_elapsed_time_sec + select_elapsed_time_sec + sum_elapsed_time_sec;
+    std::cout << "[Result Summary]" << std::endl;
+    std::cout <<  "(Decompress) Time take: " << decompress_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Scan) Time take: " << scan_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Mask) Time take: " << mask_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Select) Time take: " << select_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Sum) Time take: " << sum_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Total) Time take: " << total_elapsed_time_sec << " sec" << std::endl;
+    std::cout <<  "(Per query) Time take: " << total_elapsed_time_sec / queries.size() << " sec" << std::endl;
+    std::cout << "Compressed bytes decompressed (batched)   = " << batched_compressed_bytes << " Bytes" << std::endl;
+    std::cout << "Compressed bytes decompressed (per query) = " << per_query_compressed_bytes << " Bytes" << std::endl;
+    std::cout << "Decompressed bytes = " << decompressed_bytes << " Bytes, scan input = " << scan_input_bytes << " Bytes, select input = " << select_input_bytes << " Bytes" << std::endl;
+    for (size_t q = 0; q < queries.size(); q++) {
+        std::cout << "sum[" << q << "]: " << std::fixed << std::setprecision(4) << sum[q] << std::defaultfloat << std::endl;
+    }
+
+    for (int i = 0; i < queue_size; ++i) {
+        status = qpl_fini_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 auto main(int argc, char** argv) -> int {
     std::cout << std::endl;
     std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
@@ -953,8 +1750,42 @@ auto main(int argc, char** argv) -> int {
     const uint32_t queue_size = static_cast<uint32_t>(atoi(argv[3]));
     const std::string orig_file_path = argv[4];
 
+    // Optional mode: `batch <num_queries>` runs a batch of Q6 instances sharing one decompression pass
+    const std::string mode = argc > 5 ? argv[5] : "";
+    if (mode == "batch") {
+        const uint32_t num_queries = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 1;
+        if (batched_query_processing(orig_file_path, COMPRESSED_DATA_FILE_DIR, execution_path, queue_size, num_queries) != 0) {
+            std::cout << "An error acquired during iaa_execution(batch)" << std::endl;
+            return 1;
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+    // Optional mode: `late [selectivity_threshold]` materializes sparse chunks through an index list
+    if (mode == "late") {
+        if (execution_path == qpl_path_software) {
+            std::cout << "Software path is not supporting functional pipeline" << std::endl;
+            return 1;
+        }
+        const double selectivity_threshold = argc > 6 ? atof(argv[6]) : 1.0 / 32;
+        if (late_materialization_query_processing(orig_file_path, COMPRESSED_DATA_FILE_DIR, queue_size, selectivity_threshold) != 0) {
+            std::cout << "An error acquired during iaa_execution(late materialization)" << std::endl;
+            return 1;
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+
+    // The non-pipelined baseline only reads legacy 32-bit columns, the pipelined path reads every layout
+    if (has_column_metadata(COMPRESSED_DATA_FILE_DIR, {"l_discount", "l_quantity", "l_shipdate", "l_extendedprice"})) {
+        if (execution_path == qpl_path_software) {
+            std::cout << "Columns with a storage encoding (.meta) need the pipelined hardware path" << std::endl;
+            return 1;
+        }
+        std::cout << "[IAA without Pipelining Functionality] skipped: columns have a storage encoding (.meta)" << std::endl;
+    }
     // Decompression
-    if(query_processing(COMPRESSED_DATA_FILE_DIR, DECOMPRESSED_DATA_FILE_NAME, execution_path, queue_size) != 0) {
+    else if(query_processing(COMPRESSED_DATA_FILE_DIR, DECOMPRESSED_DATA_FILE_NAME, execution_path, queue_size) != 0) {
         std::cout << "An error acquired during iaa_execution(decompression)" << std::endl;
         return 1;
     }
@@ -0,0 +1,744 @@
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <regex>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Hybrid CPU + IAA execution of the TPC-H Q6 filter (decompress + range scan of l_shipdate, l_discount and
+ * l_quantity, one task per column chunk) with a work-stealing scheduler.
+ * A dispatcher thread keeps up to queue_depth tasks in flight on the accelerator, taking them from the front of the
+ * pending queue. CPU workers (QPL software path, decompress then scan) steal from the back of the queue, but only
+ * while the accelerator is at its queue depth limit, and only when the online throughput estimates of both sides say
+ * the CPU would finish the chunk before the accelerator could drain the queue with it.
+ *
+ * Usage: hybrid_scan <hardware_path|software_path> <compressed_dir> <lineitem_bin_dir> <queue_depth> <cpu_workers>
+ *                    [--simulate-hw=<MB/s>]
+ * The same filter runs CPU-only, accelerator-only and hybrid; the three row masks are compared.
+ * software_path without --simulate-hw runs the CPU-only configuration. With --simulate-hw the accelerator is replaced
+ * by a worker thread that runs software jobs but completes them no faster than the given rate (uncompressed MB/s),
+ * so the scheduler can be tested on a machine without IAA.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * The functional pipeline (QPL_FLAG_DECOMPRESS_ENABLE) is only used on the hardware path.
+ */
+
+/**
+ * NOTE : Maximum transfer size per grouped_workqueues of IAA is 2097152(2MB)
+ * If you want to put data larger than 2MB, you have to split the data into 2MB chunks.
+ */
+const std::size_t chunk_size = 2097152;
+constexpr const uint32_t input_vector_width     = 32;
+constexpr const uint32_t shipdate_lower_boundary = 757382400; // tpch q6 '1994-01-01' <=
+constexpr const uint32_t shipdate_upper_boundary = 788918400 - 1; // tpch q6 < '1995-01-01'
+constexpr const uint32_t discount_lower_boundary = 1028443340; // tpch q6 0.06 - 0.01 <=, float 0.05 (bit pattern)
+constexpr const uint32_t discount_upper_boundary = 1032805417; // tpch q6 <= 0.06 + 0.01, float 0.07 (bit pattern)
+constexpr const uint32_t quantity_lower_boundary = 0;
+constexpr const uint32_t quantity_upper_boundary = 23; // tpch q6 < 24
+
+void getFileSize(const std::string& filePath, int* fileSize) {
+    // Open the file in binary mode, with the file pointer at the end
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (file) {
+        // Get the file size using tellg() and save it to the provided int pointer
+        *fileSize = static_cast<int>(file.tellg());
+        file.close();
+    } else {
+        // If file cannot be opened, set fileSize to -1 to indicate an error
+        *fileSize = -1;
+        std::cerr << "Error: Unable to open file: " << filePath << std::endl;
+    }
+}
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 6) {
+            std::cout << "Usage: hybrid_scan <hardware_path|software_path> <compressed_dir> <lineitem_bin_dir> <queue_depth> <cpu_workers> [--simulate-hw=<MB/s>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Loads <src_data_file_path>.<file_id> into src_vector and returns its size, or -1 if the chunk file is missing
+int64_t read_compressed_chunk(const std::string& src_data_file_path, uint32_t file_id, std::vector<uint8_t>& src_vector)
+{
+    std::ifstream src_file;
+    src_file.open(src_data_file_path + "." + std::to_string(file_id), std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << src_data_file_path + "." + std::to_string(file_id) << std::endl;
+        return -1;
+    }
+    src_file.seekg(0, std::ios::end);
+    std::size_t src_file_size = static_cast<std::size_t>(src_file.tellg());
+    src_file.seekg(0, std::ios::beg);
+    src_vector.resize(src_file_size);
+    src_file.read(reinterpret_cast<char *>(&src_vector.front()), src_file_size);
+    src_file.close();
+    return static_cast<int64_t>(src_file_size);
+}
+
+// Counts the <column>.bin.iaa.compressed.<k> chunk files of a column in src_data_file_dir
+uint32_t count_compressed_chunks(const std::string& src_data_file_dir, const std::string& column)
+{
+    uint32_t iteration = 0;
+    std::regex pattern(R"(.*)" + column + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
+    for (const auto& entry : std::filesystem::directory_iterator(src_data_file_dir)) {
+        if (entry.is_regular_file() && std::regex_search(entry.path().filename().string(), pattern)) {
+            iteration++;
+        }
+    }
+    return iteration;
+}
+
+/**
+ * Physical layout of one compressed column (see decompression_scan.cpp).
+ * Columns with <column>.bin.iaa.compressed.meta are chunked by row count; others are legacy 32-bit columns
+ * chunked by chunk_size bytes.
+ */
+struct column_layout {
+    std::string encoding = "32";
+    uint32_t bit_width = input_vector_width;
+    std::vector<uint32_t> chunk_rows;
+};
+
+int load_column_layout(const std::string& compressed_file_path, const std::string& orig_file_path, uint32_t iteration, column_layout& layout)
+{
+    layout = column_layout();
+    std::ifstream meta_file(compressed_file_path + ".meta");
+    if (meta_file) {
+        std::string key;
+        while (meta_file >> key) {
+            if (key == "encoding") { meta_file >> layout.encoding; }
+            else if (key == "bit_width") { meta_file >> layout.bit_width; }
+            else if (key == "chunk") {
+                uint32_t k = 0, rows = 0;
+                std::size_t bytes = 0, compressed_bytes = 0;
+                meta_file >> k >> rows >> bytes >> compressed_bytes;
+                layout.chunk_rows.push_back(rows);
+            } else {
+                std::string value;
+                meta_file >> value;
+            }
+        }
+        if (layout.chunk_rows.size() != iteration) {
+            std::cout << "Chunk metadata of " << compressed_file_path << " lists " << layout.chunk_rows.size() << " chunks, found " << iteration << " files" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    int file_size = 0;
+    getFileSize(orig_file_path, &file_size);
+    if (file_size < 0) { return 1; }
+    for (uint32_t k = 0; k < iteration; k++) {
+        std::size_t bytes = k == iteration - 1 ? file_size - chunk_size * (iteration - 1) : chunk_size;
+        layout.chunk_rows.push_back(static_cast<uint32_t>(bytes / (input_vector_width / 8)));
+    }
+    return 0;
+}
+
+// Translates a query boundary to the stored encoding of the column (date16 stores days since epoch)
+uint32_t encode_boundary(const column_layout& layout, uint32_t value)
+{
+    if (layout.encoding == "date16") { return value / 86400; }
+    return value;
+}
+
+// A predicate column of the filter, held in memory so that only decompression and scan are timed
+struct scan_column {
+    std::string name;
+    column_layout layout;
+    std::vector<std::vector<uint8_t>> chunk;
+    uint32_t low;
+    uint32_t high;
+};
+
+// One unit of work: decompress + scan chunk `chunk` of column `column` into its bitmap
+struct scan_task {
+    uint32_t column;
+    uint32_t chunk;
+    std::size_t bytes;      // uncompressed bytes, the unit of the throughput estimates
+};
+
+using row_masks = std::vector<std::vector<std::vector<uint8_t>>>;   // [column][chunk] bitmap
+
+/**
+ * Online service rate of one side of the scheduler: an exponentially weighted average of uncompressed bytes over the
+ * start-to-completion time of each task, i.e. the speed of one task. Idle time between tasks does not lower it; a
+ * side running n tasks at once moves n times as many bytes. Rates are read without the lock, so a worker may act on
+ * a value one completion old.
+ */
+class throughput_estimate {
+public:
+    static constexpr double newest_weight = 0.25;
+
+    void complete(std::size_t bytes, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        const double sec = std::chrono::duration<double>(end - start).count();
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_++;
+        if (sec <= 0) { return; }
+        const double task_rate = static_cast<double>(bytes) / sec;
+        const double rate = rate_.load();
+        rate_.store(rate == 0 ? task_rate : rate + newest_weight * (task_rate - rate));
+    }
+
+    double rate() const { return rate_.load(); }   // bytes per second of one task, 0 until the first completion
+    uint32_t chunks() const { return chunks_; }
+
+private:
+    std::mutex mutex_;
+    uint32_t chunks_ = 0;
+    std::atomic<double> rate_ {0};
+};
+
+/**
+ * Pending tasks, in-flight accounting and the stealing rule shared by the dispatcher and the CPU workers.
+ */
+class hybrid_scheduler {
+public:
+    hybrid_scheduler(const std::vector<scan_task>& tasks, uint32_t depth_limit, bool hardware)
+        : tasks_(tasks), depth_limit_(depth_limit), hardware_(hardware) {
+        for (uint32_t id = 0; id < tasks.size(); id++) {
+            pending_.push_back(id);
+            pending_bytes_ += tasks[id].bytes;
+        }
+    }
+
+    // Accelerator side: the oldest pending task, if the queue depth allows another job
+    bool take_front(uint32_t& id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty() || in_flight_ >= depth_limit_) { return false; }
+        id = pending_.front();
+        pending_.pop_front();
+        pending_bytes_ -= tasks_[id].bytes;
+        in_flight_++;
+        in_flight_bytes_ += tasks_[id].bytes;
+        return true;
+    }
+
+    void hardware_done(uint32_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_--;
+        in_flight_bytes_ -= tasks_[id].bytes;
+    }
+
+    /**
+     * CPU side: steals the newest pending task when there is no accelerator, or when the accelerator is at its depth
+     * limit and one CPU worker would finish the task before the accelerator could drain everything queued for it.
+     * The stealing worker is idle, so it runs the task at one CPU task's rate; the accelerator drains at its task rate
+     * times the jobs it has in flight. Returns false with `finished` set once nothing is pending.
+     */
+    bool steal_back(uint32_t& id, bool& finished) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished = pending_.empty();
+        if (finished) { return false; }
+        if (hardware_) {
+            if (in_flight_ < depth_limit_) { return false; }
+            const double hw_rate = hardware_estimate.rate() * in_flight_;
+            const double cpu_rate = cpu_estimate.rate();
+            if (hw_rate > 0 && cpu_rate > 0) {
+                const double cpu_sec = static_cast<double>(tasks_[pending_.back()].bytes) / cpu_rate;
+                const double hw_sec = static_cast<double>(pending_bytes_ + in_flight_bytes_) / hw_rate;
+                if (cpu_sec > hw_sec) { return false; }
+            }
+        }
+        id = pending_.back();
+        pending_.pop_back();
+        pending_bytes_ -= tasks_[id].bytes;
+        return true;
+    }
+
+    bool hardware_finished() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_.empty() && in_flight_ == 0;
+    }
+
+    throughput_estimate hardware_estimate;
+    throughput_estimate cpu_estimate;
+
+private:
+    const std::vector<scan_task>& tasks_;
+    const uint32_t depth_limit_;
+    const bool hardware_;
+    std::mutex mutex_;
+    std::deque<uint32_t> pending_;
+    std::size_t pending_bytes_ = 0;
+    uint32_t in_flight_ = 0;
+    std::size_t in_flight_bytes_ = 0;
+};
+
+// Software-path decompress + scan of one task with a worker's own jobs and buffer
+int cpu_decompress_scan(const scan_column& column, uint32_t k, qpl_job *decompress_job, qpl_job *scan_job,
+                        std::vector<uint8_t>& decompressed, std::vector<uint8_t>& mask)
+{
+    decompress_job->op            = qpl_op_decompress;
+    decompress_job->next_in_ptr   = const_cast<uint8_t *>(column.chunk[k].data());
+    decompress_job->available_in  = static_cast<uint32_t>(column.chunk[k].size());
+    decompress_job->next_out_ptr  = decompressed.data();
+    decompress_job->available_out = static_cast<uint32_t>(decompressed.size());
+    decompress_job->flags         = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    qpl_status status = qpl_execute_job(decompress_job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during (decompress) job execution." << std::endl;
+        return 1;
+    }
+    scan_job->op                 = qpl_op_scan_range;
+    scan_job->next_in_ptr        = decompressed.data();
+    scan_job->available_in       = decompress_job->total_out;
+    scan_job->next_out_ptr       = mask.data();
+    scan_job->available_out      = static_cast<uint32_t>(mask.size());
+    scan_job->src1_bit_width     = column.layout.bit_width;
+    scan_job->num_input_elements = column.layout.chunk_rows[k];
+    scan_job->out_bit_width      = qpl_ow_nom;
+    scan_job->param_low          = column.low;
+    scan_job->param_high         = column.high;
+    scan_job->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    status = qpl_execute_job(scan_job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during (scan) job execution." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Software jobs owned by one worker
+struct cpu_jobs {
+    std::vector<std::unique_ptr<uint8_t[]>> job_buffer;
+    qpl_job *decompress_job = nullptr;
+    qpl_job *scan_job = nullptr;
+    std::vector<uint8_t> decompressed;
+
+    int init() {
+        uint32_t size = 0;
+        qpl_status status = qpl_get_job_size(qpl_path_software, &size);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+            return 1;
+        }
+        for (qpl_job **job_ptr : {&decompress_job, &scan_job}) {
+            job_buffer.push_back(std::make_unique<uint8_t[]>(size));
+            *job_ptr = reinterpret_cast<qpl_job *>(job_buffer.back().get());
+            status = qpl_init_job(qpl_path_software, *job_ptr);
+            if (status != QPL_STS_OK) {
+                std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+                return 1;
+            }
+        }
+        decompressed.resize(chunk_size);
+        return 0;
+    }
+
+    ~cpu_jobs() {
+        if (decompress_job != nullptr) { qpl_fini_job(decompress_job); }
+        if (scan_job != nullptr) { qpl_fini_job(scan_job); }
+    }
+};
+
+/**
+ * Accelerator side. On the hardware path every slot is one pipelined decompress + scan job
+ * (QPL_FLAG_DECOMPRESS_ENABLE). With a simulated rate, a device thread runs the submitted tasks in order on the
+ * software path and completes each no earlier than its uncompressed bytes / rate after the previous one.
+ */
+class accelerator {
+public:
+    accelerator(qpl_path_t execution_path, uint32_t depth, double simulated_mb_per_sec)
+        : execution_path_(execution_path), simulated_rate_(simulated_mb_per_sec * 1024 * 1024), slots_(depth) {}
+
+    int init() {
+        if (simulated_rate_ > 0) {
+            if (device_jobs_.init() != 0) { return 1; }
+            device_ = std::thread(&accelerator::simulated_device, this);
+            return 0;
+        }
+        uint32_t size = 0;
+        qpl_status status = qpl_get_job_size(execution_path_, &size);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+            return 1;
+        }
+        for (auto& slot : slots_) {
+            slot.job_buffer = std::make_unique<uint8_t[]>(size);
+            slot.job = reinterpret_cast<qpl_job *>(slot.job_buffer.get());
+            status = qpl_init_job(execution_path_, slot.job);
+            if (status != QPL_STS_OK) {
+                std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    ~accelerator() {
+        {
+            std::lock_guard<std::mutex> lock(device_mutex_);
+            stop_ = true;
+        }
+        if (device_.joinable()) { device_.join(); }
+        for (auto& slot : slots_) {
+            if (slot.job != nullptr) { qpl_fini_job(slot.job); }
+        }
+    }
+
+    uint32_t depth() const { return static_cast<uint32_t>(slots_.size()); }
+
+    int submit(uint32_t slot_id, const scan_column& column, uint32_t k, std::vector<uint8_t>& mask) {
+        slot& s = slots_[slot_id];
+        s.column = &column;
+        s.chunk = k;
+        s.mask = &mask;
+        s.done = false;
+        if (simulated_rate_ > 0) {
+            std::lock_guard<std::mutex> lock(device_mutex_);
+            device_queue_.push_back(slot_id);
+            return 0;
+        }
+        s.job->op                 = qpl_op_scan_range;
+        s.job->next_in_ptr        = const_cast<uint8_t *>(column.chunk[k].data());
+        s.job->available_in       = static_cast<uint32_t>(column.chunk[k].size());
+        s.job->next_out_ptr       = mask.data();
+        s.job->available_out      = static_cast<uint32_t>(mask.size());
+        s.job->src1_bit_width     = column.layout.bit_width;
+        s.job->num_input_elements = column.layout.chunk_rows[k];
+        s.job->out_bit_width      = qpl_ow_nom;
+        s.job->param_low          = column.low;
+        s.job->param_high         = column.high;
+        s.job->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+        qpl_status status = qpl_submit_job(s.job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job submission." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // QPL_STS_BEING_PROCESSED while the task of the slot runs
+    qpl_status check(uint32_t slot_id) {
+        slot& s = slots_[slot_id];
+        if (simulated_rate_ > 0) {
+            if (!s.done.load()) { return QPL_STS_BEING_PROCESSED; }
+            return s.status;
+        }
+        return qpl_check_job(s.job);
+    }
+
+private:
+    struct slot {
+        std::unique_ptr<uint8_t[]> job_buffer;
+        qpl_job *job = nullptr;
+        const scan_column *column = nullptr;
+        uint32_t chunk = 0;
+        std::vector<uint8_t> *mask = nullptr;
+        std::atomic<bool> done {false};
+        qpl_status status = QPL_STS_OK;
+    };
+
+    void simulated_device() {
+        auto available = std::chrono::steady_clock::now();
+        while (true) {
+            uint32_t slot_id = 0;
+            {
+                std::lock_guard<std::mutex> lock(device_mutex_);
+                if (stop_) { return; }
+                if (device_queue_.empty()) {
+                    slot_id = UINT32_MAX;
+                } else {
+                    slot_id = device_queue_.front();
+                    device_queue_.pop_front();
+                }
+            }
+            if (slot_id == UINT32_MAX) {
+                std::this_thread::yield();
+                continue;
+            }
+            slot& s = slots_[slot_id];
+            const auto start = std::max(available, std::chrono::steady_clock::now());
+            const std::size_t bytes = static_cast<std::size_t>(s.column->layout.chunk_rows[s.chunk]) * (s.column->layout.bit_width / 8);
+            s.status = cpu_decompress_scan(*s.column, s.chunk, device_jobs_.decompress_job, device_jobs_.scan_job, device_jobs_.decompressed, *s.mask) == 0
+                       ? QPL_STS_OK : QPL_STS_LIBRARY_INTERNAL_ERR;
+            available = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(bytes / simulated_rate_));
+            std::this_thread::sleep_until(available);
+            s.done = true;
+        }
+    }
+
+    qpl_path_t execution_path_;
+    const double simulated_rate_;
+    std::vector<slot> slots_;
+    cpu_jobs device_jobs_;
+    std::thread device_;
+    std::mutex device_mutex_;
+    std::deque<uint32_t> device_queue_;
+    bool stop_ = false;
+};
+
+struct run_summary {
+    double elapsed_sec = 0;
+    uint32_t hardware_chunks = 0;
+    uint32_t cpu_chunks = 0;
+    double hardware_rate = 0;
+    double cpu_rate = 0;
+};
+
+/**
+ * Runs every task once. hw == nullptr gives the CPU-only configuration and cpu_workers == 0 the accelerator-only one.
+ */
+int run_hybrid(const std::vector<scan_column>& columns, const std::vector<scan_task>& tasks, accelerator *hw, uint32_t cpu_workers,
+               row_masks& masks, run_summary& summary)
+{
+    masks.assign(columns.size(), {});
+    for (std::size_t c = 0; c < columns.size(); c++) {
+        for (uint32_t rows : columns[c].layout.chunk_rows) { masks[c].emplace_back((rows + 7) / 8 + 64, 0); }
+    }
+    hybrid_scheduler scheduler(tasks, hw != nullptr ? hw->depth() : 0, hw != nullptr);
+    std::atomic<bool> failed {false};
+    std::vector<cpu_jobs> worker_jobs(cpu_workers);
+    for (auto& jobs : worker_jobs) {
+        if (jobs.init() != 0) { return 1; }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < cpu_workers; w++) {
+        workers.emplace_back([&, w] {
+            bool finished = false;
+            while (!failed) {
+                uint32_t id = 0;
+                if (!scheduler.steal_back(id, finished)) {
+                    if (finished) { return; }
+                    std::this_thread::yield();
+                    continue;
+                }
+                const scan_task& task = tasks[id];
+                const auto task_start = std::chrono::steady_clock::now();
+                if (cpu_decompress_scan(columns[task.column], task.chunk, worker_jobs[w].decompress_job, worker_jobs[w].scan_job,
+                                        worker_jobs[w].decompressed, masks[task.column][task.chunk]) != 0) {
+                    failed = true;
+                    return;
+                }
+                scheduler.cpu_estimate.complete(task.bytes, task_start, std::chrono::steady_clock::now());
+            }
+        });
+    }
+
+    if (hw != nullptr) {
+        // Dispatcher: fill free slots from the front of the queue, then reap completions
+        std::vector<uint32_t> free_slots;
+        for (uint32_t s = 0; s < hw->depth(); s++) { free_slots.push_back(s); }
+        std::vector<std::pair<uint32_t, uint32_t>> in_flight;   // slot, task
+        std::vector<std::chrono::steady_clock::time_point> submitted(hw->depth());
+        while (!failed && !scheduler.hardware_finished()) {
+            uint32_t id = 0;
+            while (!free_slots.empty() && scheduler.take_front(id)) {
+                const uint32_t slot_id = free_slots.back();
+                free_slots.pop_back();
+                submitted[slot_id] = std::chrono::steady_clock::now();
+                if (hw->submit(slot_id, columns[tasks[id].column], tasks[id].chunk, masks[tasks[id].column][tasks[id].chunk]) != 0) {
+                    failed = true;
+                    break;
+                }
+                in_flight.emplace_back(slot_id, id);
+            }
+            bool progress = false;
+            for (std::size_t i = 0; i < in_flight.size() && !failed;) {
+                qpl_status status = hw->check(in_flight[i].first);
+                if (status == QPL_STS_BEING_PROCESSED) {
+                    i++;
+                    continue;
+                }
+                if (status != QPL_STS_OK) {
+                    std::cout << "An error " << status << " acquired during job waiting." << std::endl;
+                    failed = true;
+                    break;
+                }
+                scheduler.hardware_estimate.complete(tasks[in_flight[i].second].bytes, submitted[in_flight[i].first], std::chrono::steady_clock::now());
+                scheduler.hardware_done(in_flight[i].second);
+                free_slots.push_back(in_flight[i].first);
+                in_flight[i] = in_flight.back();
+                in_flight.pop_back();
+                progress = true;
+            }
+            if (!progress) { std::this_thread::yield(); }
+        }
+        // Leave no job writing into the masks after an error
+        for (auto& flight : in_flight) {
+            while (hw->check(flight.first) == QPL_STS_BEING_PROCESSED) { std::this_thread::yield(); }
+        }
+    }
+    for (auto& worker : workers) { worker.join(); }
+    auto end = std::chrono::steady_clock::now();
+    if (failed) {
+        return 1;
+    }
+
+    summary.elapsed_sec = std::chrono::duration<double>(end - start).count();
+    summary.hardware_chunks = scheduler.hardware_estimate.chunks();
+    summary.cpu_chunks = scheduler.cpu_estimate.chunks();
+    summary.hardware_rate = scheduler.hardware_estimate.rate();
+    summary.cpu_rate = scheduler.cpu_estimate.rate();
+    return 0;
+}
+
+// AND of the column bitmaps, counted per chunk
+std::size_t qualifying_rows(const std::vector<scan_column>& columns, const row_masks& masks)
+{
+    std::size_t count = 0;
+    const column_layout& layout = columns.front().layout;
+    for (std::size_t k = 0; k < layout.chunk_rows.size(); k++) {
+        for (uint32_t i = 0; i < layout.chunk_rows[k]; i++) {
+            bool selected = true;
+            for (std::size_t c = 0; c < columns.size() && selected; c++) { selected = (masks[c][k][i / 8] >> (i % 8)) & 1; }
+            count += selected;
+        }
+    }
+    return count;
+}
+
+// Bitmaps agree on every row of every chunk (bits past the last row are not compared)
+bool masks_match(const std::vector<scan_column>& columns, const row_masks& a, const row_masks& b)
+{
+    for (std::size_t c = 0; c < columns.size(); c++) {
+        for (std::size_t k = 0; k < columns[c].layout.chunk_rows.size(); k++) {
+            for (uint32_t i = 0; i < columns[c].layout.chunk_rows[k]; i++) {
+                if (((a[c][k][i / 8] ^ b[c][k][i / 8]) >> (i % 8)) & 1) { return false; }
+            }
+        }
+    }
+    return true;
+}
+
+void print_summary(const std::string& name, const run_summary& summary, std::size_t input_bytes, std::size_t count)
+{
+    std::cout << name << " : " << summary.elapsed_sec << " s, " << static_cast<double>(input_bytes) / 1024 / 1024 / summary.elapsed_sec << " MB/s"
+              << ", chunks IAA/CPU = " << summary.hardware_chunks << "/" << summary.cpu_chunks
+              << ", estimates IAA/CPU = " << summary.hardware_rate / 1024 / 1024 << "/" << summary.cpu_rate / 1024 / 1024 << " MB/s per task"
+              << ", rows = " << count << std::endl;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_hardware;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+    const std::string src_data_file_dir = argv[2];
+    const std::string orig_file_path = argv[3];
+    const uint32_t queue_depth = static_cast<uint32_t>(atoi(argv[4]));
+    const uint32_t cpu_workers = static_cast<uint32_t>(atoi(argv[5]));
+    double simulated_mb_per_sec = 0;
+    for (int arg = 6; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option.rfind("--simulate-hw=", 0) == 0) { simulated_mb_per_sec = atof(option.c_str() + 14); }
+    }
+    const bool has_accelerator = execution_path == qpl_path_hardware || simulated_mb_per_sec > 0;
+    if (has_accelerator && queue_depth == 0) {
+        std::cout << "The queue depth must be at least 1." << std::endl;
+        return 1;
+    }
+
+    // Q6 predicate columns
+    std::vector<scan_column> columns = {{"l_shipdate"}, {"l_discount"}, {"l_quantity"}};
+    const uint32_t lows[] = {shipdate_lower_boundary, discount_lower_boundary, quantity_lower_boundary};
+    const uint32_t highs[] = {shipdate_upper_boundary, discount_upper_boundary, quantity_upper_boundary};
+    std::vector<scan_task> tasks;
+    std::size_t input_bytes = 0;
+    for (uint32_t c = 0; c < columns.size(); c++) {
+        scan_column& column = columns[c];
+        const std::string compressed_path = src_data_file_dir + column.name + ".bin.iaa.compressed";
+        const uint32_t iteration = count_compressed_chunks(src_data_file_dir, column.name);
+        if (iteration == 0) {
+            std::cout << "No compressed chunks of " << column.name << " found in " << src_data_file_dir << std::endl;
+            return 1;
+        }
+        if (load_column_layout(compressed_path, orig_file_path + column.name + ".bin", iteration, column.layout) != 0) {
+            return 1;
+        }
+        column.low = encode_boundary(column.layout, lows[c]);
+        column.high = encode_boundary(column.layout, highs[c]);
+        column.chunk.resize(iteration);
+        for (uint32_t k = 0; k < iteration; k++) {
+            if (read_compressed_chunk(compressed_path, k, column.chunk[k]) < 0) { return 1; }
+            const std::size_t bytes = static_cast<std::size_t>(column.layout.chunk_rows[k]) * (column.layout.bit_width / 8);
+            tasks.push_back({c, k, bytes});
+            input_bytes += bytes;
+        }
+    }
+    if (columns[0].layout.chunk_rows != columns[1].layout.chunk_rows || columns[0].layout.chunk_rows != columns[2].layout.chunk_rows) {
+        std::cout << "Columns are not chunked by the same row counts; recompress them with a storage encoding." << std::endl;
+        return 1;
+    }
+    // Chunk k of every column before chunk k + 1, so both sides work on all columns
+    std::stable_sort(tasks.begin(), tasks.end(), [](const scan_task& a, const scan_task& b) { return a.chunk < b.chunk; });
+
+    std::cout << "[Hybrid CPU + IAA Scan] " << tasks.size() << " chunks, queue depth " << queue_depth << ", " << cpu_workers << " CPU workers";
+    if (simulated_mb_per_sec > 0) { std::cout << ", simulated accelerator at " << simulated_mb_per_sec << " MB/s"; }
+    std::cout << std::endl;
+
+    row_masks cpu_masks, hw_masks, hybrid_masks;
+    run_summary cpu_summary, hw_summary, hybrid_summary;
+    if (run_hybrid(columns, tasks, nullptr, std::max(1u, cpu_workers), cpu_masks, cpu_summary) != 0) {
+        return 1;
+    }
+    const std::size_t expected = qualifying_rows(columns, cpu_masks);
+    print_summary("CPU only", cpu_summary, input_bytes, expected);
+    if (!has_accelerator) {
+        return 0;
+    }
+
+    bool verified = true;
+    {
+        accelerator hw(execution_path, queue_depth, simulated_mb_per_sec);
+        if (hw.init() != 0 || run_hybrid(columns, tasks, &hw, 0, hw_masks, hw_summary) != 0) {
+            return 1;
+        }
+        print_summary("IAA only", hw_summary, input_bytes, qualifying_rows(columns, hw_masks));
+        verified = verified && masks_match(columns, cpu_masks, hw_masks);
+    }
+    {
+        accelerator hw(execution_path, queue_depth, simulated_mb_per_sec);
+        if (hw.init() != 0 || run_hybrid(columns, tasks, &hw, cpu_workers, hybrid_masks, hybrid_summary) != 0) {
+            return 1;
+        }
+        print_summary("Hybrid", hybrid_summary, input_bytes, qualifying_rows(columns, hybrid_masks));
+        verified = verified && masks_match(columns, cpu_masks, hybrid_masks);
+    }
+    std::cout << "Speed up over IAA only: " << hw_summary.elapsed_sec / hybrid_summary.elapsed_sec << std::endl;
+    std::cout << "Verification: " << (verified ? "PASS" : "FAIL") << std::endl;
+    return verified ? 0 : 1;
+}
+
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <thread>
 #include <filesystem>
+#include <cstring>
 
 #include "qpl/qpl.h"
 
@@ -30,6 +31,58 @@
  */
 const std::size_t chunk_size = 2097152;
 
+/**
+ * NOTE : With a storage encoding, columns are chunked by row count instead of bytes so that chunk k of every column
+ * covers the same rows whatever its physical width. rows_per_chunk keeps the widest (32-bit) chunk at chunk_size.
+ * The rows and byte sizes of every chunk are recorded in <compressed file>.meta for the query engine.
+ * --chunk-rows=<n> lowers it, e.g. to 65536 so that scans of the chunks can return 16-bit row numbers.
+ */
+const std::size_t max_rows_per_chunk = chunk_size / 4;
+std::size_t rows_per_chunk = max_rows_per_chunk;
+
+/**
+ * NOTE : Huffman strategies.
+ * `dynamic` gathers deflate statistics and builds a new table for every chunk, an extra CPU pass before each job.
+ * `fixed` uses the fixed DEFLATE codes and needs no table.
+ * `canned` builds one table per column from huffman_sample_slices evenly spaced slices and reuses it for every chunk.
+ * The sampled histogram is cached in <compressed file>.huffman so later runs of the same column skip the sampling;
+ * delete the file to resample. The table is still written in each block header, so readers need no extra state.
+ * `compare` compresses the column with all three strategies without writing files and reports ratio vs throughput.
+ */
+const std::size_t huffman_sample_slices = 16;
+const std::size_t huffman_sample_bytes = 65536;
+
+/**
+ * NOTE : Random-access index. With --index=<bytes>, chunks are compressed with QPL indexing: the stream is cut into
+ * mini-blocks of that many uncompressed bytes (512 to 32768) and the bit offset of the block header and of every
+ * mini-block is written to <compressed file>.index, one line per chunk:
+ *     mini_block_size <bytes>
+ *     chunk <k> <entries> <header> <mini-block 0> ... <mini-block n-1> <end of block>
+ * Each entry holds the bit offset in its low 32 bits and the CRC of the data before it in its high 32 bits.
+ * A reader can then decompress the block header and only the mini-blocks covering the rows it needs.
+ */
+qpl_mini_block_size mini_block_size_from_bytes(uint32_t bytes)
+{
+    switch (bytes) {
+        case 512:   return qpl_mblk_size_512;
+        case 1024:  return qpl_mblk_size_1k;
+        case 2048:  return qpl_mblk_size_2k;
+        case 4096:  return qpl_mblk_size_4k;
+        case 8192:  return qpl_mblk_size_8k;
+        case 16384: return qpl_mblk_size_16k;
+        case 32768: return qpl_mblk_size_32k;
+        default:    return qpl_mblk_size_none;
+    }
+}
+
+struct huffman_report {
+    std::string strategy;
+    std::size_t input_size = 0;
+    std::size_t output_size = 0;
+    double table_time_sec = 0;
+    double job_time_sec = 0;
+};
+
 int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
     // Get path from input argument
     if (extra_arg == 0) {
@@ -67,7 +120,116 @@ void job_execution(qpl_job *job_ptr)
     }
 }
 
-int iaa_compression(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size)
+// Re-encodes a column of 32-bit values written by split_lineitem.py into its storage encoding:
+// "32" keeps the values, "16"/"8" narrow integers, "date16" stores Unix timestamps as 16-bit days since epoch.
+int narrow_column(std::vector<uint8_t>& data, const std::string& encoding, uint32_t& bit_width)
+{
+    if (encoding == "32") { bit_width = 32; return 0; }
+    if (encoding == "16" || encoding == "date16") { bit_width = 16; }
+    else if (encoding == "8") { bit_width = 8; }
+    else {
+        std::cout << "Unrecognized storage encoding " << encoding << ". Use 32, 16, 8 or date16." << std::endl;
+        return 1;
+    }
+    const std::size_t rows = data.size() / 4;
+    const uint32_t max_value = (1u << bit_width) - 1;
+    for (std::size_t r = 0; r < rows; r++) {
+        uint32_t value = 0;
+        std::memcpy(&value, data.data() + r * 4, sizeof(value));
+        if (encoding == "date16") { value /= 86400; }
+        if (value > max_value) {
+            std::cout << "Value " << value << " at row " << r << " does not fit in " << bit_width << " bits." << std::endl;
+            return 1;
+        }
+        if (bit_width == 16) {
+            uint16_t narrow = static_cast<uint16_t>(value);
+            std::memcpy(data.data() + r * 2, &narrow, sizeof(narrow));
+        } else {
+            data[r] = static_cast<uint8_t>(value);
+        }
+    }
+    data.resize(rows * (bit_width / 8));
+    return 0;
+}
+
+// Deflate token histogram of a column sample. Every symbol keeps a count of at least one so that the table built
+// from it can encode chunks containing symbols the sample missed.
+int sample_histogram(std::vector<uint8_t>& data, qpl_path_t execution_path, qpl_histogram& histogram)
+{
+    histogram = qpl_histogram {};
+    const std::size_t slice_bytes = std::min(huffman_sample_bytes, data.size());
+    const std::size_t slices = data.size() > huffman_sample_slices * huffman_sample_bytes ? huffman_sample_slices : (data.size() + huffman_sample_bytes - 1) / huffman_sample_bytes;
+    for (std::size_t s = 0; s < slices; s++) {
+        std::size_t offset = std::min(s * (data.size() / slices) & ~static_cast<std::size_t>(3), data.size() - slice_bytes);
+        qpl_histogram slice_histogram {};
+        qpl_status status = qpl_gather_deflate_statistics(data.data() + offset, static_cast<uint32_t>(slice_bytes), &slice_histogram, qpl_default_level, execution_path);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+            return 1;
+        }
+        for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += slice_histogram.literal_lengths[k]; }
+        for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += slice_histogram.distances[k]; }
+    }
+    for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += 1; }
+    for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += 1; }
+    return 0;
+}
+
+// Cached histogram of a column, valid only for the storage encoding it was sampled with
+bool load_cached_histogram(const std::string& cache_path, const std::string& encoding, qpl_histogram& histogram)
+{
+    std::ifstream cache_file(cache_path);
+    std::string key, cached_encoding;
+    if (!(cache_file >> key >> cached_encoding) || key != "encoding" || cached_encoding != (encoding.empty() ? "raw" : encoding)) {
+        return false;
+    }
+    if (!(cache_file >> key) || key != "literal_lengths") { return false; }
+    for (auto& count : histogram.literal_lengths) {
+        if (!(cache_file >> count)) { return false; }
+    }
+    if (!(cache_file >> key) || key != "distances") { return false; }
+    for (auto& count : histogram.distances) {
+        if (!(cache_file >> count)) { return false; }
+    }
+    return true;
+}
+
+int store_cached_histogram(const std::string& cache_path, const std::string& encoding, const qpl_histogram& histogram)
+{
+    std::ofstream cache_file(cache_path, std::ofstream::out);
+    if (!cache_file) {
+        std::cout << "File not found : " << cache_path << std::endl;
+        return 1;
+    }
+    cache_file << "encoding " << (encoding.empty() ? "raw" : encoding) << "\n";
+    cache_file << "literal_lengths";
+    for (auto count : histogram.literal_lengths) { cache_file << " " << count; }
+    cache_file << "\ndistances";
+    for (auto count : histogram.distances) { cache_file << " " << count; }
+    cache_file << "\n";
+    return 0;
+}
+
+int build_huffman_table(const qpl_histogram& histogram, qpl_path_t execution_path, qpl_huffman_table_t& table)
+{
+    qpl_status status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C, &table);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table creation.\n";
+        return 1;
+    }
+    status = qpl_huffman_table_init_with_histogram(table, &histogram);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
+        qpl_huffman_table_destroy(table);
+        table = nullptr;
+        return 1;
+    }
+    return 0;
+}
+
+int iaa_compression(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size, const std::string& encoding = "",
+                    const std::string& huffman_strategy = "dynamic", bool write_output = true, huffman_report* report = nullptr,
+                    uint32_t mini_block_bytes = 0)
 {
     // Source and output containers
     std::vector<uint8_t> whole_src_vector;
@@ -135,6 +297,61 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
     src_file.close();
     std::size_t current_idx = 0;
 
+    // Row-aligned chunking of the re-encoded column
+    std::size_t chunk_bytes = chunk_size;
+    uint32_t bit_width = 8;
+    std::vector<std::size_t> chunk_compressed_bytes;
+    if (!encoding.empty()) {
+        if (narrow_column(whole_src_vector, encoding, bit_width) != 0) {
+            return 1;
+        }
+        chunk_bytes = rows_per_chunk * (bit_width / 8);
+        src_file_size = whole_src_vector.size();
+        src_file_left = src_file_size;
+        std::cout << "Storage encoding = " << encoding << " (" << bit_width << "-bit, " << rows_per_chunk << " rows per chunk)" << std::endl;
+    }
+
+    // Canned strategy: one table per column, from the cached histogram or a fresh sample
+    std::chrono::duration<int64_t, std::nano> table_time_ns = std::chrono::nanoseconds::zero();
+    qpl_huffman_table_t canned_table = nullptr;
+    if (huffman_strategy == "canned") {
+        auto start = std::chrono::steady_clock::now();
+        const std::string cache_path = dest_data_file_path + ".huffman";
+        qpl_histogram histogram {};
+        bool cached = write_output && load_cached_histogram(cache_path, encoding, histogram);
+        if (!cached) {
+            if (sample_histogram(whole_src_vector, execution_path, histogram) != 0) {
+                return 1;
+            }
+            if (write_output && store_cached_histogram(cache_path, encoding, histogram) != 0) {
+                return 1;
+            }
+        }
+        if (build_huffman_table(histogram, execution_path, canned_table) != 0) {
+            return 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        table_time_ns += end - start;
+        std::cout << "Huffman table    = " << (cached ? "loaded from " : "sampled from the column, cached in ") << cache_path << std::endl;
+    } else if (huffman_strategy != "dynamic" && huffman_strategy != "fixed") {
+        std::cout << "Unrecognized Huffman strategy " << huffman_strategy << ". Use dynamic, fixed or canned." << std::endl;
+        return 1;
+    }
+    std::vector<qpl_huffman_table_t> round_tables;
+
+    // Mini-block index of every job and of every written chunk
+    const qpl_mini_block_size mini_block_size = mini_block_size_from_bytes(mini_block_bytes);
+    if (mini_block_bytes != 0 && mini_block_size == qpl_mblk_size_none) {
+        std::cout << "Unsupported mini-block size " << mini_block_bytes << ". Use a power of two from 512 to 32768." << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<uint64_t>> index_vector(queue_size);
+    std::vector<std::vector<uint64_t>> chunk_index;
+    if (mini_block_size != qpl_mblk_size_none) {
+        // One entry per mini-block, plus the block header and the end of block
+        for (auto& index : index_vector) { index.resize(chunk_bytes / mini_block_bytes + 8); }
+    }
+
     // std::chrono::duration<int64_t, std::nano> whole_elapsed_time_ns = std::chrono::nanoseconds::zero();
     // auto whole_start = std::chrono::steady_clock::now();
 
@@ -143,36 +360,30 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
         int enqueue_cnt = 0;
         for (int i = 0; i < queue_size; ++i) {
             // Resizing source and destination vectors
-            if (src_file_left <= chunk_size) {
+            if (src_file_left <= chunk_bytes) {
                 vector_size = src_file_left;
             } else {
-                vector_size = chunk_size;
+                vector_size = chunk_bytes;
             }
             src_vector[i].resize(vector_size);
             dest_vector[i].resize(vector_size);
-            // Allocate Huffman table object (c_huffman_table).
-            qpl_huffman_table_t c_huffman_table = nullptr;
-            status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C,
-                                                    &c_huffman_table);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during Huffman table creation.\n";
-                return 1;
-            }
-
-            // Initialize Huffman table using deflate tokens histogram.
-            qpl_histogram histogram {};
-            status = qpl_gather_deflate_statistics(whole_src_vector.data() + current_idx, vector_size, &histogram, qpl_default_level, execution_path);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
-                qpl_huffman_table_destroy(c_huffman_table);
-                return 1;
-            }
-
-            status = qpl_huffman_table_init_with_histogram(c_huffman_table, &histogram);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
-                qpl_huffman_table_destroy(c_huffman_table);
-                return 1;
+            // Huffman table: the column's canned table, a new one per chunk (dynamic) or none (fixed codes)
+            qpl_huffman_table_t c_huffman_table = canned_table;
+            if (huffman_strategy == "dynamic") {
+                auto start = std::chrono::steady_clock::now();
+                // Initialize Huffman table using deflate tokens histogram.
+                qpl_histogram histogram {};
+                status = qpl_gather_deflate_statistics(whole_src_vector.data() + current_idx, vector_size, &histogram, qpl_default_level, execution_path);
+                if (status != QPL_STS_OK) {
+                    std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+                    return 1;
+                }
+                if (build_huffman_table(histogram, execution_path, c_huffman_table) != 0) {
+                    return 1;
+                }
+                round_tables.push_back(c_huffman_table);
+                auto end = std::chrono::steady_clock::now();
+                table_time_ns += end - start;
             }
 
             // Loading data from source file to source vector
@@ -186,6 +397,11 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
             job[i]->available_out  = static_cast<uint32_t>(vector_size);
             job[i]->flags          = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
             job[i]->huffman_table  = c_huffman_table;
+            if (mini_block_size != qpl_mblk_size_none) {
+                job[i]->mini_block_size = mini_block_size;
+                job[i]->idx_array       = index_vector[i].data();
+                job[i]->idx_max_size    = static_cast<uint32_t>(index_vector[i].size());
+            }
 
             current_idx += vector_size;
 
@@ -227,8 +443,17 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
             elapsed_time_ns += end - start;
         }
         
+        // Per-chunk tables are released once their round is done
+        for (auto table : round_tables) { qpl_huffman_table_destroy(table); }
+        round_tables.clear();
+
         for (int i = 0; i < enqueue_cnt; ++i) {
             compressed_size += static_cast<std::size_t>(job[i]->total_out);
+            chunk_compressed_bytes.push_back(static_cast<std::size_t>(job[i]->total_out));
+            if (mini_block_size != qpl_mblk_size_none) {
+                chunk_index.emplace_back(index_vector[i].begin(), index_vector[i].begin() + job[i]->idx_num_written);
+            }
+            if (!write_output) { continue; }
 
             // Opening destination file
             std::ofstream dest_file;
@@ -253,7 +478,44 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
 
     // Closing source file
     src_file.close();
-    
+    if (canned_table != nullptr) {
+        qpl_huffman_table_destroy(canned_table);
+    }
+
+    // Mini-block index of every chunk
+    if (mini_block_size != qpl_mblk_size_none && write_output) {
+        std::ofstream index_file(dest_data_file_path + ".index", std::ofstream::out);
+        if (!index_file) {
+            std::cout << "File not found : " << dest_data_file_path + ".index" << std::endl;
+            return 1;
+        }
+        index_file << "mini_block_size " << mini_block_bytes << "\n";
+        for (std::size_t k = 0; k < chunk_index.size(); k++) {
+            index_file << "chunk " << k << " " << chunk_index[k].size();
+            for (auto entry : chunk_index[k]) { index_file << " " << entry; }
+            index_file << "\n";
+        }
+        std::cout << std::endl << "Mini-block index = " << dest_data_file_path + ".index" << " (" << mini_block_bytes << " bytes per mini-block)" << std::endl;
+    }
+
+    // Chunk metadata: encoding, width and per-chunk rows / bytes / compressed bytes
+    if (!encoding.empty() && write_output) {
+        std::ofstream meta_file(dest_data_file_path + ".meta", std::ofstream::out);
+        if (!meta_file) {
+            std::cout << "File not found : " << dest_data_file_path + ".meta" << std::endl;
+            return 1;
+        }
+        const std::size_t element_bytes = bit_width / 8;
+        meta_file << "encoding " << encoding << "\n";
+        meta_file << "bit_width " << bit_width << "\n";
+        meta_file << "rows " << src_file_size / element_bytes << "\n";
+        meta_file << "rows_per_chunk " << rows_per_chunk << "\n";
+        for (std::size_t k = 0; k < chunk_compressed_bytes.size(); k++) {
+            std::size_t bytes = std::min(chunk_bytes, src_file_size - k * chunk_bytes);
+            meta_file << "chunk " << k << " " << bytes / element_bytes << " " << bytes << " " << chunk_compressed_bytes[k] << "\n";
+        }
+        meta_file.close();
+    }
 
     // Freeing resources
     for (int i = 0; i < queue_size; ++i) {
@@ -274,6 +536,17 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
     else { std::cout << "(hc)"; }
     std::cout << "Elapsed Time = " << elapsed_time_ns.count() << " ns (" << elapsed_time_sec << " s)" << std::endl;
     std::cout << "Bandwidth        = " << static_cast<double>(src_file_size) / 1024 / 1024 / elapsed_time_sec << " MB/s" << std::endl;
+    double table_time_sec = static_cast<double>(table_time_ns.count()) / 1000 / 1000 / 1000;
+    std::cout << "Huffman          = " << huffman_strategy << ", table time " << table_time_sec << " s" << std::endl;
+    std::cout << "Bandwidth (incl. table) = " << static_cast<double>(src_file_size) / 1024 / 1024 / (elapsed_time_sec + table_time_sec) << " MB/s" << std::endl;
+
+    if (report != nullptr) {
+        report->strategy = huffman_strategy;
+        report->input_size = src_file_size;
+        report->output_size = compressed_size;
+        report->table_time_sec = table_time_sec;
+        report->job_time_sec = elapsed_time_sec;
+    }
 
     return 0;
 }
@@ -456,12 +729,62 @@ auto main(int argc, char** argv) -> int {
     const std::string REF_DATA_FILE_PATH   = argv[4] + SRC_DATA_FILE_NAME + ".iaa.decompressed";
     
     const uint32_t queue_size = static_cast<uint32_t>(atoi(argv[5]));
+    // Optional storage encoding (32, 16, 8 or date16) enabling row-aligned chunking, e.g. l_quantity.bin ... 8
+    // Without the argument, the encoding chosen by `tbl_converter --pack` (<column>.bin.encoding) is used if present
+    // Optional --huffman=dynamic|fixed|canned|compare selects the Huffman strategy (dynamic by default)
+    // Optional --index=<bytes> writes a mini-block index for random access (512 to 32768 bytes per mini-block)
+    // Optional --chunk-rows=<n> sets the rows per chunk of a storage encoding (1 to 524288)
+    std::string encoding = "";
+    std::string huffman_strategy = "dynamic";
+    uint32_t mini_block_bytes = 0;
+    for (int arg = 6; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option.rfind("--huffman=", 0) == 0) { huffman_strategy = option.substr(10); }
+        else if (option.rfind("--index=", 0) == 0) { mini_block_bytes = static_cast<uint32_t>(atoi(option.c_str() + 8)); }
+        else if (option.rfind("--chunk-rows=", 0) == 0) {
+            const long rows = atol(option.c_str() + 13);
+            if (rows <= 0 || static_cast<std::size_t>(rows) > max_rows_per_chunk) {
+                std::cout << "--chunk-rows must be between 1 and " << max_rows_per_chunk << std::endl;
+                return 1;
+            }
+            rows_per_chunk = static_cast<std::size_t>(rows);
+        }
+        else { encoding = option; }
+    }
+    if (encoding.empty()) {
+        std::ifstream encoding_file(SRC_DATA_FILE_PATH + SRC_DATA_FILE_NAME + ".encoding");
+        encoding_file >> encoding;
+    }
     uint32_t iteration = 0;
     std::cout << "Queue Size = " << queue_size << std::endl;
     std::cout << std::endl;
     std::cout << "Input_file: " << SRC_DATA_FILE_NAME << std::endl;
+    // Huffman strategy comparison: ratio vs throughput, nothing is written
+    if (huffman_strategy == "compare") {
+        std::vector<huffman_report> reports;
+        for (const std::string strategy : {"dynamic", "fixed", "canned"}) {
+            huffman_report report;
+            std::cout << std::endl;
+            if (iaa_compression(SRC_DATA_FILE_PATH + SRC_DATA_FILE_NAME, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size, encoding, strategy, false, &report) != 0) {
+                std::cout << "An error acquired during iaa_execution(compression)" << std::endl;
+                return 1;
+            }
+            reports.push_back(report);
+        }
+        std::cout << std::endl;
+        std::cout << "[Huffman strategies] " << SRC_DATA_FILE_NAME << std::endl;
+        std::cout << "strategy\tratio\ttable_s\tjob_s\tMB/s\tMB/s(incl. table)" << std::endl;
+        for (const auto& report : reports) {
+            const double input_mb = static_cast<double>(report.input_size) / 1024 / 1024;
+            std::cout << report.strategy << "\t" << static_cast<double>(report.output_size) / static_cast<double>(report.input_size)
+                      << "\t" << report.table_time_sec << "\t" << report.job_time_sec << "\t" << input_mb / report.job_time_sec
+                      << "\t" << input_mb / (report.job_time_sec + report.table_time_sec) << std::endl;
+        }
+        return 0;
+    }
+
     // Compression
-    if(iaa_compression(SRC_DATA_FILE_PATH + SRC_DATA_FILE_NAME, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size) != 0) {
+    if(iaa_compression(SRC_DATA_FILE_PATH + SRC_DATA_FILE_NAME, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size, encoding, huffman_strategy, true, nullptr, mini_block_bytes) != 0) {
         std::cout << "An error acquired during iaa_execution(compression)" << std::endl;
         return 1;
     }
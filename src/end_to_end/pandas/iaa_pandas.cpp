@@ -0,0 +1,963 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <filesystem>
+#include <regex>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "qpl/qpl.h"
+
+namespace py = pybind11;
+
+/**
+ * @brief Python module `iaa_pandas`: the IAA filter engine of decompression_scan.cpp for pandas/NumPy users.
+ *
+ *     import iaa_pandas
+ *     engine = iaa_pandas.Engine("hardware_path", 2)
+ *     shipdate = engine.load_column(compressed_dir, "l_shipdate", lineitem_dir)
+ *     price = engine.load_column(compressed_dir, "l_extendedprice", lineitem_dir, "float32")
+ *     mask = engine.filter([(shipdate, 757382400, 788918399)])
+ *     prices = engine.select(price, mask)                  # numpy.ndarray, no copy
+ *     revenue = engine.filter_aggregate(predicates, price, discount)
+ *     rows = engine.lookup(price, 123456, 16)              # only the mini-blocks covering the rows, if indexed
+ *
+ * Columns are the <column>.bin.iaa.compressed.<k> chunks written by iaa_lineitem_compression, with or without the
+ * .meta file of a storage encoding. Arrays returned to Python own the buffer the accelerator wrote into, so no copy
+ * is made on the way to NumPy. The GIL is released while chunks are read, submitted and waited for.
+ * Each chunk of a filter mask is scanned to a bitmap or to a 16/32-bit row number list, whichever the selectivity
+ * estimated from a sample of the chunk makes smallest. select consumes row number lists as they are.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * On the software path there is no functional pipeline, so each chunk is decompressed before it is scanned or
+ * selected.
+ */
+
+/**
+ * NOTE : Maximum transfer size per grouped_workqueues of IAA is 2097152(2MB)
+ * If you want to put data larger than 2MB, you have to split the data into 2MB chunks.
+ */
+const std::size_t chunk_size = 2097152;
+constexpr const uint32_t input_vector_width     = 32;
+constexpr const uint32_t selectivity_sample_rows = 1024;   // values per chunk used to pick the scan output format
+constexpr const uint32_t index16_segment_rows   = 65536;  // rows addressed by 16-bit row numbers
+
+void getFileSize(const std::string& filePath, int* fileSize) {
+    // Open the file in binary mode, with the file pointer at the end
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (file) {
+        // Get the file size using tellg() and save it to the provided int pointer
+        *fileSize = static_cast<int>(file.tellg());
+        file.close();
+    } else {
+        // If file cannot be opened, set fileSize to -1 to indicate an error
+        *fileSize = -1;
+    }
+}
+
+void check_status(qpl_status status, const std::string& what)
+{
+    if (status != QPL_STS_OK) {
+        throw std::runtime_error("An error " + std::to_string(status) + " acquired during " + what + ".");
+    }
+}
+
+// Loads <src_data_file_path>.<file_id> into src_vector
+void read_compressed_chunk(const std::string& src_data_file_path, uint32_t file_id, std::vector<uint8_t>& src_vector)
+{
+    std::ifstream src_file;
+    src_file.open(src_data_file_path + "." + std::to_string(file_id), std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        throw std::runtime_error("File not found : " + src_data_file_path + "." + std::to_string(file_id));
+    }
+    src_file.seekg(0, std::ios::end);
+    std::size_t src_file_size = static_cast<std::size_t>(src_file.tellg());
+    src_file.seekg(0, std::ios::beg);
+    src_vector.resize(src_file_size);
+    src_file.read(reinterpret_cast<char *>(src_vector.data()), src_file_size);
+}
+
+uint32_t count_compressed_chunks(const std::string& src_data_file_dir, const std::string& column)
+{
+    uint32_t iteration = 0;
+    std::regex pattern(R"(.*)" + column + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
+    for (const auto& entry : std::filesystem::directory_iterator(src_data_file_dir)) {
+        if (entry.is_regular_file() && std::regex_search(entry.path().filename().string(), pattern)) {
+            iteration++;
+        }
+    }
+    return iteration;
+}
+
+/**
+ * Physical layout of one compressed column (see decompression_scan.cpp).
+ * Columns with <column>.bin.iaa.compressed.meta are chunked by row count; others are legacy 32-bit columns
+ * chunked by chunk_size bytes.
+ */
+struct column_layout {
+    std::string encoding = "32";
+    uint32_t bit_width = input_vector_width;
+    std::vector<uint32_t> chunk_rows;
+};
+
+void load_column_layout(const std::string& compressed_file_path, const std::string& orig_file_path, uint32_t iteration, column_layout& layout)
+{
+    layout = column_layout();
+    std::ifstream meta_file(compressed_file_path + ".meta");
+    if (meta_file) {
+        std::string key;
+        while (meta_file >> key) {
+            if (key == "encoding") { meta_file >> layout.encoding; }
+            else if (key == "bit_width") { meta_file >> layout.bit_width; }
+            else if (key == "chunk") {
+                uint32_t k = 0, rows = 0;
+                std::size_t bytes = 0, compressed_bytes = 0;
+                meta_file >> k >> rows >> bytes >> compressed_bytes;
+                layout.chunk_rows.push_back(rows);
+            } else {
+                std::string value;
+                meta_file >> value;
+            }
+        }
+        if (layout.chunk_rows.size() != iteration) {
+            throw std::runtime_error("Chunk metadata of " + compressed_file_path + " lists " + std::to_string(layout.chunk_rows.size()) +
+                                     " chunks, found " + std::to_string(iteration) + " files");
+        }
+        return;
+    }
+    int file_size = 0;
+    getFileSize(orig_file_path, &file_size);
+    if (file_size < 0) {
+        throw std::runtime_error("Unable to open file: " + orig_file_path + " (needed to size a column without chunk metadata)");
+    }
+    for (uint32_t k = 0; k < iteration; k++) {
+        std::size_t bytes = k == iteration - 1 ? file_size - chunk_size * (iteration - 1) : chunk_size;
+        layout.chunk_rows.push_back(static_cast<uint32_t>(bytes / (input_vector_width / 8)));
+    }
+}
+
+/**
+ * Mini-block index written by iaa_lineitem_compression --index=<bytes>: per chunk, the bit offsets (low 32 bits) of
+ * the block header, of every mini-block and of the end of block.
+ */
+void load_column_index(const std::string& compressed_file_path, uint32_t iteration, uint32_t& mini_block_size, std::vector<std::vector<uint64_t>>& index)
+{
+    std::ifstream index_file(compressed_file_path + ".index");
+    mini_block_size = 0;
+    index.clear();
+    if (!index_file) { return; }
+    std::string key;
+    while (index_file >> key) {
+        if (key == "mini_block_size") { index_file >> mini_block_size; }
+        else if (key == "chunk") {
+            uint32_t k = 0, entries = 0;
+            index_file >> k >> entries;
+            index.emplace_back(entries);
+            for (auto& entry : index.back()) { index_file >> entry; }
+        }
+    }
+    if (index.size() != iteration || mini_block_size == 0) {
+        throw std::runtime_error("Mini-block index of " + compressed_file_path + " lists " + std::to_string(index.size()) +
+                                 " chunks, found " + std::to_string(iteration) + " files");
+    }
+}
+
+// A compressed column held in memory; every chunk file is read once, when the column is loaded
+struct compressed_column {
+    std::string name;
+    std::string dtype;          // numpy dtype of the stored values
+    column_layout layout;
+    std::vector<std::vector<uint8_t>> chunk;
+    uint32_t mini_block_size = 0;                   // bytes per mini-block, 0 without a .index file
+    std::vector<std::vector<uint64_t>> index;       // per chunk: block header, mini-block starts, end of block
+    std::vector<std::vector<uint8_t>> sample;       // stride sample of every chunk, filled by load_column, see load_samples
+
+    std::size_t rows() const
+    {
+        std::size_t rows = 0;
+        for (uint32_t r : layout.chunk_rows) { rows += r; }
+        return rows;
+    }
+
+    std::size_t compressed_bytes() const
+    {
+        std::size_t bytes = 0;
+        for (const auto& c : chunk) { bytes += c.size(); }
+        return bytes;
+    }
+
+    std::size_t value_bytes() const { return layout.bit_width / 8; }
+};
+
+using column_ptr = std::shared_ptr<compressed_column>;
+
+/**
+ * Filter result, one entry per chunk in the format that needs the fewest bytes for its selectivity: a bitmap
+ * (qpl_ow_nom, bit i set when row i of the chunk passed every predicate) or the sorted row numbers of the passing
+ * rows within the chunk (qpl_ow_16 / qpl_ow_32). A 16-bit list of a chunk over 65536 rows starts with one 32-bit
+ * count per 65536-row segment, and each row number is relative to the start of its segment.
+ */
+struct row_mask {
+    std::vector<uint32_t> chunk_rows;
+    std::vector<std::vector<uint8_t>> chunk;
+    std::vector<qpl_out_format> chunk_format;
+    std::vector<uint32_t> chunk_count;
+
+    std::size_t count() const
+    {
+        std::size_t n = 0;
+        for (uint32_t c : chunk_count) { n += c; }
+        return n;
+    }
+};
+
+using mask_ptr = std::shared_ptr<row_mask>;
+
+// (column, lower, upper): lower <= value <= upper, in the query domain (epoch seconds for dates, floats for float32)
+using range_predicate = std::tuple<column_ptr, double, double>;
+
+uint32_t bitmap_popcount(const uint8_t* bitmap, uint32_t num_bytes)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < num_bytes; i++) { count += __builtin_popcount(bitmap[i]); }
+    return count;
+}
+
+uint32_t index_bytes(qpl_out_format format)
+{
+    return format == qpl_ow_16 ? 2 : 4;
+}
+
+// Bytes of the segment counts in front of a 16-bit row number list, see row_mask
+uint32_t segment_table_bytes(uint32_t rows)
+{
+    return rows > index16_segment_rows ? (rows + index16_segment_rows - 1) / index16_segment_rows * 4 : 0;
+}
+
+/**
+ * Mask format with the fewest bytes for `matches` passing rows out of `rows`: a bitmap costs rows / 8 bytes, an index
+ * list 2 or 4 bytes per match, plus the segment counts of a 16-bit list over more than 65536 rows.
+ */
+qpl_out_format choose_output_format(uint32_t rows, double matches)
+{
+    const double bitmap_bytes = (rows + 7) / 8;
+    const double index16_bytes = matches * 2 + segment_table_bytes(rows);
+    const double index32_bytes = matches * 4;
+    if (index16_bytes < bitmap_bytes && index16_bytes <= index32_bytes) { return qpl_ow_16; }
+    if (index32_bytes < bitmap_bytes) { return qpl_ow_32; }
+    return qpl_ow_nom;
+}
+
+// Scan output format: the accelerator writes 16-bit row numbers only for chunks of at most 65536 rows
+qpl_out_format choose_scan_format(uint32_t rows, double matches)
+{
+    if (rows <= index16_segment_rows) { return choose_output_format(rows, matches); }
+    return matches * 4 < (rows + 7) / 8 ? qpl_ow_32 : qpl_ow_nom;
+}
+
+// Row numbers of the set entries of a mask chunk in any format
+std::vector<uint32_t> chunk_indices(const std::vector<uint8_t>& chunk, qpl_out_format format, uint32_t rows)
+{
+    std::vector<uint32_t> indices;
+    if (format == qpl_ow_nom) {
+        for (uint32_t i = 0; i < rows; i++) {
+            if ((chunk[i / 8] >> (i % 8)) & 1) { indices.push_back(i); }
+        }
+    } else if (format == qpl_ow_16) {
+        const uint32_t table_bytes = segment_table_bytes(rows);
+        const uint16_t *values = reinterpret_cast<const uint16_t *>(chunk.data() + table_bytes);
+        const std::size_t n = (chunk.size() - table_bytes) / 2;
+        if (table_bytes == 0) {
+            indices.assign(values, values + n);
+        } else {
+            const uint32_t *segment_count = reinterpret_cast<const uint32_t *>(chunk.data());
+            indices.reserve(n);
+            for (uint32_t segment = 0; segment < table_bytes / 4; segment++) {
+                for (uint32_t j = 0; j < segment_count[segment]; j++) { indices.push_back(segment * index16_segment_rows + *values++); }
+            }
+        }
+    } else {
+        const uint32_t *values = reinterpret_cast<const uint32_t *>(chunk.data());
+        indices.assign(values, values + chunk.size() / 4);
+    }
+    return indices;
+}
+
+// Mask chunk of `rows` rows in `format` from sorted row numbers
+std::vector<uint8_t> encode_chunk(const std::vector<uint32_t>& indices, qpl_out_format format, uint32_t rows)
+{
+    std::vector<uint8_t> chunk;
+    if (format == qpl_ow_nom) {
+        chunk.assign((rows + 7) / 8, 0);
+        for (uint32_t i : indices) { chunk[i / 8] |= static_cast<uint8_t>(1u << (i % 8)); }
+    } else if (format == qpl_ow_16) {
+        const uint32_t table_bytes = segment_table_bytes(rows);
+        chunk.assign(table_bytes + indices.size() * 2, 0);
+        uint32_t *segment_count = reinterpret_cast<uint32_t *>(chunk.data());
+        uint16_t *values = reinterpret_cast<uint16_t *>(chunk.data() + table_bytes);
+        for (std::size_t j = 0; j < indices.size(); j++) {
+            if (table_bytes != 0) { segment_count[indices[j] / index16_segment_rows]++; }
+            values[j] = static_cast<uint16_t>(indices[j] % index16_segment_rows);
+        }
+    } else {
+        chunk.resize(indices.size() * 4);
+        std::memcpy(chunk.data(), indices.data(), chunk.size());
+    }
+    return chunk;
+}
+
+// Number of set entries of a mask chunk in any format
+uint32_t chunk_count(const std::vector<uint8_t>& chunk, qpl_out_format format, uint32_t rows)
+{
+    if (format == qpl_ow_nom) { return bitmap_popcount(chunk.data(), static_cast<uint32_t>(chunk.size())); }
+    return static_cast<uint32_t>((chunk.size() - (format == qpl_ow_16 ? segment_table_bytes(rows) : 0)) / index_bytes(format));
+}
+
+// Stored value i of a decompressed buffer of `bit_width` bit values
+uint32_t stored_value(const uint8_t* data, uint32_t bit_width, std::size_t i)
+{
+    if (bit_width == 8) { return data[i]; }
+    if (bit_width == 16) { return reinterpret_cast<const uint16_t *>(data)[i]; }
+    return reinterpret_cast<const uint32_t *>(data)[i];
+}
+
+// Widens the stored values of a column buffer to double
+void to_double(const compressed_column& column, const std::vector<uint8_t>& data, std::vector<double>& out)
+{
+    const std::size_t n = data.size() / column.value_bytes();
+    out.resize(n);
+    if (column.dtype == "float32") {
+        const float *values = reinterpret_cast<const float *>(data.data());
+        for (std::size_t i = 0; i < n; i++) { out[i] = values[i]; }
+    } else if (column.layout.bit_width == 8) {
+        for (std::size_t i = 0; i < n; i++) { out[i] = data[i]; }
+    } else if (column.layout.bit_width == 16) {
+        const uint16_t *values = reinterpret_cast<const uint16_t *>(data.data());
+        for (std::size_t i = 0; i < n; i++) { out[i] = values[i]; }
+    } else {
+        const int32_t *values = reinterpret_cast<const int32_t *>(data.data());
+        for (std::size_t i = 0; i < n; i++) { out[i] = values[i]; }
+    }
+}
+
+// Translates a query boundary to the stored representation: float bit pattern for float32, days for date16
+uint32_t encode_boundary(const compressed_column& column, double value)
+{
+    if (column.dtype == "float32") {
+        if (value < 0) { throw std::invalid_argument("Scans on " + column.name + " need non-negative float boundaries"); }
+        float f = static_cast<float>(value);
+        uint32_t bits = 0;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+    if (value < 0) { value = 0; }
+    uint32_t stored = static_cast<uint32_t>(value);
+    if (column.layout.encoding == "date16") { return stored / 86400; }
+    return stored;
+}
+
+// Wraps a heap buffer into a numpy array that owns it, so the bytes the accelerator wrote are not copied
+py::array wrap_buffer(std::vector<uint8_t>* buffer, const std::string& dtype, std::size_t item_bytes)
+{
+    py::capsule owner(buffer, [](void *p) { delete reinterpret_cast<std::vector<uint8_t> *>(p); });
+    std::vector<py::ssize_t> shape = {static_cast<py::ssize_t>(buffer->size() / item_bytes)};
+    std::vector<py::ssize_t> strides = {static_cast<py::ssize_t>(item_bytes)};
+    return py::array(py::dtype(dtype), shape, strides, buffer->data(), owner);
+}
+
+class iaa_engine {
+public:
+    iaa_engine(const std::string& path, uint32_t queue_size) : queue_size(queue_size)
+    {
+        if (path == "hardware_path") {
+            execution_path = qpl_path_hardware;
+        } else if (path == "software_path") {
+            execution_path = qpl_path_software;
+        } else {
+            throw std::invalid_argument("Unrecognized value for parameter. Use hardware_path or software_path.");
+        }
+        if (queue_size == 0) { throw std::invalid_argument("Queue size must be at least 1"); }
+
+        // Job initialization
+        uint32_t size = 0;
+        check_status(qpl_get_job_size(execution_path, &size), "job size getting");
+        job_buffer.resize(queue_size);
+        job.resize(queue_size);
+        src_vector.resize(queue_size);
+        for (uint32_t i = 0; i < queue_size; ++i) {
+            job_buffer[i] = std::make_unique<uint8_t[]>(size);
+            job[i] = reinterpret_cast<qpl_job *>(job_buffer[i].get());
+            check_status(qpl_init_job(execution_path, job[i]), "job initializing");
+        }
+    }
+
+    ~iaa_engine()
+    {
+        for (qpl_job *job_ptr : job) { qpl_fini_job(job_ptr); }
+    }
+
+    column_ptr load_column(const std::string& compressed_dir, const std::string& name, const std::string& orig_dir, const std::string& dtype)
+    {
+        auto column = std::make_shared<compressed_column>();
+        {
+            py::gil_scoped_release release;
+            const std::string compressed_path = compressed_dir + name + ".bin.iaa.compressed";
+            const uint32_t iteration = count_compressed_chunks(compressed_dir, name);
+            if (iteration == 0) { throw std::runtime_error("No compressed chunks of " + name + " found in " + compressed_dir); }
+            load_column_layout(compressed_path, orig_dir + name + ".bin", iteration, column->layout);
+            column->name = name;
+            column->chunk.resize(iteration);
+            for (uint32_t k = 0; k < iteration; k++) { read_compressed_chunk(compressed_path, k, column->chunk[k]); }
+            load_column_index(compressed_path, iteration, column->mini_block_size, column->index);
+            // The column is shared by every filter and engine it is passed to, so it is complete and read-only once loaded
+            std::lock_guard<std::mutex> lock(engine_lock);
+            load_samples(*column);
+        }
+        const uint32_t bit_width = column->layout.bit_width;
+        if (dtype.empty()) {
+            column->dtype = bit_width == 8 ? "uint8" : bit_width == 16 ? "uint16" : "int32";
+        } else if (dtype == "float32" && bit_width != 32) {
+            throw std::invalid_argument(name + " is stored with " + std::to_string(bit_width) + " bits and cannot be read as float32");
+        } else {
+            column->dtype = dtype;
+        }
+        return column;
+    }
+
+    // Whole column as a numpy array of its stored values (days since epoch for date16 columns)
+    py::array decompress(const column_ptr& column)
+    {
+        auto *dest = new std::vector<uint8_t>();
+        try {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(engine_lock);
+            const std::vector<std::size_t> offset = chunk_offsets(*column, column->layout.chunk_rows);
+            dest->resize(offset.back());
+            run_rounds(*column, false, [&](int i, uint32_t k) {
+                job[i]->op            = qpl_op_decompress;
+                job[i]->next_in_ptr   = const_cast<uint8_t *>(column->chunk[k].data());
+                job[i]->available_in  = static_cast<uint32_t>(column->chunk[k].size());
+                job[i]->next_out_ptr  = dest->data() + offset[k];
+                job[i]->available_out = static_cast<uint32_t>(offset[k + 1] - offset[k]);
+                job[i]->flags         = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+            }, [&](int i, uint32_t k) {
+                if (job[i]->total_out != offset[k + 1] - offset[k]) {
+                    throw std::runtime_error("Unexpected decompressed size of " + column->name + " chunk " + std::to_string(k));
+                }
+            });
+        } catch (...) {
+            delete dest;
+            throw;
+        }
+        return wrap_buffer(dest, column->dtype, column->value_bytes());
+    }
+
+    /**
+     * Rows [first_row, first_row + num_rows) as a numpy array. With a mini-block index only the block header and the
+     * mini-blocks covering the rows are decompressed; otherwise every chunk the rows fall in is decompressed whole.
+     */
+    py::array lookup(const column_ptr& column, std::size_t first_row, std::size_t num_rows)
+    {
+        if (first_row + num_rows > column->rows()) { throw std::out_of_range("lookup past the last row of " + column->name); }
+        auto *dest = new std::vector<uint8_t>(num_rows * column->value_bytes());
+        try {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(engine_lock);
+            const std::vector<std::size_t> offset = chunk_offsets(*column, column->layout.chunk_rows);
+            const std::size_t begin = first_row * column->value_bytes();
+            const std::size_t end = begin + dest->size();
+            std::vector<uint8_t> out(chunk_size);
+            for (uint32_t k = 0; k < column->chunk.size() && begin < end; k++) {
+                if (offset[k + 1] <= begin || offset[k] >= end) { continue; }
+                const uint32_t chunk_begin = static_cast<uint32_t>(std::max(begin, offset[k]) - offset[k]);
+                const uint32_t chunk_end = static_cast<uint32_t>(std::min(end, offset[k + 1]) - offset[k]);
+                uint32_t out_offset = chunk_begin;
+                if (column->mini_block_size != 0) {
+                    decompress_mini_blocks(*column, k, chunk_begin, chunk_end, out, out_offset);
+                } else {
+                    job[0]->op                = qpl_op_decompress;
+                    job[0]->next_in_ptr       = column->chunk[k].data();
+                    job[0]->available_in      = static_cast<uint32_t>(column->chunk[k].size());
+                    job[0]->next_out_ptr      = out.data();
+                    job[0]->available_out     = static_cast<uint32_t>(out.size());
+                    job[0]->flags             = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+                    check_status(qpl_execute_job(job[0]), "job execution");
+                }
+                std::memcpy(dest->data() + (offset[k] + chunk_begin - begin), out.data() + out_offset, chunk_end - chunk_begin);
+            }
+        } catch (...) {
+            delete dest;
+            throw;
+        }
+        return wrap_buffer(dest, column->dtype, column->value_bytes());
+    }
+
+    // AND of range predicates, evaluated by decompress + scan per column
+    mask_ptr filter(const std::vector<range_predicate>& predicates)
+    {
+        if (predicates.empty()) { throw std::invalid_argument("filter needs at least one predicate"); }
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(engine_lock);
+        return filter_locked(predicates);
+    }
+
+    // Values of the rows set in mask, as one contiguous numpy array
+    py::array select(const column_ptr& column, const mask_ptr& mask)
+    {
+        auto *dest = new std::vector<uint8_t>();
+        try {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(engine_lock);
+            select_locked(*column, *mask, *dest);
+        } catch (...) {
+            delete dest;
+            throw;
+        }
+        return wrap_buffer(dest, column->dtype, column->value_bytes());
+    }
+
+    // sum(column1 * column2) over the rows passing every predicate, e.g. TPC-H Q6
+    double filter_aggregate(const std::vector<range_predicate>& predicates, const column_ptr& column1, const column_ptr& column2)
+    {
+        if (predicates.empty()) { throw std::invalid_argument("filter_aggregate needs at least one predicate"); }
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(engine_lock);
+        mask_ptr mask = filter_locked(predicates);
+        std::vector<uint8_t> selected1, selected2;
+        select_locked(*column1, *mask, selected1);
+        select_locked(*column2, *mask, selected2);
+        std::vector<double> value1, value2;
+        to_double(*column1, selected1, value1);
+        to_double(*column2, selected2, value2);
+        double sum = 0;
+        for (std::size_t i = 0; i < value1.size(); i++) { sum += value1[i] * value2[i]; }
+        return sum;
+    }
+
+private:
+    qpl_path_t execution_path;
+    const uint32_t queue_size;
+    std::vector<std::unique_ptr<uint8_t[]>> job_buffer;
+    std::vector<qpl_job *> job;
+    std::vector<std::vector<uint8_t>> src_vector;   // software path: decompressed input of job i
+    std::vector<qpl_status> job_status;             // status of job i in the last round
+    std::mutex engine_lock;
+
+    // Decompresses bytes [begin, end) of chunk k: the block header loads the Huffman tables, then only the
+    // mini-blocks covering the range are decoded. The requested bytes start at out_offset.
+    void decompress_mini_blocks(compressed_column& column, uint32_t k, uint32_t begin, uint32_t end, std::vector<uint8_t>& out, uint32_t& out_offset)
+    {
+        const std::vector<uint64_t>& index = column.index[k];
+        const uint32_t first = begin / column.mini_block_size;
+        const uint32_t last = (end - 1) / column.mini_block_size;
+        if (index.size() < last + 3) { throw std::runtime_error("Mini-block index of " + column.name + " chunk " + std::to_string(k) + " is too short"); }
+        const uint64_t header_bit = index[0] & 0xffffffffu;
+        const uint64_t header_end_bit = index[1] & 0xffffffffu;
+        const uint64_t start_bit = index[1 + first] & 0xffffffffu;
+        const uint64_t end_bit = index[2 + last] & 0xffffffffu;
+
+        job[0]->op                = qpl_op_decompress;
+        job[0]->next_in_ptr       = column.chunk[k].data() + header_bit / 8;
+        job[0]->available_in      = static_cast<uint32_t>((header_end_bit + 7) / 8 - header_bit / 8);
+        job[0]->ignore_start_bits = static_cast<uint32_t>(header_bit & 7);
+        job[0]->ignore_end_bits   = static_cast<uint32_t>((8 - (header_end_bit & 7)) & 7);
+        job[0]->next_out_ptr      = out.data();
+        job[0]->available_out     = static_cast<uint32_t>(out.size());
+        job[0]->flags             = QPL_FLAG_FIRST | QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+        qpl_status header_status = qpl_execute_job(job[0]);
+
+        job[0]->next_in_ptr       = column.chunk[k].data() + start_bit / 8;
+        job[0]->available_in      = static_cast<uint32_t>((end_bit + 7) / 8 - start_bit / 8);
+        job[0]->ignore_start_bits = static_cast<uint32_t>(start_bit & 7);
+        job[0]->ignore_end_bits   = static_cast<uint32_t>((8 - (end_bit & 7)) & 7);
+        job[0]->next_out_ptr      = out.data();
+        job[0]->available_out     = static_cast<uint32_t>(out.size());
+        job[0]->flags             = QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+        qpl_status status = header_status == QPL_STS_OK ? qpl_execute_job(job[0]) : header_status;
+
+        // Later full-stream jobs on this slot must not inherit the bit offsets
+        job[0]->ignore_start_bits = 0;
+        job[0]->ignore_end_bits   = 0;
+        check_status(status, "mini-block decompression");
+        if (job[0]->total_out < end - first * column.mini_block_size) {
+            throw std::runtime_error("Unexpected mini-block output of " + column.name + " chunk " + std::to_string(k));
+        }
+        out_offset = begin - first * column.mini_block_size;
+    }
+
+    static std::vector<std::size_t> chunk_offsets(const compressed_column& column, const std::vector<uint32_t>& rows)
+    {
+        std::vector<std::size_t> offset(rows.size() + 1, 0);
+        for (size_t k = 0; k < rows.size(); k++) { offset[k + 1] = offset[k] + static_cast<std::size_t>(rows[k]) * column.value_bytes(); }
+        return offset;
+    }
+
+    /**
+     * Runs one job per chunk in rounds of queue_size jobs. prepare(i, k) fills job[i] for chunk k and finish(i, k)
+     * consumes its result. With analytics set, the input of job i is chunk k itself plus QPL_FLAG_DECOMPRESS_ENABLE on
+     * the hardware path, and the chunk decompressed into src_vector[i] on the software path.
+     * With short_output_ok, a job that ran out of output space leaves QPL_STS_DST_IS_SHORT_ERR in job_status[i] for
+     * finish instead of throwing. With chunks set, only the listed chunks are run.
+     */
+    void run_rounds(const compressed_column& column, bool analytics,
+                    const std::function<void(int, uint32_t)>& prepare, const std::function<void(int, uint32_t)>& finish,
+                    bool short_output_ok = false, const std::vector<uint32_t> *chunks = nullptr)
+    {
+        std::vector<uint32_t> all_chunks;
+        if (chunks == nullptr) {
+            all_chunks.resize(column.chunk.size());
+            std::iota(all_chunks.begin(), all_chunks.end(), 0);
+            chunks = &all_chunks;
+        }
+        const uint32_t iteration = static_cast<uint32_t>(chunks->size());
+        for (uint32_t file_id = 0; file_id < iteration;) {
+            int enqueue_cnt = static_cast<int>(std::min<uint32_t>(queue_size, iteration - file_id));
+            if (analytics && execution_path == qpl_path_software) {
+                for (int i = 0; i < enqueue_cnt; ++i) { software_decompress(column, (*chunks)[file_id + i], src_vector[i]); }
+            }
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                const uint32_t k = (*chunks)[file_id + i];
+                prepare(i, k);
+                if (!analytics) { continue; }
+                job[i]->src1_bit_width     = column.layout.bit_width;
+                job[i]->num_input_elements = column.layout.chunk_rows[k];
+                if (execution_path == qpl_path_software) {
+                    job[i]->next_in_ptr  = src_vector[i].data();
+                    job[i]->available_in = static_cast<uint32_t>(src_vector[i].size());
+                    job[i]->flags        = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+                } else {
+                    job[i]->next_in_ptr  = const_cast<uint8_t *>(column.chunk[k].data());
+                    job[i]->available_in = static_cast<uint32_t>(column.chunk[k].size());
+                    job[i]->flags        = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+                }
+            }
+            run_jobs(enqueue_cnt, short_output_ok);
+            for (int i = 0; i < enqueue_cnt; ++i) { finish(i, (*chunks)[file_id + i]); }
+            file_id += enqueue_cnt;
+        }
+    }
+
+    void run_jobs(int enqueue_cnt, bool short_output_ok)
+    {
+        job_status.assign(enqueue_cnt, QPL_STS_OK);
+        if (execution_path == qpl_path_software) {
+            std::vector<std::thread> job_th;
+            for (int i = 0; i < enqueue_cnt; ++i) {
+                job_th.emplace_back([&, i]() { job_status[i] = qpl_execute_job(job[i]); });
+            }
+            for (auto& th : job_th) { th.join(); }
+        } else {
+            for (int i = 0; i < enqueue_cnt; ++i) { check_status(qpl_submit_job(job[i]), "job submission"); }
+            for (int i = 0; i < enqueue_cnt; ++i) { job_status[i] = qpl_wait_job(job[i]); }
+        }
+        for (qpl_status s : job_status) {
+            if (short_output_ok && s == QPL_STS_DST_IS_SHORT_ERR) { continue; }
+            check_status(s, execution_path == qpl_path_software ? "job execution" : "job waiting");
+        }
+    }
+
+    void software_decompress(const compressed_column& column, uint32_t k, std::vector<uint8_t>& dest)
+    {
+        dest.resize(static_cast<std::size_t>(column.layout.chunk_rows[k]) * column.value_bytes());
+        qpl_job *job_ptr = job[0];
+        job_ptr->op            = qpl_op_decompress;
+        job_ptr->next_in_ptr   = const_cast<uint8_t *>(column.chunk[k].data());
+        job_ptr->available_in  = static_cast<uint32_t>(column.chunk[k].size());
+        job_ptr->next_out_ptr  = dest.data();
+        job_ptr->available_out = static_cast<uint32_t>(dest.size());
+        job_ptr->flags         = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        check_status(qpl_execute_job(job_ptr), "job execution");
+    }
+
+    /**
+     * Decompresses every chunk of a column being loaded, in rounds of queue_size jobs, and keeps selectivity_sample_rows
+     * values taken at a fixed stride over the whole chunk in column.sample. A prefix of the chunk would misjudge
+     * clustered columns such as l_shipdate, whose first values say little about the rest of the chunk. The pass is
+     * paid once per column, and filters then submit their scans without a sampling round trip.
+     */
+    void load_samples(compressed_column& column)
+    {
+        const std::size_t value_bytes = column.value_bytes();
+        std::vector<std::vector<uint8_t>> decompressed(queue_size);
+        column.sample.resize(column.chunk.size());
+        run_rounds(column, false, [&](int i, uint32_t k) {
+            decompressed[i].resize(static_cast<std::size_t>(column.layout.chunk_rows[k]) * value_bytes);
+            job[i]->op            = qpl_op_decompress;
+            job[i]->next_in_ptr   = const_cast<uint8_t *>(column.chunk[k].data());
+            job[i]->available_in  = static_cast<uint32_t>(column.chunk[k].size());
+            job[i]->next_out_ptr  = decompressed[i].data();
+            job[i]->available_out = static_cast<uint32_t>(decompressed[i].size());
+            job[i]->flags         = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        }, [&](int i, uint32_t k) {
+            if (job[i]->total_out != decompressed[i].size()) {
+                throw std::runtime_error("Unexpected decompressed size of " + column.name + " chunk " + std::to_string(k));
+            }
+            const uint32_t rows = column.layout.chunk_rows[k];
+            const uint32_t samples = std::min(rows, selectivity_sample_rows);
+            const std::size_t stride = samples > 0 ? rows / samples : 1;
+            column.sample[k].resize(samples * value_bytes);
+            for (uint32_t j = 0; j < samples; j++) {
+                std::memcpy(column.sample[k].data() + j * value_bytes, decompressed[i].data() + j * stride * value_bytes, value_bytes);
+            }
+        });
+    }
+
+    // Fraction of the sampled values of chunk k inside [low, high]
+    static double sample_selectivity(const compressed_column& column, uint32_t k, uint32_t low, uint32_t high)
+    {
+        const uint32_t samples = static_cast<uint32_t>(column.sample[k].size() / column.value_bytes());
+        if (samples == 0) { return 1.0; }
+        uint32_t hits = 0;
+        for (uint32_t j = 0; j < samples; j++) {
+            const uint32_t value = stored_value(column.sample[k].data(), column.layout.bit_width, j);
+            hits += value >= low && value <= high;
+        }
+        return static_cast<double>(hits) / samples;
+    }
+
+    // Bitmap scan of chunk k alone, for a chunk whose index list did not fit its output buffer
+    void scan_bitmap(const compressed_column& column, uint32_t k, uint32_t low, uint32_t high, std::vector<uint8_t>& bitmap)
+    {
+        bitmap.resize((column.layout.chunk_rows[k] + 7) / 8);
+        qpl_job *job_ptr = job[0];
+        if (execution_path == qpl_path_software) {
+            software_decompress(column, k, src_vector[0]);
+            job_ptr->next_in_ptr  = src_vector[0].data();
+            job_ptr->available_in = static_cast<uint32_t>(src_vector[0].size());
+            job_ptr->flags        = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        } else {
+            job_ptr->next_in_ptr  = const_cast<uint8_t *>(column.chunk[k].data());
+            job_ptr->available_in = static_cast<uint32_t>(column.chunk[k].size());
+            job_ptr->flags        = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+        }
+        job_ptr->op                 = qpl_op_scan_range;
+        job_ptr->src1_bit_width     = column.layout.bit_width;
+        job_ptr->num_input_elements = column.layout.chunk_rows[k];
+        job_ptr->next_out_ptr       = bitmap.data();
+        job_ptr->available_out      = static_cast<uint32_t>(bitmap.size());
+        job_ptr->out_bit_width      = qpl_ow_nom;
+        job_ptr->param_low          = low;
+        job_ptr->param_high         = high;
+        check_status(qpl_execute_job(job_ptr), "job execution");
+    }
+
+    // Mask chunk &= scanned chunk. A bitmap against a bitmap stays a bitmap; otherwise the index list is filtered.
+    static void and_chunk(std::vector<uint8_t>& chunk, qpl_out_format& format, std::vector<uint8_t>& scanned, qpl_out_format scanned_format, uint32_t rows)
+    {
+        if (format == qpl_ow_nom && scanned_format == qpl_ow_nom) {
+            for (size_t j = 0; j < chunk.size(); j++) { chunk[j] &= scanned[j]; }
+            return;
+        }
+        if (format == qpl_ow_nom) {
+            std::swap(chunk, scanned);
+            std::swap(format, scanned_format);
+        }
+        const std::vector<uint32_t> indices = chunk_indices(chunk, format, rows);
+        std::vector<uint32_t> kept;
+        if (scanned_format == qpl_ow_nom) {
+            for (uint32_t i : indices) {
+                if ((scanned[i / 8] >> (i % 8)) & 1) { kept.push_back(i); }
+            }
+        } else {
+            const std::vector<uint32_t> other = chunk_indices(scanned, scanned_format, rows);
+            std::set_intersection(indices.begin(), indices.end(), other.begin(), other.end(), std::back_inserter(kept));
+        }
+        chunk = encode_chunk(kept, format, rows);
+    }
+
+    mask_ptr filter_locked(const std::vector<range_predicate>& predicates)
+    {
+        auto mask = std::make_shared<row_mask>();
+        for (size_t p = 0; p < predicates.size(); p++) {
+            const compressed_column& column = *std::get<0>(predicates[p]);
+            const uint32_t lower_boundary = encode_boundary(column, std::get<1>(predicates[p]));
+            const uint32_t upper_boundary = encode_boundary(column, std::get<2>(predicates[p]));
+            if (p == 0) {
+                mask->chunk_rows = column.layout.chunk_rows;
+                mask->chunk.resize(column.chunk.size());
+                mask->chunk_format.assign(column.chunk.size(), qpl_ow_nom);
+                mask->chunk_count.assign(column.chunk.size(), 0);
+            } else if (column.layout.chunk_rows != mask->chunk_rows) {
+                throw std::invalid_argument(column.name + " is not chunked by the same row counts as the other predicate columns");
+            }
+            std::vector<std::vector<uint8_t>> scanned(column.chunk.size());
+            std::vector<qpl_out_format> format(column.chunk.size(), qpl_ow_nom);
+            std::vector<uint32_t> overflowed;
+            run_rounds(column, true, [&](int i, uint32_t k) {
+                const uint32_t rows = column.layout.chunk_rows[k];
+                format[k] = choose_scan_format(rows, sample_selectivity(column, k, lower_boundary, upper_boundary) * rows);
+                // An index list gets the room of the bitmap; one that needs more is cheaper as a bitmap anyway
+                scanned[k].resize((rows + 7) / 8);
+                job[i]->op            = qpl_op_scan_range;
+                job[i]->next_out_ptr  = scanned[k].data();
+                job[i]->available_out = static_cast<uint32_t>(scanned[k].size());
+                job[i]->out_bit_width = format[k];
+                job[i]->param_low     = lower_boundary;
+                job[i]->param_high    = upper_boundary;
+            }, [&](int i, uint32_t k) {
+                if (job_status[i] == QPL_STS_DST_IS_SHORT_ERR && format[k] != qpl_ow_nom) {
+                    overflowed.push_back(k);
+                    return;
+                }
+                if (format[k] == qpl_ow_nom ? job[i]->total_out != scanned[k].size() : job[i]->total_out % index_bytes(format[k]) != 0) {
+                    throw std::runtime_error("Unexpected scan output of " + column.name + " chunk " + std::to_string(k));
+                }
+                scanned[k].resize(job[i]->total_out);
+            }, true);
+            for (uint32_t k : overflowed) {
+                format[k] = qpl_ow_nom;
+                scan_bitmap(column, k, lower_boundary, upper_boundary, scanned[k]);
+            }
+            for (size_t k = 0; k < scanned.size(); k++) {
+                if (p == 0) {
+                    mask->chunk[k] = std::move(scanned[k]);
+                    mask->chunk_format[k] = format[k];
+                } else {
+                    and_chunk(mask->chunk[k], mask->chunk_format[k], scanned[k], format[k], mask->chunk_rows[k]);
+                }
+            }
+        }
+        // The exact counts may favour another format than the per-predicate estimates did
+        for (size_t k = 0; k < mask->chunk.size(); k++) {
+            std::vector<uint8_t>& chunk = mask->chunk[k];
+            const uint32_t rows = mask->chunk_rows[k];
+            mask->chunk_count[k] = chunk_count(chunk, mask->chunk_format[k], rows);
+            const qpl_out_format best = choose_output_format(rows, mask->chunk_count[k]);
+            if (best != mask->chunk_format[k]) {
+                chunk = encode_chunk(chunk_indices(chunk, mask->chunk_format[k], rows), best, rows);
+                mask->chunk_format[k] = best;
+            }
+        }
+        return mask;
+    }
+
+    /**
+     * The selected rows of chunk k land at the offset of the selected rows of the chunks before it, so dest needs no
+     * compaction. A bitmap chunk is one decompress + select job. A row number list is not expanded back to a bitmap:
+     * one decompress + extract job returns the rows between its first and last row number, and the listed rows are
+     * gathered from them on the CPU. Chunks without selected rows are skipped.
+     */
+    void select_locked(const compressed_column& column, const row_mask& mask, std::vector<uint8_t>& dest)
+    {
+        if (column.layout.chunk_rows != mask.chunk_rows) {
+            throw std::invalid_argument(column.name + " is not chunked by the same row counts as the mask");
+        }
+        const std::vector<std::size_t> offset = chunk_offsets(column, mask.chunk_count);
+        const std::size_t value_bytes = column.value_bytes();
+        dest.resize(offset.back());
+        std::vector<uint32_t> selected_chunks;
+        for (uint32_t k = 0; k < mask.chunk.size(); k++) {
+            if (mask.chunk_count[k] != 0) { selected_chunks.push_back(k); }
+        }
+        std::vector<std::vector<uint32_t>> indices(queue_size);
+        std::vector<std::vector<uint8_t>> extracted(queue_size);
+        run_rounds(column, true, [&](int i, uint32_t k) {
+            job[i]->out_bit_width = qpl_ow_nom;
+            if (mask.chunk_format[k] == qpl_ow_nom) {
+                job[i]->op             = qpl_op_select;
+                job[i]->next_out_ptr   = dest.data() + offset[k];
+                job[i]->available_out  = static_cast<uint32_t>(offset[k + 1] - offset[k]);
+                job[i]->next_src2_ptr  = const_cast<uint8_t *>(mask.chunk[k].data());
+                job[i]->available_src2 = static_cast<uint32_t>(mask.chunk[k].size());
+                job[i]->src2_bit_width = 1;
+                return;
+            }
+            indices[i] = chunk_indices(mask.chunk[k], mask.chunk_format[k], mask.chunk_rows[k]);
+            extracted[i].resize(static_cast<std::size_t>(indices[i].back() - indices[i].front() + 1) * value_bytes);
+            job[i]->op            = qpl_op_extract;
+            job[i]->next_out_ptr  = extracted[i].data();
+            job[i]->available_out = static_cast<uint32_t>(extracted[i].size());
+            job[i]->param_low     = indices[i].front();
+            job[i]->param_high    = indices[i].back();
+        }, [&](int i, uint32_t k) {
+            if (mask.chunk_format[k] == qpl_ow_nom) {
+                if (job[i]->total_out != offset[k + 1] - offset[k]) {
+                    throw std::runtime_error("Unexpected select output of " + column.name + " chunk " + std::to_string(k));
+                }
+                return;
+            }
+            if (job[i]->total_out != extracted[i].size()) {
+                throw std::runtime_error("Unexpected extract output of " + column.name + " chunk " + std::to_string(k));
+            }
+            uint8_t *out = dest.data() + offset[k];
+            const uint32_t first = indices[i].front();
+            for (std::size_t j = 0; j < indices[i].size(); j++) {
+                std::memcpy(out + j * value_bytes, extracted[i].data() + static_cast<std::size_t>(indices[i][j] - first) * value_bytes, value_bytes);
+            }
+        }, false, &selected_chunks);
+    }
+};
+
+PYBIND11_MODULE(iaa_pandas, m) {
+    m.doc() = "IAA (Intel QPL) decompress / scan / select engine over iaa_lineitem_compression columns";
+
+    py::class_<compressed_column, column_ptr>(m, "Column")
+        .def_readonly("name", &compressed_column::name)
+        .def_readonly("dtype", &compressed_column::dtype)
+        .def_property_readonly("encoding", [](const compressed_column& c) { return c.layout.encoding; })
+        .def_property_readonly("bit_width", [](const compressed_column& c) { return c.layout.bit_width; })
+        .def_property_readonly("num_chunks", [](const compressed_column& c) { return c.chunk.size(); })
+        .def_property_readonly("rows", &compressed_column::rows)
+        .def_property_readonly("compressed_bytes", &compressed_column::compressed_bytes)
+        .def_property_readonly("mini_block_size", [](const compressed_column& c) { return c.mini_block_size; })
+        .def("__len__", &compressed_column::rows);
+
+    py::class_<row_mask, mask_ptr>(m, "Mask")
+        .def("count", &row_mask::count)
+        .def("to_numpy", [](const row_mask& mask) {
+            std::size_t rows = 0;
+            for (uint32_t r : mask.chunk_rows) { rows += r; }
+            py::array_t<bool> result(static_cast<py::ssize_t>(rows));
+            bool *out = result.mutable_data();
+            for (size_t k = 0; k < mask.chunk.size(); k++) {
+                if (mask.chunk_format[k] == qpl_ow_nom) {
+                    for (uint32_t i = 0; i < mask.chunk_rows[k]; i++) { out[i] = (mask.chunk[k][i / 8] >> (i % 8)) & 1; }
+                } else {
+                    std::fill(out, out + mask.chunk_rows[k], false);
+                    for (uint32_t i : chunk_indices(mask.chunk[k], mask.chunk_format[k], mask.chunk_rows[k])) { out[i] = true; }
+                }
+                out += mask.chunk_rows[k];
+            }
+            return result;
+        }, "Row mask as a numpy bool array (copy)")
+        .def_property_readonly("formats", [](const row_mask& mask) {
+            std::vector<std::string> formats;
+            for (qpl_out_format format : mask.chunk_format) {
+                formats.push_back(format == qpl_ow_nom ? "bitmap" : format == qpl_ow_16 ? "index16" : "index32");
+            }
+            return formats;
+        }, "Storage format of each chunk: bitmap, index16 or index32")
+        .def_property_readonly("nbytes", [](const row_mask& mask) {
+            std::size_t bytes = 0;
+            for (const auto& chunk : mask.chunk) { bytes += chunk.size(); }
+            return bytes;
+        });
+
+    py::class_<iaa_engine>(m, "Engine")
+        .def(py::init<const std::string&, uint32_t>(), py::arg("path") = "hardware_path", py::arg("queue_size") = 2)
+        .def("load_column", &iaa_engine::load_column, py::arg("compressed_dir"), py::arg("name"), py::arg("orig_dir") = "", py::arg("dtype") = "",
+             "Reads every compressed chunk of a column; dtype defaults to the unsigned/int32 type of the stored width")
+        .def("decompress", &iaa_engine::decompress, py::arg("column"),
+             "Whole column as a numpy array owning the decompressed buffer")
+        .def("lookup", &iaa_engine::lookup, py::arg("column"), py::arg("first_row"), py::arg("num_rows"),
+             "Rows [first_row, first_row + num_rows) as a numpy array; indexed columns decompress only the covering mini-blocks")
+        .def("filter", &iaa_engine::filter, py::arg("predicates"),
+             "AND of (column, lower, upper) inclusive range predicates")
+        .def("select", &iaa_engine::select, py::arg("column"), py::arg("mask"),
+             "Values of the masked rows as a numpy array owning the selected buffer")
+        .def("filter_aggregate", &iaa_engine::filter_aggregate, py::arg("predicates"), py::arg("column1"), py::arg("column2"),
+             "sum(column1 * column2) over the rows passing every predicate");
+}
@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# Get the Git root directory
+GIT_ROOT=$(git rev-parse --show-toplevel)
+
+# Define the QPL include and library paths relative to the Git root
+QPL_INCLUDE="$GIT_ROOT/qpl/include"
+QPL_LIB="$GIT_ROOT/qpl/build/lib/libqpl.a"
+
+# Compile the Python module (requires `pip install pybind11 numpy`)
+g++ -O3 -shared -fPIC -std=c++17 $(python3 -m pybind11 --includes) -I"$QPL_INCLUDE" -o iaa_pandas$(python3-config --extension-suffix) iaa_pandas.cpp "$QPL_LIB" -ldl
@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Compile the .tbl to column binary converter (no QPL dependency)
+g++ -O3 -std=c++17 -pthread -o tbl_converter tbl_converter.cpp
@@ -20,6 +20,7 @@ def main():
     column_names = ['l_orderkey', 'l_partkey', 'l_suppkey', 'l_linenumber', 'l_quantity', 'l_extendedprice', 
                     'l_discount', 'l_tax', 'l_returnflag', 'l_linestatus', 'l_shipdate', 'l_commitdate', 
                     'l_receiptdate', 'l_shipinstruct', 'l_shipmode', 'l_comment']
+    dictionary_columns = ['l_returnflag', 'l_linestatus', 'l_shipinstruct', 'l_shipmode']
 
     # Loop through each column in the DataFrame
     for i, col_name in enumerate(df.columns):
@@ -43,5 +44,20 @@ def main():
 
         print(f"Column {column_names[i]} written to {output_path}")
 
+    # Low-cardinality string columns are also written as int32 codes into a sorted dictionary
+    # (<column>_code.bin + <column>_code.dict) so that the IAA engine can scan and group them row by row
+    for col_name in dictionary_columns:
+        values = df[column_names.index(col_name)].astype(str)
+        dictionary = sorted(values.unique())
+        codes = pd.Categorical(values, categories=dictionary).codes.astype(np.int32)
+
+        output_path = os.path.join(output_lineitem_dir, col_name + "_code.bin")
+        with open(output_path, "wb") as f:
+            f.write(codes.tobytes())
+        with open(os.path.join(output_lineitem_dir, col_name + "_code.dict"), "w") as f:
+            f.write("\n".join(dictionary) + "\n")
+
+        print(f"Column {col_name} dictionary codes written to {output_path}")
+
 if __name__ == "__main__":
     main()
@@ -0,0 +1,671 @@
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Compresses every column of a table in one pass, the table-level counterpart of iaa_lineitem_compression.
+ * The chunks of all columns are interleaved into one task list and fed to one shared set of queue_size jobs, which is
+ * kept full: a job is refilled with the next chunk as soon as its previous one completes. On the hardware path the
+ * jobs are spread round-robin over the NUMA nodes of all enabled IAA devices, so every device and work queue takes
+ * part, and writer threads store the finished chunks while the accelerator keeps working.
+ * The output files (<column>.iaa.compressed.<k>, .meta and .huffman) are the same as iaa_lineitem_compression's.
+ *
+ * Usage: table_compression <hardware_path|software_path> <src_dir> <dest_dir> <queue_size> [column[:encoding] ...]
+ *                          [--huffman=dynamic|fixed|canned] [--writers=<n>] [--numa=all|auto]
+ * Without columns, every *.bin file of src_dir is compressed. Without an encoding, <column>.encoding is used if present.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ *
+ */
+
+/**
+ * NOTE : Maximum transfer size per grouped_workqueues of IAA is 2097152(2MB)
+ * If you want to put data larger than 2MB, you have to split the data into 2MB chunks.
+ */
+const std::size_t chunk_size = 2097152;
+
+/**
+ * NOTE : With a storage encoding, columns are chunked by row count instead of bytes so that chunk k of every column
+ * covers the same rows whatever its physical width. rows_per_chunk keeps the widest (32-bit) chunk at chunk_size.
+ */
+const std::size_t rows_per_chunk = chunk_size / 4;
+
+/**
+ * NOTE : The canned Huffman strategy is the default here: a per-chunk (dynamic) table costs a CPU statistics pass on
+ * the submitting thread before every job, which keeps the devices from being saturated.
+ */
+const std::size_t huffman_sample_slices = 16;
+const std::size_t huffman_sample_bytes = 65536;
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 5) {
+            std::cout << "Usage: table_compression <hardware_path|software_path> <src_dir> <dest_dir> <queue_size> [column[:encoding] ...] [--huffman=dynamic|fixed|canned] [--writers=<n>] [--numa=all|auto]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Re-encodes a column of 32-bit values into its storage encoding, as iaa_lineitem_compression does:
+// "32" keeps the values, "16"/"8" narrow integers, "date16" stores Unix timestamps as 16-bit days since epoch.
+int narrow_column(std::vector<uint8_t>& data, const std::string& encoding, uint32_t& bit_width)
+{
+    if (encoding == "32") { bit_width = 32; return 0; }
+    if (encoding == "16" || encoding == "date16") { bit_width = 16; }
+    else if (encoding == "8") { bit_width = 8; }
+    else {
+        std::cout << "Unrecognized storage encoding " << encoding << ". Use 32, 16, 8 or date16." << std::endl;
+        return 1;
+    }
+    const std::size_t rows = data.size() / 4;
+    const uint32_t max_value = (1u << bit_width) - 1;
+    for (std::size_t r = 0; r < rows; r++) {
+        uint32_t value = 0;
+        std::memcpy(&value, data.data() + r * 4, sizeof(value));
+        if (encoding == "date16") { value /= 86400; }
+        if (value > max_value) {
+            std::cout << "Value " << value << " at row " << r << " does not fit in " << bit_width << " bits." << std::endl;
+            return 1;
+        }
+        if (bit_width == 16) {
+            uint16_t narrow = static_cast<uint16_t>(value);
+            std::memcpy(data.data() + r * 2, &narrow, sizeof(narrow));
+        } else {
+            data[r] = static_cast<uint8_t>(value);
+        }
+    }
+    data.resize(rows * (bit_width / 8));
+    return 0;
+}
+
+// Deflate token histogram of a column sample. Every symbol keeps a count of at least one so that the table built
+// from it can encode chunks containing symbols the sample missed.
+int sample_histogram(std::vector<uint8_t>& data, qpl_path_t execution_path, qpl_histogram& histogram)
+{
+    histogram = qpl_histogram {};
+    const std::size_t slice_bytes = std::min(huffman_sample_bytes, data.size());
+    const std::size_t slices = data.size() > huffman_sample_slices * huffman_sample_bytes ? huffman_sample_slices : (data.size() + huffman_sample_bytes - 1) / huffman_sample_bytes;
+    for (std::size_t s = 0; s < slices; s++) {
+        std::size_t offset = std::min(s * (data.size() / slices) & ~static_cast<std::size_t>(3), data.size() - slice_bytes);
+        qpl_histogram slice_histogram {};
+        qpl_status status = qpl_gather_deflate_statistics(data.data() + offset, static_cast<uint32_t>(slice_bytes), &slice_histogram, qpl_default_level, execution_path);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+            return 1;
+        }
+        for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += slice_histogram.literal_lengths[k]; }
+        for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += slice_histogram.distances[k]; }
+    }
+    for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += 1; }
+    for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += 1; }
+    return 0;
+}
+
+// Cached histogram of a column, valid only for the storage encoding it was sampled with
+bool load_cached_histogram(const std::string& cache_path, const std::string& encoding, qpl_histogram& histogram)
+{
+    std::ifstream cache_file(cache_path);
+    std::string key, cached_encoding;
+    if (!(cache_file >> key >> cached_encoding) || key != "encoding" || cached_encoding != (encoding.empty() ? "raw" : encoding)) {
+        return false;
+    }
+    if (!(cache_file >> key) || key != "literal_lengths") { return false; }
+    for (auto& count : histogram.literal_lengths) {
+        if (!(cache_file >> count)) { return false; }
+    }
+    if (!(cache_file >> key) || key != "distances") { return false; }
+    for (auto& count : histogram.distances) {
+        if (!(cache_file >> count)) { return false; }
+    }
+    return true;
+}
+
+int store_cached_histogram(const std::string& cache_path, const std::string& encoding, const qpl_histogram& histogram)
+{
+    std::ofstream cache_file(cache_path, std::ofstream::out);
+    if (!cache_file) {
+        std::cout << "File not found : " << cache_path << std::endl;
+        return 1;
+    }
+    cache_file << "encoding " << (encoding.empty() ? "raw" : encoding) << "\n";
+    cache_file << "literal_lengths";
+    for (auto count : histogram.literal_lengths) { cache_file << " " << count; }
+    cache_file << "\ndistances";
+    for (auto count : histogram.distances) { cache_file << " " << count; }
+    cache_file << "\n";
+    return 0;
+}
+
+int build_huffman_table(const qpl_histogram& histogram, qpl_path_t execution_path, qpl_huffman_table_t& table)
+{
+    qpl_status status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C, &table);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table creation.\n";
+        return 1;
+    }
+    status = qpl_huffman_table_init_with_histogram(table, &histogram);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
+        qpl_huffman_table_destroy(table);
+        table = nullptr;
+        return 1;
+    }
+    return 0;
+}
+
+// Enabled IAA devices and work queues as configured by accel-config (configure_iaa_user.sh)
+struct iaa_topology {
+    uint32_t devices = 0;
+    uint32_t work_queues = 0;
+    std::vector<uint32_t> numa_nodes;
+};
+
+iaa_topology discover_iaa_devices()
+{
+    iaa_topology topology;
+    std::set<uint32_t> nodes;
+    const std::filesystem::path dsa_devices = "/sys/bus/dsa/devices";
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(dsa_devices, error)) {
+        const std::string name = entry.path().filename().string();
+        std::string state;
+        std::ifstream(entry.path() / "state") >> state;
+        if (state != "enabled") { continue; }
+        if (name.rfind("iax", 0) == 0) {
+            int node = -1;
+            std::ifstream(entry.path() / "numa_node") >> node;
+            nodes.insert(node < 0 ? 0 : static_cast<uint32_t>(node));
+            topology.devices++;
+        } else if (name.rfind("wq", 0) == 0) {
+            // wq<device>.<queue> belongs to an IAA device when iax<device> exists
+            const std::string device = "iax" + name.substr(2, name.find('.') - 2);
+            if (std::filesystem::exists(dsa_devices / device)) { topology.work_queues++; }
+        }
+    }
+    topology.numa_nodes.assign(nodes.begin(), nodes.end());
+    return topology;
+}
+
+struct table_column {
+    std::string name;
+    std::string encoding;
+    uint32_t bit_width = 8;
+    std::vector<uint8_t> data;
+    std::size_t chunk_bytes = chunk_size;
+    std::vector<std::size_t> compressed_bytes;
+    qpl_huffman_table_t canned_table = nullptr;
+};
+
+struct chunk_task {
+    std::size_t column;
+    std::size_t chunk;
+    std::size_t offset;
+    std::size_t bytes;
+};
+
+struct job_slot {
+    std::unique_ptr<uint8_t[]> job_buffer;
+    qpl_job *job = nullptr;
+    std::vector<uint8_t> dest;
+    chunk_task task {};
+    qpl_huffman_table_t chunk_table = nullptr;   // dynamic strategy only
+};
+
+/**
+ * Completed jobs are handed to the writer threads, which store the output and give the slot back to the submitter.
+ */
+class chunk_writer {
+public:
+    chunk_writer(std::vector<job_slot>& slots, std::vector<table_column>& columns, const std::string& dest_dir, uint32_t num_writers)
+        : slots_(slots), columns_(columns), dest_dir_(dest_dir) {
+        for (uint32_t i = 0; i < slots.size(); i++) { free_slots_.push_back(i); }
+        for (uint32_t i = 0; i < num_writers; i++) { threads_.emplace_back(&chunk_writer::run, this); }
+    }
+
+    ~chunk_writer() { finish(); }
+
+    // Blocks only when every slot is waiting to be written
+    bool acquire(uint32_t& slot, bool wait) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wait) { free_cv_.wait(lock, [this] { return !free_slots_.empty(); }); }
+        if (free_slots_.empty()) { return false; }
+        slot = free_slots_.front();
+        free_slots_.pop_front();
+        return true;
+    }
+
+    void complete(uint32_t slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            completed_.push_back(slot);
+        }
+        completed_cv_.notify_one();
+    }
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (done_) { return; }
+            done_ = true;
+        }
+        completed_cv_.notify_all();
+        for (auto& thread : threads_) { thread.join(); }
+    }
+
+    bool failed() const { return failed_.load(); }
+
+private:
+    void run() {
+        while (true) {
+            uint32_t slot = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                completed_cv_.wait(lock, [this] { return done_ || !completed_.empty(); });
+                if (completed_.empty()) { return; }
+                slot = completed_.front();
+                completed_.pop_front();
+            }
+            const chunk_task& task = slots_[slot].task;
+            const std::size_t total_out = columns_[task.column].compressed_bytes[task.chunk];
+            const std::string dest_path = dest_dir_ + columns_[task.column].name + ".iaa.compressed." + std::to_string(task.chunk);
+            std::ofstream dest_file(dest_path, std::ofstream::out | std::ofstream::binary);
+            if (!dest_file) {
+                std::cout << "File not found : " << dest_path << std::endl;
+                failed_ = true;
+            } else {
+                dest_file.write(reinterpret_cast<char *>(slots_[slot].dest.data()), static_cast<std::streamsize>(total_out));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                free_slots_.push_back(slot);
+            }
+            free_cv_.notify_one();
+        }
+    }
+
+    std::vector<job_slot>& slots_;
+    std::vector<table_column>& columns_;
+    const std::string dest_dir_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable free_cv_;
+    std::condition_variable completed_cv_;
+    std::deque<uint32_t> free_slots_;
+    std::deque<uint32_t> completed_;
+    std::atomic<bool> failed_ {false};
+    bool done_ = false;
+};
+
+int load_column(const std::string& src_dir, const std::string& name, std::string encoding, table_column& column)
+{
+    column.name = name;
+    std::ifstream src_file(src_dir + name, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << src_dir + name << std::endl;
+        return 1;
+    }
+    src_file.seekg(0, std::ios::end);
+    column.data.resize(static_cast<std::size_t>(src_file.tellg()));
+    src_file.seekg(0, std::ios::beg);
+    src_file.read(reinterpret_cast<char *>(column.data.data()), static_cast<std::streamsize>(column.data.size()));
+
+    if (encoding.empty()) {
+        std::ifstream encoding_file(src_dir + name + ".encoding");
+        encoding_file >> encoding;
+    }
+    column.encoding = encoding;
+    if (!encoding.empty()) {
+        if (narrow_column(column.data, encoding, column.bit_width) != 0) {
+            return 1;
+        }
+        column.chunk_bytes = rows_per_chunk * (column.bit_width / 8);
+    }
+    return 0;
+}
+
+int write_column_meta(const std::string& dest_path, const table_column& column)
+{
+    std::ofstream meta_file(dest_path + ".meta", std::ofstream::out);
+    if (!meta_file) {
+        std::cout << "File not found : " << dest_path + ".meta" << std::endl;
+        return 1;
+    }
+    const std::size_t element_bytes = column.bit_width / 8;
+    meta_file << "encoding " << column.encoding << "\n";
+    meta_file << "bit_width " << column.bit_width << "\n";
+    meta_file << "rows " << column.data.size() / element_bytes << "\n";
+    meta_file << "rows_per_chunk " << rows_per_chunk << "\n";
+    for (std::size_t k = 0; k < column.compressed_bytes.size(); k++) {
+        std::size_t bytes = std::min(column.chunk_bytes, column.data.size() - k * column.chunk_bytes);
+        meta_file << "chunk " << k << " " << bytes / element_bytes << " " << bytes << " " << column.compressed_bytes[k] << "\n";
+    }
+    return 0;
+}
+
+// Points the job of a slot at its next chunk; the dynamic strategy builds the chunk's table here
+int prepare_job(job_slot& slot, const chunk_task& task, std::vector<table_column>& columns, const std::string& huffman_strategy,
+                qpl_path_t execution_path)
+{
+    table_column& column = columns[task.column];
+    slot.task = task;
+    qpl_huffman_table_t table = column.canned_table;
+    if (huffman_strategy == "dynamic") {
+        qpl_histogram histogram {};
+        qpl_status status = qpl_gather_deflate_statistics(column.data.data() + task.offset, static_cast<uint32_t>(task.bytes), &histogram, qpl_default_level, execution_path);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+            return 1;
+        }
+        if (build_huffman_table(histogram, execution_path, table) != 0) {
+            return 1;
+        }
+        slot.chunk_table = table;
+    }
+    slot.job->op             = qpl_op_compress;
+    slot.job->level          = qpl_default_level;
+    slot.job->next_in_ptr    = column.data.data() + task.offset;
+    slot.job->next_out_ptr   = slot.dest.data();
+    slot.job->available_in   = static_cast<uint32_t>(task.bytes);
+    slot.job->available_out  = static_cast<uint32_t>(task.bytes);
+    slot.job->flags          = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+    slot.job->huffman_table  = table;
+    return 0;
+}
+
+void release_chunk_table(job_slot& slot)
+{
+    if (slot.chunk_table != nullptr) {
+        qpl_huffman_table_destroy(slot.chunk_table);
+        slot.chunk_table = nullptr;
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_hardware;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+
+    const std::string SRC_DIR  = argv[2];
+    const std::string DEST_DIR = argv[3];
+    const uint32_t queue_size  = static_cast<uint32_t>(atoi(argv[4]));
+    std::string huffman_strategy = "canned";
+    std::string numa_option = "all";
+    uint32_t num_writers = std::max(1u, std::thread::hardware_concurrency() / 4);
+    std::vector<std::pair<std::string, std::string>> column_args;
+    for (int arg = 5; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option.rfind("--huffman=", 0) == 0) { huffman_strategy = option.substr(10); }
+        else if (option.rfind("--writers=", 0) == 0) { num_writers = std::max(1, atoi(option.c_str() + 10)); }
+        else if (option.rfind("--numa=", 0) == 0) { numa_option = option.substr(7); }
+        else {
+            std::size_t colon = option.find(':');
+            column_args.emplace_back(option.substr(0, colon), colon == std::string::npos ? "" : option.substr(colon + 1));
+        }
+    }
+    if (queue_size == 0) {
+        std::cout << "The queue size must be at least 1." << std::endl;
+        return 1;
+    }
+    if (huffman_strategy != "dynamic" && huffman_strategy != "fixed" && huffman_strategy != "canned") {
+        std::cout << "Unrecognized Huffman strategy " << huffman_strategy << ". Use dynamic, fixed or canned." << std::endl;
+        return 1;
+    }
+    if (column_args.empty()) {
+        for (const auto& entry : std::filesystem::directory_iterator(SRC_DIR)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+                column_args.emplace_back(entry.path().filename().string(), "");
+            }
+        }
+        std::sort(column_args.begin(), column_args.end());
+    }
+    std::filesystem::create_directories(DEST_DIR);
+
+    // Loading and re-encoding every column, then the canned tables
+    std::cout << "[IAA Table Compression]" << std::endl;
+    std::vector<table_column> columns(column_args.size());
+    std::size_t input_size = 0;
+    for (std::size_t c = 0; c < columns.size(); c++) {
+        if (load_column(SRC_DIR, column_args[c].first, column_args[c].second, columns[c]) != 0) {
+            return 1;
+        }
+        input_size += columns[c].data.size();
+    }
+    auto table_start = std::chrono::steady_clock::now();
+    if (huffman_strategy == "canned") {
+        for (auto& column : columns) {
+            const std::string cache_path = DEST_DIR + column.name + ".iaa.compressed.huffman";
+            qpl_histogram histogram {};
+            if (!load_cached_histogram(cache_path, column.encoding, histogram)) {
+                if (sample_histogram(column.data, execution_path, histogram) != 0 ||
+                    store_cached_histogram(cache_path, column.encoding, histogram) != 0) {
+                    return 1;
+                }
+            }
+            if (build_huffman_table(histogram, execution_path, column.canned_table) != 0) {
+                return 1;
+            }
+        }
+    }
+    auto table_end = std::chrono::steady_clock::now();
+
+    // Chunks of all columns interleaved, so every column's files are written from the start of the pass
+    std::vector<chunk_task> tasks;
+    for (std::size_t k = 0, added = 1; added > 0; k++) {
+        added = 0;
+        for (std::size_t c = 0; c < columns.size(); c++) {
+            const std::size_t offset = k * columns[c].chunk_bytes;
+            if (offset < columns[c].data.size()) {
+                tasks.push_back({c, k, offset, std::min(columns[c].chunk_bytes, columns[c].data.size() - offset)});
+                columns[c].compressed_bytes.push_back(0);
+                added++;
+            }
+        }
+    }
+
+    iaa_topology topology = discover_iaa_devices();
+    if (execution_path == qpl_path_hardware) {
+        std::cout << "IAA devices      = " << topology.devices << " (" << topology.work_queues << " work queues, " << topology.numa_nodes.size() << " NUMA nodes)" << std::endl;
+    }
+    const bool spread_numa = execution_path == qpl_path_hardware && numa_option == "all" && topology.numa_nodes.size() > 1;
+
+    // Shared job slots
+    uint32_t size = 0;
+    qpl_status status = qpl_get_job_size(execution_path, &size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::vector<job_slot> slots(queue_size);
+    for (uint32_t i = 0; i < queue_size; ++i) {
+        slots[i].job_buffer = std::make_unique<uint8_t[]>(size);
+        slots[i].job = reinterpret_cast<qpl_job *>(slots[i].job_buffer.get());
+        status = qpl_init_job(execution_path, slots[i].job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+            return 1;
+        }
+        if (spread_numa) {
+            slots[i].job->numa_id = topology.numa_nodes[i % topology.numa_nodes.size()];
+        }
+        slots[i].dest.resize(chunk_size);
+    }
+
+    std::cout << "Columns          = " << columns.size() << " (" << tasks.size() << " chunks)" << std::endl;
+    std::cout << "Queue Size       = " << queue_size << ", writers = " << num_writers << ", Huffman = " << huffman_strategy << std::endl;
+
+    std::vector<uint32_t> in_flight;
+    std::size_t next_task = 0;
+    std::size_t max_in_flight = 0;
+    bool failed = false;
+    auto start = std::chrono::steady_clock::now();
+    {
+        chunk_writer writer(slots, columns, DEST_DIR, num_writers);
+        if (execution_path == qpl_path_software) {
+            // Software path: queue_size threads, each running its own slot's jobs back to back
+            std::atomic<std::size_t> shared_task {0};
+            std::atomic<bool> job_failed {false};
+            std::vector<std::thread> workers;
+            for (uint32_t t = 0; t < queue_size; t++) {
+                workers.emplace_back([&] {
+                    for (std::size_t id = shared_task++; id < tasks.size() && !job_failed; id = shared_task++) {
+                        uint32_t slot = 0;
+                        writer.acquire(slot, true);
+                        if (prepare_job(slots[slot], tasks[id], columns, huffman_strategy, execution_path) != 0) {
+                            job_failed = true;
+                            break;
+                        }
+                        qpl_status job_status = qpl_execute_job(slots[slot].job);
+                        release_chunk_table(slots[slot]);
+                        if (job_status != QPL_STS_OK) {
+                            std::cout << "An error " << job_status << " acquired during job execution." << std::endl;
+                            job_failed = true;
+                            break;
+                        }
+                        columns[tasks[id].column].compressed_bytes[tasks[id].chunk] = slots[slot].job->total_out;
+                        writer.complete(slot);
+                    }
+                });
+            }
+            for (auto& worker : workers) { worker.join(); }
+            failed = job_failed;
+        } else {
+            // Hardware path: refill free slots, then reap whatever has completed
+            while (!failed && (next_task < tasks.size() || !in_flight.empty())) {
+                bool progress = false;
+                uint32_t slot = 0;
+                while (next_task < tasks.size() && writer.acquire(slot, in_flight.empty())) {
+                    if (prepare_job(slots[slot], tasks[next_task], columns, huffman_strategy, execution_path) != 0) {
+                        failed = true;
+                        break;
+                    }
+                    status = qpl_submit_job(slots[slot].job);
+                    if (status != QPL_STS_OK) {
+                        std::cout << "An error " << status << " acquired during job submission." << std::endl;
+                        failed = true;
+                        break;
+                    }
+                    in_flight.push_back(slot);
+                    next_task++;
+                    progress = true;
+                }
+                max_in_flight = std::max(max_in_flight, in_flight.size());
+                for (std::size_t i = 0; i < in_flight.size() && !failed;) {
+                    job_slot& job_slot_ref = slots[in_flight[i]];
+                    status = qpl_check_job(job_slot_ref.job);
+                    if (status == QPL_STS_BEING_PROCESSED) {
+                        i++;
+                        continue;
+                    }
+                    release_chunk_table(job_slot_ref);
+                    if (status != QPL_STS_OK) {
+                        std::cout << "An error " << status << " acquired during job waiting." << std::endl;
+                        failed = true;
+                        break;
+                    }
+                    columns[job_slot_ref.task.column].compressed_bytes[job_slot_ref.task.chunk] = job_slot_ref.job->total_out;
+                    writer.complete(in_flight[i]);
+                    in_flight[i] = in_flight.back();
+                    in_flight.pop_back();
+                    progress = true;
+                }
+                if (!progress) { std::this_thread::yield(); }
+            }
+            // Leave no job running on buffers that are about to be freed
+            for (auto slot_id : in_flight) { qpl_wait_job(slots[slot_id].job); }
+        }
+        writer.finish();
+        failed = failed || writer.failed();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (failed) {
+        return 1;
+    }
+
+    // Chunk metadata and per-column summary
+    std::size_t output_size = 0;
+    std::cout << std::endl;
+    std::cout << "column\tencoding\tchunks\tinput_bytes\toutput_bytes\tratio" << std::endl;
+    for (auto& column : columns) {
+        std::size_t column_output = 0;
+        for (auto bytes : column.compressed_bytes) { column_output += bytes; }
+        output_size += column_output;
+        if (!column.encoding.empty() && write_column_meta(DEST_DIR + column.name + ".iaa.compressed", column) != 0) {
+            return 1;
+        }
+        if (column.canned_table != nullptr) {
+            qpl_huffman_table_destroy(column.canned_table);
+        }
+        std::cout << column.name << "\t" << (column.encoding.empty() ? "raw" : column.encoding) << "\t" << column.compressed_bytes.size() << "\t"
+                  << column.data.size() << "\t" << column_output << "\t" << static_cast<double>(column_output) / static_cast<double>(column.data.size()) << std::endl;
+    }
+
+    for (auto& slot : slots) {
+        status = qpl_fini_job(slot.job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+            return 1;
+        }
+    }
+
+    std::chrono::duration<int64_t, std::nano> elapsed_time_ns = end - start;
+    std::chrono::duration<int64_t, std::nano> table_time_ns = table_end - table_start;
+    double elapsed_time_sec = static_cast<double>(elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+    std::cout << std::endl;
+    std::cout << "Content was successfully compressed." << std::endl;
+    std::cout << "Input size       = " << input_size << " Bytes" << std::endl;
+    std::cout << "Output size      = " << output_size << " Bytes" << std::endl;
+    std::cout << "Ratio            = " << static_cast<double>(output_size) / static_cast<double>(input_size) << std::endl;
+    if (execution_path == qpl_path_hardware) {
+        std::cout << "Max in flight    = " << max_in_flight << " jobs" << (spread_numa ? " (spread over all NUMA nodes)" : "") << std::endl;
+    }
+    std::cout << "Table Time = " << table_time_ns.count() << " ns" << std::endl;
+    if (execution_path == qpl_path_software) { std::cout << "(sc)"; }
+    else { std::cout << "(hc)"; }
+    std::cout << "Elapsed Time = " << elapsed_time_ns.count() << " ns (" << elapsed_time_sec << " s)" << std::endl;
+    std::cout << "Bandwidth        = " << static_cast<double>(input_size) / 1024 / 1024 / elapsed_time_sec << " MB/s" << std::endl;
+
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
@@ -0,0 +1,474 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <immintrin.h>
+
+/**
+ * @brief Converts a TPC-H .tbl file into one binary file per column, the same files split_lineitem.py writes:
+ * integers as int32, decimals as float32, dates as int32 Unix timestamps and strings as their concatenated bytes.
+ * String columns are also written as int32 codes (<column>_code.bin) into a sorted dictionary (<column>_code.dict):
+ * lineitem's l_returnflag, l_linestatus, l_shipinstruct and l_shipmode always, and with --dict every string column
+ * with at most max_dictionary_size distinct values.
+ * With --pack, the narrowest storage encoding (8, 16, 32 or date16) of every fixed-width column is written to
+ * <column>.bin.encoding, and iaa_lineitem_compression applies it when the column is compressed.
+ *
+ * The file is mapped and cut into blocks at line boundaries. Worker threads parse a round of blocks in parallel,
+ * scanning for delimiters with AVX2 when the CPU supports it, and the blocks are appended to the column files in
+ * order.
+ *
+ * Usage: tbl_converter <table.tbl> <output_dir> [--table <name>] [--threads <n>] [--dict] [--pack]
+ */
+
+constexpr const std::size_t block_size          = 16 * 1024 * 1024;
+constexpr const std::size_t max_dictionary_size = 65536;
+
+// Column types: i = int32, f = float32, d = date (int32 Unix timestamp), s = string
+struct table_schema {
+    std::string name;
+    std::vector<std::string> columns;
+    std::string types;
+    std::vector<std::string> dictionary_columns;
+};
+
+const std::vector<table_schema> tpch_schema = {
+    {"lineitem", {"l_orderkey", "l_partkey", "l_suppkey", "l_linenumber", "l_quantity", "l_extendedprice", "l_discount", "l_tax",
+                  "l_returnflag", "l_linestatus", "l_shipdate", "l_commitdate", "l_receiptdate", "l_shipinstruct", "l_shipmode", "l_comment"},
+     "iiiiifffssdddsss", {"l_returnflag", "l_linestatus", "l_shipinstruct", "l_shipmode"}},
+    {"orders", {"o_orderkey", "o_custkey", "o_orderstatus", "o_totalprice", "o_orderdate", "o_orderpriority", "o_clerk", "o_shippriority", "o_comment"},
+     "iisfdssis", {}},
+    {"part", {"p_partkey", "p_name", "p_mfgr", "p_brand", "p_type", "p_size", "p_container", "p_retailprice", "p_comment"},
+     "issssisfs", {}},
+    {"partsupp", {"ps_partkey", "ps_suppkey", "ps_availqty", "ps_supplycost", "ps_comment"}, "iiifs", {}},
+    {"customer", {"c_custkey", "c_name", "c_address", "c_nationkey", "c_phone", "c_acctbal", "c_mktsegment", "c_comment"}, "issisfss", {}},
+    {"supplier", {"s_suppkey", "s_name", "s_address", "s_nationkey", "s_phone", "s_acctbal", "s_comment"}, "issisfs", {}},
+    {"nation", {"n_nationkey", "n_name", "n_regionkey", "n_comment"}, "isis", {}},
+    {"region", {"r_regionkey", "r_name", "r_comment"}, "iss", {}},
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool parse_int(const char* s, const char* e, int64_t& value)
+{
+    bool negative = s < e && *s == '-';
+    if (negative) { s++; }
+    if (s == e) { return false; }
+    int64_t v = 0;
+    for (; s < e; s++) {
+        if (*s < '0' || *s > '9') { return false; }
+        v = v * 10 + (*s - '0');
+    }
+    value = negative ? -v : v;
+    return true;
+}
+
+// Decimal as float32, rounded through double like pandas' float64 -> float32 conversion
+bool parse_decimal(const char* s, const char* e, float& value)
+{
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    const char *p = s;
+    bool negative = p < e && *p == '-';
+    if (negative) { p++; }
+    int64_t mantissa = 0;
+    int digits = 0, fraction_digits = 0;
+    bool fraction = false, plain = p < e;
+    for (; p < e; p++) {
+        if (*p == '.' && !fraction) { fraction = true; continue; }
+        if (*p < '0' || *p > '9' || digits == 18) { plain = false; break; }
+        mantissa = mantissa * 10 + (*p - '0');
+        digits++;
+        fraction_digits += fraction;
+    }
+    if (plain) {
+        double v = static_cast<double>(mantissa) / pow10[fraction_digits];
+        value = static_cast<float>(negative ? -v : v);
+        return true;
+    }
+    std::string text(s, e);
+    char *end = nullptr;
+    double v = std::strtod(text.c_str(), &end);
+    value = static_cast<float>(v);
+    return end == text.c_str() + text.size() && !text.empty();
+}
+
+// YYYY-MM-DD as a Unix timestamp in seconds
+bool parse_date(const char* s, const char* e, int64_t& value)
+{
+    if (e - s != 10 || s[4] != '-' || s[7] != '-') { return false; }
+    int64_t y = 0, m = 0, d = 0;
+    if (!parse_int(s, s + 4, y) || !parse_int(s + 5, s + 7, m) || !parse_int(s + 8, s + 10, d)) { return false; }
+    value = days_from_civil(y, static_cast<unsigned>(m), static_cast<unsigned>(d)) * 86400;
+    return true;
+}
+
+// Calls on_delimiter(offset) for every '|' and '\n' in data[0, length)
+template <typename F>
+void scan_delimiters_scalar(const char* data, std::size_t length, F&& on_delimiter)
+{
+    for (std::size_t i = 0; i < length; i++) {
+        if (data[i] == '|' || data[i] == '\n') { on_delimiter(i); }
+    }
+}
+
+template <typename F>
+__attribute__((target("avx2")))
+void scan_delimiters_avx2(const char* data, std::size_t length, F&& on_delimiter)
+{
+    const __m256i pipe = _mm256_set1_epi8('|');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, pipe), _mm256_cmpeq_epi8(bytes, newline))));
+        while (mask != 0) {
+            on_delimiter(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    scan_delimiters_scalar(data + i, length - i, [&](std::size_t offset) { on_delimiter(i + offset); });
+}
+
+// Parsed columns of one block of lines
+struct block_result {
+    std::size_t rows = 0;
+    std::vector<std::vector<uint8_t>> data;                            // [column] bytes as written to <column>.bin
+    std::vector<std::vector<uint32_t>> local_code;                     // [column] block-local dictionary codes
+    std::vector<std::unordered_map<std::string_view, uint32_t>> local_dict;
+    std::vector<std::vector<std::string_view>> local_values;           // [column] block-local dictionary
+    std::vector<int64_t> min_value;
+    std::vector<int64_t> max_value;
+    std::string error;
+};
+
+template <typename T>
+void append_value(std::vector<uint8_t>& data, T value)
+{
+    const std::size_t offset = data.size();
+    data.resize(offset + sizeof(T));
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+void parse_block(const table_schema& schema, const std::vector<bool>& dictionary, const char* begin, const char* end, bool avx2, block_result& result)
+{
+    const std::size_t num_columns = schema.columns.size();
+    result.data.assign(num_columns, {});
+    result.local_code.assign(num_columns, {});
+    result.local_dict.assign(num_columns, {});
+    result.local_values.assign(num_columns, {});
+    result.min_value.assign(num_columns, std::numeric_limits<int64_t>::max());
+    result.max_value.assign(num_columns, std::numeric_limits<int64_t>::min());
+    for (std::size_t c = 0; c < num_columns; c++) {
+        // Pre-size the fixed-width columns assuming ~100 bytes per line
+        if (schema.types[c] != 's') { result.data[c].reserve((end - begin) / 100 * 4); }
+    }
+
+    std::size_t field = 0;
+    const char *field_start = begin;
+    auto handle_field = [&](std::size_t c, const char* s, const char* e) {
+        int64_t int_value = 0;
+        float float_value = 0;
+        switch (schema.types[c]) {
+        case 'i':
+            if (!parse_int(s, e, int_value)) { break; }
+            append_value(result.data[c], static_cast<int32_t>(int_value));
+            result.min_value[c] = std::min(result.min_value[c], int_value);
+            result.max_value[c] = std::max(result.max_value[c], int_value);
+            return true;
+        case 'd':
+            if (!parse_date(s, e, int_value)) { break; }
+            append_value(result.data[c], static_cast<int32_t>(int_value));
+            result.min_value[c] = std::min(result.min_value[c], int_value);
+            result.max_value[c] = std::max(result.max_value[c], int_value);
+            return true;
+        case 'f':
+            if (!parse_decimal(s, e, float_value)) { break; }
+            append_value(result.data[c], float_value);
+            return true;
+        default:
+            result.data[c].insert(result.data[c].end(), s, e);
+            if (dictionary[c]) {
+                auto inserted = result.local_dict[c].emplace(std::string_view(s, e - s), static_cast<uint32_t>(result.local_values[c].size()));
+                if (inserted.second) { result.local_values[c].emplace_back(s, e - s); }
+                result.local_code[c].push_back(inserted.first->second);
+            }
+            return true;
+        }
+        if (result.error.empty()) {
+            result.error = "Cannot parse '" + std::string(s, e) + "' as column " + schema.columns[c] + " (type " + schema.types[c] + ")";
+        }
+        return false;
+    };
+    auto end_line = [&](const char* line_end) {
+        // The last field has no trailing '|' when organize.sh stripped it
+        if (field == num_columns - 1) {
+            handle_field(field, field_start, line_end);
+            field++;
+        }
+        if (field == num_columns) {
+            result.rows++;
+        } else if (!(field == 0 && field_start == line_end) && result.error.empty()) {
+            result.error = "Line with " + std::to_string(field) + " fields, expected " + std::to_string(num_columns) + ": " +
+                           std::string(field_start, std::min<const char *>(line_end, field_start + 80));
+        }
+        field = 0;
+        field_start = line_end + 1;
+    };
+    auto on_delimiter = [&](std::size_t offset) {
+        const char *p = begin + offset;
+        if (*p == '|') {
+            if (field < num_columns) { handle_field(field, field_start, p); }
+            field++;
+            field_start = p + 1;
+        } else {
+            end_line(p);
+        }
+    };
+    if (avx2) {
+        scan_delimiters_avx2(begin, end - begin, on_delimiter);
+    } else {
+        scan_delimiters_scalar(begin, end - begin, on_delimiter);
+    }
+    if (field_start < end) { end_line(end); }
+}
+
+// Output state of one column across blocks
+struct column_output {
+    std::string name;
+    char type;
+    bool dictionary = false;
+    bool dictionary_overflow = false;
+    std::ofstream file;
+    std::ofstream code_file;
+    int64_t min_value = std::numeric_limits<int64_t>::max();
+    int64_t max_value = std::numeric_limits<int64_t>::min();
+    std::unordered_map<std::string, uint32_t> dict;    // value -> insertion-order code
+    std::vector<std::string> dict_values;
+};
+
+void write_block(block_result& block, std::vector<column_output>& output)
+{
+    for (std::size_t c = 0; c < output.size(); c++) {
+        column_output& column = output[c];
+        column.file.write(reinterpret_cast<const char *>(block.data[c].data()), block.data[c].size());
+        column.min_value = std::min(column.min_value, block.min_value[c]);
+        column.max_value = std::max(column.max_value, block.max_value[c]);
+        if (!column.dictionary || column.dictionary_overflow) { continue; }
+        std::vector<uint32_t> global_code(block.local_values[c].size());
+        for (std::size_t i = 0; i < global_code.size(); i++) {
+            auto inserted = column.dict.emplace(std::string(block.local_values[c][i]), static_cast<uint32_t>(column.dict_values.size()));
+            if (inserted.second) { column.dict_values.push_back(inserted.first->first); }
+            global_code[i] = inserted.first->second;
+        }
+        if (column.dict_values.size() > max_dictionary_size) {
+            column.dictionary_overflow = true;
+            continue;
+        }
+        std::vector<int32_t> codes(block.local_code[c].size());
+        for (std::size_t r = 0; r < codes.size(); r++) { codes[r] = static_cast<int32_t>(global_code[block.local_code[c][r]]); }
+        column.code_file.write(reinterpret_cast<const char *>(codes.data()), codes.size() * sizeof(int32_t));
+    }
+}
+
+// Rewrites the insertion-order codes of a dictionary column into sorted-dictionary order and writes the dictionary
+int finish_dictionary(const std::string& output_dir, column_output& column)
+{
+    const std::string code_path = output_dir + column.name + "_code.bin";
+    std::vector<uint32_t> order(column.dict_values.size());
+    for (uint32_t i = 0; i < order.size(); i++) { order[i] = i; }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return column.dict_values[a] < column.dict_values[b]; });
+    std::vector<int32_t> remap(order.size());
+    for (uint32_t i = 0; i < order.size(); i++) { remap[order[i]] = static_cast<int32_t>(i); }
+
+    std::fstream code_file(code_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!code_file) {
+        std::cout << "Error: Unable to open file: " << code_path << std::endl;
+        return 1;
+    }
+    std::vector<int32_t> codes(1 << 20);
+    std::streamoff offset = 0;
+    while (true) {
+        code_file.seekg(offset);
+        code_file.read(reinterpret_cast<char *>(codes.data()), codes.size() * sizeof(int32_t));
+        const std::size_t n = static_cast<std::size_t>(code_file.gcount()) / sizeof(int32_t);
+        if (n == 0) { break; }
+        code_file.clear();
+        for (std::size_t i = 0; i < n; i++) { codes[i] = remap[codes[i]]; }
+        code_file.seekp(offset);
+        code_file.write(reinterpret_cast<const char *>(codes.data()), n * sizeof(int32_t));
+        offset += static_cast<std::streamoff>(n * sizeof(int32_t));
+    }
+
+    std::ofstream dict_file(output_dir + column.name + "_code.dict");
+    for (uint32_t i : order) { dict_file << column.dict_values[i] << "\n"; }
+    return 0;
+}
+
+// Narrowest encoding iaa_lineitem_compression can store the column with
+std::string storage_encoding(char type, int64_t min_value, int64_t max_value)
+{
+    if (type == 'f' || min_value < 0) { return "32"; }
+    if (type == 'd') { return max_value / 86400 <= 0xFFFF ? "date16" : "32"; }
+    if (max_value <= 0xFF) { return "8"; }
+    if (max_value <= 0xFFFF) { return "16"; }
+    return "32";
+}
+
+auto main(int argc, char** argv) -> int {
+    if (argc < 3) {
+        std::cout << "Usage: tbl_converter <table.tbl> <output_dir> [--table <name>] [--threads <n>] [--dict] [--pack]" << std::endl;
+        return 1;
+    }
+    const std::string input_path = argv[1];
+    std::string output_dir = argv[2];
+    if (output_dir.back() != '/') { output_dir += '/'; }
+    std::string table_name = std::filesystem::path(input_path).stem().string();
+    uint32_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool dictionary_all = false, pack = false;
+    for (int i = 3; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--table" && i + 1 < argc) { table_name = argv[++i]; }
+        else if (arg == "--threads" && i + 1 < argc) { num_threads = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--dict") { dictionary_all = true; }
+        else if (arg == "--pack") { pack = true; }
+        else {
+            std::cout << "Unrecognized option " << arg << std::endl;
+            return 1;
+        }
+    }
+    auto schema_it = std::find_if(tpch_schema.begin(), tpch_schema.end(), [&](const table_schema& s) { return s.name == table_name; });
+    if (schema_it == tpch_schema.end()) {
+        std::cout << "Unknown TPC-H table " << table_name << "; use --table <lineitem|orders|part|partsupp|customer|supplier|nation|region>" << std::endl;
+        return 1;
+    }
+    const table_schema& schema = *schema_it;
+    const std::size_t num_columns = schema.columns.size();
+
+    // Map the input file
+    int fd = open(input_path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cout << "Error: Unable to open file: " << input_path << std::endl;
+        return 1;
+    }
+    const std::size_t file_size = static_cast<std::size_t>(st.st_size);
+    const char *file_data = nullptr;
+    if (file_size > 0) {
+        void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::cout << "Error: Unable to map file: " << input_path << std::endl;
+            return 1;
+        }
+        madvise(mapped, file_size, MADV_SEQUENTIAL);
+        file_data = static_cast<const char *>(mapped);
+    }
+
+    std::filesystem::create_directories(output_dir);
+    std::vector<column_output> output(num_columns);
+    std::vector<bool> dictionary(num_columns, false);
+    for (std::size_t c = 0; c < num_columns; c++) {
+        output[c].name = schema.columns[c];
+        output[c].type = schema.types[c];
+        output[c].dictionary = schema.types[c] == 's' &&
+            (dictionary_all || std::find(schema.dictionary_columns.begin(), schema.dictionary_columns.end(), schema.columns[c]) != schema.dictionary_columns.end());
+        dictionary[c] = output[c].dictionary;
+        output[c].file.open(output_dir + output[c].name + ".bin", std::ios::binary | std::ios::trunc);
+        if (output[c].dictionary) { output[c].code_file.open(output_dir + output[c].name + "_code.bin", std::ios::binary | std::ios::trunc); }
+        if (!output[c].file || (output[c].dictionary && !output[c].code_file)) {
+            std::cout << "Error: Unable to create the output files of " << output[c].name << " in " << output_dir << std::endl;
+            return 1;
+        }
+    }
+
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    std::cout << "Converting " << input_path << " (" << file_size << " Bytes) as " << schema.name << " with " << num_threads << " threads"
+              << (avx2 ? " (AVX2 delimiter scan)" : "") << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t rows = 0;
+    std::size_t position = 0;
+    std::vector<block_result> block(num_threads);
+    while (position < file_size) {
+        // Cut the next round of blocks at line boundaries
+        std::vector<std::pair<std::size_t, std::size_t>> range;
+        for (uint32_t t = 0; t < num_threads && position < file_size; t++) {
+            std::size_t block_end = std::min(file_size, position + block_size);
+            if (block_end < file_size) {
+                const void *newline = std::memchr(file_data + block_end, '\n', file_size - block_end);
+                block_end = newline ? static_cast<const char *>(newline) - file_data + 1 : file_size;
+            }
+            range.emplace_back(position, block_end);
+            position = block_end;
+        }
+        std::vector<std::thread> worker;
+        for (std::size_t t = 0; t < range.size(); t++) {
+            worker.emplace_back([&, t]() {
+                block[t] = block_result();
+                parse_block(schema, dictionary, file_data + range[t].first, file_data + range[t].second, avx2, block[t]);
+            });
+        }
+        for (auto& w : worker) { w.join(); }
+        for (std::size_t t = 0; t < range.size(); t++) {
+            if (!block[t].error.empty()) {
+                std::cout << "Error: " << block[t].error << std::endl;
+                return 1;
+            }
+            write_block(block[t], output);
+            rows += block[t].rows;
+        }
+    }
+
+    for (std::size_t c = 0; c < num_columns; c++) {
+        column_output& column = output[c];
+        column.file.close();
+        std::cout << "Column " << column.name << " written to " << output_dir + column.name + ".bin" << std::endl;
+        if (pack && column.type != 's') {
+            std::ofstream(output_dir + column.name + ".bin.encoding") << storage_encoding(column.type, column.min_value, column.max_value) << "\n";
+        }
+        if (!column.dictionary) { continue; }
+        column.code_file.close();
+        if (column.dictionary_overflow) {
+            std::filesystem::remove(output_dir + column.name + "_code.bin");
+            std::cout << "Column " << column.name << " has more than " << max_dictionary_size << " distinct values; no dictionary codes written" << std::endl;
+            continue;
+        }
+        if (finish_dictionary(output_dir, column) != 0) { return 1; }
+        if (pack) {
+            std::ofstream(output_dir + column.name + "_code.bin.encoding") << storage_encoding('i', 0, static_cast<int64_t>(column.dict_values.size()) - 1) << "\n";
+        }
+        std::cout << "Column " << column.name << " dictionary codes written to " << output_dir + column.name + "_code.bin" << std::endl;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Rows = " << rows << std::endl;
+    std::cout << "Elapsed Time = " << elapsed.count() << " s" << std::endl;
+    std::cout << "Bandwidth        = " << static_cast<double>(file_size) / 1024 / 1024 / elapsed.count() << " MB/s" << std::endl;
+
+    if (file_size > 0) { munmap(const_cast<char *>(file_data), file_size); }
+    close(fd);
+    return 0;
+}
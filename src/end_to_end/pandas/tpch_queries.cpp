@@ -0,0 +1,1378 @@
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <regex>
+#include <functional>
+#include <iomanip>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "qpl/qpl.h"
+
+
+
+/**
+ * @brief TPC-H Q1, Q12, Q14 and Q19 on the same decompress/scan/select primitives as decompression_scan.cpp.
+ * The first command line argument sets the execution path. Valid values are `software_path` and `hardware_path`.
+ * Every query first runs a CPU baseline (QPL software decompression of the whole columns, then scalar evaluation of
+ * the full predicate), and on the hardware path the IAA plan (decompress + scan, decompress + select, CPU-side
+ * aggregation and joins) is run and verified against the baseline. The reported result is also verified against the
+ * query evaluated row by row on lineitem.tbl; without that file the software path prints no verdict.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * The functional pipeline (QPL_FLAG_DECOMPRESS_ENABLE) is only used on the hardware path.
+ *
+ * String columns are read through the dictionary codes written by split_lineitem.py (<column>_code.bin and
+ * <column>_code.dict), and Q12/Q14/Q19 read orders.tbl and part.tbl from the TPC-H .tbl directory.
+ */
+
+/**
+ * NOTE : Maximum transfer size per grouped_workqueues of IAA is 2097152(2MB)
+ * If you want to put data larger than 2MB, you have to split the data into 2MB chunks.
+ */
+const std::size_t chunk_size = 2097152;
+constexpr const uint32_t input_vector_width     = 32;
+constexpr const uint32_t q1_shipdate_upper_boundary      = 904694400; // tpch q1 <= '1998-12-01' - 90 days
+constexpr const uint32_t q12_receiptdate_lower_boundary  = 757382400; // tpch q12 '1994-01-01' <=
+constexpr const uint32_t q12_receiptdate_upper_boundary  = 788918400 - 1; // tpch q12 < '1995-01-01'
+constexpr const uint32_t q14_shipdate_lower_boundary     = 809913600; // tpch q14 '1995-09-01' <=
+constexpr const uint32_t q14_shipdate_upper_boundary     = 812505600 - 1; // tpch q14 < '1995-10-01'
+constexpr const uint32_t q19_quantity_lower_boundary     = 1; // tpch q19 union of the three quantity ranges
+constexpr const uint32_t q19_quantity_upper_boundary     = 30;
+constexpr const double   verification_tolerance          = 1e-6;
+
+void getFileSize(const std::string& filePath, int* fileSize) {
+    // Open the file in binary mode, with the file pointer at the end
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (file) {
+        // Get the file size using tellg() and save it to the provided int pointer
+        *fileSize = static_cast<int>(file.tellg());
+        file.close();
+    } else {
+        // If file cannot be opened, set fileSize to -1 to indicate an error
+        *fileSize = -1;
+        std::cerr << "Error: Unable to open file: " << filePath << std::endl;
+    }
+}
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 6) {
+            std::cout << "Usage: tpch_queries <hardware_path|software_path> <compressed_dir> <queue_size> <lineitem_bin_dir> <tbl_dir> [q1|q12|q14|q19|all] [num_threads]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+void job_execution(qpl_job *job_ptr)
+{
+    qpl_status status = qpl_execute_job(job_ptr);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job execution." << std::endl;
+    }
+}
+
+// Runs the first enqueue_cnt jobs, one thread per job on the software path or submit & wait on the hardware path
+int run_jobs(std::vector<qpl_job *>& job, int enqueue_cnt, qpl_path_t execution_path)
+{
+    qpl_status status;
+    if (execution_path == qpl_path_software) {
+        std::vector<std::thread *> job_th;
+        job_th.resize(enqueue_cnt);
+        for (int i = 0; i < enqueue_cnt; ++i) { job_th[i] = new std::thread(job_execution, job[i]); }
+        for (int i = 0; i < enqueue_cnt; ++i) { job_th[i]->join(); }
+        for (int i = 0; i < enqueue_cnt; ++i) { delete job_th[i]; }
+        return 0;
+    }
+    for (int i = 0; i < enqueue_cnt; ++i) {
+        status = qpl_submit_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job submission." << std::endl;
+            return 1;
+        }
+    }
+    for (int i = 0; i < enqueue_cnt; ++i) {
+        status = qpl_wait_job(job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job waiting." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Loads <src_data_file_path>.<file_id> into src_vector and returns its size, or -1 if the chunk file is missing
+int64_t read_compressed_chunk(const std::string& src_data_file_path, uint32_t file_id, std::vector<uint8_t>& src_vector)
+{
+    std::ifstream src_file;
+    src_file.open(src_data_file_path + "." + std::to_string(file_id), std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << src_data_file_path + "." + std::to_string(file_id) << std::endl;
+        return -1;
+    }
+    src_file.seekg(0, std::ios::end);
+    std::size_t src_file_size = static_cast<std::size_t>(src_file.tellg());
+    src_file.seekg(0, std::ios::beg);
+    src_vector.resize(src_file_size);
+    src_file.read(reinterpret_cast<char *>(&src_vector.front()), src_file_size);
+    src_file.close();
+    return static_cast<int64_t>(src_file_size);
+}
+
+// Counts the <column>.bin.iaa.compressed.<k> chunk files of every column in src_data_file_dir
+std::vector<uint32_t> count_compressed_chunks(const std::string& src_data_file_dir, const std::vector<std::string>& columns)
+{
+    std::vector<uint32_t> iteration(columns.size(), 0);
+    for (const auto& entry : std::filesystem::directory_iterator(src_data_file_dir)) {
+        if (entry.is_regular_file()) {
+            const std::string filename = entry.path().filename().string();
+            for (size_t i = 0; i < columns.size(); ++i) {
+                std::regex pattern(R"(.*)" + columns[i] + R"(\.bin\.iaa\.compressed\.[0-9]+$)");
+                if (std::regex_search(filename, pattern)) {
+                    iteration[i]++;
+                }
+            }
+        }
+    }
+    return iteration;
+}
+
+/**
+ * Physical layout of one compressed column (see decompression_scan.cpp).
+ * Columns with <column>.bin.iaa.compressed.meta are chunked by row count; others are legacy 32-bit columns
+ * chunked by chunk_size bytes.
+ */
+struct column_layout {
+    std::string encoding = "32";
+    uint32_t bit_width = input_vector_width;
+    std::vector<uint32_t> chunk_rows;
+};
+
+int load_column_layout(const std::string& compressed_file_path, const std::string& orig_file_path, uint32_t iteration, column_layout& layout)
+{
+    layout = column_layout();
+    std::ifstream meta_file(compressed_file_path + ".meta");
+    if (meta_file) {
+        std::string key;
+        while (meta_file >> key) {
+            if (key == "encoding") { meta_file >> layout.encoding; }
+            else if (key == "bit_width") { meta_file >> layout.bit_width; }
+            else if (key == "chunk") {
+                uint32_t k = 0, rows = 0;
+                std::size_t bytes = 0, compressed_bytes = 0;
+                meta_file >> k >> rows >> bytes >> compressed_bytes;
+                layout.chunk_rows.push_back(rows);
+            } else {
+                std::string value;
+                meta_file >> value;
+            }
+        }
+        if (layout.chunk_rows.size() != iteration) {
+            std::cout << "Chunk metadata of " << compressed_file_path << " lists " << layout.chunk_rows.size() << " chunks, found " << iteration << " files" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    int file_size = 0;
+    getFileSize(orig_file_path, &file_size);
+    if (file_size < 0) { return 1; }
+    for (uint32_t k = 0; k < iteration; k++) {
+        std::size_t bytes = k == iteration - 1 ? file_size - chunk_size * (iteration - 1) : chunk_size;
+        layout.chunk_rows.push_back(static_cast<uint32_t>(bytes / (input_vector_width / 8)));
+    }
+    return 0;
+}
+
+// Row-aligned masks require every column of a query to have the same rows in every chunk
+bool layouts_aligned(const std::vector<column_layout>& layouts)
+{
+    for (const auto& layout : layouts) {
+        if (layout.chunk_rows != layouts.front().chunk_rows) { return false; }
+    }
+    return true;
+}
+
+// Translates a query boundary to the stored encoding of the column (date16 stores days since epoch)
+uint32_t encode_boundary(const column_layout& layout, uint32_t value)
+{
+    if (layout.encoding == "date16") { return value / 86400; }
+    return value;
+}
+
+// Reads element idx of a column chunk and decodes it back to the query domain (date16 back to seconds)
+uint32_t column_value(const column_layout& layout, const uint8_t* data, std::size_t idx)
+{
+    uint32_t value = 0;
+    if (layout.bit_width == 8) {
+        value = data[idx];
+    } else if (layout.bit_width == 16) {
+        uint16_t v;
+        std::memcpy(&v, data + idx * 2, sizeof(v));
+        value = v;
+    } else {
+        std::memcpy(&value, data + idx * 4, sizeof(value));
+    }
+    if (layout.bit_width == 16 && layout.encoding == "date16") { value *= 86400; }
+    return value;
+}
+
+float float_value(const uint8_t* data, std::size_t idx)
+{
+    float value;
+    std::memcpy(&value, data + idx * sizeof(float), sizeof(float));
+    return value;
+}
+
+// One lineitem column of a query, with its compressed chunk prefix and layout
+struct lineitem_column {
+    std::string name;
+    std::string compressed_path;
+    column_layout layout;
+};
+
+struct query_context {
+    std::string src_data_file_dir;
+    std::string orig_file_path;
+    std::string tbl_dir;
+    qpl_path_t execution_path;
+    uint32_t queue_size;
+    uint32_t num_threads;           // CPU threads of the group-by aggregation
+    std::vector<qpl_job *> job;     // queue_size jobs on execution_path (IAA plan)
+    qpl_job *cpu_job;               // software job (CPU baseline)
+};
+
+int open_columns(const query_context& ctx, const std::vector<std::string>& names, std::vector<lineitem_column>& columns)
+{
+    std::vector<uint32_t> iteration = count_compressed_chunks(ctx.src_data_file_dir, names);
+    std::vector<column_layout> layouts;
+    columns.resize(names.size());
+    for (size_t c = 0; c < names.size(); c++) {
+        if (iteration[c] == 0) {
+            std::cout << "No compressed chunks of " << names[c] << " found in " << ctx.src_data_file_dir << std::endl;
+            return 1;
+        }
+        columns[c].name = names[c];
+        columns[c].compressed_path = ctx.src_data_file_dir + names[c] + ".bin.iaa.compressed";
+        if (load_column_layout(columns[c].compressed_path, ctx.orig_file_path + names[c] + ".bin", iteration[c], columns[c].layout) != 0) {
+            return 1;
+        }
+        layouts.push_back(columns[c].layout);
+    }
+    if (!layouts_aligned(layouts)) {
+        std::cout << "Columns are not chunked by the same row counts; recompress them with a storage encoding." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+std::size_t total_rows(const column_layout& layout)
+{
+    std::size_t rows = 0;
+    for (uint32_t r : layout.chunk_rows) { rows += r; }
+    return rows;
+}
+
+/**
+ * Runs one job per chunk of a column in rounds of queue_size jobs.
+ * prepare(i, file_id, src) fills job[i] for chunk file_id whose compressed bytes are in src, finish(i, file_id)
+ * consumes its result. Returns the submit & wait time in seconds, or -1 on error.
+ */
+double run_chunk_rounds(const lineitem_column& column, const query_context& ctx, std::vector<qpl_job *>& job,
+                        const std::function<void(int, uint32_t, std::vector<uint8_t>&)>& prepare,
+                        const std::function<int(int, uint32_t)>& finish)
+{
+    const uint32_t iteration = static_cast<uint32_t>(column.layout.chunk_rows.size());
+    std::vector<std::vector<uint8_t>> src_vector(ctx.queue_size);
+    std::chrono::duration<int64_t, std::nano> elapsed_time_ns = std::chrono::nanoseconds::zero();
+    for (uint32_t file_id = 0; file_id < iteration;) {
+        int enqueue_cnt = static_cast<int>(std::min<uint32_t>(ctx.queue_size, iteration - file_id));
+        for (int i = 0; i < enqueue_cnt; ++i) {
+            if (read_compressed_chunk(column.compressed_path, file_id + i, src_vector[i]) < 0) { return -1; }
+            prepare(i, file_id + i, src_vector[i]);
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (run_jobs(job, enqueue_cnt, ctx.execution_path) != 0) { return -1; }
+        auto end = std::chrono::steady_clock::now();
+        elapsed_time_ns += end - start;
+        for (int i = 0; i < enqueue_cnt; ++i) {
+            if (finish(i, file_id + i) != 0) { return -1; }
+        }
+        file_id += enqueue_cnt;
+    }
+    return static_cast<double>(elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+}
+
+// Decompress + scan (qpl_op_scan_range or qpl_op_scan_eq) of every chunk into one bitmap per chunk
+double iaa_decompress_scan(const lineitem_column& column, const query_context& ctx, std::vector<qpl_job *>& job, qpl_operation op,
+                           const uint32_t lower_boundary, const uint32_t upper_boundary, std::vector<std::vector<uint8_t>>& mask)
+{
+    const column_layout& layout = column.layout;
+    mask.resize(layout.chunk_rows.size());
+    auto prepare = [&](int i, uint32_t file_id, std::vector<uint8_t>& src) {
+        mask[file_id].resize((layout.chunk_rows[file_id] + 7) / 8);
+        job[i]->op                 = op;
+        job[i]->next_in_ptr        = src.data();
+        job[i]->next_out_ptr       = mask[file_id].data();
+        job[i]->available_in       = static_cast<uint32_t>(src.size());
+        job[i]->available_out      = static_cast<uint32_t>(mask[file_id].size());
+        job[i]->src1_bit_width     = layout.bit_width;
+        job[i]->out_bit_width      = qpl_ow_nom;
+        job[i]->param_low          = encode_boundary(layout, lower_boundary);
+        job[i]->param_high         = encode_boundary(layout, upper_boundary);
+        job[i]->num_input_elements = layout.chunk_rows[file_id];
+        job[i]->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+    };
+    auto finish = [&](int i, uint32_t file_id) {
+        if (job[i]->total_out != mask[file_id].size()) {
+            std::cout << "Unexpected scan output of " << column.name << " chunk " << file_id << ": " << job[i]->total_out << " Bytes" << std::endl;
+            return 1;
+        }
+        return 0;
+    };
+    return run_chunk_rounds(column, ctx, job, prepare, finish);
+}
+
+// Decompress + select of every chunk through its bitmap; dest_vector[k] holds the selected values of chunk k
+double iaa_decompress_select(const lineitem_column& column, const query_context& ctx, std::vector<qpl_job *>& job,
+                             const std::vector<std::vector<uint8_t>>& mask, std::vector<std::vector<uint8_t>>& dest_vector)
+{
+    const column_layout& layout = column.layout;
+    dest_vector.resize(layout.chunk_rows.size());
+    auto prepare = [&](int i, uint32_t file_id, std::vector<uint8_t>& src) {
+        dest_vector[file_id].resize(static_cast<std::size_t>(layout.chunk_rows[file_id]) * layout.bit_width / 8);
+        job[i]->op                 = qpl_op_select;
+        job[i]->next_in_ptr        = src.data();
+        job[i]->next_out_ptr       = dest_vector[file_id].data();
+        job[i]->available_in       = static_cast<uint32_t>(src.size());
+        job[i]->available_out      = static_cast<uint32_t>(dest_vector[file_id].size());
+        job[i]->src1_bit_width     = layout.bit_width;
+        job[i]->out_bit_width      = qpl_ow_nom;
+        job[i]->num_input_elements = layout.chunk_rows[file_id];
+        job[i]->next_src2_ptr      = const_cast<uint8_t *>(mask[file_id].data());
+        job[i]->available_src2     = static_cast<uint32_t>(mask[file_id].size());
+        job[i]->src2_bit_width     = 1;
+        job[i]->flags              = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_DECOMPRESS_ENABLE;
+    };
+    auto finish = [&](int i, uint32_t file_id) {
+        dest_vector[file_id].resize(job[i]->total_out);
+        return 0;
+    };
+    return run_chunk_rounds(column, ctx, job, prepare, finish);
+}
+
+// CPU baseline: software decompression of a whole column into one contiguous vector
+double cpu_decompress_column(const lineitem_column& column, const query_context& ctx, std::vector<uint8_t>& dest_vector)
+{
+    const column_layout& layout = column.layout;
+    query_context cpu_ctx = ctx;
+    cpu_ctx.execution_path = qpl_path_software;
+    cpu_ctx.queue_size = 1;
+    std::vector<qpl_job *> job = {ctx.cpu_job};
+    std::vector<std::size_t> chunk_offset(layout.chunk_rows.size() + 1, 0);
+    for (size_t k = 0; k < layout.chunk_rows.size(); k++) {
+        chunk_offset[k + 1] = chunk_offset[k] + static_cast<std::size_t>(layout.chunk_rows[k]) * layout.bit_width / 8;
+    }
+    dest_vector.resize(chunk_offset.back());
+    auto prepare = [&](int i, uint32_t file_id, std::vector<uint8_t>& src) {
+        job[i]->op            = qpl_op_decompress;
+        job[i]->level         = qpl_default_level;
+        job[i]->next_in_ptr   = src.data();
+        job[i]->next_out_ptr  = dest_vector.data() + chunk_offset[file_id];
+        job[i]->available_in  = static_cast<uint32_t>(src.size());
+        job[i]->available_out = static_cast<uint32_t>(chunk_offset[file_id + 1] - chunk_offset[file_id]);
+        job[i]->flags         = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    };
+    auto finish = [&](int i, uint32_t file_id) {
+        if (job[i]->total_out != chunk_offset[file_id + 1] - chunk_offset[file_id]) {
+            std::cout << "Unexpected decompressed size of " << column.name << " chunk " << file_id << ": " << job[i]->total_out << " Bytes" << std::endl;
+            return 1;
+        }
+        return 0;
+    };
+    return run_chunk_rounds(column, cpu_ctx, job, prepare, finish);
+}
+
+double cpu_decompress_columns(const std::vector<lineitem_column>& columns, const query_context& ctx, std::vector<std::vector<uint8_t>>& data)
+{
+    double elapsed_time_sec = 0;
+    data.resize(columns.size());
+    for (size_t c = 0; c < columns.size(); c++) {
+        double t = cpu_decompress_column(columns[c], ctx, data[c]);
+        if (t < 0) { return -1; }
+        elapsed_time_sec += t;
+    }
+    return elapsed_time_sec;
+}
+
+void mask_and(std::vector<std::vector<uint8_t>>& dest, const std::vector<std::vector<uint8_t>>& src)
+{
+    for (size_t k = 0; k < dest.size(); k++) {
+        for (size_t j = 0; j < dest[k].size(); j++) { dest[k][j] &= src[k][j]; }
+    }
+}
+
+void mask_or(std::vector<std::vector<uint8_t>>& dest, const std::vector<std::vector<uint8_t>>& src)
+{
+    for (size_t k = 0; k < dest.size(); k++) {
+        for (size_t j = 0; j < dest[k].size(); j++) { dest[k][j] |= src[k][j]; }
+    }
+}
+
+void zero_mask(const column_layout& layout, std::vector<std::vector<uint8_t>>& mask)
+{
+    mask.resize(layout.chunk_rows.size());
+    for (size_t k = 0; k < mask.size(); k++) { mask[k].assign((layout.chunk_rows[k] + 7) / 8, 0); }
+}
+
+// OR of one decompress + scan_eq per dictionary code; an empty code list selects no rows
+double iaa_decompress_scan_codes(const lineitem_column& column, query_context& ctx, const std::vector<int>& codes,
+                                 std::vector<std::vector<uint8_t>>& mask)
+{
+    std::vector<std::vector<uint8_t>> predicate_mask;
+    double scan_sec = 0;
+    zero_mask(column.layout, mask);
+    for (int code : codes) {
+        double t = iaa_decompress_scan(column, ctx, ctx.job, qpl_op_scan_eq, code, code, predicate_mask);
+        if (t < 0) { return -1; }
+        scan_sec += t;
+        mask_or(mask, predicate_mask);
+    }
+    return scan_sec;
+}
+
+// Decompress + select of the given columns through the same bitmaps; selected[c] is filled for every c in columns
+double iaa_decompress_select_columns(const std::vector<lineitem_column>& col, query_context& ctx, std::initializer_list<int> columns,
+                                     const std::vector<std::vector<uint8_t>>& mask, std::vector<std::vector<std::vector<uint8_t>>>& selected)
+{
+    double select_sec = 0;
+    selected.resize(col.size());
+    for (int c : columns) {
+        double t = iaa_decompress_select(col[c], ctx, ctx.job, mask, selected[c]);
+        if (t < 0) { return -1; }
+        select_sec += t;
+    }
+    return select_sec;
+}
+
+std::size_t selected_rows(const column_layout& layout, const std::vector<uint8_t>& selected)
+{
+    return selected.size() * 8 / layout.bit_width;
+}
+
+bool results_match(double result, double expected)
+{
+    return std::fabs(result - expected) <= verification_tolerance * std::max(1.0, std::fabs(expected));
+}
+
+// Dictionary of a <column>_code.bin column, one value per line in code order
+int load_dictionary(const std::string& dict_file_path, std::vector<std::string>& dictionary)
+{
+    std::ifstream dict_file(dict_file_path);
+    if (!dict_file) {
+        std::cout << "File not found : " << dict_file_path << std::endl;
+        return 1;
+    }
+    dictionary.clear();
+    std::string line;
+    while (std::getline(dict_file, line)) {
+        if (!line.empty()) { dictionary.push_back(line); }
+    }
+    return 0;
+}
+
+int dictionary_code(const std::vector<std::string>& dictionary, const std::string& value)
+{
+    for (size_t i = 0; i < dictionary.size(); i++) {
+        if (dictionary[i] == value) { return static_cast<int>(i); }
+    }
+    return -1;
+}
+
+std::vector<std::string> split_tbl_line(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, '|')) { fields.push_back(field); }
+    return fields;
+}
+
+// orders.tbl: o_orderkey -> 1 if o_orderpriority is '1-URGENT' or '2-HIGH'
+int load_order_priority(const std::string& tbl_dir, std::vector<uint8_t>& high_priority)
+{
+    std::ifstream tbl_file(tbl_dir + "orders.tbl");
+    if (!tbl_file) {
+        std::cout << "File not found : " << tbl_dir + "orders.tbl" << std::endl;
+        return 1;
+    }
+    std::string line;
+    while (std::getline(tbl_file, line)) {
+        std::vector<std::string> fields = split_tbl_line(line);
+        if (fields.size() < 6) { continue; }
+        uint32_t orderkey = static_cast<uint32_t>(std::stoul(fields[0]));
+        if (orderkey >= high_priority.size()) { high_priority.resize(orderkey + 1, 0); }
+        high_priority[orderkey] = fields[5] == "1-URGENT" || fields[5] == "2-HIGH";
+    }
+    return 0;
+}
+
+/**
+ * part.tbl attributes used by Q14 and Q19, indexed by p_partkey.
+ * q19_group is 1..3 when the part matches the brand/container/size condition of the corresponding Q19 branch.
+ */
+struct part_table {
+    std::vector<uint8_t> promo;
+    std::vector<uint8_t> q19_group;
+};
+
+int load_part(const std::string& tbl_dir, part_table& part)
+{
+    std::ifstream tbl_file(tbl_dir + "part.tbl");
+    if (!tbl_file) {
+        std::cout << "File not found : " << tbl_dir + "part.tbl" << std::endl;
+        return 1;
+    }
+    auto in = [](const std::string& value, std::initializer_list<const char *> set) {
+        for (const char *s : set) { if (value == s) { return true; } }
+        return false;
+    };
+    std::string line;
+    while (std::getline(tbl_file, line)) {
+        std::vector<std::string> fields = split_tbl_line(line);
+        if (fields.size() < 7) { continue; }
+        uint32_t partkey = static_cast<uint32_t>(std::stoul(fields[0]));
+        if (partkey >= part.promo.size()) {
+            part.promo.resize(partkey + 1, 0);
+            part.q19_group.resize(partkey + 1, 0);
+        }
+        const std::string& brand = fields[3];
+        const std::string& container = fields[6];
+        int size = std::stoi(fields[5]);
+        part.promo[partkey] = fields[4].compare(0, 5, "PROMO") == 0;
+        if (brand == "Brand#12" && in(container, {"SM CASE", "SM BOX", "SM PACK", "SM PKG"}) && size >= 1 && size <= 5) {
+            part.q19_group[partkey] = 1;
+        } else if (brand == "Brand#23" && in(container, {"MED BAG", "MED BOX", "MED PKG", "MED PACK"}) && size >= 1 && size <= 10) {
+            part.q19_group[partkey] = 2;
+        } else if (brand == "Brand#34" && in(container, {"LG CASE", "LG BOX", "LG PACK", "LG PKG"}) && size >= 1 && size <= 15) {
+            part.q19_group[partkey] = 3;
+        }
+    }
+    return 0;
+}
+
+/**
+ * One row of lineitem.tbl, parsed the way split_lineitem.py stores it: dates as epoch seconds, decimals as float32.
+ * The rows are the independent reference of the verification: they are read from the text table, without the
+ * compressed columns or QPL.
+ */
+struct lineitem_row {
+    uint32_t orderkey = 0;
+    uint32_t partkey = 0;
+    uint32_t quantity = 0;
+    float extendedprice = 0;
+    float discount = 0;
+    float tax = 0;
+    std::string returnflag;
+    std::string linestatus;
+    uint32_t shipdate = 0;
+    uint32_t commitdate = 0;
+    uint32_t receiptdate = 0;
+    std::string shipinstruct;
+    std::string shipmode;
+};
+
+// 'YYYY-MM-DD' to seconds since epoch
+uint32_t parse_tbl_date(const std::string& date)
+{
+    int y = std::stoi(date.substr(0, 4));
+    const unsigned m = static_cast<unsigned>(std::stoi(date.substr(5, 2)));
+    const unsigned d = static_cast<unsigned>(std::stoi(date.substr(8, 2)));
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return static_cast<uint32_t>((era * 146097 + static_cast<int>(doe) - 719468) * 86400);
+}
+
+// Calls visit for every row of <tbl_dir>lineitem.tbl; returns 1 if the file is missing
+int scan_lineitem_tbl(const std::string& tbl_dir, const std::function<void(const lineitem_row&)>& visit)
+{
+    std::ifstream tbl_file(tbl_dir + "lineitem.tbl");
+    if (!tbl_file) {
+        std::cout << "File not found : " << tbl_dir + "lineitem.tbl" << std::endl;
+        return 1;
+    }
+    std::string line;
+    lineitem_row row;
+    while (std::getline(tbl_file, line)) {
+        std::vector<std::string> fields = split_tbl_line(line);
+        if (fields.size() < 15) { continue; }
+        row.orderkey = static_cast<uint32_t>(std::stoul(fields[0]));
+        row.partkey = static_cast<uint32_t>(std::stoul(fields[1]));
+        row.quantity = static_cast<uint32_t>(std::stod(fields[4]));
+        row.extendedprice = static_cast<float>(std::stod(fields[5]));
+        row.discount = static_cast<float>(std::stod(fields[6]));
+        row.tax = static_cast<float>(std::stod(fields[7]));
+        row.returnflag = fields[8];
+        row.linestatus = fields[9];
+        row.shipdate = parse_tbl_date(fields[10]);
+        row.commitdate = parse_tbl_date(fields[11]);
+        row.receiptdate = parse_tbl_date(fields[12]);
+        row.shipinstruct = fields[13];
+        row.shipmode = fields[14];
+        visit(row);
+    }
+    return 0;
+}
+
+/**
+ * Prints the verdict of a query. The result is checked against the lineitem.tbl reference when it could be read,
+ * and on the hardware path also against the CPU baseline. On the software path the result is the baseline itself,
+ * so without the reference there is nothing to check and no verdict is printed.
+ */
+int report_verification(const query_context& ctx, bool reference_loaded, bool matches_reference, bool matches_baseline)
+{
+    if (ctx.execution_path == qpl_path_software && !reference_loaded) {
+        std::cout << "Verification: skipped (no lineitem.tbl reference on the software path)" << std::endl;
+        return 0;
+    }
+    bool verified = (!reference_loaded || matches_reference) && (ctx.execution_path == qpl_path_software || matches_baseline);
+    if (reference_loaded && !matches_reference) { std::cout << "Result differs from the lineitem.tbl reference" << std::endl; }
+    if (ctx.execution_path == qpl_path_hardware && !matches_baseline) { std::cout << "Result differs from the CPU baseline" << std::endl; }
+    std::cout << "Verification: " << (verified ? "PASS" : "FAIL") << std::endl;
+    return verified ? 0 : 1;
+}
+
+std::vector<int> dictionary_codes(const std::vector<std::string>& dictionary, std::initializer_list<const char *> values)
+{
+    std::vector<int> codes;
+    for (const char *value : values) {
+        int code = dictionary_code(dictionary, value);
+        if (code >= 0) { codes.push_back(code); }
+    }
+    return codes;
+}
+
+bool has_code(const std::vector<int>& codes, uint32_t code)
+{
+    for (int c : codes) { if (static_cast<uint32_t>(c) == code) { return true; } }
+    return false;
+}
+
+void print_times(const std::string& name, double decompress_sec, double scan_sec, double select_sec, double cpu_sec)
+{
+    std::cout << "[" << name << "]" << std::endl;
+    if (scan_sec > 0 || select_sec > 0) {
+        std::cout <<  "(Decompression + Scan) Time take: " << scan_sec << " sec" << std::endl;
+        std::cout <<  "(Decompression + Select) Time take: " << select_sec << " sec" << std::endl;
+    } else {
+        std::cout <<  "(Decompression) Time take: " << decompress_sec << " sec" << std::endl;
+    }
+    std::cout <<  "(CPU evaluation) Time take: " << cpu_sec << " sec" << std::endl;
+    std::cout <<  "(Total) Time take: " << decompress_sec + scan_sec + select_sec + cpu_sec << " sec" << std::endl;
+}
+
+double elapsed_sec(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<int64_t, std::nano> elapsed_time_ns = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(elapsed_time_ns.count()) / 1000 / 1000 / 1000;
+}
+
+/**
+ * Dense-array group-by for low-cardinality keys, where the group id is the key itself (0 <= key < num_groups).
+ * count, sum, min and max are kept per group and value column; Q1 derives its averages as sum / count.
+ * Every worker thread aggregates its chunks into its own partial table and the partials are merged at the end, so
+ * the update loop needs no atomics. Blocks with 8-bit keys take an AVX2 path when the CPU supports it.
+ */
+constexpr const uint32_t group_by_block_rows     = 4096;
+constexpr const uint32_t group_by_simd_max_groups = 8;
+constexpr const uint32_t group_by_simd_max_values = 8;
+
+struct group_by_table {
+    uint32_t num_groups = 0;
+    uint32_t num_values = 0;
+    bool min_max = false;
+    std::vector<uint64_t> count;    // [group]
+    std::vector<double> sum;        // [value * num_groups + group]
+    std::vector<double> min;
+    std::vector<double> max;
+
+    void init(uint32_t groups, uint32_t values, bool track_min_max)
+    {
+        num_groups = groups;
+        num_values = values;
+        min_max = track_min_max;
+        count.assign(groups, 0);
+        sum.assign(static_cast<std::size_t>(groups) * values, 0);
+        min.assign(track_min_max ? sum.size() : 0, std::numeric_limits<double>::infinity());
+        max.assign(track_min_max ? sum.size() : 0, -std::numeric_limits<double>::infinity());
+    }
+
+    void merge(const group_by_table& other)
+    {
+        for (uint32_t g = 0; g < num_groups; g++) { count[g] += other.count[g]; }
+        for (std::size_t i = 0; i < sum.size(); i++) { sum[i] += other.sum[i]; }
+        for (std::size_t i = 0; i < min.size(); i++) {
+            min[i] = std::min(min[i], other.min[i]);
+            max[i] = std::max(max[i], other.max[i]);
+        }
+    }
+};
+
+template <typename T>
+void group_by_update_scalar(group_by_table& table, const T* keys, const double* const* values, std::size_t n)
+{
+    const uint32_t G = table.num_groups;
+    for (std::size_t i = 0; i < n; i++) {
+        const uint32_t g = keys[i];
+        table.count[g]++;
+        for (uint32_t v = 0; v < table.num_values; v++) {
+            const double x = values[v][i];
+            table.sum[v * G + g] += x;
+            if (table.min_max) {
+                table.min[v * G + g] = std::min(table.min[v * G + g], x);
+                table.max[v * G + g] = std::max(table.max[v * G + g], x);
+            }
+        }
+    }
+}
+
+// Four rows per step: the widened keys are compared against every group id and the equality masks gate the adds
+__attribute__((target("avx2")))
+void group_by_update_avx2(group_by_table& table, const uint8_t* keys, const double* const* values, std::size_t n)
+{
+    const uint32_t G = table.num_groups;
+    const uint32_t V = table.num_values;
+    const __m256d pos_inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d neg_inf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    __m256i count[group_by_simd_max_groups];
+    __m256d sum[group_by_simd_max_values * group_by_simd_max_groups];
+    __m256d min[group_by_simd_max_values * group_by_simd_max_groups];
+    __m256d max[group_by_simd_max_values * group_by_simd_max_groups];
+    for (uint32_t g = 0; g < G; g++) { count[g] = _mm256_setzero_si256(); }
+    for (uint32_t i = 0; i < V * G; i++) {
+        sum[i] = _mm256_setzero_pd();
+        min[i] = pos_inf;
+        max[i] = neg_inf;
+    }
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t packed_keys;
+        std::memcpy(&packed_keys, keys + i, sizeof(packed_keys));
+        const __m256i key = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed_keys));
+        __m256d x[group_by_simd_max_values];
+        for (uint32_t v = 0; v < V; v++) { x[v] = _mm256_loadu_pd(values[v] + i); }
+        for (uint32_t g = 0; g < G; g++) {
+            const __m256i eq = _mm256_cmpeq_epi64(key, _mm256_set1_epi64x(g));
+            const __m256d mask = _mm256_castsi256_pd(eq);
+            count[g] = _mm256_sub_epi64(count[g], eq);
+            for (uint32_t v = 0; v < V; v++) {
+                sum[v * G + g] = _mm256_add_pd(sum[v * G + g], _mm256_and_pd(mask, x[v]));
+                if (table.min_max) {
+                    min[v * G + g] = _mm256_min_pd(min[v * G + g], _mm256_blendv_pd(pos_inf, x[v], mask));
+                    max[v * G + g] = _mm256_max_pd(max[v * G + g], _mm256_blendv_pd(neg_inf, x[v], mask));
+                }
+            }
+        }
+    }
+
+    alignas(32) int64_t count_lanes[4];
+    alignas(32) double lanes[4];
+    for (uint32_t g = 0; g < G; g++) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(count_lanes), count[g]);
+        table.count[g] += count_lanes[0] + count_lanes[1] + count_lanes[2] + count_lanes[3];
+    }
+    for (uint32_t j = 0; j < V * G; j++) {
+        _mm256_store_pd(lanes, sum[j]);
+        table.sum[j] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        if (table.min_max) {
+            _mm256_store_pd(lanes, min[j]);
+            table.min[j] = std::min({table.min[j], lanes[0], lanes[1], lanes[2], lanes[3]});
+            _mm256_store_pd(lanes, max[j]);
+            table.max[j] = std::max({table.max[j], lanes[0], lanes[1], lanes[2], lanes[3]});
+        }
+    }
+
+    const double *tail[group_by_simd_max_values];
+    for (uint32_t v = 0; v < V; v++) { tail[v] = values[v] + i; }
+    group_by_update_scalar(table, keys + i, tail, n - i);
+}
+
+// Adds n rows; values[v][i] is value column v of row i
+void group_by_update(group_by_table& table, const uint8_t* keys, const double* const* values, std::size_t n)
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2 && table.num_groups <= group_by_simd_max_groups && table.num_values <= group_by_simd_max_values) {
+        group_by_update_avx2(table, keys, values, n);
+    } else {
+        group_by_update_scalar(table, keys, values, n);
+    }
+}
+
+void group_by_update(group_by_table& table, const uint32_t* keys, const double* const* values, std::size_t n)
+{
+    group_by_update_scalar(table, keys, values, n);
+}
+
+/**
+ * Runs aggregate_chunk over chunks [0, num_chunks) on num_threads threads. Thread t takes chunks t, t + num_threads, ...
+ * into its own partial table, and the partials are merged into the returned table.
+ */
+group_by_table parallel_group_by(uint32_t num_chunks, uint32_t num_threads, uint32_t num_groups, uint32_t num_values, bool min_max,
+                                 const std::function<void(uint32_t, group_by_table&)>& aggregate_chunk)
+{
+    num_threads = std::max<uint32_t>(1, std::min(num_threads, num_chunks));
+    std::vector<group_by_table> partial(num_threads);
+    std::vector<std::thread> worker;
+    for (uint32_t t = 0; t < num_threads; t++) {
+        partial[t].init(num_groups, num_values, min_max);
+        worker.emplace_back([&, t]() {
+            for (uint32_t k = t; k < num_chunks; k += num_threads) { aggregate_chunk(k, partial[t]); }
+        });
+    }
+    for (auto& w : worker) { w.join(); }
+    for (uint32_t t = 1; t < num_threads; t++) { partial[0].merge(partial[t]); }
+    return partial[0];
+}
+
+/**
+ * Q1: group by l_returnflag, l_linestatus over l_shipdate <= '1998-09-02'.
+ * Groups are a dense array indexed by returnflag_code * num_linestatus + linestatus_code; codes follow the sorted
+ * dictionaries, so array order is the ORDER BY of the query. Besides the aggregates of the query, the min and max of
+ * l_extendedprice and l_discount are reported per group.
+ */
+struct q1_group {
+    uint64_t count = 0;
+    double sum_qty = 0;
+    double sum_base_price = 0;
+    double sum_disc_price = 0;
+    double sum_charge = 0;
+    double sum_disc = 0;
+    double min_price = std::numeric_limits<double>::infinity();
+    double max_price = -std::numeric_limits<double>::infinity();
+    double min_disc = std::numeric_limits<double>::infinity();
+    double max_disc = -std::numeric_limits<double>::infinity();
+};
+
+void q1_accumulate(std::vector<q1_group>& groups, uint32_t group, uint32_t quantity, float extendedprice, float discount, float tax)
+{
+    q1_group& g = groups[group];
+    double disc_price = static_cast<double>(extendedprice) * (1 - static_cast<double>(discount));
+    g.count++;
+    g.sum_qty += quantity;
+    g.sum_base_price += extendedprice;
+    g.sum_disc_price += disc_price;
+    g.sum_charge += disc_price * (1 + static_cast<double>(tax));
+    g.sum_disc += discount;
+    g.min_price = std::min<double>(g.min_price, extendedprice);
+    g.max_price = std::max<double>(g.max_price, extendedprice);
+    g.min_disc = std::min<double>(g.min_disc, discount);
+    g.max_disc = std::max<double>(g.max_disc, discount);
+}
+
+bool q1_groups_match(const std::vector<q1_group>& result, const std::vector<q1_group>& expected)
+{
+    for (std::size_t g = 0; g < result.size(); g++) {
+        const q1_group& r = result[g];
+        const q1_group& e = expected[g];
+        if (!(r.count == e.count && results_match(r.sum_qty, e.sum_qty) && results_match(r.sum_base_price, e.sum_base_price) &&
+              results_match(r.sum_disc_price, e.sum_disc_price) && results_match(r.sum_charge, e.sum_charge) && results_match(r.sum_disc, e.sum_disc) &&
+              r.min_price == e.min_price && r.max_price == e.max_price && r.min_disc == e.min_disc && r.max_disc == e.max_disc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int run_q1(query_context& ctx)
+{
+    std::cout << "[TPC-H Q1]" << std::endl;
+    enum { shipdate, returnflag, linestatus, quantity, extendedprice, discount, tax };
+    std::vector<lineitem_column> col;
+    if (open_columns(ctx, {"l_shipdate", "l_returnflag_code", "l_linestatus_code", "l_quantity", "l_extendedprice", "l_discount", "l_tax"}, col) != 0) {
+        return 1;
+    }
+    std::vector<std::string> returnflag_dict, linestatus_dict;
+    if (load_dictionary(ctx.orig_file_path + "l_returnflag_code.dict", returnflag_dict) != 0 ||
+        load_dictionary(ctx.orig_file_path + "l_linestatus_code.dict", linestatus_dict) != 0) {
+        return 1;
+    }
+    const uint32_t num_linestatus = static_cast<uint32_t>(linestatus_dict.size());
+    const std::size_t num_groups = returnflag_dict.size() * linestatus_dict.size();
+
+    // CPU baseline
+    std::vector<std::vector<uint8_t>> data;
+    double cpu_decompress_sec = cpu_decompress_columns(col, ctx, data);
+    if (cpu_decompress_sec < 0) { return 1; }
+    std::vector<q1_group> cpu_groups(num_groups);
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t rows = total_rows(col[shipdate].layout);
+    for (std::size_t r = 0; r < rows; r++) {
+        if (column_value(col[shipdate].layout, data[shipdate].data(), r) > q1_shipdate_upper_boundary) { continue; }
+        uint32_t group = column_value(col[returnflag].layout, data[returnflag].data(), r) * num_linestatus +
+                         column_value(col[linestatus].layout, data[linestatus].data(), r);
+        q1_accumulate(cpu_groups, group, column_value(col[quantity].layout, data[quantity].data(), r),
+                      float_value(data[extendedprice].data(), r), float_value(data[discount].data(), r), float_value(data[tax].data(), r));
+    }
+    print_times("CPU baseline", cpu_decompress_sec, 0, 0, elapsed_sec(start));
+
+    std::vector<q1_group> groups = cpu_groups;
+    if (ctx.execution_path == qpl_path_hardware) {
+        // IAA: scan l_shipdate, select the group keys and the aggregated columns
+        std::vector<std::vector<uint8_t>> mask;
+        double scan_sec = iaa_decompress_scan(col[shipdate], ctx, ctx.job, qpl_op_scan_range, 0, q1_shipdate_upper_boundary, mask);
+        if (scan_sec < 0) { return 1; }
+        std::vector<std::vector<std::vector<uint8_t>>> selected;
+        double select_sec = iaa_decompress_select_columns(col, ctx, {returnflag, linestatus, quantity, extendedprice, discount, tax}, mask, selected);
+        if (select_sec < 0) { return 1; }
+        // Per block of selected rows: composite group key and the aggregated expressions, then one dense group-by update
+        enum { agg_qty, agg_base_price, agg_disc_price, agg_charge, agg_disc, num_aggregates };
+        const bool narrow_keys = num_groups <= 256;
+        start = std::chrono::steady_clock::now();
+        group_by_table table = parallel_group_by(static_cast<uint32_t>(mask.size()), ctx.num_threads, static_cast<uint32_t>(num_groups), num_aggregates, true,
+                                                 [&](uint32_t k, group_by_table& partial) {
+            std::vector<uint8_t> key8(group_by_block_rows);
+            std::vector<uint32_t> key32(narrow_keys ? 0 : group_by_block_rows);
+            std::vector<std::vector<double>> value(num_aggregates, std::vector<double>(group_by_block_rows));
+            const double *value_ptr[num_aggregates];
+            for (uint32_t v = 0; v < num_aggregates; v++) { value_ptr[v] = value[v].data(); }
+            const std::size_t n = selected_rows(col[extendedprice].layout, selected[extendedprice][k]);
+            for (std::size_t base = 0; base < n; base += group_by_block_rows) {
+                const std::size_t rows = std::min<std::size_t>(group_by_block_rows, n - base);
+                for (std::size_t i = 0; i < rows; i++) {
+                    const std::size_t idx = base + i;
+                    uint32_t group = column_value(col[returnflag].layout, selected[returnflag][k].data(), idx) * num_linestatus +
+                                     column_value(col[linestatus].layout, selected[linestatus][k].data(), idx);
+                    if (narrow_keys) { key8[i] = static_cast<uint8_t>(group); } else { key32[i] = group; }
+                    const double price = float_value(selected[extendedprice][k].data(), idx);
+                    const double disc = float_value(selected[discount][k].data(), idx);
+                    const double disc_price = price * (1 - disc);
+                    value[agg_qty][i] = column_value(col[quantity].layout, selected[quantity][k].data(), idx);
+                    value[agg_base_price][i] = price;
+                    value[agg_disc_price][i] = disc_price;
+                    value[agg_charge][i] = disc_price * (1 + static_cast<double>(float_value(selected[tax][k].data(), idx)));
+                    value[agg_disc][i] = disc;
+                }
+                if (narrow_keys) {
+                    group_by_update(partial, key8.data(), value_ptr, rows);
+                } else {
+                    group_by_update(partial, key32.data(), value_ptr, rows);
+                }
+            }
+        });
+        for (std::size_t g = 0; g < num_groups; g++) {
+            groups[g].count = table.count[g];
+            groups[g].sum_qty = table.sum[agg_qty * num_groups + g];
+            groups[g].sum_base_price = table.sum[agg_base_price * num_groups + g];
+            groups[g].sum_disc_price = table.sum[agg_disc_price * num_groups + g];
+            groups[g].sum_charge = table.sum[agg_charge * num_groups + g];
+            groups[g].sum_disc = table.sum[agg_disc * num_groups + g];
+            groups[g].min_price = table.min[agg_base_price * num_groups + g];
+            groups[g].max_price = table.max[agg_base_price * num_groups + g];
+            groups[g].min_disc = table.min[agg_disc * num_groups + g];
+            groups[g].max_disc = table.max[agg_disc * num_groups + g];
+        }
+        print_times("IAA", 0, scan_sec, select_sec, elapsed_sec(start));
+    }
+
+    // Reference: the same query evaluated on lineitem.tbl
+    std::vector<q1_group> reference(num_groups);
+    bool unknown_code = false;
+    const bool reference_loaded = scan_lineitem_tbl(ctx.tbl_dir, [&](const lineitem_row& row) {
+        if (row.shipdate > q1_shipdate_upper_boundary) { return; }
+        int flag = dictionary_code(returnflag_dict, row.returnflag);
+        int status = dictionary_code(linestatus_dict, row.linestatus);
+        if (flag < 0 || status < 0) { unknown_code = true; return; }
+        q1_accumulate(reference, flag * num_linestatus + status, row.quantity, row.extendedprice, row.discount, row.tax);
+    }) == 0;
+
+    std::cout << "returnflag|linestatus|sum_qty|sum_base_price|sum_disc_price|sum_charge|avg_qty|avg_price|avg_disc|count_order|min_price|max_price|min_disc|max_disc" << std::endl;
+    for (std::size_t g = 0; g < num_groups; g++) {
+        const q1_group& r = groups[g];
+        if (r.count == 0) { continue; }
+        std::cout << returnflag_dict[g / num_linestatus] << "|" << linestatus_dict[g % num_linestatus] << "|" << std::fixed << std::setprecision(2)
+                  << r.sum_qty << "|" << r.sum_base_price << "|" << r.sum_disc_price << "|" << r.sum_charge << "|"
+                  << r.sum_qty / r.count << "|" << r.sum_base_price / r.count << "|" << r.sum_disc / r.count << "|" << r.count << "|"
+                  << r.min_price << "|" << r.max_price << "|" << r.min_disc << "|" << r.max_disc << std::defaultfloat << std::endl;
+    }
+    return report_verification(ctx, reference_loaded, !unknown_code && q1_groups_match(groups, reference), q1_groups_match(groups, cpu_groups));
+}
+
+/**
+ * Q12: count of high/low priority orders per l_shipmode in ('MAIL', 'SHIP') received in 1994.
+ * IAA filters shipmode and receiptdate; the column-to-column date predicates and the join with orders run on CPU.
+ */
+struct q12_result {
+    std::vector<uint64_t> high_line_count;
+    std::vector<uint64_t> low_line_count;
+};
+
+void q12_accumulate(q12_result& result, const std::vector<uint8_t>& high_priority, uint32_t shipmode,
+                    uint32_t receiptdate, uint32_t commitdate, uint32_t shipdate, uint32_t orderkey)
+{
+    if (!(commitdate < receiptdate && shipdate < commitdate)) { return; }
+    if (orderkey < high_priority.size() && high_priority[orderkey]) {
+        result.high_line_count[shipmode]++;
+    } else {
+        result.low_line_count[shipmode]++;
+    }
+}
+
+int run_q12(query_context& ctx)
+{
+    std::cout << "[TPC-H Q12]" << std::endl;
+    enum { shipmode, receiptdate, commitdate, shipdate, orderkey };
+    std::vector<lineitem_column> col;
+    if (open_columns(ctx, {"l_shipmode_code", "l_receiptdate", "l_commitdate", "l_shipdate", "l_orderkey"}, col) != 0) {
+        return 1;
+    }
+    std::vector<std::string> shipmode_dict;
+    std::vector<uint8_t> high_priority;
+    if (load_dictionary(ctx.orig_file_path + "l_shipmode_code.dict", shipmode_dict) != 0 || load_order_priority(ctx.tbl_dir, high_priority) != 0) {
+        return 1;
+    }
+    const std::vector<int> shipmode_codes = dictionary_codes(shipmode_dict, {"MAIL", "SHIP"});
+
+    // CPU baseline
+    std::vector<std::vector<uint8_t>> data;
+    double cpu_decompress_sec = cpu_decompress_columns(col, ctx, data);
+    if (cpu_decompress_sec < 0) { return 1; }
+    q12_result expected = {std::vector<uint64_t>(shipmode_dict.size(), 0), std::vector<uint64_t>(shipmode_dict.size(), 0)};
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t rows = total_rows(col[shipmode].layout);
+    for (std::size_t r = 0; r < rows; r++) {
+        uint32_t mode = column_value(col[shipmode].layout, data[shipmode].data(), r);
+        uint32_t receipt = column_value(col[receiptdate].layout, data[receiptdate].data(), r);
+        if (!has_code(shipmode_codes, mode) || receipt < q12_receiptdate_lower_boundary || receipt > q12_receiptdate_upper_boundary) { continue; }
+        q12_accumulate(expected, high_priority, mode, receipt, column_value(col[commitdate].layout, data[commitdate].data(), r),
+                       column_value(col[shipdate].layout, data[shipdate].data(), r), column_value(col[orderkey].layout, data[orderkey].data(), r));
+    }
+    print_times("CPU baseline", cpu_decompress_sec, 0, 0, elapsed_sec(start));
+
+    q12_result result = expected;
+    if (ctx.execution_path == qpl_path_hardware) {
+        // IAA: OR of one scan_eq per ship mode, AND the receiptdate range
+        std::vector<std::vector<uint8_t>> mask, predicate_mask;
+        double scan_sec = iaa_decompress_scan_codes(col[shipmode], ctx, shipmode_codes, mask);
+        if (scan_sec < 0) { return 1; }
+        double t = iaa_decompress_scan(col[receiptdate], ctx, ctx.job, qpl_op_scan_range, q12_receiptdate_lower_boundary, q12_receiptdate_upper_boundary, predicate_mask);
+        if (t < 0) { return 1; }
+        scan_sec += t;
+        mask_and(mask, predicate_mask);
+
+        std::vector<std::vector<std::vector<uint8_t>>> selected;
+        double select_sec = iaa_decompress_select_columns(col, ctx, {shipmode, receiptdate, commitdate, shipdate, orderkey}, mask, selected);
+        if (select_sec < 0) { return 1; }
+        result = {std::vector<uint64_t>(shipmode_dict.size(), 0), std::vector<uint64_t>(shipmode_dict.size(), 0)};
+        start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < mask.size(); k++) {
+            std::size_t n = selected_rows(col[orderkey].layout, selected[orderkey][k]);
+            for (std::size_t i = 0; i < n; i++) {
+                q12_accumulate(result, high_priority, column_value(col[shipmode].layout, selected[shipmode][k].data(), i),
+                               column_value(col[receiptdate].layout, selected[receiptdate][k].data(), i),
+                               column_value(col[commitdate].layout, selected[commitdate][k].data(), i),
+                               column_value(col[shipdate].layout, selected[shipdate][k].data(), i),
+                               column_value(col[orderkey].layout, selected[orderkey][k].data(), i));
+            }
+        }
+        print_times("IAA", 0, scan_sec, select_sec, elapsed_sec(start));
+    }
+
+    // Reference: the same query evaluated on lineitem.tbl
+    q12_result reference = {std::vector<uint64_t>(shipmode_dict.size(), 0), std::vector<uint64_t>(shipmode_dict.size(), 0)};
+    bool unknown_code = false;
+    const bool reference_loaded = scan_lineitem_tbl(ctx.tbl_dir, [&](const lineitem_row& row) {
+        if ((row.shipmode != "MAIL" && row.shipmode != "SHIP") || row.receiptdate < q12_receiptdate_lower_boundary ||
+            row.receiptdate > q12_receiptdate_upper_boundary) {
+            return;
+        }
+        int mode = dictionary_code(shipmode_dict, row.shipmode);
+        if (mode < 0) { unknown_code = true; return; }
+        q12_accumulate(reference, high_priority, static_cast<uint32_t>(mode), row.receiptdate, row.commitdate, row.shipdate, row.orderkey);
+    }) == 0;
+
+    std::cout << "shipmode|high_line_count|low_line_count" << std::endl;
+    for (int code : shipmode_codes) {
+        std::cout << shipmode_dict[code] << "|" << result.high_line_count[code] << "|" << result.low_line_count[code] << std::endl;
+    }
+    auto counts_match = [](const q12_result& a, const q12_result& b) {
+        return a.high_line_count == b.high_line_count && a.low_line_count == b.low_line_count;
+    };
+    return report_verification(ctx, reference_loaded, !unknown_code && counts_match(result, reference), counts_match(result, expected));
+}
+
+// Q14: promo revenue share of the lineitems shipped in September 1995, joined with part on CPU
+struct q14_result {
+    double promo_revenue = 0;
+    double total_revenue = 0;
+};
+
+void q14_accumulate(q14_result& result, const part_table& part, uint32_t partkey, float extendedprice, float discount)
+{
+    double revenue = static_cast<double>(extendedprice) * (1 - static_cast<double>(discount));
+    result.total_revenue += revenue;
+    if (partkey < part.promo.size() && part.promo[partkey]) { result.promo_revenue += revenue; }
+}
+
+int run_q14(query_context& ctx, const part_table& part)
+{
+    std::cout << "[TPC-H Q14]" << std::endl;
+    enum { shipdate, partkey, extendedprice, discount };
+    std::vector<lineitem_column> col;
+    if (open_columns(ctx, {"l_shipdate", "l_partkey", "l_extendedprice", "l_discount"}, col) != 0) {
+        return 1;
+    }
+
+    // CPU baseline
+    std::vector<std::vector<uint8_t>> data;
+    double cpu_decompress_sec = cpu_decompress_columns(col, ctx, data);
+    if (cpu_decompress_sec < 0) { return 1; }
+    q14_result expected;
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t rows = total_rows(col[shipdate].layout);
+    for (std::size_t r = 0; r < rows; r++) {
+        uint32_t ship = column_value(col[shipdate].layout, data[shipdate].data(), r);
+        if (ship < q14_shipdate_lower_boundary || ship > q14_shipdate_upper_boundary) { continue; }
+        q14_accumulate(expected, part, column_value(col[partkey].layout, data[partkey].data(), r),
+                       float_value(data[extendedprice].data(), r), float_value(data[discount].data(), r));
+    }
+    print_times("CPU baseline", cpu_decompress_sec, 0, 0, elapsed_sec(start));
+
+    q14_result result = expected;
+    if (ctx.execution_path == qpl_path_hardware) {
+        std::vector<std::vector<uint8_t>> mask;
+        double scan_sec = iaa_decompress_scan(col[shipdate], ctx, ctx.job, qpl_op_scan_range, q14_shipdate_lower_boundary, q14_shipdate_upper_boundary, mask);
+        if (scan_sec < 0) { return 1; }
+        std::vector<std::vector<std::vector<uint8_t>>> selected;
+        double select_sec = iaa_decompress_select_columns(col, ctx, {partkey, extendedprice, discount}, mask, selected);
+        if (select_sec < 0) { return 1; }
+        result = q14_result();
+        start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < mask.size(); k++) {
+            std::size_t n = selected_rows(col[extendedprice].layout, selected[extendedprice][k]);
+            for (std::size_t i = 0; i < n; i++) {
+                q14_accumulate(result, part, column_value(col[partkey].layout, selected[partkey][k].data(), i),
+                               float_value(selected[extendedprice][k].data(), i), float_value(selected[discount][k].data(), i));
+            }
+        }
+        print_times("IAA", 0, scan_sec, select_sec, elapsed_sec(start));
+    }
+
+    // Reference: the same query evaluated on lineitem.tbl
+    q14_result reference;
+    const bool reference_loaded = scan_lineitem_tbl(ctx.tbl_dir, [&](const lineitem_row& row) {
+        if (row.shipdate < q14_shipdate_lower_boundary || row.shipdate > q14_shipdate_upper_boundary) { return; }
+        q14_accumulate(reference, part, row.partkey, row.extendedprice, row.discount);
+    }) == 0;
+
+    double promo_revenue = result.total_revenue > 0 ? 100.0 * result.promo_revenue / result.total_revenue : 0;
+    std::cout << "promo_revenue: " << std::fixed << std::setprecision(4) << promo_revenue << std::defaultfloat << std::endl;
+    auto revenue_match = [](const q14_result& a, const q14_result& b) {
+        return results_match(a.promo_revenue, b.promo_revenue) && results_match(a.total_revenue, b.total_revenue);
+    };
+    return report_verification(ctx, reference_loaded, revenue_match(result, reference), revenue_match(result, expected));
+}
+
+/**
+ * Q19: revenue of 'DELIVER IN PERSON' air shipments whose part matches one of three brand/container/size branches.
+ * IAA filters shipinstruct, shipmode and the union of the quantity ranges; the per-branch quantity range is checked
+ * on CPU against the branch of the joined part.
+ */
+void q19_accumulate(double& revenue, const part_table& part, uint32_t partkey, uint32_t quantity, float extendedprice, float discount)
+{
+    static const uint32_t quantity_range[4][2] = {{1, 0}, {1, 11}, {10, 20}, {20, 30}};
+    uint32_t group = partkey < part.q19_group.size() ? part.q19_group[partkey] : 0;
+    if (group == 0 || quantity < quantity_range[group][0] || quantity > quantity_range[group][1]) { return; }
+    revenue += static_cast<double>(extendedprice) * (1 - static_cast<double>(discount));
+}
+
+int run_q19(query_context& ctx, const part_table& part)
+{
+    std::cout << "[TPC-H Q19]" << std::endl;
+    enum { shipinstruct, shipmode, quantity, partkey, extendedprice, discount };
+    std::vector<lineitem_column> col;
+    if (open_columns(ctx, {"l_shipinstruct_code", "l_shipmode_code", "l_quantity", "l_partkey", "l_extendedprice", "l_discount"}, col) != 0) {
+        return 1;
+    }
+    std::vector<std::string> shipinstruct_dict, shipmode_dict;
+    if (load_dictionary(ctx.orig_file_path + "l_shipinstruct_code.dict", shipinstruct_dict) != 0 ||
+        load_dictionary(ctx.orig_file_path + "l_shipmode_code.dict", shipmode_dict) != 0) {
+        return 1;
+    }
+    const int deliver_in_person = dictionary_code(shipinstruct_dict, "DELIVER IN PERSON");
+    const std::vector<int> shipmode_codes = dictionary_codes(shipmode_dict, {"AIR", "AIR REG"});
+
+    // CPU baseline
+    std::vector<std::vector<uint8_t>> data;
+    double cpu_decompress_sec = cpu_decompress_columns(col, ctx, data);
+    if (cpu_decompress_sec < 0) { return 1; }
+    double expected = 0;
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t rows = total_rows(col[shipmode].layout);
+    for (std::size_t r = 0; r < rows; r++) {
+        if (static_cast<int>(column_value(col[shipinstruct].layout, data[shipinstruct].data(), r)) != deliver_in_person ||
+            !has_code(shipmode_codes, column_value(col[shipmode].layout, data[shipmode].data(), r))) {
+            continue;
+        }
+        q19_accumulate(expected, part, column_value(col[partkey].layout, data[partkey].data(), r),
+                       column_value(col[quantity].layout, data[quantity].data(), r),
+                       float_value(data[extendedprice].data(), r), float_value(data[discount].data(), r));
+    }
+    print_times("CPU baseline", cpu_decompress_sec, 0, 0, elapsed_sec(start));
+
+    double revenue = expected;
+    if (ctx.execution_path == qpl_path_hardware) {
+        std::vector<std::vector<uint8_t>> mask, predicate_mask;
+        double scan_sec = iaa_decompress_scan_codes(col[shipmode], ctx, shipmode_codes, mask);
+        if (scan_sec < 0) { return 1; }
+        std::vector<int> shipinstruct_codes;
+        if (deliver_in_person >= 0) { shipinstruct_codes.push_back(deliver_in_person); }
+        double t = iaa_decompress_scan_codes(col[shipinstruct], ctx, shipinstruct_codes, predicate_mask);
+        if (t < 0) { return 1; }
+        scan_sec += t;
+        mask_and(mask, predicate_mask);
+        t = iaa_decompress_scan(col[quantity], ctx, ctx.job, qpl_op_scan_range, q19_quantity_lower_boundary, q19_quantity_upper_boundary, predicate_mask);
+        if (t < 0) { return 1; }
+        scan_sec += t;
+        mask_and(mask, predicate_mask);
+
+        std::vector<std::vector<std::vector<uint8_t>>> selected;
+        double select_sec = iaa_decompress_select_columns(col, ctx, {partkey, quantity, extendedprice, discount}, mask, selected);
+        if (select_sec < 0) { return 1; }
+        revenue = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < mask.size(); k++) {
+            std::size_t n = selected_rows(col[extendedprice].layout, selected[extendedprice][k]);
+            for (std::size_t i = 0; i < n; i++) {
+                q19_accumulate(revenue, part, column_value(col[partkey].layout, selected[partkey][k].data(), i),
+                               column_value(col[quantity].layout, selected[quantity][k].data(), i),
+                               float_value(selected[extendedprice][k].data(), i), float_value(selected[discount][k].data(), i));
+            }
+        }
+        print_times("IAA", 0, scan_sec, select_sec, elapsed_sec(start));
+    }
+
+    // Reference: the same query evaluated on lineitem.tbl
+    double reference = 0;
+    const bool reference_loaded = scan_lineitem_tbl(ctx.tbl_dir, [&](const lineitem_row& row) {
+        if (row.shipinstruct != "DELIVER IN PERSON" || (row.shipmode != "AIR" && row.shipmode != "AIR REG")) { return; }
+        q19_accumulate(reference, part, row.partkey, row.quantity, row.extendedprice, row.discount);
+    }) == 0;
+
+    std::cout << "revenue: " << std::fixed << std::setprecision(4) << revenue << std::defaultfloat << std::endl;
+    return report_verification(ctx, reference_loaded, results_match(revenue, reference), results_match(revenue, expected));
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    // Default tos Software Path
+    qpl_path_t execution_path = qpl_path_hardware;
+
+    // Get path from input argument
+    int parse_ret = parse_execution_path(argc, argv, &execution_path, 1);
+    if (parse_ret != 0) {
+        return 1;
+    }
+
+    query_context ctx;
+    ctx.src_data_file_dir = argv[2];
+    ctx.queue_size = static_cast<uint32_t>(atoi(argv[3]));
+    ctx.orig_file_path = argv[4];
+    ctx.tbl_dir = argv[5];
+    ctx.execution_path = execution_path;
+    const std::string query = argc > 6 ? argv[6] : "all";
+    ctx.num_threads = argc > 7 ? static_cast<uint32_t>(atoi(argv[7])) : std::max(1u, std::thread::hardware_concurrency());
+    if (ctx.queue_size == 0) {
+        std::cout << "Queue size must be at least 1" << std::endl;
+        return 1;
+    }
+    if (execution_path == qpl_path_software) {
+        std::cout << "Software path is not supporting functional pipeline; only the CPU baseline is run." << std::endl;
+    }
+
+    // Job initialization
+    std::vector<std::unique_ptr<uint8_t[]>> job_buffer;
+    qpl_status                              status;
+    uint32_t                                size = 0;
+
+    job_buffer.resize(ctx.queue_size + 1);
+    ctx.job.resize(ctx.queue_size);
+    for (uint32_t i = 0; i <= ctx.queue_size; ++i) {
+        // The last job is the software job of the CPU baseline
+        qpl_path_t path = i == ctx.queue_size ? qpl_path_software : execution_path;
+        status = qpl_get_job_size(path, &size);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+            return 1;
+        }
+        job_buffer[i] = std::make_unique<uint8_t[]>(size);
+        qpl_job *job_ptr = reinterpret_cast<qpl_job *>(job_buffer[i].get());
+        status = qpl_init_job(path, job_ptr);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+            return 1;
+        }
+        if (i == ctx.queue_size) { ctx.cpu_job = job_ptr; } else { ctx.job[i] = job_ptr; }
+    }
+
+    part_table part;
+    if ((query == "q14" || query == "q19" || query == "all") && load_part(ctx.tbl_dir, part) != 0) {
+        return 1;
+    }
+
+    int failed = 0;
+    if (query == "q1" || query == "all") { failed += run_q1(ctx); std::cout << "==========================================================================" << std::endl; }
+    if (query == "q12" || query == "all") { failed += run_q12(ctx); std::cout << "==========================================================================" << std::endl; }
+    if (query == "q14" || query == "all") { failed += run_q14(ctx, part); std::cout << "==========================================================================" << std::endl; }
+    if (query == "q19" || query == "all") { failed += run_q19(ctx, part); std::cout << "==========================================================================" << std::endl; }
+
+    for (uint32_t i = 0; i < ctx.queue_size; ++i) {
+        status = qpl_fini_job(ctx.job[i]);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+            return 1;
+        }
+    }
+    qpl_fini_job(ctx.cpu_job);
+
+    std::cout << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+//* [QPL_LOW_LEVEL_COMPRESSION_EXAMPLE] */
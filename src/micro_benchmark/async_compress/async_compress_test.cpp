@@ -0,0 +1,303 @@
+//* [QPL_LOW_LEVEL_ASYNC_COMPRESSION_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Insert path of the ClickHouse DEFLATE_QPL codec (src/end_to_end/clickhouse) at increasing queue depths.
+ * A file is cut into blocks the size of ClickHouse compressed blocks and one thread compresses them all, as a
+ * MergeTree insert or merge does. At depth 1 every block is compressed with qpl_execute_job, like doCompressData.
+ * At depth N up to N jobs are submitted with qpl_submit_job and reaped in completion order, like
+ * compressAsynchronous / flushAsynchronousCompressRequests. A failed job is compressed again in software.
+ * Every depth is verified by decompressing all blocks in software.
+ *
+ * Usage: async_compress_test <hardware_path|software_path> <file> [block_kb] [max_depth] [iterations]
+ * block_kb defaults to 64 (min_compress_block_size), max_depth to 64, iterations to 10.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * On the software path qpl_submit_job runs the job before it returns, so the depth makes no difference there.
+ *
+ */
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 3) {
+            std::cout << "Usage: async_compress_test <hardware_path|software_path> <file> [block_kb] [max_depth] [iterations]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// CompressionCodecDeflateQpl::getMaxCompressedDataSize, aligned with ZLIB
+uint32_t max_compressed_size(uint32_t uncompressed_size)
+{
+    return uncompressed_size + (uncompressed_size >> 12) + (uncompressed_size >> 14) + (uncompressed_size >> 25) + 13;
+}
+
+class job_set {
+public:
+    int init(qpl_path_t execution_path, uint32_t count) {
+        qpl_status status = qpl_get_job_size(execution_path, &per_job_size_);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+            return 1;
+        }
+        buffer_ = std::make_unique<uint8_t[]>(static_cast<std::size_t>(per_job_size_) * count);
+        for (uint32_t i = 0; i < count; i++) {
+            status = qpl_init_job(execution_path, job(i));
+            if (status != QPL_STS_OK) {
+                std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+                return 1;
+            }
+            count_++;
+        }
+        return 0;
+    }
+
+    ~job_set() {
+        for (uint32_t i = 0; i < count_; i++) { qpl_fini_job(job(i)); }
+    }
+
+    qpl_job *job(uint32_t index) { return reinterpret_cast<qpl_job *>(buffer_.get() + static_cast<std::size_t>(index) * per_job_size_); }
+
+private:
+    uint32_t per_job_size_ = 0;
+    uint32_t count_ = 0;
+    std::unique_ptr<uint8_t[]> buffer_;
+};
+
+// Same settings as setCompressJob in clickhouse.cpp
+void set_compress_job(qpl_job *job_ptr, const uint8_t *source, uint32_t source_size, uint8_t *dest, uint32_t dest_size)
+{
+    job_ptr->op = qpl_op_compress;
+    job_ptr->next_in_ptr = const_cast<uint8_t *>(source);
+    job_ptr->next_out_ptr = dest;
+    job_ptr->available_in = source_size;
+    job_ptr->level = qpl_default_level;
+    job_ptr->available_out = dest_size;
+    job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+}
+
+struct depth_report {
+    uint32_t depth = 0;
+    double elapsed_sec = 0;
+    std::size_t compressed_bytes = 0;
+    uint64_t fallbacks = 0;
+    uint64_t out_of_order = 0;   // completions that overtook an older block still in flight
+};
+
+// Compresses every block once with up to `depth` jobs in flight. compressed_sizes[b] receives the size of block b.
+int compress_blocks(std::vector<uint8_t>& data, uint32_t block_size, uint32_t depth, job_set& hw_jobs, qpl_job *sw_job,
+                    std::vector<std::vector<uint8_t>>& dest, std::vector<uint32_t>& compressed_sizes, depth_report& report)
+{
+    const uint32_t blocks = static_cast<uint32_t>(dest.size());
+    struct in_flight {
+        uint32_t block;
+        uint32_t slot;
+    };
+    std::vector<in_flight> pending;   // submission order
+    std::vector<uint32_t> free_slots;
+    for (uint32_t slot = depth; slot > 0; slot--) { free_slots.push_back(slot - 1); }
+
+    auto block_source = [&](uint32_t b) { return data.data() + static_cast<std::size_t>(b) * block_size; };
+    auto block_length = [&](uint32_t b) { return static_cast<uint32_t>(std::min<std::size_t>(block_size, data.size() - static_cast<std::size_t>(b) * block_size)); };
+    auto software_compress = [&](uint32_t b) -> int {
+        set_compress_job(sw_job, block_source(b), block_length(b), dest[b].data(), static_cast<uint32_t>(dest[b].size()));
+        qpl_status status = qpl_execute_job(sw_job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during software compression." << std::endl;
+            return 1;
+        }
+        compressed_sizes[b] = sw_job->total_out;
+        report.fallbacks++;
+        return 0;
+    };
+    // Reaps completed jobs in completion order, at least one when wait_for_one
+    auto reap = [&](bool wait_for_one) -> int {
+        while (true) {
+            bool completed = false;
+            for (std::size_t i = 0; i < pending.size();) {
+                qpl_job *job_ptr = hw_jobs.job(pending[i].slot);
+                qpl_status status = qpl_check_job(job_ptr);
+                if (status == QPL_STS_BEING_PROCESSED) {
+                    i++;
+                    continue;
+                }
+                const in_flight done = pending[i];
+                if (i != 0) { report.out_of_order++; }
+                pending.erase(pending.begin() + i);
+                free_slots.push_back(done.slot);
+                if (status == QPL_STS_OK) {
+                    compressed_sizes[done.block] = job_ptr->total_out;
+                } else if (software_compress(done.block) != 0) {
+                    return 1;
+                }
+                completed = true;
+            }
+            if (completed || !wait_for_one || pending.empty()) {
+                return 0;
+            }
+        }
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t b = 0; b < blocks; b++) {
+        qpl_job *job_ptr = hw_jobs.job(0);
+        if (depth == 1) {
+            set_compress_job(job_ptr, block_source(b), block_length(b), dest[b].data(), static_cast<uint32_t>(dest[b].size()));
+            if (qpl_execute_job(job_ptr) == QPL_STS_OK) {
+                compressed_sizes[b] = job_ptr->total_out;
+            } else if (software_compress(b) != 0) {
+                return 1;
+            }
+            continue;
+        }
+        if (free_slots.empty() && reap(true) != 0) {
+            return 1;
+        }
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        job_ptr = hw_jobs.job(slot);
+        set_compress_job(job_ptr, block_source(b), block_length(b), dest[b].data(), static_cast<uint32_t>(dest[b].size()));
+        if (qpl_submit_job(job_ptr) != QPL_STS_OK) {
+            free_slots.push_back(slot);
+            if (software_compress(b) != 0) {
+                return 1;
+            }
+            continue;
+        }
+        pending.push_back({b, slot});
+    }
+    while (!pending.empty()) {
+        if (reap(true) != 0) {
+            return 1;
+        }
+    }
+    report.elapsed_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return 0;
+}
+
+int verify_blocks(std::vector<uint8_t>& data, uint32_t block_size, qpl_job *sw_job,
+                  std::vector<std::vector<uint8_t>>& dest, std::vector<uint32_t>& compressed_sizes)
+{
+    std::vector<uint8_t> restored(block_size);
+    for (uint32_t b = 0; b < dest.size(); b++) {
+        const std::size_t offset = static_cast<std::size_t>(b) * block_size;
+        const uint32_t length = static_cast<uint32_t>(std::min<std::size_t>(block_size, data.size() - offset));
+        sw_job->op = qpl_op_decompress;
+        sw_job->next_in_ptr = dest[b].data();
+        sw_job->next_out_ptr = restored.data();
+        sw_job->available_in = compressed_sizes[b];
+        sw_job->available_out = length;
+        sw_job->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        qpl_status status = qpl_execute_job(sw_job);
+        if (status != QPL_STS_OK || sw_job->total_out != length || !std::equal(restored.begin(), restored.begin() + length, data.begin() + offset)) {
+            std::cout << "Block " << b << " does not decompress to the source (status " << status << ")." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_software;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+    const std::string file_path = argv[2];
+    const uint32_t block_size = (argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 64) * 1024;
+    const uint32_t max_depth = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 64;
+    const uint32_t iterations = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 10;
+    if (block_size == 0 || block_size > 2097152 || max_depth == 0 || iterations == 0) {
+        std::cout << "Block size must be 1 to 2048 KB, depth and iterations at least 1." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    const uint32_t blocks = static_cast<uint32_t>((data.size() + block_size - 1) / block_size);
+    std::cout << "Source file = " << file_path << ", " << data.size() << " bytes in " << blocks << " blocks of " << block_size << " bytes"
+              << ", " << iterations << " iterations per depth" << std::endl;
+
+    job_set hw_jobs;
+    job_set sw_jobs;
+    if (hw_jobs.init(execution_path, max_depth) != 0 || sw_jobs.init(qpl_path_software, 1) != 0) {
+        return 1;
+    }
+    // Destination buffers are touched once up front, as the codec writes into already used memory
+    std::vector<std::vector<uint8_t>> dest(blocks);
+    for (uint32_t b = 0; b < blocks; b++) {
+        dest[b].assign(max_compressed_size(std::min<std::size_t>(block_size, data.size() - static_cast<std::size_t>(b) * block_size)), 0);
+    }
+    std::vector<uint32_t> compressed_sizes(blocks, 0);
+
+    std::vector<depth_report> reports;
+    for (uint32_t depth = 1; depth <= max_depth; depth = depth < max_depth && depth * 2 > max_depth ? max_depth : depth * 2) {
+        depth_report report;
+        report.depth = depth;
+        for (uint32_t it = 0; it < iterations; it++) {
+            if (compress_blocks(data, block_size, depth, hw_jobs, sw_jobs.job(0), dest, compressed_sizes, report) != 0) {
+                return 1;
+            }
+        }
+        if (verify_blocks(data, block_size, sw_jobs.job(0), dest, compressed_sizes) != 0) {
+            return 1;
+        }
+        for (uint32_t size : compressed_sizes) { report.compressed_bytes += size; }
+        reports.push_back(report);
+        if (depth == max_depth) {
+            break;
+        }
+    }
+
+    std::cout << "depth, throughput (MB/s), speedup, ratio, software fallbacks, out-of-order completions" << std::endl;
+    for (const depth_report& report : reports) {
+        const double throughput = static_cast<double>(data.size()) * iterations / report.elapsed_sec / 1e6;
+        const double baseline = static_cast<double>(data.size()) * iterations / reports.front().elapsed_sec / 1e6;
+        std::cout << report.depth << ", " << throughput << ", " << throughput / baseline << ", "
+                  << static_cast<double>(data.size()) / report.compressed_bytes << ", " << report.fallbacks << ", " << report.out_of_order << std::endl;
+    }
+    std::cout << "Verification: PASS" << std::endl;
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_ASYNC_COMPRESSION_EXAMPLE] */
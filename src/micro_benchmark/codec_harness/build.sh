@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# Usage: ./build.sh [stub]
+# stub builds against the simulated IAA devices of hw_stub/ instead of libaccel-config, for machines without IAA
+
+# Get the Git root directory
+GIT_ROOT=$(git rev-parse --show-toplevel)
+
+# Define the QPL include and library paths relative to the Git root
+QPL_INCLUDE="$GIT_ROOT/qpl/include"
+QPL_LIB="$GIT_ROOT/qpl/build/lib/libqpl.a"
+
+# The ClickHouse DEFLATE_QPL codec, compiled against the shim headers in compat/
+CODEC_SRC="$GIT_ROOT/src/end_to_end/clickhouse/clickhouse.cpp"
+
+if [ "$1" == "stub" ]; then
+    ACCEL_CONFIG_INCLUDE="hw_stub"
+    ACCEL_CONFIG_LIB="hw_stub/hw_stub.cpp -Wl,--wrap=qpl_get_job_size,--wrap=qpl_init_job,--wrap=qpl_submit_job,--wrap=qpl_check_job,--wrap=qpl_wait_job,--wrap=qpl_fini_job"
+else
+    ACCEL_CONFIG_INCLUDE="/usr/include/accel-config"
+    ACCEL_CONFIG_LIB="-laccel-config"
+fi
+
+# Compile the program using the dynamically determined paths
+g++ -std=c++20 -O2 -pthread -mwaitpkg -DUSE_QPL=1 -Icompat -I"$ACCEL_CONFIG_INCLUDE" -I"$QPL_INCLUDE" -o codec_harness codec_harness.cpp "$CODEC_SRC" $ACCEL_CONFIG_LIB "$QPL_LIB" -ldl
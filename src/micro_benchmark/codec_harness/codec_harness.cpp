@@ -0,0 +1,429 @@
+//* [QPL_LOW_LEVEL_CODEC_HARNESS_EXAMPLE] */
+
+#include <Compression/CompressionCodecDeflateQpl.h>
+#include "harness_blocks.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+/**
+ * @brief Runs the ClickHouse DEFLATE_QPL codec (src/end_to_end/clickhouse) without ClickHouse. clickhouse.cpp is compiled
+ * against the shim headers in compat/ and QPL alone, so the job pool, the hardware codec and the software fallback can be
+ * measured and debugged in isolation. hw_stub/ simulates IAA devices on machines without them (build.sh stub).
+ *
+ * Every thread cuts blocks out of the file with sizes drawn from a distribution, then runs three phases over them:
+ *   compress         : ICompressionCodec::compress, block by block
+ *   decompress       : ICompressionCodec::decompress, block by block
+ *   async decompress : asynchronous mode, `depth` blocks submitted before each flush (hardware_path only)
+ * Each decompressed block is checked against its source. On the hardware path the blocks are decompressed into buffers
+ * borrowed from DeflateQplBufferPool, which ClickHouse's own read buffers do not use, so the codec skips its touching pass over them
+ * (DeflateQplPrefaultedDestinations); `heap` decompresses into ordinary buffers instead. The codec is CompressionCodecDeflateQpl,
+ * with its job pool and fallback; on the software path it is SoftwareCodecDeflateQpl alone. The codec's DeflateQplMetrics
+ * are printed at the end, as ClickHouse would export them.
+ * Distributions:
+ *   fixed:<kb> : every block <kb> KiB
+ *   clickhouse : log-uniform from 64 KiB to 1 MiB, the default min_compress_block_size and max_compress_block_size
+ *   mixed      : 70% 4-64 KiB (small columns and granules), 25% 64 KiB-1 MiB, 5% 1-4 MiB (raised max_compress_block_size)
+ *
+ * Usage: codec_harness <hardware_path|software_path> <file> [distribution] [blocks] [threads] [depth] [pool|heap]
+ * distribution defaults to clickhouse, blocks per thread to 1000, threads to 1, depth to 16, output buffers to pool.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * Set DEFLATE_QPL_HARNESS_LOG=1 to see the codec's log lines, including every fallback.
+ *
+ */
+
+namespace DB::ErrorCodes
+{
+    extern const int CANNOT_COMPRESS = 1;
+    extern const int CANNOT_DECOMPRESS = 2;
+}
+
+using DB::CompressionCodecDeflateQpl;
+using DB::DeflateQplBufferPool;
+using DB::DeflateQplJobHWPool;
+using DB::DeflateQplJobWaiter;
+using DB::DeflateQplMetrics;
+using DB::ICompressionCodec;
+using DB::SoftwareCodecDeflateQpl;
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 3) {
+            std::cout << "Usage: codec_harness <hardware_path|software_path> <file> [distribution] [blocks] [threads] [depth]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+class block_size_distribution {
+public:
+    bool parse(const std::string& name) {
+        if (name.rfind("fixed:", 0) == 0) {
+            fixed_size_ = static_cast<uint32_t>(std::stoul(name.substr(6))) * 1024;
+            return fixed_size_ != 0;
+        }
+        if (name == "clickhouse") {
+            ranges_ = {{1.0, 64 * 1024, 1024 * 1024}};
+            return true;
+        }
+        if (name == "mixed") {
+            ranges_ = {{0.70, 4 * 1024, 64 * 1024}, {0.25, 64 * 1024, 1024 * 1024}, {0.05, 1024 * 1024, 4 * 1024 * 1024}};
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t max_size() const {
+        uint32_t size = fixed_size_;
+        for (const auto& range : ranges_) {
+            size = std::max(size, range.max);
+        }
+        return size;
+    }
+
+    uint32_t sample(std::mt19937_64& rng) const {
+        if (fixed_size_ != 0) {
+            return fixed_size_;
+        }
+        double pick = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        const range* chosen = &ranges_.back();
+        for (const auto& range : ranges_) {
+            if (pick < range.share) {
+                chosen = &range;
+                break;
+            }
+            pick -= range.share;
+        }
+        // Log-uniform inside the range, small blocks are as likely per octave as large ones
+        const double exponent = std::uniform_real_distribution<double>(std::log2(chosen->min), std::log2(chosen->max))(rng);
+        return static_cast<uint32_t>(std::exp2(exponent));
+    }
+
+private:
+    struct range {
+        double share;
+        uint32_t min;
+        uint32_t max;
+    };
+    uint32_t fixed_size_ = 0;
+    std::vector<range> ranges_;
+};
+
+struct phase_result {
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    uint64_t elapsed_ns = 0;
+    std::vector<uint32_t> latencies_ns;
+
+    void add(const phase_result& other) {
+        blocks += other.blocks;
+        bytes += other.bytes;
+        elapsed_ns = std::max(elapsed_ns, other.elapsed_ns);
+        latencies_ns.insert(latencies_ns.end(), other.latencies_ns.begin(), other.latencies_ns.end());
+    }
+};
+
+struct thread_result {
+    phase_result compress;
+    phase_result decompress;
+    phase_result async_decompress;
+    uint64_t compressed_bytes = 0;
+    bool failed = false;
+};
+
+// Same bound as CompressionCodecDeflateQpl::getMaxCompressedDataSize for a single stream
+uint32_t deflate_bound(uint32_t size)
+{
+    return size + (size >> 12) + (size >> 14) + (size >> 25) + 13;
+}
+
+// Decompression target: a buffer borrowed from DeflateQplBufferPool, or a heap buffer when not pooled or the pool is full
+class output_buffer {
+public:
+    output_buffer(std::size_t size, bool pooled) {
+        if (pooled) {
+            pooled_ = DeflateQplBufferPool::instance().borrow(size);
+        }
+        if (!pooled_) {
+            heap_.resize(size);
+        }
+    }
+
+    char *data() { return pooled_ ? pooled_.data() : heap_.data(); }
+
+private:
+    DeflateQplBufferPool::Buffer pooled_;
+    std::vector<char> heap_;
+};
+
+bool check_block(const block& b, const char *output, uint32_t index)
+{
+    if (std::memcmp(output, b.source, b.size) != 0) {
+        std::cout << "Block " << index << " of " << b.size << " bytes does not match its source after decompression." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename compress_fn, typename decompress_fn>
+void run_sync_phases(std::vector<block>& blocks, char *output, compress_fn compress, decompress_fn decompress, thread_result& result)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (auto& b : blocks) {
+        const auto block_start = std::chrono::steady_clock::now();
+        b.compressed_size = compress(b);
+        result.compress.latencies_ns.push_back(static_cast<uint32_t>(elapsed_ns(block_start, std::chrono::steady_clock::now())));
+        result.compress.bytes += b.size;
+        result.compressed_bytes += b.compressed_size;
+    }
+    result.compress.elapsed_ns = elapsed_ns(start, std::chrono::steady_clock::now());
+    result.compress.blocks = blocks.size();
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        const auto block_start = std::chrono::steady_clock::now();
+        decompress(blocks[i], output);
+        const uint64_t latency = elapsed_ns(block_start, std::chrono::steady_clock::now());
+        result.decompress.latencies_ns.push_back(static_cast<uint32_t>(latency));
+        result.decompress.elapsed_ns += latency;
+        result.decompress.bytes += blocks[i].size;
+        if (!check_block(blocks[i], output, i)) {
+            result.failed = true;
+            return;
+        }
+    }
+    result.decompress.blocks = blocks.size();
+}
+
+void run_hardware_thread(std::vector<block>& blocks, uint32_t depth, bool pooled, thread_result& result)
+{
+    try {
+        CompressionCodecDeflateQpl codec;
+        ICompressionCodec& codec_interface = codec;
+        const std::size_t output_size = std::max_element(blocks.begin(), blocks.end(), [](const block& a, const block& b) { return a.size < b.size; })->size;
+        output_buffer output(output_size, pooled);
+        for (auto& b : blocks) {
+            b.compressed.resize(codec.getCompressedReserveSize(b.size));
+        }
+        run_sync_phases(
+            blocks, output.data(),
+            [&](block& b) { return codec.compress(b.source, b.size, b.compressed.data()); },
+            [&](block& b, char *dest) { codec.decompress(b.compressed.data(), b.compressed_size, dest); },
+            result);
+        if (result.failed || depth == 0) {
+            return;
+        }
+
+        // Blocks of one batch are decompressed into separate buffers, they are all in flight at once
+        std::vector<output_buffer> outputs;
+        for (uint32_t i = 0; i < depth; i++) {
+            outputs.emplace_back(output_size, pooled);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t first = 0; first < blocks.size(); first += depth) {
+            const uint32_t last = std::min<uint32_t>(first + depth, static_cast<uint32_t>(blocks.size()));
+            codec.setDecompressMode(ICompressionCodec::CodecMode::Asynchronous);
+            for (uint32_t i = first; i < last; i++) {
+                codec.decompress(blocks[i].compressed.data(), blocks[i].compressed_size, outputs[i - first].data());
+            }
+            codec_interface.flushAsynchronousDecompressRequests();
+            for (uint32_t i = first; i < last; i++) {
+                result.async_decompress.bytes += blocks[i].size;
+                if (!check_block(blocks[i], outputs[i - first].data(), i)) {
+                    result.failed = true;
+                    return;
+                }
+            }
+        }
+        result.async_decompress.elapsed_ns = elapsed_ns(start, std::chrono::steady_clock::now());
+        result.async_decompress.blocks = blocks.size();
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        result.failed = true;
+    }
+}
+
+void run_software_thread(std::vector<block>& blocks, thread_result& result)
+{
+    try {
+        SoftwareCodecDeflateQpl codec;
+        std::vector<char> output(std::max_element(blocks.begin(), blocks.end(), [](const block& a, const block& b) { return a.size < b.size; })->size);
+        for (auto& b : blocks) {
+            b.compressed.resize(deflate_bound(b.size));
+        }
+        run_sync_phases(
+            blocks, output.data(),
+            [&](block& b) { return codec.doCompressData(b.source, b.size, b.compressed.data(), static_cast<uint32_t>(b.compressed.size())); },
+            [&](block& b, char *dest) { codec.doDecompressData(b.compressed.data(), b.compressed_size, dest, b.size); },
+            result);
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        result.failed = true;
+    }
+}
+
+void print_phase(const char *name, phase_result& phase)
+{
+    if (phase.blocks == 0) {
+        return;
+    }
+    std::sort(phase.latencies_ns.begin(), phase.latencies_ns.end());
+    std::cout << name << ", " << phase.blocks << ", " << static_cast<double>(phase.bytes) / static_cast<double>(phase.elapsed_ns) * 1000.0;
+    if (phase.latencies_ns.empty()) {
+        std::cout << ", -, -" << std::endl;
+        return;
+    }
+    uint64_t total_latency = 0;
+    for (uint32_t latency : phase.latencies_ns) {
+        total_latency += latency;
+    }
+    std::cout << ", " << total_latency / phase.latencies_ns.size() / 1000.0 << ", " << phase.latencies_ns[phase.latencies_ns.size() * 99 / 100] / 1000.0 << std::endl;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_software;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+    const std::string file_path = argv[2];
+    const std::string distribution_name = argc > 3 ? argv[3] : "clickhouse";
+    const uint32_t blocks_per_thread = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 1000;
+    const uint32_t threads = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 1;
+    const uint32_t depth = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 16;
+    const std::string buffers = argc > 7 ? argv[7] : "pool";
+    block_size_distribution distribution;
+    if (!distribution.parse(distribution_name)) {
+        std::cout << "Unknown distribution " << distribution_name << ". Use fixed:<kb>, clickhouse or mixed." << std::endl;
+        return 1;
+    }
+    if (blocks_per_thread == 0 || threads == 0) {
+        std::cout << "Blocks and threads must be at least 1." << std::endl;
+        return 1;
+    }
+    if (buffers != "pool" && buffers != "heap") {
+        std::cout << "Unknown output buffers " << buffers << ". Use pool or heap." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    // Repeat a small file so that every block is a contiguous slice of it
+    const std::size_t file_size = data.size();
+    while (data.size() < 2 * static_cast<std::size_t>(distribution.max_size())) {
+        data.insert(data.end(), data.begin(), data.begin() + static_cast<std::ptrdiff_t>(file_size));
+    }
+
+    std::vector<std::vector<block>> thread_blocks(threads);
+    for (uint32_t t = 0; t < threads; t++) {
+        std::mt19937_64 rng(t + 1);
+        for (uint32_t i = 0; i < blocks_per_thread; i++) {
+            const uint32_t size = std::min<uint32_t>(distribution.sample(rng), static_cast<uint32_t>(data.size()));
+            const std::size_t offset = std::uniform_int_distribution<std::size_t>(0, data.size() - size)(rng);
+            thread_blocks[t].push_back({data.data() + offset, size, {}, 0});
+        }
+    }
+    std::cout << "Source file = " << file_path << ", distribution " << distribution_name << ", " << threads << " threads x "
+              << blocks_per_thread << " blocks, async depth " << depth << ", " << buffers << " output buffers" << std::endl;
+
+    std::vector<thread_result> results(threads);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads; t++) {
+        if (execution_path == qpl_path_hardware) {
+            workers.emplace_back(run_hardware_thread, std::ref(thread_blocks[t]), depth, buffers == "pool", std::ref(results[t]));
+        } else {
+            workers.emplace_back(run_software_thread, std::ref(thread_blocks[t]), std::ref(results[t]));
+        }
+    }
+    for (auto& worker : workers) { worker.join(); }
+
+    thread_result total;
+    for (auto& result : results) {
+        if (result.failed) {
+            return 1;
+        }
+        total.compress.add(result.compress);
+        total.decompress.add(result.decompress);
+        total.async_decompress.add(result.async_decompress);
+        total.compressed_bytes += result.compressed_bytes;
+    }
+    std::cout << "Compression ratio = " << static_cast<double>(total.compress.bytes) / static_cast<double>(total.compressed_bytes) << std::endl;
+    std::cout << "phase, blocks, throughput (MB/s), avg latency (us), p99 latency (us)" << std::endl;
+    print_phase("compress", total.compress);
+    print_phase("decompress", total.decompress);
+    print_phase("async decompress", total.async_decompress);
+    std::cout << "Software jobs initialized = " << SoftwareCodecDeflateQpl::getInitializedJobs() << std::endl;
+    // Read through the system.asynchronous_metrics provider, as ClickHouse exports them
+    DB::AsynchronousMetricValues metric_values;
+    DeflateQplMetrics::updateAsynchronousMetrics(metric_values);
+    std::cout << "Codec metrics:" << std::endl;
+    for (const auto& [name, value] : std::map<std::string, DB::AsynchronousMetricValue>(metric_values.begin(), metric_values.end())) {
+        std::cout << "  " << name << " = " << static_cast<UInt64>(value.value) << std::endl;
+    }
+
+    if (execution_path == qpl_path_hardware) {
+        auto& pool = DeflateQplJobHWPool::instance();
+        if (!pool.isJobPoolReady()) {
+            std::cout << "The hardware job pool is not ready, every block went through the software codec." << std::endl;
+            return 0;
+        }
+        const auto acquire = pool.getAcquireCounters();
+        std::cout << "Job pool: acquired immediately " << acquire.immediate << ", after wait " << acquire.after_wait
+                  << "; fell back after the budget " << acquire.budget_expired << ", with a full queue " << acquire.queue_full
+                  << ", without waiting " << acquire.no_wait << "; waited " << acquire.wait_us << " us" << std::endl;
+        for (const auto& node : pool.getNodeUtilization()) {
+            std::cout << "NUMA node " << node.numa_node << " [" << node.devices << "]: " << node.jobs << " jobs, acquired locally "
+                      << node.acquired_local << ", from other nodes " << node.acquired_remote << std::endl;
+        }
+        const auto buffer_pool = DeflateQplBufferPool::instance().getCounters();
+        std::cout << "Buffer pool: " << buffer_pool.borrows << " borrows, " << buffer_pool.reuses << " reuses, " << buffer_pool.maps
+                  << " maps, " << buffer_pool.exhausted << " empty, " << buffer_pool.mapped_bytes << " bytes mapped" << std::endl;
+        const auto waiter = DeflateQplJobWaiter::instance().getCounters();
+        std::cout << "Waiter: " << waiter.waits << " waits, " << waiter.pauses << " pauses, " << waiter.polls << " polls, "
+                  << waiter.wait_cycles << " TSC cycles" << std::endl;
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_CODEC_HARNESS_EXAMPLE] */
@@ -0,0 +1,25 @@
+#pragma once
+
+/// The value type of ClickHouse's asynchronous metrics, which DeflateQplMetrics::updateAsynchronousMetrics fills in.
+/// The harness has no AsynchronousMetrics thread; it calls the provider itself.
+
+#include <string>
+#include <unordered_map>
+
+namespace DB
+{
+
+struct AsynchronousMetricValue
+{
+    double value;
+    const char * documentation;
+
+    template <typename T>
+    AsynchronousMetricValue(T value_, const char * documentation_)
+        : value(static_cast<double>(value_)), documentation(documentation_) {}
+    AsynchronousMetricValue() = default; /// For std::unordered_map::operator[].
+};
+
+using AsynchronousMetricValues = std::unordered_map<std::string, AsynchronousMetricValue>;
+
+}
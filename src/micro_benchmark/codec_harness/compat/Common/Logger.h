@@ -0,0 +1,63 @@
+#pragma once
+
+/// Harness stand-ins for the ClickHouse integer types and loggers used by the DEFLATE_QPL codec.
+/// Log lines go to stderr only when DEFLATE_QPL_HARNESS_LOG=1, so fallbacks on the hot path cost no output.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using UInt8 = uint8_t;
+using UInt16 = uint16_t;
+using UInt32 = uint32_t;
+using UInt64 = uint64_t;
+using Int32 = int32_t;
+using Int64 = int64_t;
+
+struct HarnessLogger
+{
+    std::string name;
+    bool enabled = false;
+};
+using LoggerPtr = std::shared_ptr<HarnessLogger>;
+
+inline LoggerPtr getLogger(const char * name)
+{
+    const char * enabled = std::getenv("DEFLATE_QPL_HARNESS_LOG");
+    return std::make_shared<HarnessLogger>(HarnessLogger{name, enabled && std::strcmp(enabled, "1") == 0});
+}
+
+/// Replaces each {} of format with the next argument
+inline void formatTo(std::ostringstream & out, const char * format)
+{
+    out << format;
+}
+
+template <typename T, typename... Args>
+void formatTo(std::ostringstream & out, const char * format, const T & value, const Args &... args)
+{
+    for (; *format; ++format)
+    {
+        if (format[0] == '{' && format[1] == '}')
+        {
+            out << value;
+            formatTo(out, format + 2, args...);
+            return;
+        }
+        out << *format;
+    }
+}
+
+template <typename... Args>
+void logMessage(const char * level, const LoggerPtr & log, const char * format, const Args &... args)
+{
+    if (!log->enabled)
+        return;
+    std::ostringstream out;
+    formatTo(out, format, args...);
+    std::cerr << level << " " << log->name << ": " << out.str() << std::endl;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+/// The harness is not built with MemorySanitizer
+#define __msan_unpoison(addr, size) do { (void)(addr); (void)(size); } while (false)
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Common/Logger.h>
+
+#define LOG_TRACE(log, ...) logMessage("Trace", log, __VA_ARGS__)
+#define LOG_DEBUG(log, ...) logMessage("Debug", log, __VA_ARGS__)
+#define LOG_INFO(log, ...) logMessage("Information", log, __VA_ARGS__)
+#define LOG_WARNING(log, ...) logMessage("Warning", log, __VA_ARGS__)
+#define LOG_ERROR(log, ...) logMessage("Error", log, __VA_ARGS__)
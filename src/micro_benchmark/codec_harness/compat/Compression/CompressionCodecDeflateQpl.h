@@ -0,0 +1,4 @@
+#pragma once
+
+/// setup_clickhouse.sh installs clickhouse.h under this name
+#include "../../../../end_to_end/clickhouse/clickhouse.h"
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Compression/ICompressionCodec.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace DB
+{
+
+class IAST;
+using ASTPtr = std::shared_ptr<IAST>;
+
+/// registerCodecDeflateQpl compiles against it; the harness creates the codec directly.
+class CompressionCodecFactory
+{
+public:
+    template <typename Creator>
+    void registerSimpleCompressionCodec(const char * /*family_name*/, char /*method_byte*/, Creator /*creator*/) {}
+
+    template <typename Creator>
+    void registerCompressionCodec(const char * /*family_name*/, std::optional<uint8_t> /*method_byte*/, Creator /*creator*/) {}
+};
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace DB
+{
+
+enum class CompressionMethodByte : uint8_t
+{
+    DeflateQpl = 0x99,
+};
+
+}
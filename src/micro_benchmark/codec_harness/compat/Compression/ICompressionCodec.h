@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Common/Logger.h>
+#include <Compression/CompressionInfo.h>
+#include <base/unaligned.h>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+class SipHash
+{
+};
+
+namespace DB
+{
+
+class Exception : public std::runtime_error
+{
+public:
+    template <typename... Args>
+    Exception(int code_, const char * format, const Args &... args)
+        : std::runtime_error(formatMessage(format, args...))
+        , code(code_)
+    {
+    }
+
+    int getCode() const { return code; }
+
+private:
+    template <typename... Args>
+    static std::string formatMessage(const char * format, const Args &... args)
+    {
+        std::ostringstream out;
+        formatTo(out, format, args...);
+        return out.str();
+    }
+
+    int code;
+};
+
+class IAST
+{
+public:
+    void updateTreeHash(SipHash & /*hash*/, bool /*ignore_aliases*/) const {}
+};
+
+/// The part of ClickHouse's ICompressionCodec the DEFLATE_QPL codec uses. Blocks carry the same 9 byte header:
+/// method byte, compressed size with the header, uncompressed size.
+class ICompressionCodec
+{
+public:
+    enum class CodecMode : uint8_t
+    {
+        Synchronous,
+        Asynchronous,
+        SoftwareFallback,
+    };
+
+    virtual ~ICompressionCodec() = default;
+
+    static constexpr UInt8 getHeaderSize() { return 1 + 2 * sizeof(UInt32); }
+
+    UInt32 compress(const char * source, UInt32 source_size, char * dest) const
+    {
+        dest[0] = getMethodByte();
+        const UInt32 compressed_size = doCompressData(source, source_size, &dest[getHeaderSize()]) + getHeaderSize();
+        unalignedStore<UInt32>(&dest[1], compressed_size);
+        unalignedStore<UInt32>(&dest[5], source_size);
+        return compressed_size;
+    }
+
+    UInt32 decompress(const char * source, UInt32 source_size, char * dest) const
+    {
+        if (source_size < getHeaderSize() || static_cast<uint8_t>(source[0]) != getMethodByte()
+            || unalignedLoad<UInt32>(&source[1]) != source_size)
+            throw std::runtime_error("Corrupted compressed block header");
+        const UInt32 decompressed_size = unalignedLoad<UInt32>(&source[5]);
+        doDecompressData(&source[getHeaderSize()], source_size - getHeaderSize(), dest, decompressed_size);
+        return decompressed_size;
+    }
+
+    UInt32 getCompressedReserveSize(UInt32 uncompressed_size) const { return getHeaderSize() + getMaxCompressedDataSize(uncompressed_size); }
+
+    virtual uint8_t getMethodByte() const = 0;
+    virtual void updateHash(SipHash & hash) const = 0;
+
+    void setDecompressMode(CodecMode mode) { decompress_mode = mode; }
+    virtual void flushAsynchronousDecompressRequests() {}
+
+    const IAST * getCodecDesc() const { return &codec_desc; }
+
+protected:
+    virtual bool isCompression() const = 0;
+    virtual bool isGenericCompression() const = 0;
+    virtual bool isDeflateQpl() const { return false; }
+
+    virtual UInt32 getMaxCompressedDataSize(UInt32 uncompressed_size) const { return uncompressed_size; }
+    virtual UInt32 doCompressData(const char * source, UInt32 source_size, char * dest) const = 0;
+    virtual void doDecompressData(const char * source, UInt32 source_size, char * dest, UInt32 uncompressed_size) const = 0;
+
+    CodecMode getDecompressMode() const { return decompress_mode; }
+    void setCodecDescription(const std::string & /*name*/) {}
+
+private:
+    CodecMode decompress_mode = CodecMode::Synchronous;
+    IAST codec_desc;
+};
+
+}
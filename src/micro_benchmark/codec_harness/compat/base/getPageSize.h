@@ -0,0 +1,8 @@
+#pragma once
+
+#include <unistd.h>
+
+inline long getPageSize()
+{
+    return sysconf(_SC_PAGESIZE);
+}
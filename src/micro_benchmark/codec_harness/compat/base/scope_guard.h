@@ -0,0 +1,18 @@
+#pragma once
+
+#include <utility>
+
+template <typename F>
+class BasicScopeGuard
+{
+public:
+    explicit BasicScopeGuard(F && function_) : function(std::move(function_)) {}
+    ~BasicScopeGuard() { function(); }
+
+private:
+    F function;
+};
+
+#define SCOPE_EXIT_CONCAT_IMPL(a, b) a##b
+#define SCOPE_EXIT_CONCAT(a, b) SCOPE_EXIT_CONCAT_IMPL(a, b)
+#define SCOPE_EXIT(...) BasicScopeGuard SCOPE_EXIT_CONCAT(scope_exit_, __LINE__)([&] { __VA_ARGS__; })
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstring>
+
+template <typename T>
+inline T unalignedLoad(const void * address)
+{
+    T res;
+    std::memcpy(&res, address, sizeof(res));
+    return res;
+}
+
+template <typename T>
+inline void unalignedStore(void * address, const T & src)
+{
+    std::memcpy(address, &src, sizeof(src));
+}
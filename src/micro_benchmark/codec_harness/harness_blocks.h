@@ -0,0 +1,33 @@
+#pragma once
+
+// Blocks and timing shared by the codec harness and the benchmarks built on it (../priority_pool, ../dictionary_codec)
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// A slice of the input file and its compressed form
+struct block {
+    const char *source;
+    uint32_t size;
+    std::vector<char> compressed;
+    uint32_t compressed_size = 0;
+};
+
+inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+// `count` blocks of `size` bytes at random offsets of `data`, the same ones for the same seed
+inline std::vector<block> cut_blocks(const std::vector<char>& data, uint32_t size, uint32_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<block> blocks;
+    for (uint32_t i = 0; i < count; i++) {
+        const std::size_t offset = std::uniform_int_distribution<std::size_t>(0, data.size() - size)(rng);
+        blocks.push_back({data.data() + offset, size, {}, 0});
+    }
+    return blocks;
+}
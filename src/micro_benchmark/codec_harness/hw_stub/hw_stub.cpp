@@ -0,0 +1,293 @@
+/**
+ * @brief Simulated IAA devices for running the DEFLATE_QPL codec on CPU-only machines.
+ *
+ * The libaccel-config calls report HW_STUB_DEVICES devices (default 1) spread over HW_STUB_NUMA_NODES nodes (default 1,
+ * 0 reports no NUMA node), each with one work queue of HW_STUB_WQ_SIZE entries (default 128).
+ * The QPL calls of the codec are wrapped (-Wl,--wrap): a job initialized for qpl_path_hardware becomes a software job
+ * that qpl_submit_job queues to HW_STUB_ENGINES engine threads per device (default 8). qpl_check_job and qpl_wait_job
+ * report it as being processed until an engine has run it, so the pool, the asynchronous paths and the waiting behave
+ * as with a device. Like the device, a transfer over 2 MiB fails. HW_STUB_FAIL_EVERY=N fails every Nth job to exercise
+ * the software fallback.
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "qpl/qpl.h"
+#include "libaccel_config.h"
+
+extern "C" {
+qpl_status __real_qpl_get_job_size(qpl_path_t path, uint32_t * job_size);
+qpl_status __real_qpl_init_job(qpl_path_t path, qpl_job * job);
+qpl_status __real_qpl_submit_job(qpl_job * job);
+qpl_status __real_qpl_check_job(qpl_job * job);
+qpl_status __real_qpl_wait_job(qpl_job * job);
+qpl_status __real_qpl_fini_job(qpl_job * job);
+}
+
+namespace
+{
+
+const uint32_t max_transfer_size = 2 * 1024 * 1024;
+
+uint32_t env_or(const char * name, uint32_t default_value)
+{
+    const char * value = std::getenv(name);
+    return value ? static_cast<uint32_t>(std::strtoul(value, nullptr, 10)) : default_value;
+}
+
+class stub_device
+{
+public:
+    static stub_device & instance()
+    {
+        static stub_device device;
+        return device;
+    }
+
+    stub_device()
+        : devices_(env_or("HW_STUB_DEVICES", 1))
+        , numa_nodes_(env_or("HW_STUB_NUMA_NODES", 1))
+        , wq_size_(env_or("HW_STUB_WQ_SIZE", 128))
+        , fail_every_(env_or("HW_STUB_FAIL_EVERY", 0))
+    {
+        const uint32_t engines = devices_ * env_or("HW_STUB_ENGINES", 8);
+        for (uint32_t e = 0; e < engines; e++) {
+            engines_.emplace_back([this] { run_engine(); });
+        }
+    }
+
+    ~stub_device()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        queued_.notify_all();
+        for (auto & engine : engines_) {
+            engine.join();
+        }
+    }
+
+    uint32_t devices() const { return devices_; }
+    uint32_t numa_nodes() const { return numa_nodes_; }
+    uint32_t wq_size() const { return wq_size_; }
+
+    void track(qpl_job * job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_[job] = QPL_STS_OK;
+    }
+
+    void untrack(qpl_job * job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.erase(job);
+    }
+
+    bool tracked(qpl_job * job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return jobs_.count(job) != 0;
+    }
+
+    qpl_status submit(qpl_job * job)
+    {
+        // The device rejects descriptors over its maximum transfer size
+        if (job->available_in > max_transfer_size || job->available_out > max_transfer_size) {
+            return QPL_STS_LIBRARY_INTERNAL_ERR;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_[job] = QPL_STS_BEING_PROCESSED;
+        queue_.push_back(job);
+        queued_.notify_one();
+        return QPL_STS_OK;
+    }
+
+    qpl_status check(qpl_job * job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return jobs_[job];
+    }
+
+    qpl_status wait(qpl_job * job)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [&] { return jobs_[job] != QPL_STS_BEING_PROCESSED; });
+        return jobs_[job];
+    }
+
+private:
+    void run_engine()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            queued_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            qpl_job * job = queue_.front();
+            queue_.pop_front();
+            const bool inject_failure = fail_every_ != 0 && ++executed_ % fail_every_ == 0;
+            lock.unlock();
+
+            // A software job finishes within qpl_submit_job
+            qpl_status status = inject_failure ? QPL_STS_LIBRARY_INTERNAL_ERR : __real_qpl_submit_job(job);
+
+            lock.lock();
+            jobs_[job] = status;
+            finished_.notify_all();
+        }
+    }
+
+    const uint32_t devices_;
+    const uint32_t numa_nodes_;
+    const uint32_t wq_size_;
+    const uint32_t fail_every_;
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable finished_;
+    std::deque<qpl_job *> queue_;
+    std::unordered_map<qpl_job *, qpl_status> jobs_;
+    std::vector<std::thread> engines_;
+    uint64_t executed_ = 0;
+    bool stopping_ = false;
+};
+
+}
+
+struct accfg_ctx {
+    int unused;
+};
+
+struct accfg_device {
+    uint32_t id;
+    char name[16];
+};
+
+struct accfg_wq {
+    uint32_t device_id;
+};
+
+static std::vector<accfg_device> & stub_devices()
+{
+    static std::vector<accfg_device> devices = [] {
+        std::vector<accfg_device> result(stub_device::instance().devices());
+        for (uint32_t d = 0; d < result.size(); d++) {
+            result[d].id = d;
+            std::snprintf(result[d].name, sizeof(result[d].name), "iax%u", 2 * d + 1);
+        }
+        return result;
+    }();
+    return devices;
+}
+
+static std::vector<accfg_wq> & stub_wqs()
+{
+    static std::vector<accfg_wq> wqs = [] {
+        std::vector<accfg_wq> result(stub_device::instance().devices());
+        for (uint32_t d = 0; d < result.size(); d++) {
+            result[d].device_id = d;
+        }
+        return result;
+    }();
+    return wqs;
+}
+
+extern "C" {
+
+int accfg_new(struct accfg_ctx ** ctx)
+{
+    static accfg_ctx context {};
+    *ctx = &context;
+    return 0;
+}
+
+struct accfg_ctx * accfg_unref(struct accfg_ctx * /*ctx*/)
+{
+    return nullptr;
+}
+
+struct accfg_device * accfg_device_get_first(struct accfg_ctx * /*ctx*/)
+{
+    return stub_devices().empty() ? nullptr : &stub_devices().front();
+}
+
+struct accfg_device * accfg_device_get_next(struct accfg_device * device)
+{
+    return device->id + 1 < stub_devices().size() ? &stub_devices()[device->id + 1] : nullptr;
+}
+
+const char * accfg_device_get_devname(struct accfg_device * device)
+{
+    return device->name;
+}
+
+int accfg_device_get_numa_node(struct accfg_device * device)
+{
+    const uint32_t nodes = stub_device::instance().numa_nodes();
+    return nodes == 0 ? -1 : static_cast<int>(device->id % nodes);
+}
+
+struct accfg_wq * accfg_wq_get_first(struct accfg_device * device)
+{
+    return &stub_wqs()[device->id];
+}
+
+struct accfg_wq * accfg_wq_get_next(struct accfg_wq * /*wq*/)
+{
+    return nullptr;
+}
+
+int accfg_wq_get_size(struct accfg_wq * /*wq*/)
+{
+    return static_cast<int>(stub_device::instance().wq_size());
+}
+
+qpl_status __wrap_qpl_get_job_size(qpl_path_t path, uint32_t * job_size)
+{
+    return __real_qpl_get_job_size(path == qpl_path_hardware ? qpl_path_software : path, job_size);
+}
+
+qpl_status __wrap_qpl_init_job(qpl_path_t path, qpl_job * job)
+{
+    if (path != qpl_path_hardware) {
+        return __real_qpl_init_job(path, job);
+    }
+    qpl_status status = __real_qpl_init_job(qpl_path_software, job);
+    if (status == QPL_STS_OK) {
+        stub_device::instance().track(job);
+    }
+    return status;
+}
+
+qpl_status __wrap_qpl_submit_job(qpl_job * job)
+{
+    return stub_device::instance().tracked(job) ? stub_device::instance().submit(job) : __real_qpl_submit_job(job);
+}
+
+qpl_status __wrap_qpl_check_job(qpl_job * job)
+{
+    return stub_device::instance().tracked(job) ? stub_device::instance().check(job) : __real_qpl_check_job(job);
+}
+
+qpl_status __wrap_qpl_wait_job(qpl_job * job)
+{
+    return stub_device::instance().tracked(job) ? stub_device::instance().wait(job) : __real_qpl_wait_job(job);
+}
+
+qpl_status __wrap_qpl_fini_job(qpl_job * job)
+{
+    stub_device::instance().untrack(job);
+    return __real_qpl_fini_job(job);
+}
+
+}
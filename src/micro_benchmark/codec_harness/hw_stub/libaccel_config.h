@@ -0,0 +1,25 @@
+#pragma once
+
+/// The libaccel-config calls of the DEFLATE_QPL codec, implemented by hw_stub.cpp with simulated IAA devices
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct accfg_ctx;
+struct accfg_device;
+struct accfg_wq;
+
+int accfg_new(struct accfg_ctx ** ctx);
+struct accfg_ctx * accfg_unref(struct accfg_ctx * ctx);
+struct accfg_device * accfg_device_get_first(struct accfg_ctx * ctx);
+struct accfg_device * accfg_device_get_next(struct accfg_device * device);
+const char * accfg_device_get_devname(struct accfg_device * device);
+int accfg_device_get_numa_node(struct accfg_device * device);
+struct accfg_wq * accfg_wq_get_first(struct accfg_device * device);
+struct accfg_wq * accfg_wq_get_next(struct accfg_wq * wq);
+int accfg_wq_get_size(struct accfg_wq * wq);
+
+#ifdef __cplusplus
+}
+#endif
@@ -34,6 +34,23 @@ std::size_t chunk_size = 2097152;
 // const std::size_t chunk_size = 1048576;
 // const std::size_t chunk_size = 524288;
 
+/**
+ * NOTE : Huffman strategies (optional fifth argument).
+ * `dynamic` gathers deflate statistics and builds a new table for every chunk, `fixed` uses the fixed DEFLATE codes,
+ * `canned` builds one table from huffman_sample_slices evenly spaced slices of the file and reuses it for every chunk.
+ * `compare` runs all three and reports ratio vs throughput. Table building is timed separately from the jobs.
+ */
+const std::size_t huffman_sample_slices = 16;
+const std::size_t huffman_sample_bytes = 65536;
+
+struct huffman_report {
+    std::string strategy;
+    std::size_t input_size = 0;
+    std::size_t output_size = 0;
+    double table_time_sec = 0;
+    double job_time_sec = 0;
+};
+
 int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
     // Get path from input argument
     if (extra_arg == 0) {
@@ -71,7 +88,48 @@ void job_execution(qpl_job *job_ptr)
     }
 }
 
-int iaa_compression(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size)
+// Deflate token histogram of evenly spaced slices of the data. Every symbol keeps a count of at least one so that the
+// table built from it can encode chunks containing symbols the sample missed.
+int sample_histogram(std::vector<uint8_t>& data, qpl_path_t execution_path, qpl_histogram& histogram)
+{
+    histogram = qpl_histogram {};
+    const std::size_t slice_bytes = std::min(huffman_sample_bytes, data.size());
+    const std::size_t slices = data.size() > huffman_sample_slices * huffman_sample_bytes ? huffman_sample_slices : (data.size() + huffman_sample_bytes - 1) / huffman_sample_bytes;
+    for (std::size_t s = 0; s < slices; s++) {
+        std::size_t offset = std::min(s * (data.size() / slices), data.size() - slice_bytes);
+        qpl_histogram slice_histogram {};
+        qpl_status status = qpl_gather_deflate_statistics(data.data() + offset, static_cast<uint32_t>(slice_bytes), &slice_histogram, qpl_default_level, execution_path);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+            return 1;
+        }
+        for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += slice_histogram.literal_lengths[k]; }
+        for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += slice_histogram.distances[k]; }
+    }
+    for (std::size_t k = 0; k < sizeof(histogram.literal_lengths) / sizeof(uint32_t); k++) { histogram.literal_lengths[k] += 1; }
+    for (std::size_t k = 0; k < sizeof(histogram.distances) / sizeof(uint32_t); k++) { histogram.distances[k] += 1; }
+    return 0;
+}
+
+int build_huffman_table(const qpl_histogram& histogram, qpl_path_t execution_path, qpl_huffman_table_t& table)
+{
+    qpl_status status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C, &table);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table creation.\n";
+        return 1;
+    }
+    status = qpl_huffman_table_init_with_histogram(table, &histogram);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
+        qpl_huffman_table_destroy(table);
+        table = nullptr;
+        return 1;
+    }
+    return 0;
+}
+
+int iaa_compression(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size,
+                    const std::string& huffman_strategy = "dynamic", huffman_report* report = nullptr)
 {
     // Source and output containers
     std::vector<uint8_t> whole_src_vector;
@@ -158,6 +216,24 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
         dest_array[i] = new uint8_t[chunk_size]();
     }
 
+    // Canned strategy: one table sampled from the whole file
+    std::chrono::duration<int64_t, std::nano> table_time_ns = std::chrono::nanoseconds::zero();
+    qpl_huffman_table_t canned_table = nullptr;
+    if (huffman_strategy == "canned") {
+        auto start = std::chrono::steady_clock::now();
+        qpl_histogram histogram {};
+        if (sample_histogram(whole_src_vector, execution_path, histogram) != 0 ||
+            build_huffman_table(histogram, execution_path, canned_table) != 0) {
+            return 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        table_time_ns += end - start;
+    } else if (huffman_strategy != "dynamic" && huffman_strategy != "fixed") {
+        std::cout << "Unrecognized Huffman strategy " << huffman_strategy << ". Use dynamic, fixed, canned or compare." << std::endl;
+        return 1;
+    }
+    std::vector<qpl_huffman_table_t> round_tables;
+
     // Compression
     auto whole_start = std::chrono::steady_clock::now();
     while(src_file_left > 0) {
@@ -172,30 +248,23 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
             src_vector[i].resize(vector_size);
             // dest_vector[i].resize(vector_size);
 
-            // Allocate Huffman table object (c_huffman_table).
-            qpl_huffman_table_t c_huffman_table = nullptr;
-
-            status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C,
-                                                    &c_huffman_table);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during Huffman table creation.\n";
-                return 1;
-            }
-
-            // Initialize Huffman table using deflate tokens histogram.
-            qpl_histogram histogram {};
-            status = qpl_gather_deflate_statistics(whole_src_vector.data() + current_idx, vector_size, &histogram, qpl_default_level, execution_path);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
-                qpl_huffman_table_destroy(c_huffman_table);
-                return 1;
-            }
-
-            status = qpl_huffman_table_init_with_histogram(c_huffman_table, &histogram);
-            if (status != QPL_STS_OK) {
-                std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
-                qpl_huffman_table_destroy(c_huffman_table);
-                return 1;
+            // Huffman table: the canned table, a new one per chunk (dynamic) or none (fixed codes)
+            qpl_huffman_table_t c_huffman_table = canned_table;
+            if (huffman_strategy == "dynamic") {
+                auto start = std::chrono::steady_clock::now();
+                // Initialize Huffman table using deflate tokens histogram.
+                qpl_histogram histogram {};
+                status = qpl_gather_deflate_statistics(whole_src_vector.data() + current_idx, vector_size, &histogram, qpl_default_level, execution_path);
+                if (status != QPL_STS_OK) {
+                    std::cout << "An error " << status << " acquired during gathering statistics for Huffman table.\n";
+                    return 1;
+                }
+                if (build_huffman_table(histogram, execution_path, c_huffman_table) != 0) {
+                    return 1;
+                }
+                round_tables.push_back(c_huffman_table);
+                auto end = std::chrono::steady_clock::now();
+                table_time_ns += end - start;
             }
 
             // Loading data from source file to source vector
@@ -249,7 +318,11 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
             auto end = std::chrono::steady_clock::now();
             elapsed_time_ns += end - start;
         }
-        
+
+        // Per-chunk tables are released once their round is done
+        for (auto table : round_tables) { qpl_huffman_table_destroy(table); }
+        round_tables.clear();
+
         auto start = std::chrono::steady_clock::now();
         for (int i = 0; i < enqueue_cnt; ++i) {
             // std::cout << std::endl <<  job[i]->total_out << std::endl;
@@ -282,7 +355,9 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
 
     // Closing source file
     src_file.close();
-    
+    if (canned_table != nullptr) {
+        qpl_huffman_table_destroy(canned_table);
+    }
 
     // Freeing resources
     for (int i = 0; i < queue_size; ++i) {
@@ -305,6 +380,17 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
     elapsed_time_sec = static_cast<double>(elapsed_time_ns.count()) / 1000 / 1000 / 1000;
     // std::cout << "Elapsed Time = " << elapsed_time_ns.count() << " ns (" << elapsed_time_sec << " s)" << std::endl;
     std::cout << "Bandwidth        = " << static_cast<double>(src_file_size) / 1024 / 1024 / elapsed_time_sec << " MB/s" << std::endl;
+    double table_time_sec = static_cast<double>(table_time_ns.count()) / 1000 / 1000 / 1000;
+    std::cout << "Huffman          = " << huffman_strategy << ", table time " << table_time_sec << " s" << std::endl;
+    std::cout << "Bandwidth (incl. table) = " << static_cast<double>(src_file_size) / 1024 / 1024 / (elapsed_time_sec + table_time_sec) << " MB/s" << std::endl;
+
+    if (report != nullptr) {
+        report->strategy = huffman_strategy;
+        report->input_size = src_file_size;
+        report->output_size = compressed_size;
+        report->table_time_sec = table_time_sec;
+        report->job_time_sec = elapsed_time_sec;
+    }
 
     return 0;
 }
@@ -552,22 +638,49 @@ auto main(int argc, char** argv) -> int {
     uint32_t iteration = 0;
 
     chunk_size = static_cast<std::size_t>(atoi(argv[4]));
+    const std::size_t compression_chunk_size = chunk_size;
 
-    std::cout << std::endl;
-    // Compression
-    if(iaa_compression(SRC_DATA_FILE_PATH, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size) != 0) {
-        std::cout << "An error acquired during iaa_execution(compression)" << std::endl;
-        return 1;
+    // Optional Huffman strategy: dynamic (default), fixed, canned or compare
+    const std::string huffman_option = argc > 5 ? argv[5] : "dynamic";
+    std::vector<std::string> strategies = {huffman_option};
+    if (huffman_option == "compare") {
+        strategies = {"dynamic", "fixed", "canned"};
     }
 
-    std::cout << std::endl;
-    // Decompression
-    if(iaa_decompression(DEST_DATA_FILE_PATH, REF_DATA_FILE_PATH, execution_path, iteration, queue_size) != 0) {
-        std::cout << "An error acquired during iaa_execution(decompression)" << std::endl;
-        return 1;
+    std::vector<huffman_report> reports;
+    for (const auto& strategy : strategies) {
+        huffman_report report;
+        // iaa_decompression resets chunk_size to the 2MB output limit
+        chunk_size = compression_chunk_size;
+
+        std::cout << std::endl;
+        // Compression
+        if(iaa_compression(SRC_DATA_FILE_PATH, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size, strategy, &report) != 0) {
+            std::cout << "An error acquired during iaa_execution(compression)" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::endl;
+        // Decompression
+        if(iaa_decompression(DEST_DATA_FILE_PATH, REF_DATA_FILE_PATH, execution_path, iteration, queue_size) != 0) {
+            std::cout << "An error acquired during iaa_execution(decompression)" << std::endl;
+            return 1;
+        }
+        reports.push_back(report);
     }
 
     std::cout << std::endl;
+    if (reports.size() > 1) {
+        std::cout << "[Huffman strategies]" << std::endl;
+        std::cout << "strategy\tratio\ttable_s\tjob_s\tMB/s\tMB/s(incl. table)" << std::endl;
+        for (const auto& report : reports) {
+            const double input_mb = static_cast<double>(report.input_size) / 1024 / 1024;
+            std::cout << report.strategy << "\t" << static_cast<double>(report.output_size) / static_cast<double>(report.input_size)
+                      << "\t" << report.table_time_sec << "\t" << report.job_time_sec << "\t" << input_mb / report.job_time_sec
+                      << "\t" << input_mb / (report.job_time_sec + report.table_time_sec) << std::endl;
+        }
+        std::cout << std::endl;
+    }
 
     return 0;
 }
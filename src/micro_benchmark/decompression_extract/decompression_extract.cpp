@@ -8,6 +8,9 @@
 #include <string>
 #include <chrono>
 #include <thread>
+#include <random>
+#include <algorithm>
+#include <cstring>
 
 #include "qpl/qpl.h"
 
@@ -28,7 +31,8 @@
  * NOTE : Maximum transfer size per grouped_workqueues of IAA is 2097152(2MB)
  * If you want to put data larger than 2MB, you have to split the data into 2MB chunks.
  */
-std::size_t chunk_size = 2097152;
+constexpr const std::size_t max_chunk_size = 2097152;
+std::size_t chunk_size = max_chunk_size;
 // const std::size_t chunk_size = 1048576;
 // const std::size_t chunk_size = 524288;
 // const std::size_t chunk_size = 262144;
@@ -44,6 +48,23 @@ constexpr const uint32_t input_vector_width = 8;
 uint32_t lower_index        = 0;
 uint32_t upper_index        = chunk_size;
 
+/**
+ * NOTE : Random-range lookups (`lookup [rows] [count]`). The file is compressed with QPL indexing, one index entry per
+ * mini-block of index_mini_block_size bytes, and `count` random ranges of `rows` elements are read twice: once by
+ * decompressing the whole chunk, once by decompressing only the block header and the mini-blocks covering the range.
+ * Index entries hold the bit offset of the block header, of every mini-block and of the end of block in their low
+ * 32 bits (the CRC of the preceding data is in the high 32 bits).
+ */
+constexpr const uint32_t index_mini_block_size = 4096;
+constexpr const qpl_mini_block_size index_mini_block = qpl_mblk_size_4k;
+constexpr const uint64_t index_bit_offset_mask = 0xffffffffu;
+
+struct indexed_chunk {
+    std::vector<uint8_t>  compressed;
+    std::vector<uint64_t> index;
+    uint32_t              bytes = 0;
+};
+
 int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
     // Get path from input argument
     if (extra_arg == 0) {
@@ -312,6 +333,246 @@ int iaa_compression(std::string src_data_file_path, std::string dest_data_file_p
     return 0;
 }
 
+int iaa_indexed_compression(std::string src_data_file_path, qpl_path_t execution_path, std::vector<uint8_t>& whole_src_vector, std::vector<indexed_chunk>& chunks)
+{
+    std::cout << "[IAA Indexed Compression]" << std::endl;
+    std::ifstream src_file(src_data_file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << src_data_file_path << std::endl;
+        return 1;
+    }
+    src_file.seekg(0, std::ios::end);
+    whole_src_vector.resize(static_cast<std::size_t>(src_file.tellg()));
+    src_file.seekg(0, std::ios::beg);
+    src_file.read(reinterpret_cast<char *>(whole_src_vector.data()), whole_src_vector.size());
+    src_file.close();
+
+    uint32_t size = 0;
+    qpl_status status = qpl_get_job_size(execution_path, &size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    status = qpl_init_job(execution_path, job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+        return 1;
+    }
+
+    std::size_t compressed_size = 0;
+    for (std::size_t offset = 0; offset < whole_src_vector.size(); offset += chunk_size) {
+        indexed_chunk chunk;
+        chunk.bytes = static_cast<uint32_t>(std::min(chunk_size, whole_src_vector.size() - offset));
+        chunk.compressed.resize(chunk.bytes);
+        // One entry per mini-block, plus the block header and the end of block
+        chunk.index.resize(chunk.bytes / index_mini_block_size + 8);
+
+        qpl_huffman_table_t c_huffman_table = nullptr;
+        status = qpl_deflate_huffman_table_create(compression_table_type, execution_path, DEFAULT_ALLOCATOR_C, &c_huffman_table);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during Huffman table creation.\n";
+            return 1;
+        }
+        qpl_histogram histogram {};
+        status = qpl_gather_deflate_statistics(whole_src_vector.data() + offset, chunk.bytes, &histogram, qpl_default_level, execution_path);
+        if (status == QPL_STS_OK) {
+            status = qpl_huffman_table_init_with_histogram(c_huffman_table, &histogram);
+        }
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during Huffman table initialization.\n";
+            qpl_huffman_table_destroy(c_huffman_table);
+            return 1;
+        }
+
+        job->op              = qpl_op_compress;
+        job->level           = qpl_default_level;
+        job->next_in_ptr     = whole_src_vector.data() + offset;
+        job->next_out_ptr    = chunk.compressed.data();
+        job->available_in    = chunk.bytes;
+        job->available_out   = chunk.bytes;
+        job->flags           = QPL_FLAG_FIRST | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+        job->huffman_table   = c_huffman_table;
+        job->mini_block_size = index_mini_block;
+        job->idx_array       = chunk.index.data();
+        job->idx_max_size    = static_cast<uint32_t>(chunk.index.size());
+        status = qpl_execute_job(job);
+        qpl_huffman_table_destroy(c_huffman_table);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job execution." << std::endl;
+            return 1;
+        }
+        chunk.compressed.resize(job->total_out);
+        chunk.index.resize(job->idx_num_written);
+        compressed_size += job->total_out;
+        chunks.push_back(std::move(chunk));
+    }
+
+    status = qpl_fini_job(job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+        return 1;
+    }
+    std::cout << "Chunks           = " << chunks.size() << " (" << index_mini_block_size << " bytes per mini-block)" << std::endl;
+    std::cout << "Ratio            = " << static_cast<double>(compressed_size) / static_cast<double>(whole_src_vector.size()) << std::endl;
+    return 0;
+}
+
+// Decompresses bytes [begin, end) of an indexed chunk: the block header first, then only the mini-blocks covering the
+// range. out receives whole mini-blocks; the requested bytes start at out_offset.
+int indexed_decompress_range(qpl_job *job, indexed_chunk& chunk, uint32_t begin, uint32_t end, std::vector<uint8_t>& out, uint32_t& out_offset)
+{
+    const uint32_t first = begin / index_mini_block_size;
+    const uint32_t last = (end - 1) / index_mini_block_size;
+    const uint64_t header_bit = chunk.index[0] & index_bit_offset_mask;
+    const uint64_t header_end_bit = chunk.index[1] & index_bit_offset_mask;
+    const uint64_t start_bit = chunk.index[1 + first] & index_bit_offset_mask;
+    const uint64_t end_bit = chunk.index[2 + last] & index_bit_offset_mask;
+
+    // Block header alone, up to the first mini-block; loads the Huffman tables into the job
+    job->op                = qpl_op_decompress;
+    job->next_in_ptr       = chunk.compressed.data() + header_bit / 8;
+    job->available_in      = static_cast<uint32_t>((header_end_bit + 7) / 8 - header_bit / 8);
+    job->ignore_start_bits = static_cast<uint32_t>(header_bit & 7);
+    job->ignore_end_bits   = static_cast<uint32_t>((8 - (header_end_bit & 7)) & 7);
+    job->next_out_ptr      = out.data();
+    job->available_out     = static_cast<uint32_t>(out.size());
+    job->flags             = QPL_FLAG_FIRST | QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+    qpl_status status = qpl_execute_job(job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during block header decompression." << std::endl;
+        return 1;
+    }
+
+    // Mini-blocks first..last
+    job->next_in_ptr       = chunk.compressed.data() + start_bit / 8;
+    job->available_in      = static_cast<uint32_t>((end_bit + 7) / 8 - start_bit / 8);
+    job->ignore_start_bits = static_cast<uint32_t>(start_bit & 7);
+    job->ignore_end_bits   = static_cast<uint32_t>((8 - (end_bit & 7)) & 7);
+    job->next_out_ptr      = out.data();
+    job->available_out     = static_cast<uint32_t>(out.size());
+    job->flags             = QPL_FLAG_NO_BUFFERING | QPL_FLAG_RND_ACCESS;
+    status = qpl_execute_job(job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during mini-block decompression." << std::endl;
+        return 1;
+    }
+    if (job->total_out < end - first * index_mini_block_size) {
+        std::cout << "Mini-block decompression returned " << job->total_out << " bytes, expected " << end - first * index_mini_block_size << std::endl;
+        return 1;
+    }
+    out_offset = begin - first * index_mini_block_size;
+    return 0;
+}
+
+void print_latency(const std::string& name, std::vector<double>& latency_us, double bytes_per_lookup)
+{
+    std::sort(latency_us.begin(), latency_us.end());
+    double sum = 0;
+    for (auto value : latency_us) { sum += value; }
+    std::cout << name << " : avg " << sum / latency_us.size() << " us, p50 " << latency_us[latency_us.size() / 2]
+              << " us, p99 " << latency_us[std::min(latency_us.size() - 1, latency_us.size() * 99 / 100)] << " us, "
+              << bytes_per_lookup << " bytes decompressed per lookup" << std::endl;
+}
+
+int iaa_random_lookup(std::string src_data_file_path, qpl_path_t execution_path, uint32_t lookup_rows, uint32_t lookup_count)
+{
+    std::vector<uint8_t> whole_src_vector;
+    std::vector<indexed_chunk> chunks;
+    if (iaa_indexed_compression(src_data_file_path, execution_path, whole_src_vector, chunks) != 0) {
+        return 1;
+    }
+    const uint32_t lookup_bytes = lookup_rows * (input_vector_width / 8);
+    if (chunks.empty() || lookup_bytes == 0 || lookup_bytes > chunks.back().bytes) {
+        std::cout << "The lookup range of " << lookup_rows << " rows does not fit in the last chunk." << std::endl;
+        return 1;
+    }
+
+    uint32_t size = 0;
+    qpl_status status = qpl_get_job_size(execution_path, &size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    status = qpl_init_job(execution_path, job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+        return 1;
+    }
+
+    // Same random ranges for both methods
+    std::mt19937 generator(42);
+    std::vector<std::pair<uint32_t, uint32_t>> lookups(lookup_count);
+    for (auto& lookup : lookups) {
+        lookup.first = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(chunks.size() - 1))(generator);
+        uint32_t max_begin = (chunks[lookup.first].bytes - lookup_bytes) / (input_vector_width / 8);
+        lookup.second = std::uniform_int_distribution<uint32_t>(0, max_begin)(generator) * (input_vector_width / 8);
+    }
+
+    std::cout << "[IAA Random Lookup] " << lookup_count << " lookups of " << lookup_rows << " rows" << std::endl;
+    std::vector<uint8_t> out(chunk_size);
+    std::vector<double> full_latency_us;
+    std::vector<double> indexed_latency_us;
+    double full_bytes = 0;
+    double indexed_bytes = 0;
+    bool verified = true;
+
+    // Full-chunk decompression
+    for (const auto& lookup : lookups) {
+        indexed_chunk& chunk = chunks[lookup.first];
+        auto start = std::chrono::steady_clock::now();
+        job->op                = qpl_op_decompress;
+        job->next_in_ptr       = chunk.compressed.data();
+        job->available_in      = static_cast<uint32_t>(chunk.compressed.size());
+        job->next_out_ptr      = out.data();
+        job->available_out     = static_cast<uint32_t>(out.size());
+        job->ignore_start_bits = 0;
+        job->ignore_end_bits   = 0;
+        job->flags             = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        status = qpl_execute_job(job);
+        auto end = std::chrono::steady_clock::now();
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during job execution." << std::endl;
+            return 1;
+        }
+        full_latency_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        full_bytes += job->total_out;
+        verified = verified && std::memcmp(out.data() + lookup.second, whole_src_vector.data() + lookup.first * chunk_size + lookup.second, lookup_bytes) == 0;
+    }
+
+    // Mini-block decompression
+    for (const auto& lookup : lookups) {
+        indexed_chunk& chunk = chunks[lookup.first];
+        uint32_t out_offset = 0;
+        auto start = std::chrono::steady_clock::now();
+        if (indexed_decompress_range(job, chunk, lookup.second, lookup.second + lookup_bytes, out, out_offset) != 0) {
+            return 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        indexed_latency_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        indexed_bytes += job->total_out;
+        verified = verified && std::memcmp(out.data() + out_offset, whole_src_vector.data() + lookup.first * chunk_size + lookup.second, lookup_bytes) == 0;
+    }
+
+    status = qpl_fini_job(job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job finalization." << std::endl;
+        return 1;
+    }
+
+    print_latency("Full chunk", full_latency_us, full_bytes / lookup_count);
+    print_latency("Mini-blocks", indexed_latency_us, indexed_bytes / lookup_count);
+    double full_sum = 0, indexed_sum = 0;
+    for (auto value : full_latency_us) { full_sum += value; }
+    for (auto value : indexed_latency_us) { indexed_sum += value; }
+    std::cout << "Speed up: " << full_sum / indexed_sum << std::endl;
+    std::cout << "Verification: " << (verified ? "PASS" : "FAIL") << std::endl;
+    return verified ? 0 : 1;
+}
+
 int iaa_chaining(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t iteration, const uint32_t queue_size, int* input_file_size, double* chaining_time)
 {
     std::vector<std::vector<uint8_t>> src_vector;
@@ -744,7 +1005,36 @@ auto main(int argc, char** argv) -> int {
 
     // File path
     int parse_ret = parse_execution_path(argc, argv, &execution_path, 1);
-    if (parse_ret != 0 || execution_path == qpl_path_software) {
+    if (parse_ret != 0) {
+        return 1;
+    }
+
+    // A chunk of 0 bytes would never advance the chunk loops, and a chunk over 2MB exceeds the IAA transfer size
+    const long chunk_size_arg = argc > 4 ? atol(argv[4]) : 0;
+    if (chunk_size_arg <= 0 || static_cast<std::size_t>(chunk_size_arg) > max_chunk_size) {
+        std::cout << "Usage: decompression_extract <hardware_path|software_path> <file> <queue_size> <chunk_size> [lookup [rows] [count]]" << std::endl;
+        std::cout << "The chunk size must be between 1 and " << max_chunk_size << " bytes." << std::endl;
+        return 1;
+    }
+    chunk_size = static_cast<std::size_t>(chunk_size_arg);
+
+    // Random-range lookup benchmark: decompression_extract <path> <file> <queue_size> <chunk_size> lookup [rows] [count]
+    if (argc > 5 && std::string(argv[5]) == "lookup") {
+        const uint32_t lookup_rows = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 16;
+        const int lookup_count_arg = argc > 7 ? atoi(argv[7]) : 1000;
+        if (lookup_count_arg <= 0) {
+            std::cout << "The lookup count must be at least 1." << std::endl;
+            return 1;
+        }
+        const uint32_t lookup_count = static_cast<uint32_t>(lookup_count_arg);
+        if (iaa_random_lookup(argv[2], execution_path, lookup_rows, lookup_count) != 0) {
+            std::cout << "An error acquired during iaa_execution(lookup)" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (execution_path == qpl_path_software) {
         std::cout << "Software path is not supporting functional pipeline" << std::endl;
         return 1;
     }
@@ -779,7 +1069,6 @@ auto main(int argc, char** argv) -> int {
     
     uint32_t iteration = 0;
 
-    chunk_size = static_cast<std::size_t>(atoi(argv[4]));
     upper_index = chunk_size;
 
     std::cout << "Queue Size = " << queue_size << std::endl;
@@ -0,0 +1,216 @@
+//* [QPL_LOW_LEVEL_DICTIONARY_CODEC_EXAMPLE] */
+
+#include <Compression/CompressionCodecDeflateQpl.h>
+#include "harness_blocks.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Compares the DEFLATE_QPL and DEFLATE_QPL_DICT codecs of ClickHouse (src/end_to_end/clickhouse) on small blocks,
+ * where a stream without history compresses worst. clickhouse.cpp is built as in ../codec_harness.
+ * For every block size the same random slices of the file are compressed and decompressed by
+ *   plain      : CompressionCodecDeflateQpl(), as DEFLATE_QPL
+ *   dictionary : CompressionCodecDeflateQpl(true), as DEFLATE_QPL_DICT. A warm-up pass over the blocks feeds its sample
+ *                until the dictionary is trained, so the measured pass only writes dictionary blocks
+ * It reports the compression ratio, the compression and decompression throughput and the share of the blocks that ran
+ * on the hardware instead of the software fallback, from the codec metrics.
+ * The trainer reads DEFLATE_QPL_DICTIONARY_SIZE and DEFLATE_QPL_DICTIONARY_SAMPLE_KB, set them to compare dictionaries.
+ * After each dictionary pass the registry is cleared, as on a server that never saw the dictionary (a replica, a restored
+ * backup or a restart), and a new codec must read every block back with the dictionary each block carries.
+ *
+ * Usage: dictionary_codec_test <file> [iterations] [block_kb,...]
+ * iterations defaults to 5, the block sizes to 4,16,64,256,1024 KiB.
+ *
+ * @warning ---! Important !---
+ * Without IAA devices build it with `./build.sh stub`; the dictionary jobs then run on the software path.
+ *
+ */
+
+namespace DB::ErrorCodes
+{
+    extern const int CANNOT_COMPRESS = 1;
+    extern const int CANNOT_DECOMPRESS = 2;
+}
+
+using DB::CompressionCodecDeflateQpl;
+using DB::DeflateQplDictionaryRegistry;
+using DB::DeflateQplMetrics;
+
+struct codec_result {
+    uint64_t source_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    uint64_t compress_ns = 0;
+    uint64_t decompress_ns = 0;
+    uint64_t hardware_jobs = 0;
+    uint64_t software_jobs = 0;
+    uint64_t dictionary_blocks = 0;
+};
+
+// Compresses and decompresses every block `iterations` times and checks the last round trip
+int run_codec(CompressionCodecDeflateQpl& codec, std::vector<block>& blocks, uint32_t iterations, codec_result& result)
+{
+    using Counter = DeflateQplMetrics::Counter;
+    const auto before = DeflateQplMetrics::instance().getSnapshot();
+    std::vector<char> output(blocks.front().size);
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        for (auto& b : blocks) {
+            b.compressed_size = codec.compress(b.source, b.size, b.compressed.data());
+        }
+        result.compress_ns += elapsed_ns(start, std::chrono::steady_clock::now());
+
+        start = std::chrono::steady_clock::now();
+        for (const auto& b : blocks) {
+            codec.decompress(b.compressed.data(), b.compressed_size, output.data());
+        }
+        result.decompress_ns += elapsed_ns(start, std::chrono::steady_clock::now());
+    }
+    for (const auto& b : blocks) {
+        codec.decompress(b.compressed.data(), b.compressed_size, output.data());
+        if (std::memcmp(output.data(), b.source, b.size) != 0) {
+            std::cout << "A block does not match its source after decompression." << std::endl;
+            return 1;
+        }
+        result.source_bytes += b.size;
+        result.compressed_bytes += b.compressed_size;
+    }
+    const auto after = DeflateQplMetrics::instance().getSnapshot();
+    auto delta = [&](Counter counter) { return after.get(counter) - before.get(counter); };
+    result.hardware_jobs = delta(Counter::HardwareCompressions) + delta(Counter::HardwareDecompressions);
+    result.software_jobs = delta(Counter::SoftwareCompressions) + delta(Counter::SoftwareDecompressions);
+    result.dictionary_blocks = delta(Counter::DictionaryCompressions);
+    return 0;
+}
+
+// Reads the blocks with a new codec after the registry forgot every dictionary, so the dictionary is built again from
+// the bytes the blocks carry
+int check_after_restart(const std::vector<block>& blocks)
+{
+    auto& registry = DeflateQplDictionaryRegistry::instance();
+    registry.clear();
+    const auto before = registry.getCounters();
+    CompressionCodecDeflateQpl reader;
+    std::vector<char> output(blocks.front().size);
+    for (const auto& b : blocks) {
+        reader.decompress(b.compressed.data(), b.compressed_size, output.data());
+        if (std::memcmp(output.data(), b.source, b.size) != 0) {
+            std::cout << "A dictionary block does not match its source after the registry was cleared." << std::endl;
+            return 1;
+        }
+    }
+    if (registry.getCounters().builds == before.builds) {
+        std::cout << "Reading the blocks after the registry was cleared did not build their dictionary." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void print_result(const char *name, uint32_t block_size, const codec_result& result, uint32_t iterations)
+{
+    const double bytes = static_cast<double>(result.source_bytes) * iterations;
+    const uint64_t jobs = result.hardware_jobs + result.software_jobs;
+    std::cout << name << ", " << block_size / 1024 << ", "
+              << static_cast<double>(result.source_bytes) / static_cast<double>(result.compressed_bytes) << ", "
+              << bytes / static_cast<double>(result.compress_ns) * 1000.0 << ", "
+              << bytes / static_cast<double>(result.decompress_ns) * 1000.0 << ", "
+              << (jobs == 0 ? std::string("-") : std::to_string(100.0 * static_cast<double>(result.hardware_jobs) / static_cast<double>(jobs)))
+              << ", " << result.dictionary_blocks << std::endl;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    if (argc < 2) {
+        std::cout << "Usage: dictionary_codec_test <file> [iterations] [block_kb,...]" << std::endl;
+        return 1;
+    }
+    const std::string file_path = argv[1];
+    const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 5;
+    std::vector<uint32_t> block_sizes;
+    std::string sizes = argc > 3 ? argv[3] : "4,16,64,256,1024";
+    for (std::size_t begin = 0; begin < sizes.size();) {
+        const std::size_t end = std::min(sizes.find(',', begin), sizes.size());
+        block_sizes.push_back(static_cast<uint32_t>(atoi(sizes.substr(begin, end - begin).c_str())) * 1024);
+        begin = end + 1;
+    }
+    if (iterations == 0 || block_sizes.empty() || std::find(block_sizes.begin(), block_sizes.end(), 0u) != block_sizes.end()) {
+        std::cout << "Iterations and block sizes must be at least 1." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    // Repeat a small file so that every block is a contiguous slice of it
+    const std::size_t file_size = data.size();
+    while (data.size() < 2 * static_cast<std::size_t>(*std::max_element(block_sizes.begin(), block_sizes.end()))) {
+        data.insert(data.end(), data.begin(), data.begin() + static_cast<std::ptrdiff_t>(file_size));
+    }
+
+    std::cout << "Source file = " << file_path << ", " << iterations << " iterations" << std::endl;
+    std::cout << "codec, block (KiB), ratio, compress MB/s, decompress MB/s, jobs on hardware (%), dictionary blocks" << std::endl;
+    try {
+        for (uint32_t block_size : block_sizes) {
+            // About 16 MiB per pass, at least 4 blocks
+            const uint32_t count = std::max<uint32_t>(4, static_cast<uint32_t>((16u << 20) / block_size));
+            std::vector<block> blocks = cut_blocks(data, block_size, count, block_size);
+
+            CompressionCodecDeflateQpl plain;
+            CompressionCodecDeflateQpl dictionary(/*train_dictionary=*/ true);
+            for (auto& b : blocks) {
+                b.compressed.resize(std::max(plain.getCompressedReserveSize(b.size), dictionary.getCompressedReserveSize(b.size)));
+            }
+
+            codec_result plain_result;
+            if (run_codec(plain, blocks, iterations, plain_result) != 0) {
+                return 1;
+            }
+            print_result("plain", block_size, plain_result, iterations);
+
+            for (std::size_t i = 0; !dictionary.getDictionaryId() && i < 64 * blocks.size(); i++) {
+                block& b = blocks[i % blocks.size()];
+                dictionary.compress(b.source, b.size, b.compressed.data());
+            }
+            if (!dictionary.getDictionaryId()) {
+                std::cout << "dictionary, " << block_size / 1024 << ": no dictionary was trained from the blocks" << std::endl;
+                continue;
+            }
+            codec_result dictionary_result;
+            if (run_codec(dictionary, blocks, iterations, dictionary_result) != 0) {
+                return 1;
+            }
+            print_result("dictionary", block_size, dictionary_result, iterations);
+            if (check_after_restart(blocks) != 0) {
+                return 1;
+            }
+        }
+        const auto registry = DeflateQplDictionaryRegistry::instance().getCounters();
+        std::cout << "Dictionary registry: " << registry.hits << " hits, " << registry.builds << " builds, " << registry.evictions
+                  << " evictions, " << registry.cached << " cached (" << registry.cached_bytes << " bytes)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_DICTIONARY_CODEC_EXAMPLE] */
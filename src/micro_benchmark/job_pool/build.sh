@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# Usage: ./build.sh [stub]
+# stub builds against the simulated IAA devices of ../codec_harness/hw_stub/ instead of libaccel-config
+
+# Get the Git root directory
+GIT_ROOT=$(git rev-parse --show-toplevel)
+
+# Define the QPL include and library paths relative to the Git root
+QPL_INCLUDE="$GIT_ROOT/qpl/include"
+QPL_LIB="$GIT_ROOT/qpl/build/lib/libqpl.a"
+
+# The ClickHouse DEFLATE_QPL codec, compiled against the shim headers of the codec harness, and its shared block helpers
+CODEC_SRC="$GIT_ROOT/src/end_to_end/clickhouse/clickhouse.cpp"
+HARNESS_DIR="$GIT_ROOT/src/micro_benchmark/codec_harness"
+
+if [ "$1" == "stub" ]; then
+    ACCEL_CONFIG_INCLUDE="$HARNESS_DIR/hw_stub"
+    ACCEL_CONFIG_LIB="$HARNESS_DIR/hw_stub/hw_stub.cpp -Wl,--wrap=qpl_get_job_size,--wrap=qpl_init_job,--wrap=qpl_submit_job,--wrap=qpl_check_job,--wrap=qpl_wait_job,--wrap=qpl_fini_job"
+else
+    ACCEL_CONFIG_INCLUDE="/usr/include/accel-config"
+    ACCEL_CONFIG_LIB="-laccel-config"
+fi
+
+# Compile the program using the dynamically determined paths
+g++ -std=c++20 -O2 -pthread -mwaitpkg -DUSE_QPL=1 -I"$HARNESS_DIR" -I"$HARNESS_DIR/compat" -I"$ACCEL_CONFIG_INCLUDE" -I"$QPL_INCLUDE" -o job_pool_test job_pool_test.cpp "$CODEC_SRC" $ACCEL_CONFIG_LIB "$QPL_LIB" -ldl
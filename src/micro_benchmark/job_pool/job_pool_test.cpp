@@ -0,0 +1,196 @@
+//* [QPL_LOW_LEVEL_JOB_POOL_EXAMPLE] */
+
+#include <Compression/CompressionCodecDeflateQpl.h>
+#include "harness_blocks.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Stress test of the hardware job pool of the ClickHouse DEFLATE_QPL codec (src/end_to_end/clickhouse).
+ * clickhouse.cpp is built as in ../codec_harness and its DeflateQplJobHWPool is driven directly.
+ * Many threads acquire a job, hold it for a fixed time (the job run) and release it, as concurrent decompressing
+ * queries do. An acquire that gets no job is a software fallback in the codec. Two runs over the same pool:
+ *   no_wait      : acquireJob(job_id, false), as asynchronous decompression does; an empty pool falls back at once.
+ *   bounded_wait : acquireJob(job_id, true), as compression and synchronous decompression do; an empty pool makes the
+ *                  caller queue for up to DEFLATE_QPL_ACQUIRE_WAIT_US before it falls back.
+ * Background threads, if any, run the same loop inside DeflateQplJobHWPool::PriorityScope(Priority::Background), like
+ * merges, and the report splits the acquires by priority class and NUMA node.
+ *
+ * Usage: job_pool_test [threads] [acquires_per_thread] [hold_ns] [background_threads]
+ * threads defaults to 64, acquires per thread to 10000, hold_ns to 2000, background_threads to 0.
+ * The pool size is the total work queue size of the devices (HW_STUB_WQ_SIZE x HW_STUB_DEVICES with the stub).
+ *
+ * @warning ---! Important !---
+ * Only the hardware path has a job pool. Without IAA devices build it with `./build.sh stub`.
+ *
+ */
+
+namespace DB::ErrorCodes
+{
+    extern const int CANNOT_COMPRESS = 1;
+    extern const int CANNOT_DECOMPRESS = 2;
+}
+
+using DB::DeflateQplJobHWPool;
+
+// Stands in for the job run (or its software fallback) between acquire and release
+void hold_for(uint32_t hold_ns)
+{
+    const auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(hold_ns);
+    while (std::chrono::steady_clock::now() < until) {}
+}
+
+struct thread_result {
+    std::vector<uint32_t> latencies_ns;
+    uint64_t fallbacks = 0;
+    uint64_t spurious_fallbacks = 0;   // foreground fallbacks while another job was free (sampled)
+};
+
+int run_stress(const char *name, bool wait, uint32_t max_jobs, uint32_t threads, uint32_t background_threads,
+               uint32_t acquires_per_thread, uint32_t hold_ns)
+{
+    auto& pool = DeflateQplJobHWPool::instance();
+    const auto counters_before = pool.getAcquireCounters();
+    const auto classes_before = pool.getClassUtilization();
+    const auto nodes_before = pool.getNodeUtilization();
+
+    std::vector<thread_result> results(threads + background_threads);
+    std::atomic<uint32_t> in_use {0};
+    std::vector<std::unique_ptr<std::atomic<uint32_t>>> owners;   // detects a job handed to two threads at once
+    for (uint32_t i = 0; i <= max_jobs; ++i) { owners.push_back(std::make_unique<std::atomic<uint32_t>>(0)); }
+    std::atomic<bool> start {false};
+    std::atomic<bool> double_acquire {false};
+
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads + background_threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::unique_ptr<DeflateQplJobHWPool::PriorityScope> scope;
+            if (t >= threads) {
+                scope = std::make_unique<DeflateQplJobHWPool::PriorityScope>(DeflateQplJobHWPool::Priority::Background);
+            }
+            thread_result& result = results[t];
+            result.latencies_ns.reserve(acquires_per_thread);
+            while (!start.load()) { std::this_thread::yield(); }
+            for (uint32_t n = 0; n < acquires_per_thread; ++n) {
+                UInt32 job_id = 0;
+                const auto acquire_start = std::chrono::steady_clock::now();
+                qpl_job *job_ptr = pool.acquireJob(job_id, wait);
+                result.latencies_ns.push_back(static_cast<uint32_t>(elapsed_ns(acquire_start, std::chrono::steady_clock::now())));
+                if (job_ptr == nullptr) {
+                    result.fallbacks++;
+                    // Background threads may hold only part of the jobs, so only foreground ones sample
+                    if (!scope && in_use.load() < max_jobs) { result.spurious_fallbacks++; }
+                    hold_for(hold_ns);
+                    continue;
+                }
+                if (job_id == 0 || job_id > max_jobs || owners[job_id]->exchange(t + 1) != 0) { double_acquire = true; }
+                in_use++;
+                hold_for(hold_ns);
+                in_use--;
+                if (job_id <= max_jobs) { owners[job_id]->store(0); }
+                pool.releaseJob(job_id);
+            }
+        });
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto& worker : workers) { worker.join(); }
+    const double elapsed_sec = static_cast<double>(elapsed_ns(begin, std::chrono::steady_clock::now())) / 1e9;
+
+    std::vector<uint32_t> all;
+    uint64_t total_fallbacks = 0;
+    uint64_t total_spurious = 0;
+    for (const auto& result : results) {
+        all.insert(all.end(), result.latencies_ns.begin(), result.latencies_ns.end());
+        total_fallbacks += result.fallbacks;
+        total_spurious += result.spurious_fallbacks;
+    }
+    std::sort(all.begin(), all.end());
+    double sum = 0;
+    for (uint32_t ns : all) { sum += ns; }
+
+    std::cout << name << " : acquire avg = " << sum / all.size() << " ns, p50 = " << all[all.size() / 2]
+              << " ns, p99 = " << all[all.size() * 99 / 100] << " ns, max = " << all.back() << " ns"
+              << ", fallback = " << 100.0 * total_fallbacks / all.size() << " % (" << total_spurious << " with a free job)"
+              << ", " << all.size() / elapsed_sec << " acquires/s" << std::endl;
+
+    const auto counters = pool.getAcquireCounters();
+    std::cout << name << " : immediate = " << counters.immediate - counters_before.immediate
+              << ", after wait = " << counters.after_wait - counters_before.after_wait
+              << ", budget expired = " << counters.budget_expired - counters_before.budget_expired
+              << ", queue full = " << counters.queue_full - counters_before.queue_full
+              << ", no wait = " << counters.no_wait - counters_before.no_wait
+              << ", total wait = " << counters.wait_us - counters_before.wait_us << " us" << std::endl;
+    const auto classes = pool.getClassUtilization();
+    for (std::size_t i = 0; i < classes.size(); ++i) {
+        std::cout << name << " : " << (classes[i].priority == DeflateQplJobHWPool::Priority::Foreground ? "foreground" : "background")
+                  << " class, limit = " << classes[i].limit << ", acquired = " << classes[i].acquired - classes_before[i].acquired
+                  << ", fallbacks = " << classes[i].fallbacks - classes_before[i].fallbacks << std::endl;
+    }
+    const auto nodes = pool.getNodeUtilization();
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::cout << name << " : node " << nodes[i].numa_node << " (" << nodes[i].devices << "), jobs = " << nodes[i].jobs
+                  << ", local = " << nodes[i].acquired_local - nodes_before[i].acquired_local
+                  << ", remote = " << nodes[i].acquired_remote - nodes_before[i].acquired_remote << std::endl;
+    }
+
+    if (double_acquire) {
+        std::cout << name << " handed one job to two threads at once." << std::endl;
+        return 1;
+    }
+    for (const auto& node : nodes) {
+        if (node.in_use != 0) {
+            std::cout << name << " left " << node.in_use << " jobs of node " << node.numa_node << " in use." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    const uint32_t threads = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 64;
+    const uint32_t acquires_per_thread = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 10000;
+    const uint32_t hold_ns = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 2000;
+    const uint32_t background_threads = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 0;
+    if (threads == 0 || acquires_per_thread == 0) {
+        std::cout << "Usage: job_pool_test [threads] [acquires_per_thread] [hold_ns] [background_threads]" << std::endl;
+        std::cout << "Threads and acquires per thread must be at least 1." << std::endl;
+        return 1;
+    }
+
+    auto& pool = DeflateQplJobHWPool::instance();
+    if (!pool.isJobPoolReady()) {
+        std::cout << "The hardware job pool is not ready, there is nothing to stress." << std::endl;
+        return 1;
+    }
+    uint32_t max_jobs = 0;
+    for (const auto& node : pool.getNodeUtilization()) { max_jobs += node.jobs; }
+
+    std::cout << "Jobs = " << max_jobs << ", threads = " << threads << " + " << background_threads << " background"
+              << ", acquires per thread = " << acquires_per_thread << ", hold = " << hold_ns << " ns" << std::endl;
+    if (!pool.arePriorityClassesEnabled()) {
+        std::cout << "Priority classes are disabled, every job counts as foreground" << std::endl;
+    }
+
+    if (run_stress("no_wait", false, max_jobs, threads, background_threads, acquires_per_thread, hold_ns) != 0) {
+        return 1;
+    }
+    if (run_stress("bounded_wait", true, max_jobs, threads, background_threads, acquires_per_thread, hold_ns) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_JOB_POOL_EXAMPLE] */
@@ -0,0 +1,300 @@
+//* [QPL_LOW_LEVEL_PREFAULT_BUFFER_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Compares how the output buffer of a decompression can be faulted in before IAA writes it, as the ClickHouse
+ * DEFLATE_QPL codec (src/end_to_end/clickhouse) does. A file is compressed in chunks, then every chunk is decompressed
+ * once per mode:
+ *   none     : a fresh buffer per call, not prefaulted; the device takes the faults
+ *   touch    : a fresh buffer per call, one byte written per page first, as touchBufferWithZeroFilling does
+ *   populate : a fresh buffer per call, mapped with MAP_POPULATE
+ *   pool     : buffers mapped with MAP_POPULATE once and reused, as DeflateQplBufferPool does
+ * Fresh buffers are mapped and unmapped per call, which is what the allocator does for blocks of this size.
+ * It reports the time to prepare the buffer, to decompress and to release it, the minor page faults per call and the
+ * output throughput.
+ *
+ * Usage: prefault_buffer_test <hardware_path|software_path> <file> [chunk_kb] [mode|all] [huge_pages]
+ * chunk_kb defaults to 1024, mode to all. huge_pages=1 maps the pooled buffers with MAP_HUGETLB when huge pages are
+ * reserved (/proc/sys/vm/nr_hugepages).
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * On the software path the CPU takes the faults, so only the hardware path shows the cost of IOTLB misses.
+ *
+ */
+
+const char *mode_names[] = {"none", "touch", "populate", "pool"};
+enum class prefault_mode { none, touch, populate, pool };
+const uint32_t pool_buffers = 8;
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 3) {
+            std::cout << "Usage: prefault_buffer_test <hardware_path|software_path> <file> [chunk_kb] [mode|all] [huge_pages]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+uint64_t minor_faults()
+{
+    rusage usage {};
+    getrusage(RUSAGE_THREAD, &usage);
+    return static_cast<uint64_t>(usage.ru_minflt);
+}
+
+uint8_t *map_buffer(size_t size, int extra_flags)
+{
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<uint8_t *>(ptr);
+}
+
+struct mode_result {
+    uint64_t calls = 0;
+    uint64_t prepare_ns = 0;
+    uint64_t decompress_ns = 0;
+    uint64_t release_ns = 0;
+    uint64_t faults = 0;
+    uint64_t bytes = 0;
+};
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+int decompress_chunks(qpl_job *job, prefault_mode mode, bool huge_pages, std::vector<std::vector<uint8_t>>& compressed,
+                      std::vector<uint32_t>& chunk_sizes, mode_result& result)
+{
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t huge_page_size = 2 * 1024 * 1024;
+    size_t buffer_size = *std::max_element(chunk_sizes.begin(), chunk_sizes.end());
+    buffer_size = (buffer_size + page_size - 1) / page_size * page_size;
+
+    std::vector<uint8_t *> pool;
+    size_t pool_buffer_size = buffer_size;
+    if (mode == prefault_mode::pool) {
+        if (huge_pages) {
+            pool_buffer_size = (buffer_size + huge_page_size - 1) / huge_page_size * huge_page_size;
+        }
+        for (uint32_t b = 0; b < pool_buffers; b++) {
+            uint8_t *buffer = huge_pages ? map_buffer(pool_buffer_size, MAP_POPULATE | MAP_HUGETLB) : nullptr;
+            if (!buffer) {
+                buffer = map_buffer(pool_buffer_size, MAP_POPULATE);
+            }
+            if (!buffer) {
+                std::cout << "Mapping a pooled buffer failed." << std::endl;
+                return 1;
+            }
+            pool.push_back(buffer);
+        }
+    }
+
+    const uint64_t faults_start = minor_faults();
+    for (uint32_t c = 0; c < compressed.size(); c++) {
+        const auto start = std::chrono::steady_clock::now();
+        uint8_t *output = nullptr;
+        switch (mode) {
+            case prefault_mode::none:
+                output = map_buffer(buffer_size, 0);
+                break;
+            case prefault_mode::touch:
+                output = map_buffer(buffer_size, 0);
+                for (size_t offset = 0; output && offset < buffer_size; offset += page_size) {
+                    output[offset] = 0;
+                }
+                break;
+            case prefault_mode::populate:
+                output = map_buffer(buffer_size, MAP_POPULATE);
+                break;
+            case prefault_mode::pool:
+                output = pool[c % pool_buffers];
+                break;
+        }
+        if (!output) {
+            std::cout << "Mapping an output buffer failed." << std::endl;
+            return 1;
+        }
+        const auto prepared = std::chrono::steady_clock::now();
+
+        job->op = qpl_op_decompress;
+        job->next_in_ptr = compressed[c].data();
+        job->next_out_ptr = output;
+        job->available_in = static_cast<uint32_t>(compressed[c].size());
+        job->available_out = static_cast<uint32_t>(buffer_size);
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+        qpl_status status = qpl_execute_job(job);
+        const auto decompressed = std::chrono::steady_clock::now();
+        if (status != QPL_STS_OK || job->total_out != chunk_sizes[c]) {
+            std::cout << "An error " << status << " acquired during decompression of chunk " << c << "." << std::endl;
+            return 1;
+        }
+
+        if (mode != prefault_mode::pool) {
+            munmap(output, buffer_size);
+        }
+        const auto released = std::chrono::steady_clock::now();
+
+        result.calls++;
+        result.prepare_ns += elapsed_ns(start, prepared);
+        result.decompress_ns += elapsed_ns(prepared, decompressed);
+        result.release_ns += elapsed_ns(decompressed, released);
+        result.bytes += chunk_sizes[c];
+    }
+    result.faults = minor_faults() - faults_start;
+
+    for (uint8_t *buffer : pool) {
+        munmap(buffer, pool_buffer_size);
+    }
+    return 0;
+}
+
+int compress_file(std::vector<uint8_t>& data, uint32_t chunk_size, std::vector<std::vector<uint8_t>>& compressed, std::vector<uint32_t>& chunk_sizes)
+{
+    uint32_t job_size = 0;
+    qpl_status status = qpl_get_job_size(qpl_path_software, &job_size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(job_size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    status = qpl_init_job(qpl_path_software, job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+        return 1;
+    }
+    for (std::size_t offset = 0; offset < data.size(); offset += chunk_size) {
+        const uint32_t length = static_cast<uint32_t>(std::min<std::size_t>(chunk_size, data.size() - offset));
+        std::vector<uint8_t> dest(length + length / 2 + 1024);
+        job->op = qpl_op_compress;
+        job->level = qpl_default_level;
+        job->next_in_ptr = data.data() + offset;
+        job->next_out_ptr = dest.data();
+        job->available_in = length;
+        job->available_out = static_cast<uint32_t>(dest.size());
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+        status = qpl_execute_job(job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during compression." << std::endl;
+            qpl_fini_job(job);
+            return 1;
+        }
+        dest.resize(job->total_out);
+        compressed.push_back(std::move(dest));
+        chunk_sizes.push_back(length);
+    }
+    qpl_fini_job(job);
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_software;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+    const std::string file_path = argv[2];
+    const uint32_t chunk_size = (argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 1024) * 1024;
+    const std::string mode_option = argc > 4 ? argv[4] : "all";
+    const bool huge_pages = argc > 5 && atoi(argv[5]) == 1;
+    if (chunk_size == 0 || chunk_size > 2097152) {
+        std::cout << "Chunk size must be 1 to 2048 KB." << std::endl;
+        return 1;
+    }
+    std::vector<prefault_mode> modes;
+    for (int m = 0; m < 4; m++) {
+        if (mode_option == "all" || mode_option == mode_names[m]) {
+            modes.push_back(static_cast<prefault_mode>(m));
+        }
+    }
+    if (modes.empty()) {
+        std::cout << "Unknown mode " << mode_option << ". Use none, touch, populate, pool or all." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<uint8_t>> compressed;
+    std::vector<uint32_t> chunk_sizes;
+    if (compress_file(data, chunk_size, compressed, chunk_sizes) != 0) {
+        return 1;
+    }
+
+    uint32_t job_size = 0;
+    qpl_status status = qpl_get_job_size(execution_path, &job_size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(job_size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    status = qpl_init_job(execution_path, job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+        return 1;
+    }
+    std::cout << "Source file = " << file_path << ", " << compressed.size() << " chunks of " << chunk_size << " bytes, "
+              << (huge_pages ? "huge" : "normal") << " pages for the pool" << std::endl;
+
+    std::cout << "mode, prepare (ns/call), decompress (ns/call), release (ns/call), total (ns/call), minor faults/call, throughput (GB/s)" << std::endl;
+    for (prefault_mode mode : modes) {
+        mode_result result;
+        if (decompress_chunks(job, mode, huge_pages, compressed, chunk_sizes, result) != 0) {
+            qpl_fini_job(job);
+            return 1;
+        }
+        const double calls = static_cast<double>(result.calls);
+        const uint64_t total_ns = result.prepare_ns + result.decompress_ns + result.release_ns;
+        std::cout << mode_names[static_cast<int>(mode)] << ", " << result.prepare_ns / calls << ", " << result.decompress_ns / calls
+                  << ", " << result.release_ns / calls << ", " << total_ns / calls << ", " << result.faults / calls
+                  << ", " << static_cast<double>(result.bytes) / static_cast<double>(total_ns) << std::endl;
+    }
+    qpl_fini_job(job);
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_PREFAULT_BUFFER_EXAMPLE] */
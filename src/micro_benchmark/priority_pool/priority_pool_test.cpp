@@ -0,0 +1,255 @@
+//* [QPL_LOW_LEVEL_PRIORITY_POOL_EXAMPLE] */
+
+#include <Compression/CompressionCodecDeflateQpl.h>
+#include "harness_blocks.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Shows how the priority classes of the ClickHouse DEFLATE_QPL job pool (src/end_to_end/clickhouse) keep foreground
+ * reads on the accelerator while background merges load it. clickhouse.cpp is built as in ../codec_harness.
+ * Foreground threads decompress small blocks synchronously, like SELECT reads of granules. Background threads run inside
+ * DeflateQplJobHWPool::PriorityScope(Priority::Background) and compress and decompress large blocks, like merges.
+ * Two phases of the same length are measured:
+ *   foreground alone    : the foreground threads only
+ *   foreground + merges : the foreground threads while the background threads run
+ * For each phase it reports the foreground latency (p50, p99, p99.9), the throughput of both classes and the share of
+ * their jobs that ran on the hardware instead of the software fallback.
+ * Run it once with the defaults and once with DEFLATE_QPL_PRIORITY_CLASSES=0, which puts every thread in one class as
+ * the pool did before, to see what the reserved capacity and the foreground share buy.
+ *
+ * Usage: priority_pool_test <file> [foreground_threads] [background_threads] [seconds] [foreground_kb] [background_kb]
+ * foreground_threads defaults to 4, background_threads to 8, seconds per phase to 5, block sizes to 64 and 1024 KiB.
+ *
+ * @warning ---! Important !---
+ * Only the hardware path has a job pool. Without IAA devices build it with `./build.sh stub`.
+ *
+ */
+
+namespace DB::ErrorCodes
+{
+    extern const int CANNOT_COMPRESS = 1;
+    extern const int CANNOT_DECOMPRESS = 2;
+}
+
+using DB::CompressionCodecDeflateQpl;
+using DB::DeflateQplJobHWPool;
+
+struct class_result {
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+    std::vector<uint32_t> latencies_ns;
+    bool failed = false;
+};
+
+// A SELECT thread: decompresses the shared blocks one by one until the phase ends
+void run_foreground(const std::vector<block>& blocks, uint32_t thread_index, const std::atomic<bool>& stop, class_result& result)
+{
+    try {
+        CompressionCodecDeflateQpl codec;
+        std::vector<char> output(blocks.front().size);
+        for (std::size_t i = thread_index; !stop.load(std::memory_order_relaxed); i++) {
+            const block& b = blocks[i % blocks.size()];
+            const auto start = std::chrono::steady_clock::now();
+            codec.decompress(b.compressed.data(), b.compressed_size, output.data());
+            result.latencies_ns.push_back(static_cast<uint32_t>(elapsed_ns(start, std::chrono::steady_clock::now())));
+            if (std::memcmp(output.data(), b.source, b.size) != 0) {
+                std::cout << "A foreground block does not match its source after decompression." << std::endl;
+                result.failed = true;
+                return;
+            }
+            result.blocks++;
+            result.bytes += b.size;
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        result.failed = true;
+    }
+}
+
+// A merge thread: compresses and decompresses large blocks in the background class until the phase ends
+void run_background(const std::vector<block>& blocks, uint32_t thread_index, const std::atomic<bool>& stop, class_result& result)
+{
+    DeflateQplJobHWPool::PriorityScope scope(DeflateQplJobHWPool::Priority::Background);
+    try {
+        CompressionCodecDeflateQpl codec;
+        std::vector<char> compressed(codec.getCompressedReserveSize(blocks.front().size));
+        std::vector<char> output(blocks.front().size);
+        for (std::size_t i = thread_index; !stop.load(std::memory_order_relaxed); i++) {
+            const block& b = blocks[i % blocks.size()];
+            const uint32_t compressed_size = codec.compress(b.source, b.size, compressed.data());
+            codec.decompress(compressed.data(), compressed_size, output.data());
+            if (std::memcmp(output.data(), b.source, b.size) != 0) {
+                std::cout << "A background block does not match its source after decompression." << std::endl;
+                result.failed = true;
+                return;
+            }
+            result.blocks++;
+            result.bytes += 2 * static_cast<uint64_t>(b.size);
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        result.failed = true;
+    }
+}
+
+// Share of the class's acquires in the phase that got a hardware job, "-" when it had none
+std::string hardware_share(const DeflateQplJobHWPool::ClassUtilization& before, const DeflateQplJobHWPool::ClassUtilization& after)
+{
+    const uint64_t acquired = after.acquired - before.acquired;
+    const uint64_t fallbacks = after.fallbacks - before.fallbacks;
+    if (acquired + fallbacks == 0) {
+        return "-";
+    }
+    return std::to_string(100.0 * static_cast<double>(acquired) / static_cast<double>(acquired + fallbacks));
+}
+
+int run_phase(const char *name, const std::vector<block>& foreground_blocks, const std::vector<block>& background_blocks,
+              uint32_t foreground_threads, uint32_t background_threads, uint32_t seconds)
+{
+    auto& pool = DeflateQplJobHWPool::instance();
+    const auto classes_before = pool.getClassUtilization();
+    std::atomic<bool> stop{false};
+    std::vector<class_result> foreground(foreground_threads);
+    std::vector<class_result> background(background_threads);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < background_threads; t++) {
+        workers.emplace_back(run_background, std::cref(background_blocks), t, std::cref(stop), std::ref(background[t]));
+    }
+    for (uint32_t t = 0; t < foreground_threads; t++) {
+        workers.emplace_back(run_foreground, std::cref(foreground_blocks), t, std::cref(stop), std::ref(foreground[t]));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& worker : workers) { worker.join(); }
+    const double elapsed = static_cast<double>(elapsed_ns(start, std::chrono::steady_clock::now()));
+    const auto classes_after = pool.getClassUtilization();
+
+    class_result foreground_total;
+    class_result background_total;
+    for (const auto& result : foreground) {
+        foreground_total.failed |= result.failed;
+        foreground_total.blocks += result.blocks;
+        foreground_total.bytes += result.bytes;
+        foreground_total.latencies_ns.insert(foreground_total.latencies_ns.end(), result.latencies_ns.begin(), result.latencies_ns.end());
+    }
+    for (const auto& result : background) {
+        background_total.failed |= result.failed;
+        background_total.bytes += result.bytes;
+    }
+    if (foreground_total.failed || background_total.failed) {
+        return 1;
+    }
+    auto& latencies = foreground_total.latencies_ns;
+    if (latencies.empty()) {
+        std::cout << name << ": no foreground block finished." << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto foreground_class = static_cast<std::size_t>(DeflateQplJobHWPool::Priority::Foreground);
+    const auto background_class = static_cast<std::size_t>(DeflateQplJobHWPool::Priority::Background);
+    std::cout << name << ", " << foreground_total.blocks << ", " << static_cast<double>(foreground_total.bytes) / elapsed * 1000.0
+              << ", " << latencies[latencies.size() / 2] / 1000.0 << ", " << latencies[latencies.size() * 99 / 100] / 1000.0
+              << ", " << latencies[latencies.size() * 999 / 1000] / 1000.0
+              << ", " << hardware_share(classes_before[foreground_class], classes_after[foreground_class]);
+    if (background_threads == 0) {
+        std::cout << ", -, -" << std::endl;
+    } else {
+        std::cout << ", " << static_cast<double>(background_total.bytes) / elapsed * 1000.0
+                  << ", " << hardware_share(classes_before[background_class], classes_after[background_class]) << std::endl;
+    }
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    if (argc < 2) {
+        std::cout << "Usage: priority_pool_test <file> [foreground_threads] [background_threads] [seconds] [foreground_kb] [background_kb]" << std::endl;
+        return 1;
+    }
+    const std::string file_path = argv[1];
+    const uint32_t foreground_threads = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 4;
+    const uint32_t background_threads = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 8;
+    const uint32_t seconds = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 5;
+    const uint32_t foreground_size = (argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 64) * 1024;
+    const uint32_t background_size = (argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 1024) * 1024;
+    if (foreground_threads == 0 || seconds == 0 || foreground_size == 0 || background_size == 0) {
+        std::cout << "Foreground threads, seconds and block sizes must be at least 1." << std::endl;
+        return 1;
+    }
+
+    auto& pool = DeflateQplJobHWPool::instance();
+    if (!pool.isJobPoolReady()) {
+        std::cout << "The hardware job pool is not ready, there is nothing to prioritize." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    // Repeat a small file so that every block is a contiguous slice of it
+    const std::size_t file_size = data.size();
+    while (data.size() < 2 * static_cast<std::size_t>(std::max(foreground_size, background_size))) {
+        data.insert(data.end(), data.begin(), data.begin() + static_cast<std::ptrdiff_t>(file_size));
+    }
+
+    // The foreground blocks are compressed once, reads only decompress them
+    std::vector<block> foreground_blocks = cut_blocks(data, foreground_size, 256, 1);
+    const std::vector<block> background_blocks = cut_blocks(data, background_size, 16, 2);
+    try {
+        CompressionCodecDeflateQpl codec;
+        for (auto& b : foreground_blocks) {
+            b.compressed.resize(codec.getCompressedReserveSize(b.size));
+            b.compressed_size = codec.compress(b.source, b.size, b.compressed.data());
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Codec failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Source file = " << file_path << ", " << foreground_threads << " foreground threads x " << foreground_size
+              << " bytes, " << background_threads << " background threads x " << background_size << " bytes, " << seconds
+              << " s per phase" << std::endl;
+    if (pool.arePriorityClassesEnabled()) {
+        for (const auto& entry : pool.getClassUtilization()) {
+            std::cout << (entry.priority == DeflateQplJobHWPool::Priority::Foreground ? "Foreground" : "Background")
+                      << " class may hold " << entry.limit << " jobs" << std::endl;
+        }
+    } else {
+        std::cout << "Priority classes are disabled, every job counts as foreground" << std::endl;
+    }
+    std::cout << "phase, foreground blocks, foreground MB/s, p50 (us), p99 (us), p99.9 (us), foreground on hardware (%), "
+              << "background MB/s, background on hardware (%)" << std::endl;
+    if (run_phase("foreground alone", foreground_blocks, background_blocks, foreground_threads, 0, seconds) != 0) {
+        return 1;
+    }
+    if (background_threads > 0
+        && run_phase("foreground + merges", foreground_blocks, background_blocks, foreground_threads, background_threads, seconds) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_PRIORITY_POOL_EXAMPLE] */
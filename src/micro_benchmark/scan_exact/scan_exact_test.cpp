@@ -7,6 +7,7 @@
 #include <string>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 
 #include "qpl/qpl.h"
 
@@ -18,6 +19,10 @@
  * If there is no difference where calculations should be done, @ref qpl_path_auto (`Auto Path`) can be used to allow
  * the library to chose the path to execute. The Auto Path usage is not demonstrated by this example.
  *
+ * The optional fifth argument sets the scan output: `nom` (bitmap), `8`, `16` or `32` (indices, the default), or
+ * `adaptive`, which samples each chunk on the CPU and picks the format with the fewest output bytes for its estimated
+ * selectivity (16-bit indices only for chunks of at most 65536 values).
+ *
  * @warning ---! Important !---
  * `Hardware Path` doesn't support all features declared for `Software Path`
  *
@@ -41,6 +46,7 @@ std::size_t chunk_size = 2097152;
 // const std::size_t chunk_size = 1024;
 constexpr const uint32_t input_vector_width = 8;
 constexpr const uint32_t boundary           = 65; //'A'
+constexpr const uint32_t selectivity_sample_rows = 1024;
 
 int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
     // Get path from input argument
@@ -71,15 +77,59 @@ int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_
     return 0;
 }
 
-void job_execution(qpl_job *job_ptr)
+int parse_output_format(const std::string& name, qpl_out_format *format_ptr, bool *adaptive_ptr) {
+    *adaptive_ptr = false;
+    if (name == "nom") { *format_ptr = qpl_ow_nom; }
+    else if (name == "8") { *format_ptr = qpl_ow_8; }
+    else if (name == "16") { *format_ptr = qpl_ow_16; }
+    else if (name == "32") { *format_ptr = qpl_ow_32; }
+    else if (name == "adaptive") { *format_ptr = qpl_ow_nom; *adaptive_ptr = true; }
+    else {
+        std::cout << "Unrecognized output format " << name << ". Use nom, 8, 16, 32 or adaptive." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Output format with the fewest bytes for `matches` hits out of `rows` values: a bitmap costs rows / 8 bytes, an index
+ * list 2 or 4 bytes per hit. 16-bit indices only address chunks of at most 65536 values.
+ */
+qpl_out_format choose_output_format(uint32_t rows, double matches)
+{
+    const double bitmap_bytes = (rows + 7) / 8;
+    if (rows <= 65536 && matches * 2 < bitmap_bytes) { return qpl_ow_16; }
+    if (matches * 4 < bitmap_bytes) { return qpl_ow_32; }
+    return qpl_ow_nom;
+}
+
+// Estimated hits of the scan in a chunk, from a stride sample of selectivity_sample_rows values
+double sample_matches(const uint8_t *values, uint32_t rows)
+{
+    const uint32_t samples = std::min(rows, selectivity_sample_rows);
+    if (samples == 0) { return 0; }
+    const uint32_t stride = rows / samples;
+    uint32_t hits = 0;
+    for (uint32_t j = 0; j < samples; j++) { hits += values[static_cast<std::size_t>(j) * stride] == boundary; }
+    return static_cast<double>(hits) / samples * rows;
+}
+
+const char *format_name(qpl_out_format format)
+{
+    return format == qpl_ow_nom ? "nom" : format == qpl_ow_8 ? "8" : format == qpl_ow_16 ? "16" : "32";
+}
+
+void job_execution(qpl_job *job_ptr, qpl_status *status_ptr)
 {
     qpl_status status = qpl_execute_job(job_ptr);
-    if (status != QPL_STS_OK) {
+    *status_ptr = status;
+    if (status != QPL_STS_OK && status != QPL_STS_DST_IS_SHORT_ERR) {
         std::cout << "An error " << status << " acquired during job execution." << std::endl;
     }
 }
 
-int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size)
+int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qpl_path_t execution_path, uint32_t &iteration, const uint32_t queue_size,
+             qpl_out_format output_format, bool adaptive)
 {
     // Source and output containers
     std::vector<uint8_t> whole_src_vector;
@@ -132,6 +182,13 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
     }
 
     std::chrono::duration<int64_t, std::nano> elapsed_time_ns = std::chrono::nanoseconds::zero();
+    std::chrono::duration<int64_t, std::nano> sample_time_ns = std::chrono::nanoseconds::zero();
+    std::vector<qpl_out_format> job_format(queue_size, output_format);
+    std::vector<qpl_status> job_status(queue_size, QPL_STS_OK);
+    std::vector<std::size_t> job_offset(queue_size, 0);
+    std::size_t output_bytes = 0;
+    uint32_t format_chunks[4] = {0, 0, 0, 0};   // chunks per qpl_out_format
+    uint32_t rescanned_chunks = 0;
     std::size_t src_file_left = src_file_size;
     std::size_t vector_size = 0;
     iteration = 0;
@@ -167,16 +224,28 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
             */
             dest_vector[i].resize(vector_size);
 
+            if (adaptive) {
+                auto sample_start = std::chrono::steady_clock::now();
+                const uint32_t rows = static_cast<uint32_t>(vector_size);
+                job_format[i] = choose_output_format(rows, sample_matches(whole_src_vector.data() + current_idx, rows));
+                sample_time_ns += std::chrono::steady_clock::now() - sample_start;
+            }
+
             // Performing a operation
             job[i]->op                 = qpl_op_scan_eq;
             job[i]->level              = qpl_default_level;
+            job_offset[i]              = current_idx;
             job[i]->next_in_ptr        = whole_src_vector.data() + current_idx;
             job[i]->next_out_ptr       = dest_vector[i].data();
             job[i]->available_in       = static_cast<uint32_t>(vector_size);
             job[i]->available_out      = static_cast<uint32_t>(vector_size);
+            if (adaptive && job_format[i] != qpl_ow_nom) {
+                // An index list gets the room of the bitmap; one that needs more is cheaper as a bitmap anyway
+                job[i]->available_out  = static_cast<uint32_t>((vector_size + 7) / 8);
+            }
             job[i]->src1_bit_width     = input_vector_width;
             job[i]->num_input_elements = static_cast<uint32_t>(vector_size);
-            job[i]->out_bit_width      = qpl_ow_32;
+            job[i]->out_bit_width      = job_format[i];
             job[i]->param_low          = boundary;
 
             current_idx += vector_size;
@@ -191,7 +260,7 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
             std::vector<std::thread *> job_th;
             job_th.resize(enqueue_cnt);
             auto start = std::chrono::steady_clock::now();
-            for (int i = 0; i < enqueue_cnt; ++i) { job_th[i] = new std::thread(job_execution, job[i]); }
+            for (int i = 0; i < enqueue_cnt; ++i) { job_th[i] = new std::thread(job_execution, job[i], &job_status[i]); }
             for (int i = 0; i < enqueue_cnt; ++i) { job_th[i]->join(); }
             auto end = std::chrono::steady_clock::now();
             elapsed_time_ns += end - start;
@@ -206,11 +275,17 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
                 }
             }
             for (int i = 0; i < enqueue_cnt; ++i) {
+                job_status[i] = QPL_STS_OK;
                 if (qpl_check_job(job[i]) == QPL_STS_OK) {
                     // std::cout << i << "th is already done" << std::endl;
                     continue;
                 }
                 status = qpl_wait_job(job[i]);
+                job_status[i] = status;
+                if (status == QPL_STS_DST_IS_SHORT_ERR && adaptive && job_format[i] != qpl_ow_nom) {
+                    // More hits than the sample suggested: the chunk is scanned again as a bitmap below
+                    continue;
+                }
                 if (status != QPL_STS_OK) {
                     std::cout << "An error " << status << " acquired during job waiting." << std::endl;
                     return 1;
@@ -220,6 +295,31 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
             elapsed_time_ns += end - start;
         }
 
+        for (int i = 0; i < enqueue_cnt; ++i) {
+            if (job_status[i] == QPL_STS_DST_IS_SHORT_ERR) {
+                if (!adaptive || job_format[i] == qpl_ow_nom) {
+                    std::cout << "An error " << job_status[i] << " acquired during job execution." << std::endl;
+                    continue;
+                }
+                auto start = std::chrono::steady_clock::now();
+                job_format[i]         = qpl_ow_nom;
+                job[i]->next_in_ptr   = whole_src_vector.data() + job_offset[i];
+                job[i]->available_in  = static_cast<uint32_t>(dest_vector[i].size());
+                job[i]->next_out_ptr  = dest_vector[i].data();
+                job[i]->available_out = static_cast<uint32_t>(dest_vector[i].size());
+                job[i]->out_bit_width = qpl_ow_nom;
+                status = qpl_execute_job(job[i]);
+                elapsed_time_ns += std::chrono::steady_clock::now() - start;
+                if (status != QPL_STS_OK) {
+                    std::cout << "An error " << status << " acquired during job execution." << std::endl;
+                    return 1;
+                }
+                rescanned_chunks++;
+            }
+            output_bytes += job[i]->total_out;
+            format_chunks[job_format[i]]++;
+        }
+
         // for (int i = 0; i < enqueue_cnt; ++i) {
         //     // Opening destination file
         //     std::ofstream dest_file;
@@ -264,6 +364,14 @@ int iaa_scan(std::string src_data_file_path, std::string dest_data_file_path, qp
     std::cout << std::endl;
     std::cout << "Scan was performed successfully." << std::endl;
     std::cout << "Input size      = " << src_file_size << " Bytes" << std::endl;
+    std::cout << "Output size     = " << output_bytes << " Bytes (";
+    for (qpl_out_format format : {qpl_ow_nom, qpl_ow_8, qpl_ow_16, qpl_ow_32}) {
+        if (format_chunks[format] != 0) { std::cout << " " << format_name(format) << ":" << format_chunks[format]; }
+    }
+    std::cout << " chunks)" << std::endl;
+    if (adaptive) {
+        std::cout << "Sample time     = " << sample_time_ns.count() << " ns, rescanned as bitmap = " << rescanned_chunks << " chunks" << std::endl;
+    }
     // if (execution_path == qpl_path_hardware) {
         elapsed_time_sec = static_cast<double>(elapsed_time_ns.count()) / 1000 / 1000 / 1000;
         std::cout << "Elapsed Time = " << elapsed_time_ns.count() << " ns (" << elapsed_time_sec << " s)" << std::endl;
@@ -300,8 +408,14 @@ auto main(int argc, char** argv) -> int {
     std::cout << "Queue Size = " << queue_size << std::endl;
     std::cout << std::endl;
     chunk_size = static_cast<size_t>(atoi(argv[4]));
+    qpl_out_format output_format = qpl_ow_32;
+    bool adaptive = false;
+    if (argc > 5 && parse_output_format(argv[5], &output_format, &adaptive) != 0) {
+        return 1;
+    }
+    std::cout << "Output format = " << (adaptive ? "adaptive" : format_name(output_format)) << std::endl;
     // Scan
-    if(iaa_scan(SRC_DATA_FILE_PATH, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size) != 0) {
+    if(iaa_scan(SRC_DATA_FILE_PATH, DEST_DATA_FILE_PATH, execution_path, iteration, queue_size, output_format, adaptive) != 0) {
         std::cout << "An error acquired during iaa_execution(scan)" << std::endl;
         return 1;
     }
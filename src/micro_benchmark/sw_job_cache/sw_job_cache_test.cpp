@@ -0,0 +1,254 @@
+//* [QPL_LOW_LEVEL_SW_JOB_CACHE_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Measures how the software fallback of the ClickHouse DEFLATE_QPL codec (src/end_to_end/clickhouse) scales when
+ * many threads fall back at once, with three ways to get a software job:
+ *   shared       : one job per codec, shared by all threads and guarded by a mutex. Before, SoftwareCodecDeflateQpl
+ *                  had one job per codec instance, so threads sharing a codec ran their fallbacks one at a time
+ *   per_call     : qpl_init_job and qpl_fini_job around every call
+ *   thread_local : one job per thread, initialized on first use, as SoftwareCodecDeflateQpl does now
+ * A file is compressed in chunks, then for every thread count from 1 to the maximum, doubling, each thread decompresses
+ * (or compresses) all chunks the given number of times. It reports the throughput, the speedup over one thread and how
+ * many jobs were initialized.
+ *
+ * Usage: sw_job_cache_test <file> [chunk_kb] [max_threads] [iterations] [decompress|compress]
+ * chunk_kb defaults to 64, max_threads to the number of CPUs, iterations to 10.
+ *
+ */
+
+const char *scheme_names[] = {"shared", "per_call", "thread_local"};
+enum class job_scheme { shared, per_call, thread_local_job };
+
+// A software job in its own buffer, finalized on destruction
+class software_job {
+public:
+    bool init() {
+        uint32_t job_size = 0;
+        if (qpl_get_job_size(qpl_path_software, &job_size) != QPL_STS_OK) {
+            return false;
+        }
+        buffer_ = std::make_unique<uint8_t[]>(job_size);
+        if (qpl_init_job(qpl_path_software, get()) != QPL_STS_OK) {
+            buffer_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    ~software_job() {
+        if (buffer_) {
+            qpl_fini_job(get());
+        }
+    }
+
+    qpl_job *get() const { return reinterpret_cast<qpl_job *>(buffer_.get()); }
+    explicit operator bool() const { return buffer_ != nullptr; }
+
+private:
+    std::unique_ptr<uint8_t[]> buffer_;
+};
+
+struct workload {
+    std::vector<uint8_t> data;
+    std::vector<std::vector<uint8_t>> compressed;
+    std::vector<uint32_t> chunk_sizes;
+    uint32_t chunk_size = 0;
+    bool compress = false;
+};
+
+std::atomic<uint64_t> initialized_jobs{0};
+
+qpl_status run_job(qpl_job *job, const workload& work, uint32_t c, std::vector<uint8_t>& output)
+{
+    if (work.compress) {
+        job->op = qpl_op_compress;
+        job->level = qpl_default_level;
+        job->next_in_ptr = const_cast<uint8_t *>(work.data.data()) + static_cast<std::size_t>(c) * work.chunk_size;
+        job->available_in = work.chunk_sizes[c];
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+    } else {
+        job->op = qpl_op_decompress;
+        job->next_in_ptr = const_cast<uint8_t *>(work.compressed[c].data());
+        job->available_in = static_cast<uint32_t>(work.compressed[c].size());
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+    }
+    job->next_out_ptr = output.data();
+    job->available_out = static_cast<uint32_t>(output.size());
+    return qpl_execute_job(job);
+}
+
+void run_thread(job_scheme scheme, const workload& work, uint32_t iterations, software_job& shared_job, std::mutex& shared_mutex, bool& failed)
+{
+    std::vector<uint8_t> output(work.chunk_size + work.chunk_size / 2 + 1024);
+    software_job own_job;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t c = 0; c < work.chunk_sizes.size(); c++) {
+            qpl_status status = QPL_STS_OK;
+            switch (scheme) {
+                case job_scheme::shared: {
+                    std::lock_guard<std::mutex> lock(shared_mutex);
+                    status = run_job(shared_job.get(), work, c, output);
+                    break;
+                }
+                case job_scheme::per_call: {
+                    software_job job;
+                    if (!job.init()) {
+                        failed = true;
+                        return;
+                    }
+                    initialized_jobs++;
+                    status = run_job(job.get(), work, c, output);
+                    break;
+                }
+                case job_scheme::thread_local_job: {
+                    if (!own_job) {
+                        if (!own_job.init()) {
+                            failed = true;
+                            return;
+                        }
+                        initialized_jobs++;
+                    }
+                    status = run_job(own_job.get(), work, c, output);
+                    break;
+                }
+            }
+            if (status != QPL_STS_OK) {
+                std::cout << "An error " << status << " acquired during processing of chunk " << c << "." << std::endl;
+                failed = true;
+                return;
+            }
+        }
+    }
+}
+
+int compress_file(workload& work)
+{
+    software_job job;
+    if (!job.init()) {
+        std::cout << "Software job initialization failed." << std::endl;
+        return 1;
+    }
+    for (std::size_t offset = 0; offset < work.data.size(); offset += work.chunk_size) {
+        const uint32_t length = static_cast<uint32_t>(std::min<std::size_t>(work.chunk_size, work.data.size() - offset));
+        std::vector<uint8_t> dest(length + length / 2 + 1024);
+        qpl_job *job_ptr = job.get();
+        job_ptr->op = qpl_op_compress;
+        job_ptr->level = qpl_default_level;
+        job_ptr->next_in_ptr = work.data.data() + offset;
+        job_ptr->next_out_ptr = dest.data();
+        job_ptr->available_in = length;
+        job_ptr->available_out = static_cast<uint32_t>(dest.size());
+        job_ptr->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+        qpl_status status = qpl_execute_job(job_ptr);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during compression." << std::endl;
+            return 1;
+        }
+        dest.resize(job_ptr->total_out);
+        work.compressed.push_back(std::move(dest));
+        work.chunk_sizes.push_back(length);
+    }
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    if (argc < 2) {
+        std::cout << "Usage: sw_job_cache_test <file> [chunk_kb] [max_threads] [iterations] [decompress|compress]" << std::endl;
+        return 1;
+    }
+    const std::string file_path = argv[1];
+    workload work;
+    work.chunk_size = (argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 64) * 1024;
+    const uint32_t max_threads = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t iterations = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 10;
+    const std::string operation = argc > 5 ? argv[5] : "decompress";
+    if (work.chunk_size == 0 || max_threads == 0 || iterations == 0 || (operation != "decompress" && operation != "compress")) {
+        std::cout << "Chunk size, threads and iterations must be at least 1, the operation decompress or compress." << std::endl;
+        return 1;
+    }
+    work.compress = operation == "compress";
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    work.data.assign((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (work.data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    if (compress_file(work) != 0) {
+        return 1;
+    }
+    std::cout << "Source file = " << file_path << ", " << work.chunk_sizes.size() << " chunks of " << work.chunk_size << " bytes, "
+              << operation << ", " << iterations << " iterations per thread" << std::endl;
+
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "scheme, threads, throughput (MB/s), speedup over 1 thread, jobs initialized" << std::endl;
+    for (int s = 0; s < 3; s++) {
+        const job_scheme scheme = static_cast<job_scheme>(s);
+        double single_thread_throughput = 0;
+        for (uint32_t threads : thread_counts) {
+            software_job shared_job;
+            std::mutex shared_mutex;
+            if (scheme == job_scheme::shared) {
+                if (!shared_job.init()) {
+                    std::cout << "Software job initialization failed." << std::endl;
+                    return 1;
+                }
+                initialized_jobs = 1;
+            } else {
+                initialized_jobs = 0;
+            }
+
+            std::vector<char> failed(threads, 0);
+            std::vector<std::thread> workers;
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t t = 0; t < threads; t++) {
+                workers.emplace_back([&, t] {
+                    bool thread_failed = false;
+                    run_thread(scheme, work, iterations, shared_job, shared_mutex, thread_failed);
+                    failed[t] = thread_failed;
+                });
+            }
+            for (auto& worker : workers) { worker.join(); }
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+                return 1;
+            }
+
+            const double bytes = static_cast<double>(work.data.size()) * iterations * threads;
+            const double throughput = bytes / static_cast<double>(elapsed) * 1000.0;
+            if (threads == 1) {
+                single_thread_throughput = throughput;
+            }
+            std::cout << scheme_names[s] << ", " << threads << ", " << throughput << ", " << throughput / single_thread_throughput
+                      << ", " << initialized_jobs << std::endl;
+        }
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_SW_JOB_CACHE_EXAMPLE] */
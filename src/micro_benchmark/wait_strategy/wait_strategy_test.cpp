@@ -0,0 +1,310 @@
+//* [QPL_LOW_LEVEL_WAIT_STRATEGY_EXAMPLE] */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <ctime>
+
+#include <immintrin.h>
+#include <x86intrin.h>
+
+#include "qpl/qpl.h"
+
+/**
+ * @brief Compares the ways a thread can wait for a submitted IAA job, as DeflateQplJobWaiter in the ClickHouse
+ * DEFLATE_QPL codec (src/end_to_end/clickhouse) does. A file is compressed in chunks, then every chunk is decompressed
+ * with submit + wait, as doDecompressDataSynchronous does, once per strategy:
+ *   spin     : qpl_check_job in a PAUSE loop
+ *   tpause   : TPAUSE till the job is expected to be finished (learned per input byte), then 1000-cycle windows
+ *   yield    : yield between checks
+ *   blocking : sleep till the job is expected to be finished, then short sleeps
+ *   qpl_wait : qpl_wait_job, which UMWAITs on the completion record
+ * Next to the job latency it reports what the waiting costs the core: thread CPU time and TSC cycles per job, and the
+ * share of the latency the waiting thread was on the CPU. A lower share leaves more of the core to other work.
+ *
+ * Usage: wait_strategy_test <hardware_path|software_path> <file> [chunk_kb] [threads] [strategy|all]
+ * chunk_kb defaults to 64, threads (each waiting for its own jobs) to 1, strategy to all.
+ *
+ * @warning ---! Important !---
+ * `Hardware Path` doesn't support all features declared for `Software Path`
+ * On the software path a job is finished when qpl_submit_job returns, so only the hardware path tells strategies apart.
+ * TPAUSE needs WAITPKG support (Sapphire Rapids and later).
+ *
+ */
+
+const char *strategy_names[] = {"spin", "tpause", "yield", "blocking", "qpl_wait"};
+enum class wait_strategy { spin, tpause, yield, blocking, qpl_wait };
+const uint64_t short_window_cycles = 1000;
+
+int parse_execution_path(int argc, char **argv, qpl_path_t *path_ptr, int extra_arg = 0) {
+    // Get path from input argument
+    if (extra_arg == 0) {
+        if (argc < 2) {
+            std::cout << "Missing the execution path as the first parameter. Use either hardware_path or software_path." << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc < 3) {
+            std::cout << "Usage: wait_strategy_test <hardware_path|software_path> <file> [chunk_kb] [threads] [strategy|all]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string path = argv[1];
+    if (path == "hardware_path") {
+        *path_ptr = qpl_path_hardware;
+        std::cout << "The test will be run on the hardware path." << std::endl;
+    } else if (path == "software_path") {
+        *path_ptr = qpl_path_software;
+        std::cout << "The test will be run on the software path." << std::endl;
+    } else {
+        std::cout << "Unrecognized value for parameter. Use hardware_path or software_path." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+uint64_t thread_cpu_ns()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+double measure_tsc_per_ns()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t start_cycles = __rdtsc();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10)) { _mm_pause(); }
+    const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(__rdtsc() - start_cycles) / static_cast<double>(elapsed_ns);
+}
+
+// Same algorithm as DeflateQplJobWaiter::wait in clickhouse.cpp, with a per-thread duration estimate
+class job_waiter {
+public:
+    job_waiter(wait_strategy strategy, double tsc_per_ns) : strategy_(strategy), tsc_per_ns_(tsc_per_ns) {}
+
+    qpl_status wait(qpl_job *job_ptr, uint32_t bytes, uint64_t& polls) {
+        const uint64_t start = __rdtsc();
+        qpl_status status = QPL_STS_BEING_PROCESSED;
+        polls = 1;
+        if (strategy_ == wait_strategy::qpl_wait) {
+            status = qpl_wait_job(job_ptr);
+        } else {
+            // The first pause ends at 3/4 of the expected duration, so a shorter job still pulls the average down
+            uint64_t window = static_cast<uint64_t>(bytes) * cycles_per_kb_ / 1024 * 3 / 4;
+            while ((status = qpl_check_job(job_ptr)) == QPL_STS_BEING_PROCESSED) {
+                const uint64_t elapsed = __rdtsc() - start;
+                pause_for(window > elapsed + short_window_cycles ? window - elapsed : short_window_cycles);
+                window = 0;
+                polls++;
+            }
+        }
+        if (status == QPL_STS_OK && bytes >= 1024) {
+            const uint64_t observed = (__rdtsc() - start) * 1024 / bytes;
+            cycles_per_kb_ = cycles_per_kb_ ? (cycles_per_kb_ * 7 + observed) / 8 : observed;
+        }
+        return status;
+    }
+
+private:
+    void pause_for(uint64_t cycles) const {
+        switch (strategy_) {
+            case wait_strategy::spin: _mm_pause(); break;
+            case wait_strategy::tpause: _tpause(1, __rdtsc() + cycles); break;
+            case wait_strategy::yield: std::this_thread::yield(); break;
+            case wait_strategy::blocking: std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<uint64_t>(static_cast<double>(cycles) / tsc_per_ns_))); break;
+            case wait_strategy::qpl_wait: break;
+        }
+    }
+
+    wait_strategy strategy_;
+    double tsc_per_ns_;
+    uint64_t cycles_per_kb_ = 0;
+};
+
+struct thread_result {
+    uint64_t jobs = 0;
+    uint64_t latency_ns = 0;
+    uint64_t wait_cycles = 0;
+    uint64_t cpu_ns = 0;
+    uint64_t polls = 0;
+    std::vector<uint32_t> latencies;
+    bool failed = false;
+};
+
+// Decompresses chunks first, first + threads, ... with one job, waiting with the strategy after every submit
+void decompress_chunks(qpl_path_t execution_path, wait_strategy strategy, double tsc_per_ns, uint32_t first, uint32_t threads,
+                       std::vector<std::vector<uint8_t>>& compressed, std::vector<uint32_t>& chunk_sizes, thread_result& result)
+{
+    uint32_t job_size = 0;
+    if (qpl_get_job_size(execution_path, &job_size) != QPL_STS_OK) {
+        result.failed = true;
+        return;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(job_size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    if (qpl_init_job(execution_path, job) != QPL_STS_OK) {
+        result.failed = true;
+        return;
+    }
+    std::vector<uint8_t> output(*std::max_element(chunk_sizes.begin(), chunk_sizes.end()));
+    job_waiter waiter(strategy, tsc_per_ns);
+
+    const uint64_t cpu_start = thread_cpu_ns();
+    for (uint32_t c = first; c < compressed.size(); c += threads) {
+        job->op = qpl_op_decompress;
+        job->next_in_ptr = compressed[c].data();
+        job->next_out_ptr = output.data();
+        job->available_in = static_cast<uint32_t>(compressed[c].size());
+        job->available_out = static_cast<uint32_t>(output.size());
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_LAST;
+
+        const auto submit = std::chrono::steady_clock::now();
+        qpl_status status = qpl_submit_job(job);
+        const uint64_t wait_start = __rdtsc();
+        uint64_t polls = 0;
+        if (status == QPL_STS_OK) {
+            status = waiter.wait(job, job->available_in, polls);
+        }
+        const uint64_t wait_end = __rdtsc();
+        const auto done = std::chrono::steady_clock::now();
+        if (status != QPL_STS_OK || job->total_out != chunk_sizes[c]) {
+            std::cout << "An error " << status << " acquired during decompression of chunk " << c << "." << std::endl;
+            result.failed = true;
+            break;
+        }
+        const uint64_t latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - submit).count());
+        result.jobs++;
+        result.latency_ns += latency;
+        result.latencies.push_back(static_cast<uint32_t>(latency));
+        result.wait_cycles += wait_end - wait_start;
+        result.polls += polls;
+    }
+    result.cpu_ns = thread_cpu_ns() - cpu_start;
+    qpl_fini_job(job);
+}
+
+int compress_file(std::vector<uint8_t>& data, uint32_t chunk_size, std::vector<std::vector<uint8_t>>& compressed, std::vector<uint32_t>& chunk_sizes)
+{
+    uint32_t job_size = 0;
+    qpl_status status = qpl_get_job_size(qpl_path_software, &job_size);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job size getting." << std::endl;
+        return 1;
+    }
+    std::unique_ptr<uint8_t[]> job_buffer = std::make_unique<uint8_t[]>(job_size);
+    qpl_job *job = reinterpret_cast<qpl_job *>(job_buffer.get());
+    status = qpl_init_job(qpl_path_software, job);
+    if (status != QPL_STS_OK) {
+        std::cout << "An error " << status << " acquired during job initializing." << std::endl;
+        return 1;
+    }
+    for (std::size_t offset = 0; offset < data.size(); offset += chunk_size) {
+        const uint32_t length = static_cast<uint32_t>(std::min<std::size_t>(chunk_size, data.size() - offset));
+        std::vector<uint8_t> dest(length + length / 2 + 1024);
+        job->op = qpl_op_compress;
+        job->level = qpl_default_level;
+        job->next_in_ptr = data.data() + offset;
+        job->next_out_ptr = dest.data();
+        job->available_in = length;
+        job->available_out = static_cast<uint32_t>(dest.size());
+        job->flags = QPL_FLAG_FIRST | QPL_FLAG_DYNAMIC_HUFFMAN | QPL_FLAG_LAST | QPL_FLAG_OMIT_VERIFY;
+        status = qpl_execute_job(job);
+        if (status != QPL_STS_OK) {
+            std::cout << "An error " << status << " acquired during compression." << std::endl;
+            qpl_fini_job(job);
+            return 1;
+        }
+        dest.resize(job->total_out);
+        compressed.push_back(std::move(dest));
+        chunk_sizes.push_back(length);
+    }
+    qpl_fini_job(job);
+    return 0;
+}
+
+auto main(int argc, char** argv) -> int {
+    std::cout << std::endl;
+    std::cout << "Intel(R) Query Processing Library version is " << qpl_get_library_version() << ".\n";
+
+    qpl_path_t execution_path = qpl_path_software;
+    if (parse_execution_path(argc, argv, &execution_path, 1) != 0) {
+        return 1;
+    }
+    const std::string file_path = argv[2];
+    const uint32_t chunk_size = (argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 64) * 1024;
+    const uint32_t threads = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 1;
+    const std::string strategy_option = argc > 5 ? argv[5] : "all";
+    if (chunk_size == 0 || chunk_size > 2097152 || threads == 0) {
+        std::cout << "Chunk size must be 1 to 2048 KB and threads at least 1." << std::endl;
+        return 1;
+    }
+    std::vector<wait_strategy> strategies;
+    for (int s = 0; s < 5; s++) {
+        if (strategy_option == "all" || strategy_option == strategy_names[s]) {
+            strategies.push_back(static_cast<wait_strategy>(s));
+        }
+    }
+    if (strategies.empty()) {
+        std::cout << "Unknown strategy " << strategy_option << ". Use spin, tpause, yield, blocking, qpl_wait or all." << std::endl;
+        return 1;
+    }
+
+    std::ifstream src_file(file_path, std::ifstream::in | std::ifstream::binary);
+    if (!src_file) {
+        std::cout << "File not found : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(src_file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        std::cout << "File is empty : " << file_path << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<uint8_t>> compressed;
+    std::vector<uint32_t> chunk_sizes;
+    if (compress_file(data, chunk_size, compressed, chunk_sizes) != 0) {
+        return 1;
+    }
+    const double tsc_per_ns = measure_tsc_per_ns();
+    std::cout << "Source file = " << file_path << ", " << compressed.size() << " chunks of " << chunk_size << " bytes, "
+              << threads << " waiting threads, " << tsc_per_ns << " TSC cycles per ns" << std::endl;
+
+    std::cout << "strategy, avg latency (ns), p99 latency (ns), thread CPU (ns/job), wait (TSC cycles/job), CPU share of latency (%), polls/job" << std::endl;
+    for (wait_strategy strategy : strategies) {
+        std::vector<thread_result> results(threads);
+        std::vector<std::thread> workers;
+        for (uint32_t t = 0; t < threads; t++) {
+            workers.emplace_back(decompress_chunks, execution_path, strategy, tsc_per_ns, t, threads, std::ref(compressed), std::ref(chunk_sizes), std::ref(results[t]));
+        }
+        for (auto& worker : workers) { worker.join(); }
+
+        thread_result total;
+        for (auto& result : results) {
+            if (result.failed) {
+                return 1;
+            }
+            total.jobs += result.jobs;
+            total.latency_ns += result.latency_ns;
+            total.wait_cycles += result.wait_cycles;
+            total.cpu_ns += result.cpu_ns;
+            total.polls += result.polls;
+            total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+        }
+        std::sort(total.latencies.begin(), total.latencies.end());
+        const double jobs = static_cast<double>(total.jobs);
+        std::cout << strategy_names[static_cast<int>(strategy)] << ", " << total.latency_ns / jobs << ", " << total.latencies[total.latencies.size() * 99 / 100]
+                  << ", " << total.cpu_ns / jobs << ", " << total.wait_cycles / jobs << ", " << 100.0 * total.cpu_ns / total.latency_ns
+                  << ", " << total.polls / jobs << std::endl;
+    }
+    return 0;
+}
+
+//* [QPL_LOW_LEVEL_WAIT_STRATEGY_EXAMPLE] */